@@ -0,0 +1,69 @@
+
+// AntihuffmanBody.c written with the C++ front end. Both
+// assemble to the same code, which examples/bench/cpp.sh
+// checks.
+
+#include "gbafe.h"
+#include "thumblib3.hpp"
+
+using namespace thumblib;
+
+extern "C" {
+
+extern char* gCurrentTextString;
+char* String_GetFromIndexExt(int index, char* buffer);
+extern void (*gpARM_HuffmanTextDecomp)(const char *, char *);
+extern void BXR2();
+
+enum {
+  TEXT_END = 0x00,
+};
+
+THUMBLIB_FUNC char* GetStringFromIndex_Replacement(int index) {
+
+  ldr_pool<&gCurrentTextString>(r1);
+  B_ABS(String_GetFromIndexExt);
+
+  LTORG();
+
+}
+
+THUMBLIB_FUNC void AntihuffmanCompressed(const char* source, char* dest) {
+
+  push(lr);
+
+  ldr_pool<&gpARM_HuffmanTextDecomp>(r2);
+  ldr(r2, r2);
+  BL(BXR2);
+  pop(pc);
+
+  LTORG();
+
+}
+
+THUMBLIB_FUNC void AntihuffmanUncompressed(const char* source, char* dest) {
+
+  // r0 is source, r1 is dest
+  constexpr auto theBit = r3;
+  constexpr auto current = r2;
+
+  mov<(1 << (8 - 1))>(theBit);
+  lsl<((sizeof(source) - 1) * 8)>(theBit);
+  sub(r0, theBit);
+
+  _AHLoop:;
+
+    ldrb(current, r0);
+    strb(current, r1);
+
+    add<sizeof(char)>(r0);
+    add<sizeof(char)>(r1);
+
+    cmp<TEXT_END>(current);
+    BNE(_AHLoop);
+
+  BX_LR();
+
+}
+
+} // extern "C"
@@ -0,0 +1,53 @@
+
+#define THUMBLIB_VOLATILE
+
+#include "gbafe.h"
+#include "thumblib3.h"
+
+extern const char* const gMsgStringTable[];
+
+/* ANTIHUFFMAN_DECODE(Source, Dest, Flag)
+ *
+ * The pointer test of AntihuffmanPointerTester.c as a
+ * fragment. Decodes the string at `Source` into `Dest`,
+ * copying it as is when the top bit of its pointer is set
+ * and calling the game's Huffman decoder otherwise. `Source`
+ * and `Dest` are in r0 and r1, `Flag` is r2 and is clobbered,
+ * along with the other registers the decoders clobber. The
+ * function using it must save lr.
+ */
+#define ANTIHUFFMAN_DECODE(Source, Dest, Flag)          \
+  THUMBLIB_FRAGMENT(ANTIHUFFMAN_DECODE,                 \
+    ((Source, r0), (Dest, r1), (Flag, r2)),             \
+    __label__ _AHCompressed, _AHDone;                   \
+    LSR_I(Flag, (int)Source, (sizeof(Source) * 8) - 1); \
+    BEQ(_AHCompressed);                                 \
+      BL(AntihuffmanUncompressed);                      \
+      B(_AHDone);                                       \
+    _AHCompressed:;                                     \
+      BL(AntihuffmanCompressed);                        \
+    _AHDone:;                                           \
+  )
+
+// Decodes text `index` into `dest`, with the pointer test
+// inline rather than a `BL` to AntihuffmanPointerTester
+THUMBLIB_FUNC void AntihuffmanDecodeIndex(int index, char* dest) {
+
+  register const char* source asm("r0");
+  register char* buffer asm("r1") = dest;
+  register const char* const* table asm("r2");
+  register bool isUncompressed asm("r2");
+
+  PUSH_LR();
+
+  LDR_POOL(table, gMsgStringTable);
+  LSL_I(source, index, 2);
+  LDR(source, table, source);
+
+  ANTIHUFFMAN_DECODE(source, buffer, isUncompressed);
+
+  POP_PC();
+
+  LTORG();
+
+}
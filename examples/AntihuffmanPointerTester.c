@@ -24,4 +24,7 @@ THUMBLIB_FUNC void AntihuffmanPointerTester(const char* source, char* dest) {
   _AHReturn:;
   POP_PC();
 
+  // The space up to the ASSERT in Antihuffman.event
+  THUMBLIB_SIZE_LIMIT(AntihuffmanPointerTester, 0x2BB8 - 0x2BA4);
+
 }
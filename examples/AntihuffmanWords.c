@@ -0,0 +1,102 @@
+
+#define THUMBLIB_VOLATILE
+
+#include "gbafe.h"
+#include "thumblib3.h"
+
+void AntihuffmanCompressed(const char* source, char* dest);
+
+enum {
+  TEXT_END = 0x00,
+};
+
+/* Word-at-a-time versions of the routines in
+ * AntihuffmanBody.c and AntihuffmanPointerTester.c.
+ *
+ * Text lives in ROM, where every `ldrb` pays a full
+ * nonsequential access. Once the source is word aligned,
+ * these read 4 characters per `ldmia` and store them one
+ * byte at a time, since the destination may have any
+ * alignment relative to the source.
+ *
+ * See examples/bench for the benchmark comparing them.
+ */
+
+THUMBLIB_FUNC void AntihuffmanUncompressedWords(const char* source, char* dest) {
+
+  register int word asm("r2");
+  register int scratch asm("r3");
+
+  MOV_I(scratch, (1 << (8 - 1)));
+  LSL_I(scratch, ((sizeof(source) - 1) * 8));
+  SUB_R(source, scratch);
+
+  // Copy single characters until the source is word aligned
+
+  _AHHead:;
+
+    LSL_I(scratch, (int)source, 30);
+    BEQ(_AHWords);
+
+    LDRB(word, source);
+    STRB(word, dest);
+
+    ADD_I(source, sizeof(char));
+    ADD_I(dest, sizeof(char));
+
+    CMP_I(word, TEXT_END);
+    BNE(_AHHead);
+
+  BX_LR();
+
+  // Then 4 characters per load, stopping after the
+  // terminator has been stored
+
+  _AHWords:;
+
+    LDMIA(source, word);
+
+    STRB_I(word, dest, 0);
+    LSL_I(scratch, word, 24);
+    BEQ(_AHReturn);
+
+    LSR_I(word, 8);
+    STRB_I(word, dest, 1);
+    LSL_I(scratch, word, 24);
+    BEQ(_AHReturn);
+
+    LSR_I(word, 8);
+    STRB_I(word, dest, 2);
+    LSL_I(scratch, word, 24);
+    BEQ(_AHReturn);
+
+    LSR_I(word, 8);
+    STRB_I(word, dest, 3);
+
+    ADD_I(dest, 4 * sizeof(char));
+
+    CMP_I(word, TEXT_END);
+    BNE(_AHWords);
+
+  _AHReturn:;
+  BX_LR();
+
+}
+
+// Tail-branches into the decoders rather than calling
+// them, which saves the push and pop of lr.
+THUMBLIB_FUNC void AntihuffmanPointerTesterWords(const char* source, char* dest) {
+
+  register bool isUncompressed asm("r2");
+
+  const int uppermostBitIndex = (sizeof(source) * 8) - 1;
+
+  LSR_I(isUncompressed, (int)source, uppermostBitIndex);
+  BEQ(_AHCompressed);
+
+    B_ABS(AntihuffmanUncompressedWords);
+
+  _AHCompressed:;
+    B_ABS(AntihuffmanCompressed);
+
+}
@@ -0,0 +1,184 @@
+#include "gbafe.h"
+#include "thumblib3.h"
+
+/* Table-driven replacement for the game's Huffman text
+ * decoder, the ARM routine `gpARM_HuffmanTextDecomp` points
+ * to and AntihuffmanCompressed in AntihuffmanBody.c calls.
+ *
+ * The game's decoder walks the Huffman tree one bit at a
+ * time. HuffmanTableDecomp looks up `HUFFMAN_TABLE_BITS` bits
+ * at once in a table built from the same tree, which yields
+ * the character and the length of its code for every code
+ * up to that length. Longer codes, which are rare, continue
+ * bit by bit from the node the table stops at.
+ *
+ * Call HuffmanTableInit once at startup, after the IWRAM
+ * sections have been copied. It builds the table and points
+ * `gpARM_HuffmanTextDecomp` at HuffmanTableDecomp, which has
+ * the same (source, dest) signature, so every caller of the
+ * game's decoder uses the table from then on.
+ *
+ * The tree is an array of nodes of two halfwords. A node
+ * whose second halfword has bit 15 set is a leaf, and its
+ * first halfword is the character: its low byte is written,
+ * followed by its high byte when that is not zero. Otherwise
+ * the halfwords are the indices of the children for a 0 and
+ * a 1 bit. Bits are read from the least significant bit of
+ * each source byte, and the string ends after the character
+ * 0 is written.
+ *
+ * See examples/bench/huffman.sh for the test that checks
+ * every string against the game's decoder.
+ */
+
+// Between 8 and 12 bits per lookup, the table takes
+// 4 << HUFFMAN_TABLE_BITS bytes
+#ifndef HUFFMAN_TABLE_BITS
+  #define HUFFMAN_TABLE_BITS 10
+#endif
+
+#if HUFFMAN_TABLE_BITS < 8 || HUFFMAN_TABLE_BITS > 12
+  #error "HUFFMAN_TABLE_BITS must be between 8 and 12"
+#endif
+
+enum {
+  HUFFMAN_TABLE_SIZE = 1 << HUFFMAN_TABLE_BITS,
+
+  // Bits 0-15 hold the character and bits 24-28 the length
+  // of its code. With bit 31 set, bits 0-23 hold the byte
+  // offset of the node reached after HUFFMAN_TABLE_BITS bits
+  // instead.
+  HUFFMAN_ENTRY_LENGTH_SHIFT = 24,
+  HUFFMAN_ENTRY_LENGTH_MASK  = 0x1F,
+
+  HUFFMAN_LEAF = 0x8000,
+};
+
+// Bit 31 of a table entry, see above. It is out of range
+// for an enumerator.
+#define HUFFMAN_ENTRY_CONTINUE (1u << 31)
+
+// Pointers to the tree and to its root node, as read by
+// the game's decoder
+extern const u16* const gMsgHuffmanTable;
+extern const u16* const gMsgHuffmanTableRoot;
+
+extern void (*gpARM_HuffmanTextDecomp)(const char *, char *);
+
+// HUFFMAN_TABLE_SIZE words of free RAM, preferably IWRAM
+extern u32 gHuffmanTable[];
+
+void HuffmanTableDecomp(const char* source, char* dest);
+
+void HuffmanTableInit(void) {
+
+  const u16* tree = gMsgHuffmanTable;
+  int index;
+
+  for (index = 0; index < HUFFMAN_TABLE_SIZE; index++) {
+    const u16* node = gMsgHuffmanTableRoot;
+    u32 length = 0;
+
+    do {
+      node = tree + 2 * node[(index >> length) & 1];
+      length++;
+    } while (!(node[1] & HUFFMAN_LEAF) && length < HUFFMAN_TABLE_BITS);
+
+    if (node[1] & HUFFMAN_LEAF)
+      gHuffmanTable[index] = (length << HUFFMAN_ENTRY_LENGTH_SHIFT) | node[0];
+    else
+      gHuffmanTable[index] = HUFFMAN_ENTRY_CONTINUE | (length << HUFFMAN_ENTRY_LENGTH_SHIFT) | ((const u8*)node - (const u8*)tree);
+  }
+
+  gpARM_HuffmanTextDecomp = HuffmanTableDecomp;
+
+}
+
+THUMBLIB_IWRAM_ARM_FUNC void HuffmanTableDecomp(const char* source, char* dest) {
+
+  register u32 bits asm("r2");
+  register int count asm("r3");
+  register const u32* table asm("r4");
+  register u32 entry asm("r5");
+  register u32 scratch asm("r6");
+  register const u16* tree asm("r12");
+
+  ARM_PUSH(table, entry, scratch);
+
+  ARM_LDR_POOL(AL, table, gHuffmanTable);
+  ARM_LDR_POOL(AL, tree, &gMsgHuffmanTable);
+  ARM_LDR(AL, tree, tree);
+
+  ARM_MOV_I(AL, bits, 0);
+  ARM_MOV_I(AL, count, 0);
+
+  // Keep at least 25 bits in the buffer, one byte at a
+  // time since the source has any alignment
+
+  _HTRefill:;
+
+    ARM_CMP_I(AL, count, 24);
+    ARM_LDRB_POST(LS, scratch, source, 1);
+    ARM_ORR_RS(LS, bits, bits, scratch, LSL, count);
+    ARM_ADD_I(LS, count, 8);
+    ARM_B(LS, _HTRefill);
+
+    // Look up the low HUFFMAN_TABLE_BITS bits and drop the
+    // ones the entry consumed
+
+    ARM_MOV(AL, entry, bits, LSL, 32 - HUFFMAN_TABLE_BITS);
+    ARM_LDR(AL, entry, table, entry, LSR, 30 - HUFFMAN_TABLE_BITS);
+
+    ARM_MOV(AL, scratch, entry, LSR, HUFFMAN_ENTRY_LENGTH_SHIFT);
+    ARM_AND_I(AL, scratch, HUFFMAN_ENTRY_LENGTH_MASK);
+    ARM_MOV_RS(AL, bits, bits, LSR, scratch);
+    ARM_SUB(AL, count, scratch);
+
+    ARM_CMP_I(AL, entry, 0);
+    ARM_B(LT, _HTLong);
+
+  _HTChar:;
+
+    ARM_STRB_POST(AL, entry, dest, 1);
+    ARM_ANDS_I(AL, scratch, entry, 0xFF00);
+    ARM_MOV(NE, scratch, scratch, LSR, 8);
+    ARM_STRB_POST(NE, scratch, dest, 1);
+
+    ARM_TST_I(AL, entry, 0xFF);
+    ARM_B(NE, _HTRefill);
+
+  ARM_POP(table, entry, scratch);
+  ARM_BX_LR(AL);
+
+  // Codes longer than HUFFMAN_TABLE_BITS continue one bit
+  // at a time from the node the table stopped at
+
+  _HTLong:;
+
+    ARM_BIC_I(AL, entry, 0xFF000000);
+    ARM_ADD(AL, entry, tree, entry);
+
+  _HTWalk:;
+
+    ARM_CMP_I(AL, count, 0);
+    ARM_LDRB_POST(EQ, bits, source, 1);
+    ARM_MOV_I(EQ, count, 8);
+
+    ARM_AND_I(AL, scratch, bits, 1);
+    ARM_MOV(AL, bits, bits, LSR, 1);
+    ARM_SUB_I(AL, count, 1);
+
+    ARM_ADD(AL, scratch, entry, scratch, LSL, 1);
+    ARM_LDRH(AL, scratch, scratch);
+    ARM_ADD(AL, entry, tree, scratch, LSL, 2);
+
+    ARM_LDRH_I(AL, scratch, entry, 2);
+    ARM_TST_I(AL, scratch, HUFFMAN_LEAF);
+    ARM_B(EQ, _HTWalk);
+
+    ARM_LDRH(AL, entry, entry);
+    ARM_B(AL, _HTChar);
+
+  LTORG();
+
+}
@@ -0,0 +1,183 @@
+#include "gbafe.h"
+#include "thumblib3.h"
+
+/* Decoded string cache in front of String_GetFromIndexExt.
+ *
+ * GetStringFromIndex_Replacement in AntihuffmanBody.c decodes
+ * the string into gCurrentTextString on every call, even for
+ * strings requested every frame such as menu labels and unit
+ * names. GetStringFromIndex_Cached keeps the most recently
+ * decoded strings in an EWRAM arena and returns a pointer
+ * into it on a hit, without decoding.
+ *
+ * Each text index hashes to a bucket holding the number of
+ * the slot that last cached an index with that hash. The hit
+ * path reads the bucket, compares the slot's index, stamps
+ * the slot with the clock and returns its text. On a miss,
+ * StringCacheFill decodes the string as usual and copies it
+ * into the least recently used slot, unless it is longer
+ * than a slot. Misses return gCurrentTextString.
+ *
+ * A hit returns a pointer into the arena rather than
+ * gCurrentTextString, so it must replace GetStringFromIndex
+ * only where callers use the returned pointer and don't
+ * modify the string. Call StringCacheInit once at startup.
+ *
+ * See examples/bench/string_cache.sh for the benchmark that
+ * replays a trace of text indices through the cache.
+ */
+
+// Slots of 1 << STRING_CACHE_SLOT_BITS bytes, including
+// the terminator
+#ifndef STRING_CACHE_SLOTS
+  #define STRING_CACHE_SLOTS 16
+#endif
+
+#ifndef STRING_CACHE_SLOT_BITS
+  #define STRING_CACHE_SLOT_BITS 6
+#endif
+
+// At most 32 buckets, so that the slot entries stay within
+// reach of `ldrh`
+#ifndef STRING_CACHE_BUCKET_BITS
+  #define STRING_CACHE_BUCKET_BITS 5
+#endif
+
+#if STRING_CACHE_BUCKET_BITS < 2 || STRING_CACHE_BUCKET_BITS > 5
+  #error "STRING_CACHE_BUCKET_BITS must be between 2 and 5"
+#endif
+
+#if STRING_CACHE_SLOT_BITS < 3
+  #error "STRING_CACHE_SLOT_BITS must be at least 3"
+#endif
+
+enum {
+  TEXT_END = 0x00,
+
+  STRING_CACHE_SLOT_SIZE = 1 << STRING_CACHE_SLOT_BITS,
+  STRING_CACHE_BUCKETS   = 1 << STRING_CACHE_BUCKET_BITS,
+
+  // Index of an empty slot
+  STRING_CACHE_EMPTY = 0xFFFF,
+
+  // Offsets into StringCache, from the address of slot
+  // entry 0 or the text of slot 0, which don't exist
+  STRING_CACHE_INDEX = STRING_CACHE_BUCKETS,
+  STRING_CACHE_STAMP = STRING_CACHE_BUCKETS + 4,
+  STRING_CACHE_TEXT  = STRING_CACHE_BUCKETS + 8 * (STRING_CACHE_SLOTS + 1) - STRING_CACHE_SLOT_SIZE,
+};
+
+#if STRING_CACHE_BUCKETS + 8 * (STRING_CACHE_SLOTS + 1) - (1 << STRING_CACHE_SLOT_BITS) > 255
+  #error "the string cache arena is out of reach of `add`, use fewer or larger slots"
+#endif
+
+typedef struct {
+  u16 index;  // Text index, STRING_CACHE_EMPTY if empty
+  u16 unused;
+  u32 stamp;  // Value of the clock when last used
+} StringCacheSlot;
+
+// The layout is used by the hit path, see the offsets above
+typedef struct {
+  u8 buckets[STRING_CACHE_BUCKETS];  // Slot number, 0 for none
+  StringCacheSlot head;              // Slot 0, always empty, its stamp is the clock
+  StringCacheSlot slots[STRING_CACHE_SLOTS];
+  char arena[STRING_CACHE_SLOTS][STRING_CACHE_SLOT_SIZE];
+} StringCache;
+
+extern char* gCurrentTextString;
+char* String_GetFromIndexExt(int index, char* buffer);
+
+// sizeof(StringCache) bytes of free EWRAM
+extern StringCache gStringCache;
+
+char* StringCacheFill(int index);
+
+void StringCacheInit(void) {
+
+  StringCache* cache = &gStringCache;
+  int i;
+
+  for (i = 0; i < STRING_CACHE_BUCKETS; i++)
+    cache->buckets[i] = 0;
+
+  cache->head.index = STRING_CACHE_EMPTY;
+  cache->head.stamp = 0;
+
+  for (i = 0; i < STRING_CACHE_SLOTS; i++) {
+    cache->slots[i].index = STRING_CACHE_EMPTY;
+    cache->slots[i].stamp = 0;
+  }
+
+}
+
+THUMBLIB_FUNC char* GetStringFromIndex_Cached(int index) {
+
+  register StringCache* cache asm("r1");
+  register int slot asm("r2");
+  register int scratch asm("r3");
+
+  LDR_POOL(cache, &gStringCache);
+
+  LSL_I(slot, index, 32 - STRING_CACHE_BUCKET_BITS);
+  LSR_I(slot, 32 - STRING_CACHE_BUCKET_BITS);
+  LDRB(slot, cache, slot);
+
+  LSL_I(slot, 3);
+  ADD_R(slot, cache);
+  LDRH_I(scratch, slot, STRING_CACHE_INDEX);
+  CMP(scratch, index);
+  BNE(_SCMiss);
+
+    LDR_I(scratch, cache, STRING_CACHE_STAMP);
+    ADD_I(scratch, 1);
+    STR_I(scratch, cache, STRING_CACHE_STAMP);
+    STR_I(scratch, slot, STRING_CACHE_STAMP);
+
+    SUB_R(slot, cache);
+    LSL_I(slot, STRING_CACHE_SLOT_BITS - 3);
+    ADD_R(index, slot, cache);
+    ADD_I(index, STRING_CACHE_TEXT);
+    BX_LR();
+
+  _SCMiss:;
+    B_ABS(StringCacheFill);
+
+  LTORG();
+
+}
+
+// Decodes the string and caches it in the least recently
+// used slot
+char* StringCacheFill(int index) {
+
+  StringCache* cache = &gStringCache;
+  char* text = String_GetFromIndexExt(index, (char*)&gCurrentTextString);
+  StringCacheSlot* victim = &cache->slots[0];
+  char* dest;
+  int i;
+
+  for (i = 1; i < STRING_CACHE_SLOTS; i++)
+    if (cache->slots[i].stamp < victim->stamp)
+      victim = &cache->slots[i];
+
+  if (victim->index != STRING_CACHE_EMPTY) {
+    u8* bucket = &cache->buckets[victim->index & (STRING_CACHE_BUCKETS - 1)];
+    if (*bucket == victim - cache->slots + 1)
+      *bucket = 0;
+    victim->index = STRING_CACHE_EMPTY;
+    victim->stamp = 0;
+  }
+
+  dest = cache->arena[victim - cache->slots];
+  for (i = 0; (dest[i] = text[i]) != TEXT_END; i++)
+    if (i == STRING_CACHE_SLOT_SIZE - 1)
+      return text;
+
+  victim->index = index;
+  victim->stamp = ++cache->head.stamp;
+  cache->buckets[index & (STRING_CACHE_BUCKETS - 1)] = victim - cache->slots + 1;
+
+  return text;
+
+}
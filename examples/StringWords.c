@@ -0,0 +1,326 @@
+#include "gbafe.h"
+#include "thumblib3.h"
+
+enum {
+  TEXT_END = 0x00,
+};
+
+/* Word-at-a-time string kernels.
+ *
+ * The loops in the Antihuffman examples test one character
+ * per iteration. These routines test a whole word with
+ *
+ *   (word - 0x01010101) AND NOT word AND 0x80808080
+ *
+ * which is not zero exactly when one of the word's bytes is
+ * zero. Single characters are handled until the source is
+ * word aligned, then whole words until one holds the
+ * terminator, which is finished a byte at a time. Loads
+ * never cross the word holding the terminator.
+ *
+ * StringCopyWords(source, dest)   copies source to dest, terminator included
+ * StringEndWords(source)          returns the address of the terminator
+ * StringLengthWords(source)       returns the length, terminator excluded
+ *
+ * The THUMB versions are plain THUMBLIB functions and the
+ * `Arm` versions are ARM functions placed in IWRAM.
+ *
+ * See examples/bench for the benchmark comparing them with
+ * the byte loops.
+ */
+
+THUMBLIB_FUNC void StringCopyWords(const char* source, char* dest) {
+
+  register int word asm("r2");
+  register int zeros asm("r3");
+  register int ones asm("r4");
+  register int highs asm("r5");
+
+  // Copy single characters until the source is word aligned
+
+  _SWCopyHead:;
+
+    LSL_I(zeros, (int)source, 30);
+    BEQ(_SWCopyAligned);
+
+    LDRB(word, source);
+    STRB(word, dest);
+
+    ADD_I(source, sizeof(char));
+    ADD_I(dest, sizeof(char));
+
+    CMP_I(word, TEXT_END);
+    BNE(_SWCopyHead);
+
+  BX_LR();
+
+  _SWCopyAligned:;
+
+  PUSH(ones, highs);
+
+  LDR_POOL(ones, 0x01010101);
+  LSL_I(highs, ones, 7);
+
+  LSL_I(zeros, (int)dest, 30);
+  BNE(_SWCopyUnalignedTest);
+  B(_SWCopyTest);
+
+  // Then whole words until one holds the terminator, stored
+  // as words if dest is now aligned as well
+
+  _SWCopyWords:;
+
+    STMIA(dest, word);
+
+  _SWCopyTest:;
+
+    LDMIA(source, word);
+    SUB_R(zeros, word, ones);
+    BIC(zeros, word);
+    TST(zeros, highs);
+    BEQ(_SWCopyWords);
+
+  B(_SWCopyTail);
+
+  // or a byte at a time otherwise
+
+  _SWCopyUnaligned:;
+
+    STRB_I(word, dest, 0);
+    LSR_I(word, 8);
+    STRB_I(word, dest, 1);
+    LSR_I(word, 8);
+    STRB_I(word, dest, 2);
+    LSR_I(word, 8);
+    STRB_I(word, dest, 3);
+
+    ADD_I(dest, 4 * sizeof(char));
+
+  _SWCopyUnalignedTest:;
+
+    LDMIA(source, word);
+    SUB_R(zeros, word, ones);
+    BIC(zeros, word);
+    TST(zeros, highs);
+    BEQ(_SWCopyUnaligned);
+
+  // The word holding the terminator, a byte at a time
+
+  _SWCopyTail:;
+
+  SUB_I(source, 4 * sizeof(char));
+
+  _SWCopyBytes:;
+
+    LDRB(word, source);
+    STRB(word, dest);
+
+    ADD_I(source, sizeof(char));
+    ADD_I(dest, sizeof(char));
+
+    CMP_I(word, TEXT_END);
+    BNE(_SWCopyBytes);
+
+  POP(ones, highs);
+  BX_LR();
+
+  LTORG();
+
+}
+
+THUMBLIB_FUNC char* StringEndWords(const char* source) {
+
+  register int word asm("r1");
+  register int zeros asm("r2");
+  register int ones asm("r3");
+  register int highs asm("r4");
+
+  _SWEndHead:;
+
+    LSL_I(zeros, (int)source, 30);
+    BEQ(_SWEndAligned);
+
+    LDRB(word, source);
+    CMP_I(word, TEXT_END);
+    BEQ(_SWEndReturn);
+
+    ADD_I(source, sizeof(char));
+    B(_SWEndHead);
+
+  _SWEndAligned:;
+
+  PUSH(highs);
+
+  LDR_POOL(ones, 0x01010101);
+  LSL_I(highs, ones, 7);
+
+  _SWEndWords:;
+
+    LDMIA(source, word);
+    SUB_R(zeros, word, ones);
+    BIC(zeros, word);
+    TST(zeros, highs);
+    BEQ(_SWEndWords);
+
+  POP(highs);
+
+  SUB_I(source, 4 * sizeof(char));
+
+  _SWEndBytes:;
+
+    LDRB(word, source);
+    CMP_I(word, TEXT_END);
+    BEQ(_SWEndReturn);
+
+    ADD_I(source, sizeof(char));
+    B(_SWEndBytes);
+
+  _SWEndReturn:;
+  BX_LR();
+
+  LTORG();
+
+}
+
+THUMBLIB_FUNC int StringLengthWords(const char* source) {
+
+  register const char* start asm("r1");
+
+  PUSH_WITH_LR(source);
+  BL(StringEndWords);
+  POP(start);
+
+  SUB_R(source, start);
+  POP_PC();
+
+}
+
+THUMBLIB_IWRAM_ARM_FUNC void StringCopyWordsArm(const char* source, char* dest) {
+
+  register int word asm("r2");
+  register int zeros asm("r3");
+  register int ones asm("r12");
+
+  _SWACopyHead:;
+
+    ARM_TST_I(AL, source, 3);
+    ARM_B(EQ, _SWACopyAligned);
+
+    ARM_LDRB_POST(AL, word, source, sizeof(char));
+    ARM_STRB_POST(AL, word, dest, sizeof(char));
+
+    ARM_CMP_I(AL, word, TEXT_END);
+    ARM_B(NE, _SWACopyHead);
+
+  ARM_BX_LR(AL);
+
+  _SWACopyAligned:;
+
+  ARM_LDR_POOL(AL, ones, 0x01010101);
+
+  ARM_TST_I(AL, dest, 3);
+  ARM_B(NE, _SWACopyUnaligned);
+
+  _SWACopyWords:;
+
+    ARM_LDR_POST(AL, word, source, 4 * sizeof(char));
+    ARM_SUB(AL, zeros, word, ones);
+    ARM_BIC(AL, zeros, word);
+    ARM_TST(AL, zeros, ones, LSL, 7);
+    ARM_STR_POST(EQ, word, dest, 4 * sizeof(char));
+    ARM_B(EQ, _SWACopyWords);
+
+  ARM_B(AL, _SWACopyTail);
+
+  _SWACopyUnaligned:;
+
+    ARM_LDR_POST(AL, word, source, 4 * sizeof(char));
+    ARM_SUB(AL, zeros, word, ones);
+    ARM_BIC(AL, zeros, word);
+    ARM_TST(AL, zeros, ones, LSL, 7);
+    ARM_B(NE, _SWACopyTail);
+
+    ARM_STRB_POST(AL, word, dest, sizeof(char));
+    ARM_MOV(AL, word, word, LSR, 8);
+    ARM_STRB_POST(AL, word, dest, sizeof(char));
+    ARM_MOV(AL, word, word, LSR, 8);
+    ARM_STRB_POST(AL, word, dest, sizeof(char));
+    ARM_MOV(AL, word, word, LSR, 8);
+    ARM_STRB_POST(AL, word, dest, sizeof(char));
+    ARM_B(AL, _SWACopyUnaligned);
+
+  _SWACopyTail:;
+
+  ARM_SUB_I(AL, source, 4 * sizeof(char));
+
+  _SWACopyBytes:;
+
+    ARM_LDRB_POST(AL, word, source, sizeof(char));
+    ARM_STRB_POST(AL, word, dest, sizeof(char));
+
+    ARM_CMP_I(AL, word, TEXT_END);
+    ARM_B(NE, _SWACopyBytes);
+
+  ARM_BX_LR(AL);
+
+  LTORG();
+
+}
+
+THUMBLIB_IWRAM_ARM_FUNC char* StringEndWordsArm(const char* source) {
+
+  register int word asm("r1");
+  register int zeros asm("r2");
+  register int ones asm("r12");
+
+  _SWAEndHead:;
+
+    ARM_TST_I(AL, source, 3);
+    ARM_B(EQ, _SWAEndAligned);
+
+    ARM_LDRB(AL, word, source);
+    ARM_CMP_I(AL, word, TEXT_END);
+    ARM_BX_LR(EQ);
+
+    ARM_ADD_I(AL, source, sizeof(char));
+    ARM_B(AL, _SWAEndHead);
+
+  _SWAEndAligned:;
+
+  ARM_LDR_POOL(AL, ones, 0x01010101);
+
+  _SWAEndWords:;
+
+    ARM_LDR_POST(AL, word, source, 4 * sizeof(char));
+    ARM_SUB(AL, zeros, word, ones);
+    ARM_BIC(AL, zeros, word);
+    ARM_TST(AL, zeros, ones, LSL, 7);
+    ARM_B(EQ, _SWAEndWords);
+
+  ARM_SUB_I(AL, source, 4 * sizeof(char));
+
+  _SWAEndBytes:;
+
+    ARM_LDRB(AL, word, source);
+    ARM_CMP_I(AL, word, TEXT_END);
+    ARM_BX_LR(EQ);
+
+    ARM_ADD_I(AL, source, sizeof(char));
+    ARM_B(AL, _SWAEndBytes);
+
+  LTORG();
+
+}
+
+THUMBLIB_IWRAM_ARM_FUNC int StringLengthWordsArm(const char* source) {
+
+  register const char* start asm("r1");
+
+  ARM_PUSH_WITH_LR(source);
+  ARM_BL(AL, StringEndWordsArm);
+  ARM_POP_WITH_LR(start);
+
+  ARM_SUB(AL, source, start);
+  ARM_BX_LR(AL);
+
+}
@@ -0,0 +1,178 @@
+#include "gbafe.h"
+#include "thumblib3.h"
+
+/* Correctness test for the ARM division macros of
+ * include/divide.h, run with thumbsim by divide.sh.
+ *
+ * Each divisor of DIVIDE_TEST_DIVISORS gets an ARM function
+ * for each of ARM_DIV_CONST, ARM_DIV_CONST_S, ARM_MOD_CONST
+ * and ARM_MOD_CONST_S, so building this file also checks
+ * that every one of them assembles. DivideTest compares them
+ * with a bit-by-bit long division on a few edge cases and
+ * `count` pseudo-random dividends per divisor, and returns
+ * the first divisor that gave a wrong result, or -1.
+ */
+
+// A mix of short and long multipliers, powers of 2 on both
+// sides of 256 and the largest divisor the macros take
+#define DIVIDE_TEST_DIVISORS(Test) \
+  Test(1)                          \
+  Test(2)                          \
+  Test(3)                          \
+  Test(5)                          \
+  Test(6)                          \
+  Test(7)                          \
+  Test(10)                         \
+  Test(25)                         \
+  Test(100)                        \
+  Test(255)                        \
+  Test(256)                        \
+  Test(641)                        \
+  Test(1000)                       \
+  Test(0x10000)                    \
+  Test(0x12345)                    \
+  Test(0x7FFFFFFF)
+
+// Rd, Rs and Scratch are all different, see include/divide.h
+#define DIVIDE_TEST_FUNCTION(Name, Macro, Type, Divisor) \
+  THUMBLIB_ARM_FUNC Type Name##_##Divisor(Type number) { \
+                                                         \
+    register Type result asm("r1");                      \
+    register Type scratch asm("r2");                     \
+                                                         \
+    Macro(result, number, Divisor, scratch);             \
+    ARM_MOV(AL, number, result);                         \
+    ARM_BX_LR(AL);                                       \
+                                                         \
+    LTORG();                                             \
+                                                         \
+  }
+
+#define DIVIDE_TEST_FUNCTIONS(Divisor)                                \
+  DIVIDE_TEST_FUNCTION(DivideTestDiv, ARM_DIV_CONST, u32, Divisor)    \
+  DIVIDE_TEST_FUNCTION(DivideTestDivS, ARM_DIV_CONST_S, s32, Divisor) \
+  DIVIDE_TEST_FUNCTION(DivideTestMod, ARM_MOD_CONST, u32, Divisor)    \
+  DIVIDE_TEST_FUNCTION(DivideTestModS, ARM_MOD_CONST_S, s32, Divisor)
+
+DIVIDE_TEST_DIVISORS(DIVIDE_TEST_FUNCTIONS)
+
+typedef struct {
+  u32 divisor;
+  void* divide;
+  void* divideSigned;
+  void* modulo;
+  void* moduloSigned;
+} DivideTestCase;
+
+#define DIVIDE_TEST_CASE(Divisor) \
+  { Divisor, DivideTestDiv_##Divisor, DivideTestDivS_##Divisor, DivideTestMod_##Divisor, DivideTestModS_##Divisor },
+
+static const DivideTestCase sDivideTests[] = {
+  DIVIDE_TEST_DIVISORS(DIVIDE_TEST_CASE)
+};
+
+// Edge case dividends, as divisor * scale + offset
+static const struct {
+  u32 scale;
+  u32 offset;
+} sDivideEdges[] = {
+  { 0, 0 },
+  { 0, 1 },
+  { 1, -1 },
+  { 1, 0 },
+  { 1, 1 },
+  { 2, -1 },
+  { -1, 0 },
+  { -1, 1 },
+  { 0, 0x7FFFFFFF },
+  { 0, 0x80000000 },
+  { 0, 0xFFFFFFFF },
+};
+
+enum {
+  DIVIDE_TEST_COUNT = sizeof(sDivideTests) / sizeof(sDivideTests[0]),
+  DIVIDE_TEST_EDGES = sizeof(sDivideEdges) / sizeof(sDivideEdges[0]),
+};
+
+// Calls an ARM function through its address
+THUMBLIB_FUNC u32 DivideTestCall(u32 number, void* function) {
+
+  BX(function);
+
+}
+
+// Long division one bit at a time, which needs no library
+// call and no divide macro
+static u32 DivideReference(u32 number, u32 divisor, u32* remainder) {
+
+  u32 quotient = 0, rest = 0;
+  int bit;
+
+  for (bit = 31; bit >= 0; bit--) {
+    rest = (rest << 1) | ((number >> bit) & 1);
+
+    if (rest >= divisor) {
+      rest -= divisor;
+      quotient |= 1u << bit;
+    }
+  }
+
+  *remainder = rest;
+  return quotient;
+
+}
+
+// Whether all four functions of `test` are right for `number`
+static bool DivideTestCheck(const DivideTestCase* test, u32 number) {
+
+  u32 quotient, remainder;
+  int negative = (s32)number < 0;
+
+  quotient = DivideReference(number, test->divisor, &remainder);
+
+  if (DivideTestCall(number, test->divide) != quotient)
+    return false;
+  if (DivideTestCall(number, test->modulo) != remainder)
+    return false;
+
+  // C's signed `/` and `%` round towards 0
+  quotient = DivideReference(negative ? -number : number, test->divisor, &remainder);
+
+  if (negative) {
+    quotient = -quotient;
+    remainder = -remainder;
+  }
+
+  if (DivideTestCall(number, test->divideSigned) != quotient)
+    return false;
+  if (DivideTestCall(number, test->moduloSigned) != remainder)
+    return false;
+
+  return true;
+
+}
+
+int DivideTest(int count) {
+
+  const DivideTestCase* test;
+  u32 seed = 1;
+  int i;
+
+  for (test = sDivideTests; test < sDivideTests + DIVIDE_TEST_COUNT; test++) {
+    for (i = 0; i < DIVIDE_TEST_EDGES; i++)
+      if (!DivideTestCheck(test, test->divisor * sDivideEdges[i].scale + sDivideEdges[i].offset))
+        return test->divisor;
+
+    // Shifting by the top bits of the seed mixes small and
+    // large dividends
+    for (i = 0; i < count; i++) {
+      seed = seed * 1664525 + 1013904223;
+
+      if (!DivideTestCheck(test, seed >> (seed >> 27)))
+        return test->divisor;
+    }
+  }
+
+  return -1;
+
+}
@@ -0,0 +1,65 @@
+#include "gbafe.h"
+#include "thumblib3.h"
+
+/* Correctness test for the table-driven decoder in
+ * examples/HuffmanTable.c, run with thumbsim by huffman.sh.
+ *
+ * HuffmanTableTest decodes every compressed string in a
+ * range of text indices with both the game's decoder and
+ * HuffmanTableDecomp, and returns the first index where the
+ * two disagree, or -1. The decoder, the text table and the
+ * tree are read from the game's ROM, so their addresses are
+ * given to thumbsim with `-D`.
+ */
+
+void HuffmanTableInit(void);
+void HuffmanTableDecomp(const char* source, char* dest);
+
+// The game's ARM decoder as stored in ROM, and its text table
+extern void HuffmanOriginalDecomp(const char* source, char* dest);
+extern const char* const gMsgStringTable[];
+
+enum {
+  TEXT_END = 0x00,
+
+  // Strings with this bit set in their pointer are stored
+  // uncompressed, see AntihuffmanPointerTester.c
+  TEXT_UNCOMPRESSED = 0x80000000,
+};
+
+static char sExpected[0x1000];
+static char sActual[0x1000];
+
+// Calls an ARM or THUMB decoder through its address
+THUMBLIB_FUNC void HuffmanTestCall(const char* source, char* dest, void* decompressor) {
+
+  BX(decompressor);
+
+}
+
+int HuffmanTableTest(int first, int last) {
+
+  int index, i;
+
+  HuffmanTableInit();
+
+  for (index = first; index < last; index++) {
+    const char* source = gMsgStringTable[index];
+
+    if ((u32)source & TEXT_UNCOMPRESSED)
+      continue;
+
+    HuffmanTestCall(source, sExpected, HuffmanOriginalDecomp);
+    HuffmanTestCall(source, sActual, HuffmanTableDecomp);
+
+    for (i = 0; sExpected[i] == sActual[i]; i++)
+      if (sExpected[i] == TEXT_END)
+        break;
+
+    if (sExpected[i] != sActual[i])
+      return index;
+  }
+
+  return -1;
+
+}
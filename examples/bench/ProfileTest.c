@@ -0,0 +1,84 @@
+#define THUMBLIB_PROFILER
+
+#include "gbafe.h"
+#include "thumblib3.h"
+
+/* Test for the profiling macros of include/profile.h, run
+ * with thumbsim and its timer model by profile.sh.
+ *
+ * ProfileTest starts the timers and calls ProfileSpin and
+ * ProfileEmpty the given number of times. ProfileSpin times
+ * a loop whose cost profile.sh measures separately by
+ * calling ProfileSpinBare, and ProfileEmpty times nothing,
+ * which gives the overhead of the macros themselves.
+ */
+
+THUMBLIB_PROFILE_TABLE(0x0203E000)
+
+enum {
+  PROFILE_ID_SPIN,
+  PROFILE_ID_EMPTY,
+
+  // Iterations of the loop in ProfileSpin
+  PROFILE_SPIN_COUNT = 100,
+};
+
+THUMBLIB_FUNC void ProfileSpinBare(int count) {
+
+  _PBLoop:;
+    SUB_I(count, 1);
+    BNE(_PBLoop);
+
+  BX_LR();
+
+}
+
+THUMBLIB_FUNC void ProfileSpin(int count) {
+
+  register int a asm("r1");
+  register int b asm("r2");
+  register int c asm("r3");
+
+  PROFILE_BEGIN(PROFILE_ID_SPIN, a, b)
+
+  _PSLoop:;
+    SUB_I(count, 1);
+    BNE(_PSLoop);
+
+  PROFILE_END(PROFILE_ID_SPIN, a, b, c)
+
+  BX_LR();
+
+  LTORG();
+
+}
+
+THUMBLIB_FUNC void ProfileEmpty(void) {
+
+  register int a asm("r1");
+  register int b asm("r2");
+  register int c asm("r3");
+
+  PROFILE_BEGIN(PROFILE_ID_EMPTY, a, b)
+  PROFILE_END(PROFILE_ID_EMPTY, a, b, c)
+
+  BX_LR();
+
+  LTORG();
+
+}
+
+int ProfileTest(int calls) {
+
+  int i;
+
+  PROFILE_INIT()
+
+  for (i = 0; i < calls; i++) {
+    ProfileSpin(PROFILE_SPIN_COUNT);
+    ProfileEmpty();
+  }
+
+  return calls;
+
+}
@@ -0,0 +1,62 @@
+#include "gbafe.h"
+#include "thumblib3.h"
+
+/* Trace replay for the string cache in examples/StringCache.c,
+ * run with thumbsim by string_cache.sh.
+ *
+ * Both replays request every text index of the trace in
+ * order, one through GetStringFromIndex_Replacement and one
+ * through GetStringFromIndex_Cached. String_GetFromIndexExt
+ * is replaced by a copy of the text that string_cache.sh
+ * writes for each index, which is cheaper than decoding it.
+ */
+
+char* GetStringFromIndex_Replacement(int index);
+char* GetStringFromIndex_Cached(int index);
+void StringCacheInit(void);
+void AntihuffmanUncompressed(const char* source, char* dest);
+
+extern char* gCurrentTextString;
+
+// Generated by string_cache.sh from the trace
+extern const u16 gStringCacheTrace[];
+extern const int gStringCacheTraceLength;
+
+enum {
+  // The text of index N is at BENCH_TEXT + N * BENCH_TEXT_STRIDE
+  BENCH_TEXT        = 0x08100000,
+  BENCH_TEXT_STRIDE = 0x100,
+
+  TEXT_UNCOMPRESSED = 0x80000000,
+};
+
+char* String_GetFromIndexExt(int index, char* buffer) {
+
+  AntihuffmanUncompressed((const char*)((BENCH_TEXT + index * BENCH_TEXT_STRIDE) | TEXT_UNCOMPRESSED), buffer);
+  return buffer;
+
+}
+
+void StringCacheReplayUncached(void) {
+
+  int i;
+
+  for (i = 0; i < gStringCacheTraceLength; i++)
+    GetStringFromIndex_Replacement(gStringCacheTrace[i]);
+
+}
+
+// Returns the number of hits
+int StringCacheReplayCached(void) {
+
+  int i, hits = 0;
+
+  StringCacheInit();
+
+  for (i = 0; i < gStringCacheTraceLength; i++)
+    if (GetStringFromIndex_Cached(gStringCacheTrace[i]) != (char*)&gCurrentTextString)
+      hits++;
+
+  return hits;
+
+}
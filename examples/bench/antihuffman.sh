@@ -0,0 +1,149 @@
+#!/bin/sh
+#
+# Antihuffman benchmark
+#
+# Runs the routines in the Antihuffman examples, their
+# word-at-a-time versions from AntihuffmanWords.c and the
+# string copies from StringWords.c on every line of
+# corpus.txt with thumbsim, with the code placed in ROM and
+# in IWRAM. The `Arm` routines are always in IWRAM. The
+# strings are always read from ROM and decoded into an EWRAM
+# buffer.
+#
+# Prints one tab-separated line per routine and placement:
+#
+#   routine placement calls bytes cycles cycles_per_call cycles_per_byte
+#
+# `bytes` counts the characters copied, including the
+# terminators. The output is meant to be saved and compared
+# with `-b FILE`, which adds the change in cycles per call
+# against a previous run and exits with 1 if any routine got
+# slower.
+#
+# Usage:  examples/bench/antihuffman.sh [-b BASELINE] [CORPUS]
+#
+# Environment:
+#   CC      ARM compiler (default arm-none-eabi-gcc)
+#   CFLAGS  extra flags, such as -I path/to/FE-CLib/include
+#   HOSTCC  host compiler for thumbsim (default cc)
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$here/../.." && pwd)
+
+baseline=
+if [ "$1" = "-b" ]; then
+  baseline=$2
+  shift 2
+fi
+corpus=${1:-$here/corpus.txt}
+
+CC=${CC:-arm-none-eabi-gcc}
+HOSTCC=${HOSTCC:-cc}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+"$HOSTCC" -O2 -o "$work/thumbsim" "$root/tools/thumbsim.c"
+
+for name in AntihuffmanBody AntihuffmanPointerTester AntihuffmanWords StringWords; do
+  $CC -mcpu=arm7tdmi -mthumb -O2 -I "$root" $CFLAGS -c -o "$work/$name.o" "$root/examples/$name.c"
+done
+
+objects="$work/AntihuffmanBody.o $work/AntihuffmanPointerTester.o $work/AntihuffmanWords.o $work/StringWords.o"
+
+# Strings are placed at different alignments, away from
+# the code.
+text=0x08100000
+buffer=0x02030000
+
+# run ROUTINE PLACEMENT [thumbsim options...]
+# Prints the cycles taken by one call.
+run() {
+  routine=$1
+  placement=$2
+  shift 2
+  "$work/thumbsim" -p "$placement" -x String_GetFromIndexExt -c "$routine" "$@" $objects |
+    sed -n "s/^$routine: \([0-9]*\) cycles.*/\1/p"
+}
+
+results=$work/results.txt
+
+for placement in rom iwram; do
+  for routine in AntihuffmanUncompressed AntihuffmanUncompressedWords \
+                 AntihuffmanPointerTester AntihuffmanPointerTesterWords \
+                 StringCopyWords StringCopyWordsArm; do
+    line=0
+    while IFS= read -r string; do
+      source=$(printf '0x%08X' $((text + line * 0x100 + line % 4)))
+      # The Antihuffman routines take uncompressed strings
+      # with the top bit of the pointer set
+      case $routine in
+        String*) pointer=$source ;;
+        *) pointer=$(printf '0x%08X' $((source | 0x80000000))) ;;
+      esac
+      cycles=$(run "$routine" "$placement" -s "$source=$string" \
+        -r r0="$pointer" -r r1="$buffer" -E "$buffer=$string")
+      if [ -z "$cycles" ]; then
+        echo "antihuffman.sh: $routine failed on line $((line + 1))" >&2
+        exit 2
+      fi
+      printf '%s\t%s\t%d\t%d\n' "$routine" "$placement" "${#string}" "$cycles"
+      line=$((line + 1))
+    done < "$corpus"
+  done
+
+  cycles=$(run GetStringFromIndex_Replacement "$placement" -r r0=0x100)
+  printf '%s\t%s\t-1\t%d\n' GetStringFromIndex_Replacement "$placement" "$cycles"
+done > "$results"
+
+awk -F '\t' -v OFS='\t' '
+  {
+    key = $1 OFS $2
+    if (!(key in calls))
+      order[count++] = key
+    calls[key]++
+    cycles[key] += $4
+    if ($3 >= 0)
+      bytes[key] += $3 + 1
+  }
+  END {
+    print "routine", "placement", "calls", "bytes", "cycles", "cycles_per_call", "cycles_per_byte"
+    for (i = 0; i < count; i++) {
+      key = order[i]
+      perByte = bytes[key] ? sprintf("%.2f", cycles[key] / bytes[key]) : "-"
+      print key, calls[key], bytes[key] + 0, cycles[key], sprintf("%.2f", cycles[key] / calls[key]), perByte
+    }
+  }
+' "$results" > "$work/summary.txt"
+
+if [ -z "$baseline" ]; then
+  cat "$work/summary.txt"
+  exit 0
+fi
+
+awk -F '\t' -v OFS='\t' '
+  NR == FNR {
+    if (FNR > 1)
+      previous[$1 OFS $2] = $6
+    next
+  }
+  FNR == 1 {
+    print $0, "change"
+    next
+  }
+  {
+    key = $1 OFS $2
+    change = "new"
+    if (key in previous) {
+      change = sprintf("%+.2f%%", previous[key] ? ($6 - previous[key]) * 100 / previous[key] : 0)
+      if ($6 > previous[key])
+        slower = 1
+    }
+    print $0, change
+  }
+  END {
+    exit slower
+  }
+' "$baseline" "$work/summary.txt"
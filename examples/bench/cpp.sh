@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# C++ front end check
+#
+# Builds examples/AntihuffmanBody.c with the C macros and
+# examples/AntihuffmanBody.cpp with thumblib3.hpp, and checks
+# that every function disassembles to the same code, with and
+# without THUMBLIB_ANNOTATE.
+#
+# Prints a diff and exits with 1 for any function that
+# differs.
+#
+# Usage:  examples/bench/cpp.sh
+#
+# Environment:
+#   CC       ARM C compiler (default arm-none-eabi-gcc)
+#   CXX      ARM C++ compiler (default arm-none-eabi-g++)
+#   OBJDUMP  (default arm-none-eabi-objdump)
+#   CFLAGS   extra flags for both, such as -I path/to/FE-CLib/include
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$here/../.." && pwd)
+
+CC=${CC:-arm-none-eabi-gcc}
+CXX=${CXX:-arm-none-eabi-g++}
+OBJDUMP=${OBJDUMP:-arm-none-eabi-objdump}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# disassemble OBJECT
+# Prints the code of OBJECT without its file name.
+disassemble() {
+  "$OBJDUMP" -dr "$1" | sed -n '/^Disassembly/,$p'
+}
+
+status=0
+for flags in "" -DTHUMBLIB_ANNOTATE; do
+  $CC -mcpu=arm7tdmi -mthumb -O2 -I "$root" $flags $CFLAGS -c -o "$work/c.o" "$root/examples/AntihuffmanBody.c"
+  $CXX -std=c++17 -mcpu=arm7tdmi -mthumb -O2 -I "$root" $flags $CFLAGS -c -o "$work/cpp.o" "$root/examples/AntihuffmanBody.cpp"
+
+  disassemble "$work/c.o" > "$work/c.txt"
+  disassemble "$work/cpp.o" > "$work/cpp.txt"
+
+  if diff -u "$work/c.txt" "$work/cpp.txt"; then
+    echo "cpp.sh: same code${flags:+ with $flags}"
+  else
+    status=1
+  fi
+done
+
+exit $status
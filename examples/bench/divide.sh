@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# ARM division macro test
+#
+# Builds DivideTest.c, which expands ARM_DIV_CONST,
+# ARM_DIV_CONST_S, ARM_MOD_CONST and ARM_MOD_CONST_S from
+# include/divide.h for a range of divisors, and runs it with
+# thumbsim to check every quotient and remainder against a
+# long division.
+#
+# Prints `ok`, or `mismatch for divisor DIVISOR` and exits
+# with 1 if any result was wrong.
+#
+# Usage:  examples/bench/divide.sh [COUNT]
+#
+# COUNT is the number of pseudo-random dividends tried for
+# each divisor on top of the edge cases, and defaults to 1000.
+#
+# Environment:
+#   CC      ARM compiler (default arm-none-eabi-gcc)
+#   CFLAGS  extra flags, such as -I path/to/FE-CLib/include
+#   HOSTCC  host compiler for thumbsim (default cc)
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$here/../.." && pwd)
+
+count=${1:-1000}
+
+CC=${CC:-arm-none-eabi-gcc}
+HOSTCC=${HOSTCC:-cc}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+"$HOSTCC" -O2 -o "$work/thumbsim" "$root/tools/thumbsim.c"
+
+$CC -mcpu=arm7tdmi -mthumb -O2 -I "$root" $CFLAGS -c -o "$work/DivideTest.o" "$here/DivideTest.c"
+
+result=$("$work/thumbsim" -L 1000000000 -c DivideTest -r r0="$count" "$work/DivideTest.o" |
+  sed -n 's/^  r0 = \(0x[0-9A-F]*\).*/\1/p')
+
+if [ -z "$result" ]; then
+  echo "divide.sh: the test failed to run" >&2
+  exit 2
+fi
+
+if [ "$result" = 0xFFFFFFFF ]; then
+  echo "ok"
+else
+  echo "mismatch for divisor $((result))"
+  exit 1
+fi
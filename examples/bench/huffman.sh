@@ -0,0 +1,97 @@
+#!/bin/sh
+#
+# Huffman decoder test
+#
+# Checks the table-driven decoder in examples/HuffmanTable.c
+# against the game's own decoder with thumbsim. The ROM is
+# loaded at 0x08000000 and HuffmanTableTest.c decodes every
+# compressed string of the text table with both, once for
+# each table size from 8 to 12 bits.
+#
+# Prints one line per table size, either `BITS ok` or
+# `BITS mismatch at string INDEX`, and exits with 1 if any
+# string was decoded differently.
+#
+# Usage:  examples/bench/huffman.sh [-k BITS] ROM COUNT SYMBOL=ADDRESS...
+#
+# COUNT is the number of strings in the text table, and the
+# symbols are the ROM addresses of:
+#
+#   HuffmanOriginalDecomp  the game's ARM decoder, where it is
+#                          stored in ROM before being copied
+#                          to IWRAM
+#   gMsgStringTable        the text table
+#   gMsgHuffmanTable       the pointer to the Huffman tree
+#   gMsgHuffmanTableRoot   the pointer to its root node
+#
+# `-k BITS` tests a single table size.
+#
+# Environment:
+#   CC      ARM compiler (default arm-none-eabi-gcc)
+#   CFLAGS  extra flags, such as -I path/to/FE-CLib/include
+#   HOSTCC  host compiler for thumbsim (default cc)
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$here/../.." && pwd)
+
+sizes="8 9 10 11 12"
+if [ "$1" = "-k" ]; then
+  sizes=$2
+  shift 2
+fi
+
+if [ $# -lt 6 ]; then
+  echo "usage: huffman.sh [-k BITS] ROM COUNT SYMBOL=ADDRESS..." >&2
+  exit 2
+fi
+
+rom=$1
+count=$2
+shift 2
+
+defines=
+for symbol in "$@"; do
+  defines="$defines -D $symbol"
+done
+
+CC=${CC:-arm-none-eabi-gcc}
+HOSTCC=${HOSTCC:-cc}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+"$HOSTCC" -O2 -o "$work/thumbsim" "$root/tools/thumbsim.c"
+
+$CC -mcpu=arm7tdmi -mthumb -O2 -I "$root" $CFLAGS -c -o "$work/HuffmanTableTest.o" "$here/HuffmanTableTest.c"
+
+# The ROM takes the ROM region, so the code goes to EWRAM
+# and the table after it
+table=0x02030000
+
+status=0
+
+for bits in $sizes; do
+  $CC -mcpu=arm7tdmi -mthumb -O2 -I "$root" $CFLAGS -D HUFFMAN_TABLE_BITS="$bits" \
+    -c -o "$work/HuffmanTable.o" "$root/examples/HuffmanTable.c"
+
+  result=$("$work/thumbsim" -p ewram -l 0x08000000="$rom" -D gHuffmanTable=$table $defines \
+    -L 100000000000 -c HuffmanTableTest -r r0=0 -r r1="$count" \
+    "$work/HuffmanTableTest.o" "$work/HuffmanTable.o" |
+    sed -n 's/^  r0 = \(0x[0-9A-F]*\).*/\1/p')
+
+  if [ -z "$result" ]; then
+    echo "huffman.sh: the test failed to run with $bits bits" >&2
+    exit 2
+  fi
+
+  if [ "$result" = 0xFFFFFFFF ]; then
+    echo "$bits ok"
+  else
+    echo "$bits mismatch at string $((result))"
+    status=1
+  fi
+done
+
+exit $status
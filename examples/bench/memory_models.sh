@@ -0,0 +1,108 @@
+#!/bin/sh
+#
+# Memory model comparison
+#
+# Builds the examples with each `THUMBLIB_MEMORY_MODEL` and
+# counts the instructions emitted for every function with
+# thumbverify, including the ones GCC inserted between
+# opcodes. Each model is then checked for correctness by
+# running the Antihuffman benchmark with it, which fails if
+# any routine decodes a string wrongly.
+#
+# Prints one tab-separated line per model and function:
+#
+#   model function instructions inserted
+#
+# followed by one `total` line per model, where `correct` is
+# `yes` or `no`:
+#
+#   model total instructions inserted correct
+#
+# The output is meant to be saved and compared with `-b FILE`,
+# which adds the change in instructions against a previous
+# run and exits with 1 if any function grew or a model that
+# was correct no longer is.
+#
+# Usage:  examples/bench/memory_models.sh [-b BASELINE]
+#
+# Environment:
+#   CC      ARM compiler (default arm-none-eabi-gcc)
+#   CFLAGS  extra flags, such as -I path/to/FE-CLib/include
+#   HOSTCC  host compiler for thumbverify and thumbsim (default cc)
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$here/../.." && pwd)
+
+baseline=
+if [ "$1" = "-b" ]; then
+  baseline=$2
+  shift 2
+fi
+
+CC=${CC:-arm-none-eabi-gcc}
+HOSTCC=${HOSTCC:-cc}
+export CC HOSTCC
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+"$HOSTCC" -O2 -o "$work/thumbverify" "$root/tools/thumbverify.c"
+
+for model in OPERANDS CLOBBER REGISTERS; do
+  flags="-D THUMBLIB_MEMORY_MODEL=THUMBLIB_MEMORY_$model"
+
+  for name in AntihuffmanBody AntihuffmanPointerTester AntihuffmanWords StringWords; do
+    $CC -mcpu=arm7tdmi -mthumb -O2 -I "$root" $CFLAGS $flags -D THUMBLIB_ANNOTATE \
+      -c -o "$work/$name.o" "$root/examples/$name.c"
+    # thumbverify exits with 1 when it finds inserted instructions
+    "$work/thumbverify" "$work/$name.o" > "$work/$name.txt" || [ $? -eq 1 ]
+    sed -n '
+      /^  [^ ].*:$/ { s/^  \(.*\):$/\1/; h; }
+      /^    [0-9]* instructions, ok$/ { s/^    \([0-9]*\).*/\1	0/; H; x; s/\n/	/; p; }
+      /^    [0-9]* instructions, [0-9]* inserted/ { s/^    \([0-9]*\) instructions, \([0-9]*\) inserted.*/\1	\2/; H; x; s/\n/	/; p; }
+    ' "$work/$name.txt" | sed "s/^/$model	/"
+  done > "$work/$model.txt"
+
+  cat "$work/$model.txt"
+
+  correct=no
+  if CFLAGS="$CFLAGS $flags" "$here/antihuffman.sh" > /dev/null 2>&1; then
+    correct=yes
+  fi
+
+  awk -F '\t' -v OFS='\t' -v model="$model" -v correct="$correct" '
+    { instructions += $3; inserted += $4 }
+    END { print model, "total", instructions + 0, inserted + 0, correct }
+  ' "$work/$model.txt"
+done > "$work/summary.txt"
+
+if [ -z "$baseline" ]; then
+  cat "$work/summary.txt"
+  exit 0
+fi
+
+awk -F '\t' -v OFS='\t' '
+  NR == FNR {
+    previous[$1 OFS $2] = $3
+    if ($2 == "total")
+      wasCorrect[$1] = $5
+    next
+  }
+  {
+    key = $1 OFS $2
+    change = "new"
+    if (key in previous) {
+      change = sprintf("%+d", $3 - previous[key])
+      if ($3 > previous[key])
+        worse = 1
+    }
+    if ($2 == "total" && wasCorrect[$1] == "yes" && $5 != "yes")
+      worse = 1
+    print $0, change
+  }
+  END {
+    exit worse
+  }
+' "$baseline" "$work/summary.txt"
@@ -0,0 +1,120 @@
+#!/bin/sh
+#
+# Preprocessing benchmark
+#
+# Generates a source file with N thousand opcodes, spread
+# over THUMBLIB_FUNC functions of 100 opcodes each, once
+# with the overloaded opcodes (`LSL_I(a, b, 2)`) and once with
+# their fixed-arity forms (`LSL_I3(a, b, 2)`), and times
+# preprocessing and compiling each. Register lists are the
+# same in both.
+#
+# Prints one tab-separated line per variant:
+#
+#   variant opcodes preprocess_seconds compile_seconds
+#
+# Times are the best of 3 runs. Unless `-E` is given, it also
+# checks that both variants compile to the same assembly, and
+# exits with 1 if they don't.
+#
+# Usage:  examples/bench/preprocess.sh [-E] [THOUSANDS]
+#
+# Options:
+#   -E  only preprocess, so that any C compiler will do, as
+#       in `CC=cc CFLAGS=-Ipath/to/FE-CLib/include`
+#
+# THOUSANDS defaults to 10.
+#
+# Environment:
+#   CC      ARM compiler (default arm-none-eabi-gcc)
+#   CFLAGS  extra flags, such as -I path/to/FE-CLib/include
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$here/../.." && pwd)
+
+preprocessOnly=
+if [ "$1" = "-E" ]; then
+  preprocessOnly=1
+  shift
+fi
+thousands=${1:-10}
+
+CC=${CC:-arm-none-eabi-gcc}
+if [ -z "$preprocessOnly" ]; then
+  CFLAGS="-mcpu=arm7tdmi -mthumb -O2 $CFLAGS"
+fi
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# generate VARIANT
+# Prints the synthetic source for `overloaded` or `fixed`.
+generate() {
+  awk -v variant="$1" -v count="$((thousands * 1000))" '
+    BEGIN {
+      # Overloaded and fixed-arity spellings of each opcode
+      n = 0
+      overloaded[n] = "LSL_I(a, b, 2)";  fixed[n++] = "LSL_I3(a, b, 2)"
+      overloaded[n] = "LSR_I(a, 3)";     fixed[n++] = "LSR_I2(a, 3)"
+      overloaded[n] = "ADD_R(a, b, c)";  fixed[n++] = "ADD_R3(a, b, c)"
+      overloaded[n] = "SUB_R(a, b)";     fixed[n++] = "SUB_R2(a, b)"
+      overloaded[n] = "ADD_RI(a, b, 1)"; fixed[n++] = "ADD_RI3(a, b, 1)"
+      overloaded[n] = "LDR_I(a, b, 4)";  fixed[n++] = "LDR_I3(a, b, 4)"
+      overloaded[n] = "LDR(a, b)";       fixed[n++] = "LDR2(a, b)"
+      overloaded[n] = "STRB(a, b, c)";   fixed[n++] = "STRB3(a, b, c)"
+      overloaded[n] = "LDR_SP(a, 8)";    fixed[n++] = "LDR_SP2(a, 8)"
+      overloaded[n] = "PUSH(d, e)";      fixed[n++] = "PUSH(d, e)"
+      overloaded[n] = "POP(d, e)";       fixed[n++] = "POP(d, e)"
+
+      print "#include \"gbafe.h\""
+      print "#include \"thumblib3.h\""
+      for (i = 0; i < count; i++) {
+        if (i % 100 == 0) {
+          if (i)
+            print "  BX_LR();\n}\n"
+          printf "THUMBLIB_FUNC void Synthetic%d(void) {\n", i / 100
+          print "  register int a asm(\"r0\"), b asm(\"r1\"), c asm(\"r2\"), d asm(\"r4\"), e asm(\"r5\");"
+        }
+        print "  " (variant == "fixed" ? fixed[i % n] : overloaded[i % n])
+      }
+      print "  BX_LR();\n}"
+    }
+  '
+}
+
+# best COMMAND...
+# Runs COMMAND once to check it works, then prints the
+# shortest time of 3 more runs, in seconds.
+best() {
+  "$@" > /dev/null || return 1
+  for run in 1 2 3; do
+    start=$(date +%s.%N)
+    "$@" > /dev/null
+    end=$(date +%s.%N)
+    echo "$start $end"
+  done | awk '{ t = $2 - $1; if (NR == 1 || t < min) min = t } END { printf "%.3f\n", min }'
+}
+
+printf 'variant\topcodes\tpreprocess_seconds\tcompile_seconds\n'
+
+# Both variants are compiled from the same path, which GCC
+# writes into the assembly with `.file` and around each `asm`
+for variant in overloaded fixed; do
+  generate $variant > "$work/synthetic.c"
+
+  preprocess=$(best $CC -E -I "$root" $CFLAGS -o "$work/$variant.i" "$work/synthetic.c")
+  compile=-
+  if [ -z "$preprocessOnly" ]; then
+    compile=$(best $CC -S -I "$root" $CFLAGS -o "$work/$variant.s" "$work/synthetic.c")
+  fi
+
+  printf '%s\t%d\t%s\t%s\n' $variant $((thousands * 1000)) "$preprocess" "$compile"
+done
+
+if [ -z "$preprocessOnly" ] && ! cmp -s "$work/overloaded.s" "$work/fixed.s"; then
+  echo "preprocess.sh: the variants compiled to different code" >&2
+  diff "$work/overloaded.s" "$work/fixed.s" | head -20 >&2
+  exit 1
+fi
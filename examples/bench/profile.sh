@@ -0,0 +1,83 @@
+#!/bin/sh
+#
+# Profiling macro test
+#
+# Runs ProfileTest.c with thumbsim, which models the GBA's
+# timers, writes EWRAM to a file after the run and decodes the
+# profiling table in it with thumbprofile. No hardware or
+# emulator is needed.
+#
+# Prints the output of thumbprofile, then checks that:
+#
+#   * each id was called COUNT times
+#   * the cycles timed for the loop in ProfileSpin, minus the
+#     overhead timed by ProfileEmpty, are within 32 cycles of
+#     what thumbsim measures for the same loop on its own in
+#     ProfileSpinBare (which also pays for the call and return)
+#
+# and exits with 1 if either check fails.
+#
+# Usage:  examples/bench/profile.sh [COUNT]
+#
+# COUNT defaults to 50.
+#
+# Environment:
+#   CC      ARM compiler (default arm-none-eabi-gcc)
+#   CFLAGS  extra flags, such as -I path/to/FE-CLib/include
+#   HOSTCC  host compiler for thumbsim and thumbprofile (default cc)
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$here/../.." && pwd)
+
+count=${1:-50}
+
+CC=${CC:-arm-none-eabi-gcc}
+HOSTCC=${HOSTCC:-cc}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+"$HOSTCC" -O2 -o "$work/thumbsim" "$root/tools/thumbsim.c"
+"$HOSTCC" -O2 -o "$work/thumbprofile" "$root/tools/thumbprofile.c"
+
+$CC -mcpu=arm7tdmi -mthumb -O2 -I "$root" $CFLAGS -c -o "$work/ProfileTest.o" "$here/ProfileTest.c"
+
+printf '0 Spin\n1 Empty\n' > "$work/names.txt"
+
+"$work/thumbsim" -c ProfileTest -r r0="$count" -e r0="$count" -m "$work/ewram.bin" \
+  "$work/ProfileTest.o" > /dev/null
+
+"$work/thumbprofile" -n "$work/names.txt" -s 4 "$work/ewram.bin" | tee "$work/profile.txt"
+
+# ProfileSpinBare runs the same 100 iterations
+bare=$("$work/thumbsim" -c ProfileSpinBare -r r0=100 "$work/ProfileTest.o" |
+  sed -n 's/^ProfileSpinBare: \([0-9]*\) cycles.*/\1/p')
+
+# Only the totals, the recent samples list the same ids
+awk -v count="$count" -v bare="$bare" '
+  /^Recent samples/ {
+    exit
+  }
+  $1 == "Spin" || $1 == "Empty" {
+    calls[$1] = $2
+    average[$1] = $4
+  }
+  END {
+    status = 0
+    split("Spin Empty", ids, " ")
+    for (i = 1; i <= 2; i++)
+      if (calls[ids[i]] != count) {
+        printf "%s: %d calls, expected %d\n", ids[i], calls[ids[i]], count
+        status = 1
+      }
+    loop = average["Spin"] - average["Empty"]
+    printf "\nloop: %d cycles profiled, %d with thumbsim\n", loop, bare
+    if (loop > bare || loop < bare - 32) {
+      print "loop: profiled cycles out of range"
+      status = 1
+    }
+    exit status
+  }
+' "$work/profile.txt"
@@ -0,0 +1,101 @@
+#!/bin/sh
+#
+# String cache benchmark
+#
+# Replays a trace of text indices through the string cache
+# in examples/StringCache.c with thumbsim, and through
+# GetStringFromIndex_Replacement without it. Every index of
+# the trace is given the text of a line of corpus.txt, in
+# the order they first appear.
+#
+# Prints a tab-separated header and one line of results:
+#
+#   calls hits hit_rate uncached_cycles cached_cycles cycles_saved
+#
+# The game's decoder is replaced by a copy of the text, which
+# is cheaper than decoding it, so `cycles_saved` is a lower
+# bound.
+#
+# Usage:  examples/bench/string_cache.sh [TRACE] [CORPUS]
+#
+# TRACE has one text index per line, in decimal or with a
+# `0x` prefix, and lines starting with `#` are ignored. It
+# defaults to trace.txt, a synthetic trace of menus and
+# dialogue.
+#
+# Environment:
+#   CC      ARM compiler (default arm-none-eabi-gcc)
+#   CFLAGS  extra flags, such as -I path/to/FE-CLib/include
+#   HOSTCC  host compiler for thumbsim (default cc)
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$here/../.." && pwd)
+
+trace=${1:-$here/trace.txt}
+corpus=${2:-$here/corpus.txt}
+
+CC=${CC:-arm-none-eabi-gcc}
+HOSTCC=${HOSTCC:-cc}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+"$HOSTCC" -O2 -o "$work/thumbsim" "$root/tools/thumbsim.c"
+
+grep -v '^#' "$trace" | grep -v '^[[:space:]]*$' > "$work/trace.txt"
+
+awk '
+  BEGIN { print "const unsigned short gStringCacheTrace[] = {" }
+  { print "  " $1 "," }
+  END { print "};"; print "const int gStringCacheTraceLength = " NR ";" }
+' "$work/trace.txt" > "$work/StringCacheTrace.c"
+
+for source in "$root/examples/StringCache.c" "$root/examples/AntihuffmanBody.c" \
+              "$here/StringCacheReplay.c" "$work/StringCacheTrace.c"; do
+  name=$(basename "$source" .c)
+  $CC -mcpu=arm7tdmi -mthumb -O2 -I "$root" $CFLAGS -c -o "$work/$name.o" "$source"
+done
+
+objects="$work/StringCache.o $work/AntihuffmanBody.o $work/StringCacheReplay.o $work/StringCacheTrace.o"
+
+# Must match StringCacheReplay.c
+text=0x08100000
+stride=0x100
+
+# One `-s` option per distinct index, cycling through the
+# corpus
+lines=$(grep -c '' "$corpus")
+set --
+for index in $(awk '!seen[$1]++ { print $1 }' "$work/trace.txt"); do
+  line=$(sed -n "$(($# / 2 % lines + 1))p" "$corpus")
+  set -- "$@" -s "$(printf '0x%08X' $((text + index * stride)))=$line"
+done
+
+# run FUNCTION [thumbsim options...]
+# Prints the cycles taken and r0.
+run() {
+  function=$1
+  shift
+  "$work/thumbsim" -D gCurrentTextString=0x02030000 -D gStringCache=0x02031000 \
+    -L 1000000000 -c "$function" "$@" $objects |
+    sed -n "s/^$function: \([0-9]*\) cycles.*/\1/p; s/^  r0 = \(0x[0-9A-F]*\).*/\1/p" | tr '\n' ' '
+}
+
+set -- $(run StringCacheReplayUncached "$@") $(run StringCacheReplayCached "$@")
+uncached=$1
+cached=$3
+hits=$(($4))
+
+if [ -z "$uncached" ] || [ -z "$cached" ]; then
+  echo "string_cache.sh: the replay failed" >&2
+  exit 2
+fi
+
+calls=$(grep -c '' "$work/trace.txt")
+
+printf 'calls\thits\thit_rate\tuncached_cycles\tcached_cycles\tcycles_saved\n'
+awk -v OFS='\t' -v calls="$calls" -v hits="$hits" -v uncached="$uncached" -v cached="$cached" '
+  BEGIN { print calls, hits, sprintf("%.1f%%", hits * 100 / calls), uncached, cached, uncached - cached }
+'
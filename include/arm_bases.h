@@ -0,0 +1,468 @@
+
+#ifndef THUMBLIB_3_ARM_BASES
+#define THUMBLIB_3_ARM_BASES
+
+  /* THUMBLIB3 ARM opcode base macros
+   *
+   * These macros are used to construct ARM opcodes and
+   * their overloads. See `include/arm_opcodes.h` for a final
+   * list of ARM opcodes and their usage.
+   *
+   * Every base takes the opcode's name and suffix as strings
+   * and a condition token (`AL`, `EQ`, `NE`, ...) which is
+   * placed between them, as GCC hands inline assembly to the
+   * assembler in divided syntax (`addeqs`, `ldrneb`, `ldmeqia`).
+   */
+
+  // Condition helpers
+
+    /* _THUMBLIB_ARM_COND(Cond)
+     *
+     * Expands to the condition suffix string for the
+     * condition token `Cond`.
+     *
+     * _THUMBLIB_ARM_EXEC(Cond)
+     *
+     * Expands to `ALWAYS` for `AL` and `CONDITIONAL` for every
+     * other condition. A conditional instruction might not
+     * write its destination, so outputs of conditional
+     * instructions are `+r` rather than `=r`.
+     */
+
+    #define _THUMBLIB_ARM_COND(Cond) _THUMBLIB_ARM_COND_##Cond
+    #define _THUMBLIB_ARM_EXEC(Cond) _THUMBLIB_ARM_EXEC_##Cond
+
+    // Full mnemonic of an opcode, such as `addeqs`
+    #define _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) Opcode _THUMBLIB_ARM_COND(Cond) Suffix
+
+    #define _THUMBLIB_ARM_COND_EQ "eq"
+    #define _THUMBLIB_ARM_COND_NE "ne"
+    #define _THUMBLIB_ARM_COND_CS "cs"
+    #define _THUMBLIB_ARM_COND_CC "cc"
+    #define _THUMBLIB_ARM_COND_HS "cs"
+    #define _THUMBLIB_ARM_COND_LO "cc"
+    #define _THUMBLIB_ARM_COND_MI "mi"
+    #define _THUMBLIB_ARM_COND_PL "pl"
+    #define _THUMBLIB_ARM_COND_VS "vs"
+    #define _THUMBLIB_ARM_COND_VC "vc"
+    #define _THUMBLIB_ARM_COND_HI "hi"
+    #define _THUMBLIB_ARM_COND_LS "ls"
+    #define _THUMBLIB_ARM_COND_GE "ge"
+    #define _THUMBLIB_ARM_COND_LT "lt"
+    #define _THUMBLIB_ARM_COND_GT "gt"
+    #define _THUMBLIB_ARM_COND_LE "le"
+    #define _THUMBLIB_ARM_COND_AL ""
+
+    #define _THUMBLIB_ARM_EXEC_EQ CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_NE CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_CS CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_CC CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_HS CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_LO CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_MI CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_PL CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_VS CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_VC CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_HI CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_LS CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_GE CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_LT CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_GT CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_LE CONDITIONAL
+    #define _THUMBLIB_ARM_EXEC_AL ALWAYS
+
+    // Annotation kind of an ARM opcode
+    #define _THUMBLIB_ARM_KIND(Kind, Cond) \
+      (Kind | _THUMBLIB_KIND_ARM | _THUMBLIB_CONCAT(_THUMBLIB_ARM_KIND_, _THUMBLIB_ARM_EXEC(Cond)))
+
+    #define _THUMBLIB_ARM_KIND_ALWAYS 0
+    #define _THUMBLIB_ARM_KIND_CONDITIONAL _THUMBLIB_KIND_CONDITIONAL
+
+    // Output constraint of an ARM opcode's destination
+    #define _THUMBLIB_ARM_OUT(Cond) _THUMBLIB_CONCAT(_THUMBLIB_ARM_OUT_, _THUMBLIB_ARM_EXEC(Cond))
+
+    #define _THUMBLIB_ARM_OUT_ALWAYS "=r"
+    #define _THUMBLIB_ARM_OUT_CONDITIONAL "+r"
+
+    /* _THUMBLIB_ARM_OUTPUT(Cond) and _THUMBLIB_ARM_OUTPUT_LAST(Cond)
+     *
+     * These expand to the names of `_THUMBLIB_FOR_EACH_REG`
+     * macros that make a list of output operands using the
+     * constraint for `Cond`.
+     */
+    #define _THUMBLIB_ARM_OUTPUT(Cond) _THUMBLIB_CONCAT(_THUMBLIB_ARM_OUTPUT_, _THUMBLIB_ARM_EXEC(Cond))
+    #define _THUMBLIB_ARM_OUTPUT_LAST(Cond) _THUMBLIB_CONCAT(_THUMBLIB_ARM_OUTPUT_LAST_, _THUMBLIB_ARM_EXEC(Cond))
+
+    #define _THUMBLIB_ARM_OUTPUT_ALWAYS(Reg) [_##Reg] "=r" (Reg),
+    #define _THUMBLIB_ARM_OUTPUT_LAST_ALWAYS(Reg) [_##Reg] "=r" (Reg)
+    #define _THUMBLIB_ARM_OUTPUT_CONDITIONAL(Reg) [_##Reg] "+r" (Reg),
+    #define _THUMBLIB_ARM_OUTPUT_LAST_CONDITIONAL(Reg) [_##Reg] "+r" (Reg)
+
+  // Barrel shifter helpers
+
+    // Expands to the shift name for `LSL`, `LSR`, `ASR` or `ROR`.
+    #define _THUMBLIB_ARM_SHIFT(Shift) _THUMBLIB_ARM_SHIFT_##Shift
+
+    #define _THUMBLIB_ARM_SHIFT_LSL "lsl"
+    #define _THUMBLIB_ARM_SHIFT_LSR "lsr"
+    #define _THUMBLIB_ARM_SHIFT_ASR "asr"
+    #define _THUMBLIB_ARM_SHIFT_ROR "ror"
+
+  // LDM/STM addressing mode helpers
+
+    // Expands to the mode name for `IA`, `IB`, `DA` or `DB`.
+    #define _THUMBLIB_ARM_MODE(Mode) _THUMBLIB_ARM_MODE_##Mode
+
+    #define _THUMBLIB_ARM_MODE_IA "ia"
+    #define _THUMBLIB_ARM_MODE_IB "ib"
+    #define _THUMBLIB_ARM_MODE_DA "da"
+    #define _THUMBLIB_ARM_MODE_DB "db"
+
+  // `data processing` with 3 registers
+
+    #define ARM_DP3_R_BASE(Opcode, Suffix, Cond, Rd, Rn, Rm)                                                           \
+      asm THUMBLIB_OP_FLAGS (                                                                                          \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_DATA, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], %[_Rn], %[_Rm]"                                               \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd)                                                                           \
+        : [_Rn] "r" (Rn), [_Rm] "r" (Rm)                                                                               \
+        : "cc"                                                                                                         \
+      );
+
+  // `data processing` with 3 registers, the last shifted
+  // by an immediate
+
+    #define ARM_DP3_SHIFT_BASE(Opcode, Suffix, Cond, Rd, Rn, Rm, Shift, Amount)                                        \
+      asm THUMBLIB_OP_FLAGS (                                                                                          \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_DATA, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], %[_Rn], %[_Rm], " _THUMBLIB_ARM_SHIFT(Shift) " %[_Amount]"    \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd)                                                                           \
+        : [_Rn] "r" (Rn), [_Rm] "r" (Rm), [_Amount] "M" (Amount)                                                       \
+        : "cc"                                                                                                         \
+      );
+
+    #define ARM_DP3_5(Opcode, Suffix, Cond, Rd, Rm, ...) ARM_DP3_R_BASE(Opcode, Suffix, Cond, Rd, Rd, Rm)
+    #define ARM_DP3_6(Opcode, Suffix, Cond, Rd, Rn, Rm, ...) ARM_DP3_R_BASE(Opcode, Suffix, Cond, Rd, Rn, Rm)
+    #define ARM_DP3_7(Opcode, Suffix, Cond, Rd, Rm, Shift, Amount, ...) ARM_DP3_SHIFT_BASE(Opcode, Suffix, Cond, Rd, Rd, Rm, Shift, Amount)
+    #define ARM_DP3_8(Opcode, Suffix, Cond, Rd, Rn, Rm, Shift, Amount, ...) ARM_DP3_SHIFT_BASE(Opcode, Suffix, Cond, Rd, Rn, Rm, Shift, Amount)
+
+  // `data processing` with 3 registers, the last shifted
+  // by a register
+
+    #define ARM_DP3_RS_BASE(Opcode, Suffix, Cond, Rd, Rn, Rm, Shift, Rs)                                                       \
+      asm THUMBLIB_OP_FLAGS (                                                                                                  \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_DATA_SHIFT_R, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], %[_Rn], %[_Rm], " _THUMBLIB_ARM_SHIFT(Shift) " %[_Rs]"                \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd)                                                                                   \
+        : [_Rn] "r" (Rn), [_Rm] "r" (Rm), [_Rs] "r" (Rs)                                                                       \
+        : "cc"                                                                                                                 \
+      );
+
+  // `data processing` with 2 registers and a
+  // rotated 8-bit immediate
+
+    #define ARM_DP3_I_BASE(Opcode, Suffix, Cond, Rd, Rn, Immediate)                                                    \
+      asm THUMBLIB_OP_FLAGS (                                                                                          \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_DATA, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], %[_Rn], %[_Immediate]"                                        \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd)                                                                           \
+        : [_Rn] "r" (Rn), [_Immediate] "I" (Immediate)                                                                 \
+        : "cc"                                                                                                         \
+      );
+
+    #define ARM_DP3_I_5(Opcode, Suffix, Cond, Rd, Immediate, ...) ARM_DP3_I_BASE(Opcode, Suffix, Cond, Rd, Rd, Immediate)
+    #define ARM_DP3_I_6(Opcode, Suffix, Cond, Rd, Rn, Immediate, ...) ARM_DP3_I_BASE(Opcode, Suffix, Cond, Rd, Rn, Immediate)
+
+  // `data processing` with one source operand, for
+  // `mov` and `mvn`
+
+    #define ARM_DP2_R_BASE(Opcode, Suffix, Cond, Rd, Rm)                                                               \
+      asm THUMBLIB_OP_FLAGS (                                                                                          \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_DATA, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], %[_Rm]"                                                       \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd)                                                                           \
+        : [_Rm] "r" (Rm)                                                                                               \
+        : "cc"                                                                                                         \
+      );
+
+    #define ARM_DP2_SHIFT_BASE(Opcode, Suffix, Cond, Rd, Rm, Shift, Amount)                                            \
+      asm THUMBLIB_OP_FLAGS (                                                                                          \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_DATA, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], %[_Rm], " _THUMBLIB_ARM_SHIFT(Shift) " %[_Amount]"            \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd)                                                                           \
+        : [_Rm] "r" (Rm), [_Amount] "M" (Amount)                                                                       \
+        : "cc"                                                                                                         \
+      );
+
+    #define ARM_DP2_5(Opcode, Suffix, Cond, Rd, Rm, ...) ARM_DP2_R_BASE(Opcode, Suffix, Cond, Rd, Rm)
+    #define ARM_DP2_7(Opcode, Suffix, Cond, Rd, Rm, Shift, Amount, ...) ARM_DP2_SHIFT_BASE(Opcode, Suffix, Cond, Rd, Rm, Shift, Amount)
+
+    #define ARM_DP2_RS_BASE(Opcode, Suffix, Cond, Rd, Rm, Shift, Rs)                                                           \
+      asm THUMBLIB_OP_FLAGS (                                                                                                  \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_DATA_SHIFT_R, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], %[_Rm], " _THUMBLIB_ARM_SHIFT(Shift) " %[_Rs]"                        \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd)                                                                                   \
+        : [_Rm] "r" (Rm), [_Rs] "r" (Rs)                                                                                       \
+        : "cc"                                                                                                                 \
+      );
+
+    #define ARM_DP2_I_BASE(Opcode, Suffix, Cond, Rd, Immediate)                                                        \
+      asm THUMBLIB_OP_FLAGS (                                                                                          \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_DATA, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], %[_Immediate]"                                                \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd)                                                                           \
+        : [_Immediate] "I" (Immediate)                                                                                 \
+        : "cc"                                                                                                         \
+      );
+
+  // `data processing` with no output, for `tst`,
+  // `teq`, `cmp` and `cmn`
+
+    #define ARM_TEST_R_BASE(Opcode, Cond, Rn, Rm)                                                                  \
+      asm THUMBLIB_OP_FLAGS (                                                                                      \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_DATA, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, "")) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, "") " %[_Rn], %[_Rm]"                                                       \
+        :                                                                                                          \
+        : [_Rn] "r" (Rn), [_Rm] "r" (Rm)                                                                           \
+        : "cc"                                                                                                     \
+      );
+
+    #define ARM_TEST_SHIFT_BASE(Opcode, Cond, Rn, Rm, Shift, Amount)                                               \
+      asm THUMBLIB_OP_FLAGS (                                                                                      \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_DATA, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, "")) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, "") " %[_Rn], %[_Rm], " _THUMBLIB_ARM_SHIFT(Shift) " %[_Amount]"            \
+        :                                                                                                          \
+        : [_Rn] "r" (Rn), [_Rm] "r" (Rm), [_Amount] "M" (Amount)                                                   \
+        : "cc"                                                                                                     \
+      );
+
+    #define ARM_TEST_4(Opcode, Cond, Rn, Rm, ...) ARM_TEST_R_BASE(Opcode, Cond, Rn, Rm)
+    #define ARM_TEST_6(Opcode, Cond, Rn, Rm, Shift, Amount, ...) ARM_TEST_SHIFT_BASE(Opcode, Cond, Rn, Rm, Shift, Amount)
+
+    #define ARM_TEST_I_BASE(Opcode, Cond, Rn, Immediate)                                                           \
+      asm THUMBLIB_OP_FLAGS (                                                                                      \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_DATA, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, "")) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, "") " %[_Rn], %[_Immediate]"                                                \
+        :                                                                                                          \
+        : [_Rn] "r" (Rn), [_Immediate] "I" (Immediate)                                                             \
+        : "cc"                                                                                                     \
+      );
+
+  // `multiply` and `multiply accumulate`
+
+    // Assembler error when the operands named by the strings
+    // `First` and `Second` were given the same register. An
+    // early-clobber output would keep it apart from every
+    // input instead, rejecting legal forms like
+    // `mla Rd, Rm, Rs, Rd`.
+    #define _THUMBLIB_ARM_DIFFERENT(Opcode, First, Second)                                                 \
+      ".ifc %[_" First "], %[_" Second "]\n\t"                                                             \
+      ".error \"" Opcode ": " First " and " Second " must be different registers, not %[_" First "]\"\n\t" \
+      ".endif\n\t"
+
+    // The ARM7TDMI requires `Rd` and `Rm` to be
+    // different registers.
+    #define ARM_MUL_BASE(Opcode, Suffix, Cond, Rd, Rm, Rs)                                                                 \
+      asm THUMBLIB_OP_FLAGS (                                                                                              \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_MULTIPLY, Cond), 0, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_DIFFERENT(Opcode, "Rd", "Rm")                                                                        \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], %[_Rm], %[_Rs]"                                                   \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd)                                                                               \
+        : [_Rm] "r" (Rm), [_Rs] "r" (Rs)                                                                                   \
+        : "cc"                                                                                                             \
+      );
+
+    #define ARM_MLA_BASE(Opcode, Suffix, Cond, Rd, Rm, Rs, Rn)                                                             \
+      asm THUMBLIB_OP_FLAGS (                                                                                              \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_MULTIPLY, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_DIFFERENT(Opcode, "Rd", "Rm")                                                                        \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], %[_Rm], %[_Rs], %[_Rn]"                                           \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd)                                                                               \
+        : [_Rm] "r" (Rm), [_Rs] "r" (Rs), [_Rn] "r" (Rn)                                                                   \
+        : "cc"                                                                                                             \
+      );
+
+  // `multiply long`, `RdLo`, `RdHi` and `Rm` must all
+  // be different registers
+
+    #define ARM_MULL_BASE(Opcode, Suffix, Cond, RdLo, RdHi, Rm, Rs)                                                        \
+      asm THUMBLIB_OP_FLAGS (                                                                                              \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_MULTIPLY, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_DIFFERENT(Opcode, "RdLo", "Rm")                                                                      \
+        _THUMBLIB_ARM_DIFFERENT(Opcode, "RdHi", "Rm")                                                                      \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_RdLo], %[_RdHi], %[_Rm], %[_Rs]"                                       \
+        : [_RdLo] _THUMBLIB_ARM_OUT(Cond) (RdLo), [_RdHi] _THUMBLIB_ARM_OUT(Cond) (RdHi)                                   \
+        : [_Rm] "r" (Rm), [_Rs] "r" (Rs)                                                                                   \
+        : "cc"                                                                                                             \
+      );
+
+    #define ARM_MLAL_BASE(Opcode, Suffix, Cond, RdLo, RdHi, Rm, Rs)                                                        \
+      asm THUMBLIB_OP_FLAGS (                                                                                              \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_MULTIPLY, Cond), 2, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_DIFFERENT(Opcode, "RdLo", "Rm")                                                                      \
+        _THUMBLIB_ARM_DIFFERENT(Opcode, "RdHi", "Rm")                                                                      \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_RdLo], %[_RdHi], %[_Rm], %[_Rs]"                                       \
+        : [_RdLo] "+r" (RdLo), [_RdHi] "+r" (RdHi)                                                                         \
+        : [_Rm] "r" (Rm), [_Rs] "r" (Rs)                                                                                   \
+        : "cc"                                                                                                             \
+      );
+
+  // `store` with 2 or 3 registers
+
+    // Conditional stores might not write, so the
+    // memory operand is `+m` rather than `=m`.
+    #define ARM_STR_R_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, Rm)                                                      \
+      asm THUMBLIB_OP_FLAGS (                                                                                           \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_STORE, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], [%[_Rn], %[_Rm]]"                                              \
+        : _THUMBLIB_MEM_OPERAND("+m", Size, (int)Rn + (int)Rm)                                                          \
+        : [_Rd] "r" (Rd), [_Rn] "r" (Rn), [_Rm] "r" (Rm)                                                                \
+        : _THUMBLIB_MEM_CLOBBER                                                                                         \
+      );
+
+    #define ARM_STR_SHIFT_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, Rm, Shift, Amount)                                   \
+      asm THUMBLIB_OP_FLAGS (                                                                                           \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_STORE, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], [%[_Rn], %[_Rm], " _THUMBLIB_ARM_SHIFT(Shift) " %[_Amount]]"   \
+        :                                                                                                               \
+        : [_Rd] "r" (Rd), [_Rn] "r" (Rn), [_Rm] "r" (Rm), [_Amount] "M" (Amount)                                        \
+        : "memory"                                                                                                      \
+      );
+
+  // `store` with 2 registers and an immediate
+
+    // `J` allows offsets of up to 4095 bytes, halfword
+    // stores only take up to 255 and the assembler will
+    // complain about the rest.
+    #define ARM_STR_I_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, Immediate)                                               \
+      asm THUMBLIB_OP_FLAGS (                                                                                           \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_STORE, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], [%[_Rn], %[_Immediate]]"                                       \
+        : _THUMBLIB_MEM_OPERAND("+m", Size, (int)Rn + Immediate)                                                        \
+        : [_Rd] "r" (Rd), [_Rn] "r" (Rn), [_Immediate] "J" (Immediate)                                                  \
+        : _THUMBLIB_MEM_CLOBBER                                                                                         \
+      );
+
+    // Post-indexed, stores to `[Rn]` then adds `Immediate` to `Rn`
+    #define ARM_STR_POST_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, Immediate)                                            \
+      asm THUMBLIB_OP_FLAGS (                                                                                           \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_STORE, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], [%[_Rn]], %[_Immediate]"                                       \
+        : [_Rn] "+r" (Rn) _THUMBLIB_MEM_OPERAND_NEXT("+m", Size, Rn)                                                    \
+        : [_Rd] "r" (Rd), [_Immediate] "J" (Immediate)                                                                  \
+        : _THUMBLIB_MEM_CLOBBER                                                                                         \
+      );
+
+    // Pre-indexed, adds `Immediate` to `Rn` then stores to `[Rn]`
+    #define ARM_STR_PRE_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, Immediate)                                             \
+      asm THUMBLIB_OP_FLAGS (                                                                                           \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_STORE, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], [%[_Rn], %[_Immediate]]!"                                      \
+        : [_Rn] "+r" (Rn) _THUMBLIB_MEM_OPERAND_NEXT("+m", Size, (int)Rn + Immediate)                                   \
+        : [_Rd] "r" (Rd), [_Immediate] "J" (Immediate)                                                                  \
+        : _THUMBLIB_MEM_CLOBBER                                                                                         \
+      );
+
+    #define ARM_STR_6(Opcode, Suffix, Size, Cond, Rd, Rn, ...) ARM_STR_I_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, 0)
+    #define ARM_STR_7(Opcode, Suffix, Size, Cond, Rd, Rn, Rm, ...) ARM_STR_R_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, Rm)
+    #define ARM_STR_9(Opcode, Suffix, Size, Cond, Rd, Rn, Rm, Shift, Amount, ...) ARM_STR_SHIFT_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, Rm, Shift, Amount)
+
+  // `load` with 2 or 3 registers
+
+    #define ARM_LDR_R_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, Rm)                                                     \
+      asm THUMBLIB_OP_FLAGS (                                                                                          \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_LOAD, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], [%[_Rn], %[_Rm]]"                                             \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd)                                                                           \
+        : [_Rn] "r" (Rn), [_Rm] "r" (Rm) _THUMBLIB_MEM_OPERAND_NEXT("m", Size, (int)Rn + (int)Rm)                      \
+        : _THUMBLIB_MEM_CLOBBER                                                                                        \
+      );
+
+    #define ARM_LDR_SHIFT_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, Rm, Shift, Amount)                                  \
+      asm THUMBLIB_OP_FLAGS (                                                                                          \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_LOAD, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], [%[_Rn], %[_Rm], " _THUMBLIB_ARM_SHIFT(Shift) " %[_Amount]]"  \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd)                                                                           \
+        : [_Rn] "r" (Rn), [_Rm] "r" (Rm), [_Amount] "M" (Amount)                                                       \
+        : "memory"                                                                                                     \
+      );
+
+  // `load` with 2 registers and an immediate
+
+    // See `ARM_STR_I_BASE` comments.
+    #define ARM_LDR_I_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, Immediate)                                              \
+      asm THUMBLIB_OP_FLAGS (                                                                                          \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_LOAD, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], [%[_Rn], %[_Immediate]]"                                      \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd)                                                                           \
+        : [_Rn] "r" (Rn), [_Immediate] "J" (Immediate) _THUMBLIB_MEM_OPERAND_NEXT("m", Size, (int)Rn + Immediate)      \
+        : _THUMBLIB_MEM_CLOBBER                                                                                        \
+      );
+
+    // Post-indexed, loads from `[Rn]` then adds `Immediate` to `Rn`
+    #define ARM_LDR_POST_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, Immediate)                                           \
+      asm THUMBLIB_OP_FLAGS (                                                                                          \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_LOAD, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], [%[_Rn]], %[_Immediate]"                                      \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd), [_Rn] "+r" (Rn)                                                          \
+        : [_Immediate] "J" (Immediate) _THUMBLIB_MEM_OPERAND_NEXT("m", Size, Rn)                                       \
+        : _THUMBLIB_MEM_CLOBBER                                                                                        \
+      );
+
+    // Pre-indexed, adds `Immediate` to `Rn` then loads from `[Rn]`
+    #define ARM_LDR_PRE_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, Immediate)                                            \
+      asm THUMBLIB_OP_FLAGS (                                                                                          \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_LOAD, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, Suffix)) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, Suffix) " %[_Rd], [%[_Rn], %[_Immediate]]!"                                     \
+        : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd), [_Rn] "+r" (Rn)                                                          \
+        : [_Immediate] "J" (Immediate) _THUMBLIB_MEM_OPERAND_NEXT("m", Size, (int)Rn + Immediate)                      \
+        : _THUMBLIB_MEM_CLOBBER                                                                                        \
+      );
+
+    #define ARM_LDR_6(Opcode, Suffix, Size, Cond, Rd, Rn, ...) ARM_LDR_I_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, 0)
+    #define ARM_LDR_7(Opcode, Suffix, Size, Cond, Rd, Rn, Rm, ...) ARM_LDR_R_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, Rm)
+    #define ARM_LDR_9(Opcode, Suffix, Size, Cond, Rd, Rn, Rm, Shift, Amount, ...) ARM_LDR_SHIFT_BASE(Opcode, Suffix, Size, Cond, Rd, Rn, Rm, Shift, Amount)
+
+  // `load/store multiple`
+
+    #define ARM_STM_BASE(Cond, Mode, Writeback, Rb, Registers...)                         \
+      asm THUMBLIB_OP_FLAGS (                                                             \
+        _THUMBLIB_ANNOTATION(                                                             \
+          _THUMBLIB_ARM_KIND(_THUMBLIB_KIND_STORE_MULTIPLE, Cond),                        \
+          _THUMBLIB_NARG(Registers),                                                      \
+          _THUMBLIB_ARM_OP("stm", Cond, _THUMBLIB_ARM_MODE(Mode))                         \
+        )                                                                                 \
+        _THUMBLIB_ARM_OP("stm", Cond, _THUMBLIB_ARM_MODE(Mode)) " %[_Rb]" Writeback ", {" \
+        _THUMBLIB_FOR_EACH_REG(_THUMBLIB_REGLIST, _THUMBLIB_REGLIST_LAST, Registers) "}"  \
+        : [_Rb] "+r" (Rb)                                                                 \
+        : _THUMBLIB_FOR_EACH_REG(_THUMBLIB_INPUT, _THUMBLIB_INPUT_LAST, Registers)        \
+        : "memory"                                                                        \
+      );
+
+    #define ARM_LDM_BASE(Cond, Mode, Writeback, Rb, Registers...)                                                         \
+      asm THUMBLIB_OP_FLAGS (                                                                                             \
+        _THUMBLIB_ANNOTATION(                                                                                             \
+          _THUMBLIB_ARM_KIND(_THUMBLIB_KIND_LOAD_MULTIPLE, Cond),                                                         \
+          _THUMBLIB_NARG(Registers),                                                                                      \
+          _THUMBLIB_ARM_OP("ldm", Cond, _THUMBLIB_ARM_MODE(Mode))                                                         \
+        )                                                                                                                 \
+        _THUMBLIB_ARM_OP("ldm", Cond, _THUMBLIB_ARM_MODE(Mode)) " %[_Rb]" Writeback ", {"                                 \
+        _THUMBLIB_FOR_EACH_REG(_THUMBLIB_REGLIST, _THUMBLIB_REGLIST_LAST, Registers) "}"                                  \
+        : [_Rb] "+r" (Rb), _THUMBLIB_FOR_EACH_REG(_THUMBLIB_ARM_OUTPUT(Cond), _THUMBLIB_ARM_OUTPUT_LAST(Cond), Registers) \
+        :                                                                                                                 \
+        : "memory"                                                                                                        \
+      );
+
+  // conditional branches
+
+    #define ARM_BRANCH_BASE(Opcode, Kind, Cond, Label)                                              \
+      asm goto THUMBLIB_OP_FLAGS (                                                                  \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(Kind, Cond), 1, _THUMBLIB_ARM_OP(Opcode, Cond, "")) \
+        _THUMBLIB_ARM_OP(Opcode, Cond, "") " %l0"                                                   \
+        :                                                                                           \
+        :                                                                                           \
+        : "memory"                                                                                  \
+        : Label                                                                                     \
+      );
+
+#endif // THUMBLIB_3_ARM_BASES
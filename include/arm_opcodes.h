@@ -0,0 +1,413 @@
+
+#ifndef THUMBLIB_3_ARM_OPCODES
+#define THUMBLIB_3_ARM_OPCODES
+
+  /* THUMBLIB3 ARM opcode listing
+   *
+   * This file defines the ARM opcodes provided by the
+   * library and documents their usage. They are meant for
+   * hot loops placed in IWRAM, where 32-bit ARM instructions
+   * are fetched in a single cycle.
+   *
+   * ARM opcodes can be used in two ways:
+   *
+   * - In a function marked `THUMBLIB_ARM_FUNC` or
+   *   `THUMBLIB_IWRAM_ARM_FUNC`, which is assembled in
+   *   ARM state from start to end.
+   * - In a THUMB `THUMBLIB_FUNC` between `ENTER_ARM()` and
+   *   `ENTER_THUMB(Rs)`. Only THUMBLIB opcodes may appear
+   *   between the two, as the compiler doesn't know about
+   *   the state change.
+   */
+
+  /* Opcode cheat sheet
+   *
+   * Every opcode takes a condition as its first parameter:
+   * `AL` (always), `EQ`, `NE`, `CS`/`HS`, `CC`/`LO`, `MI`, `PL`,
+   * `VS`, `VC`, `HI`, `LS`, `GE`, `LT`, `GT` or `LE`.
+   *
+   * Any register r0-r14 may be used. Op2 below is one of
+   *
+   * Rm                 | Rm
+   * Rm, Shift, Imm5bit | Rm, lsl #nn
+   *
+   * where Shift is `LSL`, `LSR`, `ASR` or `ROR`. The `_RS` variants
+   * shift Rm by a register instead, and the `_I` variants take
+   * an immediate instead of Op2.
+   *
+   * THUMBLIB syntax                      | ARM syntax                | Explanation
+   *                                      |                           |
+   * ARM_MOV(Cond, Rd, Op2)               | mov Rd, Op2               | Rd = Op2
+   * ARM_MOV_RS(Cond, Rd, Rm, Sh, Rs)     | mov Rd, Rm, lsl Rs        | Rd = Rm SHL (Rs AND 0xFF)
+   * ARM_MOV_I(Cond, Rd, Imm)             | mov Rd, #nn               | Rd = nn
+   * ARM_MVN(Cond, Rd, Op2)               | mvn Rd, Op2               | Rd = NOT Op2
+   * ARM_ADD(Cond, Rd, Rn, Op2)           | add Rd, Rn, Op2           | Rd = Rn + Op2
+   * ARM_ADD(Cond, Rd, Op2)               | add Rd, Rd, Op2           | Rd = Rd + Op2
+   * ARM_ADD_RS(Cond, Rd, Rn, Rm, Sh, Rs) | add Rd, Rn, Rm, lsl Rs    | Rd = Rn + (Rm SHL Rs)
+   * ARM_ADD_I(Cond, Rd, Rn, Imm)         | add Rd, Rn, #nn           | Rd = Rn + nn
+   * ARM_ADD_I(Cond, Rd, Imm)             | add Rd, Rd, #nn           | Rd = Rd + nn
+   * ARM_ADC(...)                         | adc ...                   | Rd = Rn + Op2 + Cy
+   * ARM_SUB(...)                         | sub ...                   | Rd = Rn - Op2
+   * ARM_SBC(...)                         | sbc ...                   | Rd = Rn - Op2 - (NOT Cy)
+   * ARM_RSB(...)                         | rsb ...                   | Rd = Op2 - Rn
+   * ARM_RSC(...)                         | rsc ...                   | Rd = Op2 - Rn - (NOT Cy)
+   * ARM_AND(...)                         | and ...                   | Rd = Rn AND Op2
+   * ARM_ORR(...)                         | orr ...                   | Rd = Rn OR Op2
+   * ARM_EOR(...)                         | eor ...                   | Rd = Rn XOR Op2
+   * ARM_BIC(...)                         | bic ...                   | Rd = Rn AND NOT Op2
+   * ARM_CMP(Cond, Rn, Op2)               | cmp Rn, Op2               | Void = Rn - Op2
+   * ARM_CMP_I(Cond, Rn, Imm)             | cmp Rn, #nn               | Void = Rn - nn
+   * ARM_CMN(...)                         | cmn ...                   | Void = Rn + Op2
+   * ARM_TST(...)                         | tst ...                   | Void = Rn AND Op2
+   * ARM_TEQ(...)                         | teq ...                   | Void = Rn XOR Op2
+   * ARM_MUL(Cond, Rd, Rm, Rs)            | mul Rd, Rm, Rs            | Rd = Rm * Rs, Rd != Rm
+   * ARM_MLA(Cond, Rd, Rm, Rs, Rn)        | mla Rd, Rm, Rs, Rn        | Rd = Rm * Rs + Rn, Rd != Rm
+   * ARM_UMULL(Cond, Lo, Hi, Rm, Rs)      | umull Lo, Hi, Rm, Rs      | Hi:Lo = Rm * Rs, unsigned
+   * ARM_UMLAL(Cond, Lo, Hi, Rm, Rs)      | umlal Lo, Hi, Rm, Rs      | Hi:Lo = Hi:Lo + Rm * Rs, unsigned
+   * ARM_SMULL(Cond, Lo, Hi, Rm, Rs)      | smull Lo, Hi, Rm, Rs      | Hi:Lo = Rm * Rs, signed
+   * ARM_SMLAL(Cond, Lo, Hi, Rm, Rs)      | smlal Lo, Hi, Rm, Rs      | Hi:Lo = Hi:Lo + Rm * Rs, signed
+   * ARM_LDR(Cond, Rd, Rn)                | ldr Rd, [Rn]              | Rd = WORD[Rn]
+   * ARM_LDR(Cond, Rd, Rn, Rm)            | ldr Rd, [Rn, Rm]          | Rd = WORD[Rn + Rm]
+   * ARM_LDR(Cond, Rd, Rn, Rm, Sh, N)     | ldr Rd, [Rn, Rm, lsl #nn] | Rd = WORD[Rn + (Rm SHL nn)]
+   * ARM_LDR_I(Cond, Rd, Rn, Imm12bit)    | ldr Rd, [Rn, #nn]         | Rd = WORD[Rn + nn]
+   * ARM_LDR_POST(Cond, Rd, Rn, Imm)      | ldr Rd, [Rn], #nn         | Rd = WORD[Rn], Rn = Rn + nn
+   * ARM_LDR_PRE(Cond, Rd, Rn, Imm)       | ldr Rd, [Rn, #nn]!        | Rn = Rn + nn, Rd = WORD[Rn]
+   * ARM_LDRB(...)                        | ldrb ...                  | Rd = BYTE[...]
+   * ARM_LDRH(Cond, Rd, Rn[, Rm])         | ldrh ...                  | Rd = HALFWORD[...], no shifts
+   * ARM_LDRSB(Cond, Rd, Rn[, Rm])        | ldrsb ...                 | Rd = SIGNED_BYTE[...], no shifts
+   * ARM_LDRSH(Cond, Rd, Rn[, Rm])        | ldrsh ...                 | Rd = SIGNED_HALFWORD[...], no shifts
+   * ARM_STR(...)                         | str ...                   | WORD[...] = Rd
+   * ARM_STRB(...)                        | strb ...                  | BYTE[...] = Rd
+   * ARM_STRH(Cond, Rd, Rn[, Rm])         | strh ...                  | HALFWORD[...] = Rd, no shifts
+   * ARM_LDR_POOL(Cond, Rd, Value)        | ldr Rd, =Value            | Rd = Value, Value in literal pool
+   * ARM_LDM(Cond, Mode, Rb, Regs...)     | ldmia Rb, {...}           | Regs = WORD[Rb...]
+   * ARM_LDM_WB(Cond, Mode, Rb, Regs...)  | ldmia Rb!, {...}          | Regs = WORD[Rb...], Rb updated
+   * ARM_STM(Cond, Mode, Rb, Regs...)     | stmia Rb, {...}           | WORD[Rb...] = Regs
+   * ARM_STM_WB(Cond, Mode, Rb, Regs...)  | stmia Rb!, {...}          | WORD[Rb...] = Regs, Rb updated
+   * ARM_PUSH(Registers...)               | stmfd sp!, {...}          |
+   * ARM_PUSH_WITH_LR(Registers...)       | stmfd sp!, {..., lr}      |
+   * ARM_PUSH_LR()                        | stmfd sp!, {lr}           |
+   * ARM_POP(Registers...)                | ldmfd sp!, {...}          |
+   * ARM_POP_WITH_LR(Registers...)        | ldmfd sp!, {..., lr}      |
+   * ARM_POP_LR()                         | ldmfd sp!, {lr}           |
+   * ARM_B(Cond, Label)                   | b Label                   | pc = &&Label
+   * ARM_BL(Cond, Symbol)                 | bl Symbol                 | pc = Symbol, lr = $ + 4
+   * ARM_BX(Cond, Rs)                     | bx Rs                     | pc = Rs, ARM/THUMB (Rs bit0)
+   * ARM_BX_LR(Cond)                      | bx lr                     | pc = lr, ARM/THUMB (lr bit0)
+   * ARM_SWI(Cond, Imm8bit)               | swi nn << 16              | pc = 8, lr = $ + 4, GBA BIOS call
+   * ARM_NOP()                            | mov r0, r0                | r0 = r0
+   *
+   * Every data processing opcode (except the comparisons) also
+   * has an `S` variant that sets the flags, such as `ARM_ADDS`,
+   * `ARM_ADDS_I` and `ARM_ADDS_RS`, and so do the multiplies,
+   * such as `ARM_MULS` and `ARM_UMULLS`.
+   *
+   * `ENTER_ARM()` and `ENTER_THUMB(Rs)` switch between the
+   * two states within a THUMB function, see below.
+   *
+   * Notes:
+   * Imm       -> an 8-bit value rotated right by an even amount
+   * Imm5bit   -> 0-31, or 1-32 for `LSR` and `ASR`
+   * Imm12bit  -> -4095-4095, or -255-255 for halfword and
+   *              signed loads/stores
+   * Mode      -> `IA`, `IB`, `DA` or `DB`
+   *
+   * $ denotes the instruction's address
+   *
+   * Registers... indicates a comma-separated list of up to 16
+   * registers, which must be given in ascending order.
+   *
+   * The ARM7TDMI is an ARMv4T core: `ldm` with pc in the list
+   * does not switch to THUMB state, so pop into lr and use
+   * `ARM_BX_LR(AL)` to return to THUMB callers.
+   */
+
+  // Data processing
+
+  #define ARM_AND(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "and", "", __VA_ARGS__)
+  #define ARM_EOR(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "eor", "", __VA_ARGS__)
+  #define ARM_SUB(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "sub", "", __VA_ARGS__)
+  #define ARM_RSB(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "rsb", "", __VA_ARGS__)
+  #define ARM_ADD(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "add", "", __VA_ARGS__)
+  #define ARM_ADC(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "adc", "", __VA_ARGS__)
+  #define ARM_SBC(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "sbc", "", __VA_ARGS__)
+  #define ARM_RSC(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "rsc", "", __VA_ARGS__)
+  #define ARM_ORR(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "orr", "", __VA_ARGS__)
+  #define ARM_BIC(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "bic", "", __VA_ARGS__)
+
+  #define ARM_ANDS(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "and", "s", __VA_ARGS__)
+  #define ARM_EORS(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "eor", "s", __VA_ARGS__)
+  #define ARM_SUBS(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "sub", "s", __VA_ARGS__)
+  #define ARM_RSBS(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "rsb", "s", __VA_ARGS__)
+  #define ARM_ADDS(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "add", "s", __VA_ARGS__)
+  #define ARM_ADCS(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "adc", "s", __VA_ARGS__)
+  #define ARM_SBCS(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "sbc", "s", __VA_ARGS__)
+  #define ARM_RSCS(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "rsc", "s", __VA_ARGS__)
+  #define ARM_ORRS(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "orr", "s", __VA_ARGS__)
+  #define ARM_BICS(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_, "bic", "s", __VA_ARGS__)
+
+  #define ARM_AND_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "and", "", __VA_ARGS__)
+  #define ARM_EOR_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "eor", "", __VA_ARGS__)
+  #define ARM_SUB_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "sub", "", __VA_ARGS__)
+  #define ARM_RSB_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "rsb", "", __VA_ARGS__)
+  #define ARM_ADD_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "add", "", __VA_ARGS__)
+  #define ARM_ADC_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "adc", "", __VA_ARGS__)
+  #define ARM_SBC_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "sbc", "", __VA_ARGS__)
+  #define ARM_RSC_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "rsc", "", __VA_ARGS__)
+  #define ARM_ORR_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "orr", "", __VA_ARGS__)
+  #define ARM_BIC_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "bic", "", __VA_ARGS__)
+
+  #define ARM_ANDS_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "and", "s", __VA_ARGS__)
+  #define ARM_EORS_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "eor", "s", __VA_ARGS__)
+  #define ARM_SUBS_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "sub", "s", __VA_ARGS__)
+  #define ARM_RSBS_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "rsb", "s", __VA_ARGS__)
+  #define ARM_ADDS_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "add", "s", __VA_ARGS__)
+  #define ARM_ADCS_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "adc", "s", __VA_ARGS__)
+  #define ARM_SBCS_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "sbc", "s", __VA_ARGS__)
+  #define ARM_RSCS_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "rsc", "s", __VA_ARGS__)
+  #define ARM_ORRS_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "orr", "s", __VA_ARGS__)
+  #define ARM_BICS_I(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP3_I_, "bic", "s", __VA_ARGS__)
+
+  #define ARM_AND_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("and", "", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_EOR_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("eor", "", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_SUB_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("sub", "", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_RSB_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("rsb", "", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_ADD_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("add", "", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_ADC_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("adc", "", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_SBC_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("sbc", "", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_RSC_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("rsc", "", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_ORR_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("orr", "", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_BIC_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("bic", "", Cond, Rd, Rn, Rm, Shift, Rs)
+
+  #define ARM_ANDS_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("and", "s", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_EORS_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("eor", "s", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_SUBS_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("sub", "s", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_RSBS_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("rsb", "s", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_ADDS_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("add", "s", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_ADCS_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("adc", "s", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_SBCS_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("sbc", "s", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_RSCS_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("rsc", "s", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_ORRS_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("orr", "s", Cond, Rd, Rn, Rm, Shift, Rs)
+  #define ARM_BICS_RS(Cond, Rd, Rn, Rm, Shift, Rs) ARM_DP3_RS_BASE("bic", "s", Cond, Rd, Rn, Rm, Shift, Rs)
+
+  #define ARM_MOV(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP2_, "mov", "", __VA_ARGS__)
+  #define ARM_MVN(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP2_, "mvn", "", __VA_ARGS__)
+  #define ARM_MOVS(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP2_, "mov", "s", __VA_ARGS__)
+  #define ARM_MVNS(...) _THUMBLIB_APPLY_OVERLOAD(ARM_DP2_, "mvn", "s", __VA_ARGS__)
+
+  #define ARM_MOV_I(Cond, Rd, Immediate) ARM_DP2_I_BASE("mov", "", Cond, Rd, Immediate)
+  #define ARM_MVN_I(Cond, Rd, Immediate) ARM_DP2_I_BASE("mvn", "", Cond, Rd, Immediate)
+  #define ARM_MOVS_I(Cond, Rd, Immediate) ARM_DP2_I_BASE("mov", "s", Cond, Rd, Immediate)
+  #define ARM_MVNS_I(Cond, Rd, Immediate) ARM_DP2_I_BASE("mvn", "s", Cond, Rd, Immediate)
+
+  #define ARM_MOV_RS(Cond, Rd, Rm, Shift, Rs) ARM_DP2_RS_BASE("mov", "", Cond, Rd, Rm, Shift, Rs)
+  #define ARM_MVN_RS(Cond, Rd, Rm, Shift, Rs) ARM_DP2_RS_BASE("mvn", "", Cond, Rd, Rm, Shift, Rs)
+  #define ARM_MOVS_RS(Cond, Rd, Rm, Shift, Rs) ARM_DP2_RS_BASE("mov", "s", Cond, Rd, Rm, Shift, Rs)
+  #define ARM_MVNS_RS(Cond, Rd, Rm, Shift, Rs) ARM_DP2_RS_BASE("mvn", "s", Cond, Rd, Rm, Shift, Rs)
+
+  #define ARM_TST(...) _THUMBLIB_APPLY_OVERLOAD(ARM_TEST_, "tst", __VA_ARGS__)
+  #define ARM_TEQ(...) _THUMBLIB_APPLY_OVERLOAD(ARM_TEST_, "teq", __VA_ARGS__)
+  #define ARM_CMP(...) _THUMBLIB_APPLY_OVERLOAD(ARM_TEST_, "cmp", __VA_ARGS__)
+  #define ARM_CMN(...) _THUMBLIB_APPLY_OVERLOAD(ARM_TEST_, "cmn", __VA_ARGS__)
+
+  #define ARM_TST_I(Cond, Rn, Immediate) ARM_TEST_I_BASE("tst", Cond, Rn, Immediate)
+  #define ARM_TEQ_I(Cond, Rn, Immediate) ARM_TEST_I_BASE("teq", Cond, Rn, Immediate)
+  #define ARM_CMP_I(Cond, Rn, Immediate) ARM_TEST_I_BASE("cmp", Cond, Rn, Immediate)
+  #define ARM_CMN_I(Cond, Rn, Immediate) ARM_TEST_I_BASE("cmn", Cond, Rn, Immediate)
+
+  // Pseudoinstruction
+  #define ARM_NOP() asm THUMBLIB_OP_FLAGS (_THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_DATA, AL), 1, "mov") "mov r0, r0");
+
+  // Multiplies
+
+  #define ARM_MUL(Cond, Rd, Rm, Rs) ARM_MUL_BASE("mul", "", Cond, Rd, Rm, Rs)
+  #define ARM_MULS(Cond, Rd, Rm, Rs) ARM_MUL_BASE("mul", "s", Cond, Rd, Rm, Rs)
+  #define ARM_MLA(Cond, Rd, Rm, Rs, Rn) ARM_MLA_BASE("mla", "", Cond, Rd, Rm, Rs, Rn)
+  #define ARM_MLAS(Cond, Rd, Rm, Rs, Rn) ARM_MLA_BASE("mla", "s", Cond, Rd, Rm, Rs, Rn)
+
+  #define ARM_UMULL(Cond, RdLo, RdHi, Rm, Rs) ARM_MULL_BASE("umull", "", Cond, RdLo, RdHi, Rm, Rs)
+  #define ARM_UMULLS(Cond, RdLo, RdHi, Rm, Rs) ARM_MULL_BASE("umull", "s", Cond, RdLo, RdHi, Rm, Rs)
+  #define ARM_SMULL(Cond, RdLo, RdHi, Rm, Rs) ARM_MULL_BASE("smull", "", Cond, RdLo, RdHi, Rm, Rs)
+  #define ARM_SMULLS(Cond, RdLo, RdHi, Rm, Rs) ARM_MULL_BASE("smull", "s", Cond, RdLo, RdHi, Rm, Rs)
+
+  #define ARM_UMLAL(Cond, RdLo, RdHi, Rm, Rs) ARM_MLAL_BASE("umlal", "", Cond, RdLo, RdHi, Rm, Rs)
+  #define ARM_UMLALS(Cond, RdLo, RdHi, Rm, Rs) ARM_MLAL_BASE("umlal", "s", Cond, RdLo, RdHi, Rm, Rs)
+  #define ARM_SMLAL(Cond, RdLo, RdHi, Rm, Rs) ARM_MLAL_BASE("smlal", "", Cond, RdLo, RdHi, Rm, Rs)
+  #define ARM_SMLALS(Cond, RdLo, RdHi, Rm, Rs) ARM_MLAL_BASE("smlal", "s", Cond, RdLo, RdHi, Rm, Rs)
+
+  // Loads and stores
+
+  #define ARM_LDR(...) _THUMBLIB_APPLY_OVERLOAD(ARM_LDR_, "ldr", "", u32, __VA_ARGS__)
+  #define ARM_LDRB(...) _THUMBLIB_APPLY_OVERLOAD(ARM_LDR_, "ldr", "b", u8, __VA_ARGS__)
+  #define ARM_LDRH(...) _THUMBLIB_APPLY_OVERLOAD(ARM_LDR_, "ldr", "h", u16, __VA_ARGS__)
+  #define ARM_LDRSB(...) _THUMBLIB_APPLY_OVERLOAD(ARM_LDR_, "ldr", "sb", s8, __VA_ARGS__)
+  #define ARM_LDRSH(...) _THUMBLIB_APPLY_OVERLOAD(ARM_LDR_, "ldr", "sh", s16, __VA_ARGS__)
+
+  #define ARM_STR(...) _THUMBLIB_APPLY_OVERLOAD(ARM_STR_, "str", "", u32, __VA_ARGS__)
+  #define ARM_STRB(...) _THUMBLIB_APPLY_OVERLOAD(ARM_STR_, "str", "b", u8, __VA_ARGS__)
+  #define ARM_STRH(...) _THUMBLIB_APPLY_OVERLOAD(ARM_STR_, "str", "h", u16, __VA_ARGS__)
+
+  #define ARM_LDR_I(Cond, Rd, Rn, Immediate) ARM_LDR_I_BASE("ldr", "", u32, Cond, Rd, Rn, Immediate)
+  #define ARM_LDRB_I(Cond, Rd, Rn, Immediate) ARM_LDR_I_BASE("ldr", "b", u8, Cond, Rd, Rn, Immediate)
+  #define ARM_LDRH_I(Cond, Rd, Rn, Immediate) ARM_LDR_I_BASE("ldr", "h", u16, Cond, Rd, Rn, Immediate)
+  #define ARM_LDRSB_I(Cond, Rd, Rn, Immediate) ARM_LDR_I_BASE("ldr", "sb", s8, Cond, Rd, Rn, Immediate)
+  #define ARM_LDRSH_I(Cond, Rd, Rn, Immediate) ARM_LDR_I_BASE("ldr", "sh", s16, Cond, Rd, Rn, Immediate)
+
+  #define ARM_STR_I(Cond, Rd, Rn, Immediate) ARM_STR_I_BASE("str", "", u32, Cond, Rd, Rn, Immediate)
+  #define ARM_STRB_I(Cond, Rd, Rn, Immediate) ARM_STR_I_BASE("str", "b", u8, Cond, Rd, Rn, Immediate)
+  #define ARM_STRH_I(Cond, Rd, Rn, Immediate) ARM_STR_I_BASE("str", "h", u16, Cond, Rd, Rn, Immediate)
+
+  #define ARM_LDR_POST(Cond, Rd, Rn, Immediate) ARM_LDR_POST_BASE("ldr", "", u32, Cond, Rd, Rn, Immediate)
+  #define ARM_LDRB_POST(Cond, Rd, Rn, Immediate) ARM_LDR_POST_BASE("ldr", "b", u8, Cond, Rd, Rn, Immediate)
+  #define ARM_LDRH_POST(Cond, Rd, Rn, Immediate) ARM_LDR_POST_BASE("ldr", "h", u16, Cond, Rd, Rn, Immediate)
+  #define ARM_STR_POST(Cond, Rd, Rn, Immediate) ARM_STR_POST_BASE("str", "", u32, Cond, Rd, Rn, Immediate)
+  #define ARM_STRB_POST(Cond, Rd, Rn, Immediate) ARM_STR_POST_BASE("str", "b", u8, Cond, Rd, Rn, Immediate)
+  #define ARM_STRH_POST(Cond, Rd, Rn, Immediate) ARM_STR_POST_BASE("str", "h", u16, Cond, Rd, Rn, Immediate)
+
+  #define ARM_LDR_PRE(Cond, Rd, Rn, Immediate) ARM_LDR_PRE_BASE("ldr", "", u32, Cond, Rd, Rn, Immediate)
+  #define ARM_LDRB_PRE(Cond, Rd, Rn, Immediate) ARM_LDR_PRE_BASE("ldr", "b", u8, Cond, Rd, Rn, Immediate)
+  #define ARM_LDRH_PRE(Cond, Rd, Rn, Immediate) ARM_LDR_PRE_BASE("ldr", "h", u16, Cond, Rd, Rn, Immediate)
+  #define ARM_STR_PRE(Cond, Rd, Rn, Immediate) ARM_STR_PRE_BASE("str", "", u32, Cond, Rd, Rn, Immediate)
+  #define ARM_STRB_PRE(Cond, Rd, Rn, Immediate) ARM_STR_PRE_BASE("str", "b", u8, Cond, Rd, Rn, Immediate)
+  #define ARM_STRH_PRE(Cond, Rd, Rn, Immediate) ARM_STR_PRE_BASE("str", "h", u16, Cond, Rd, Rn, Immediate)
+
+  #define ARM_LDR_POOL(Cond, Rd, Value)                                                                              \
+    asm THUMBLIB_OP_FLAGS (                                                                                          \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_LOAD_CODE, Cond), 1, _THUMBLIB_ARM_OP("ldr", Cond, "")) \
+      _THUMBLIB_ARM_OP("ldr", Cond, "") " %[_Rd], =%[_Value]"                                                        \
+      : [_Rd] _THUMBLIB_ARM_OUT(Cond) (Rd)                                                                           \
+      : [_Value] "i" (Value)                                                                                         \
+      : "memory"                                                                                                     \
+    );
+
+  #define ARM_LDM(Cond, Mode, Rb, Registers...) ARM_LDM_BASE(Cond, Mode, "", Rb, Registers)
+  #define ARM_LDM_WB(Cond, Mode, Rb, Registers...) ARM_LDM_BASE(Cond, Mode, "!", Rb, Registers)
+  #define ARM_STM(Cond, Mode, Rb, Registers...) ARM_STM_BASE(Cond, Mode, "", Rb, Registers)
+  #define ARM_STM_WB(Cond, Mode, Rb, Registers...) ARM_STM_BASE(Cond, Mode, "!", Rb, Registers)
+
+  // If you need to push lr, see `ARM_PUSH_WITH_LR` and `ARM_PUSH_LR`.
+  #define ARM_PUSH(Registers...)                                                                            \
+    asm THUMBLIB_OP_FLAGS (                                                                                 \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_PUSH, AL), _THUMBLIB_NARG(Registers), "stmfd") \
+      "stmfd sp!, {" _THUMBLIB_FOR_EACH_REG(_THUMBLIB_REGLIST, _THUMBLIB_REGLIST_LAST, Registers) "}"       \
+      :                                                                                                     \
+      : _THUMBLIB_FOR_EACH_REG(_THUMBLIB_INPUT, _THUMBLIB_INPUT_LAST, Registers)                            \
+      : "memory"                                                                                            \
+    );
+
+  #define ARM_PUSH_WITH_LR(Registers...)                                                                        \
+    asm THUMBLIB_OP_FLAGS (                                                                                     \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_PUSH, AL), _THUMBLIB_NARG(Registers) + 1, "stmfd") \
+      "stmfd sp!, {" _THUMBLIB_FOR_EACH_REG(_THUMBLIB_REGLIST, _THUMBLIB_REGLIST_LAST, Registers) ", lr}"       \
+      :                                                                                                         \
+      : _THUMBLIB_FOR_EACH_REG(_THUMBLIB_INPUT, _THUMBLIB_INPUT_LAST, Registers)                                \
+      : "memory"                                                                                                \
+    );
+
+  #define ARM_PUSH_LR()                                                             \
+    asm THUMBLIB_OP_FLAGS (                                                         \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_PUSH, AL), 1, "stmfd") \
+      "stmfd sp!, {lr}"                                                             \
+      :                                                                             \
+      :                                                                             \
+      : "memory"                                                                    \
+    );
+
+  // Returning through pc is not interworking-safe
+  // on the ARM7TDMI, so pop lr and use `ARM_BX_LR`.
+  #define ARM_POP(Registers...)                                                                            \
+    asm THUMBLIB_OP_FLAGS (                                                                                \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_POP, AL), _THUMBLIB_NARG(Registers), "ldmfd") \
+      "ldmfd sp!, {" _THUMBLIB_FOR_EACH_REG(_THUMBLIB_REGLIST, _THUMBLIB_REGLIST_LAST, Registers) "}"      \
+      : _THUMBLIB_FOR_EACH_REG(_THUMBLIB_OUTPUT, _THUMBLIB_OUTPUT_LAST, Registers)                         \
+      :                                                                                                    \
+      : "memory"                                                                                           \
+    );
+
+  #define ARM_POP_WITH_LR(Registers...)                                                                        \
+    asm THUMBLIB_OP_FLAGS (                                                                                    \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_POP, AL), _THUMBLIB_NARG(Registers) + 1, "ldmfd") \
+      "ldmfd sp!, {" _THUMBLIB_FOR_EACH_REG(_THUMBLIB_REGLIST, _THUMBLIB_REGLIST_LAST, Registers) ", lr}"      \
+      : _THUMBLIB_FOR_EACH_REG(_THUMBLIB_OUTPUT, _THUMBLIB_OUTPUT_LAST, Registers)                             \
+      :                                                                                                        \
+      : "lr", "memory"                                                                                         \
+    );
+
+  #define ARM_POP_LR()                                                             \
+    asm THUMBLIB_OP_FLAGS (                                                        \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_POP, AL), 1, "ldmfd") \
+      "ldmfd sp!, {lr}"                                                            \
+      :                                                                            \
+      :                                                                            \
+      : "lr", "memory"                                                             \
+    );
+
+  // Branches
+
+  #define ARM_B(Cond, Label) ARM_BRANCH_BASE("b", _THUMBLIB_KIND_BRANCH, Cond, Label)
+
+  #define ARM_BL(Cond, Symbol)                                                                                        \
+    asm THUMBLIB_OP_FLAGS (                                                                                           \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_BRANCH_LINK, Cond), 1, _THUMBLIB_ARM_OP("bl", Cond, "")) \
+      _THUMBLIB_ARM_OP("bl", Cond, "") " " #Symbol                                                                    \
+      :                                                                                                               \
+      :                                                                                                               \
+      : "lr", "memory", "cc"                                                                                          \
+    );
+
+  #define ARM_BX(Cond, Rs)                                                                                                \
+    asm THUMBLIB_OP_FLAGS (                                                                                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_BRANCH_EXCHANGE, Cond), 1, _THUMBLIB_ARM_OP("bx", Cond, "")) \
+      _THUMBLIB_ARM_OP("bx", Cond, "") " %[_Rs]"                                                                          \
+      :                                                                                                                   \
+      : [_Rs] "r" (Rs)                                                                                                    \
+      : "pc"                                                                                                              \
+    );
+
+  #define ARM_BX_LR(Cond)                                                                                                 \
+    asm THUMBLIB_OP_FLAGS (                                                                                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_BRANCH_EXCHANGE, Cond), 1, _THUMBLIB_ARM_OP("bx", Cond, "")) \
+      _THUMBLIB_ARM_OP("bx", Cond, "") " lr"                                                                              \
+      ::: "pc"                                                                                                            \
+    );
+
+  // The GBA BIOS reads its function number from the
+  // upper byte of an ARM `swi` comment field.
+  #define ARM_SWI(Cond, Index)                                                                                 \
+    asm THUMBLIB_OP_FLAGS (                                                                                    \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_SWI, Cond), 1, _THUMBLIB_ARM_OP("swi", Cond, "")) \
+      _THUMBLIB_ARM_OP("swi", Cond, "") " %c[_Index]"                                                          \
+      :                                                                                                        \
+      : [_Index] "i" ((Index) << 16)                                                                           \
+    );
+
+  // State switching
+
+  /* ENTER_ARM()
+   *
+   * Switches a THUMB function to ARM state. `BX_PC()` is
+   * aligned so that it lands on the following word, and
+   * every opcode after this must be an `ARM_*` opcode until
+   * `ENTER_THUMB`.
+   */
+  #define ENTER_ARM() \
+    ALIGN(4)          \
+    BX_PC()           \
+    NOP()             \
+    asm volatile (".arm");
+
+  /* ENTER_THUMB(Rs)
+   *
+   * Switches back to THUMB state at the following
+   * instruction, clobbering `Rs`.
+   */
+  #define ENTER_THUMB(Rs)                                                         \
+    asm THUMBLIB_OP_FLAGS (                                                       \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_ARM_KIND(_THUMBLIB_KIND_DATA, AL), 1, "add") \
+      "add %[_Rs], pc, #1"                                                        \
+      : [_Rs] "=r" (Rs)                                                           \
+    );                                                                            \
+    ARM_BX(AL, Rs)                                                                \
+    asm volatile (".thumb");
+
+#endif // THUMBLIB_3_ARM_OPCODES
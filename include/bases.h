@@ -11,12 +11,13 @@
 
   // `move shifted register`
 
-    #define MSR_BASE(Opcode, Rd, Rs, Offset)     \
-      asm THUMBLIB_OP_FLAGS (                    \
-        Opcode " %[_Rd], %[_Rs], %[_Offset]"     \
-        : [_Rd] "=l" (Rd)                        \
-        : [_Rs] "l" (Rs), [_Offset] "N" (Offset) \
-        : "cc"                                   \
+    #define MSR_BASE(Opcode, Rd, Rs, Offset)                 \
+      asm THUMBLIB_OP_FLAGS (                                \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, Opcode) \
+        Opcode " %[_Rd], %[_Rs], %[_Offset]"                 \
+        : [_Rd] "=l" (Rd)                                    \
+        : [_Rs] "l" (Rs), [_Offset] "N" (Offset)             \
+        : "cc"                                               \
       );
 
     #define MSR_I_3(Opcode, Rd, Immediate, ...) MSR_BASE(Opcode, Rd, Rd, Immediate)
@@ -24,12 +25,13 @@
 
   // `addition/subtraction` with 3 registers
 
-    #define ADDSUB_R_BASE(Opcode, Rd, Rs, Rn) \
-      asm THUMBLIB_OP_FLAGS (                 \
-        Opcode " %[_Rd], %[_Rs], %[_Rn]"      \
-        : [_Rd] "=l" (Rd)                     \
-        : [_Rs] "l" (Rs), [_Rn] "l" (Rn)      \
-        : "cc"                                \
+    #define ADDSUB_R_BASE(Opcode, Rd, Rs, Rn)                \
+      asm THUMBLIB_OP_FLAGS (                                \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, Opcode) \
+        Opcode " %[_Rd], %[_Rs], %[_Rn]"                     \
+        : [_Rd] "=l" (Rd)                                    \
+        : [_Rs] "l" (Rs), [_Rn] "l" (Rn)                     \
+        : "cc"                                               \
       );
 
     #define ADDSUB_R_3(Opcode, Rd, Rn, ...) ADDSUB_R_BASE(Opcode, Rd, Rd, Rn)
@@ -38,12 +40,13 @@
   // `addition/subtraction` with two registers
   // and small immediate
 
-    #define ADDSUB_RI_BASE(Opcode, Rd, Rs, Immediate)  \
-      asm THUMBLIB_OP_FLAGS (                          \
-        Opcode " %[_Rd], %[_Rs], %[_Immediate]"        \
-        : [_Rd] "=l" (Rd)                              \
-        : [_Rs] "l" (Rs), [_Immediate] "L" (Immediate) \
-        : "cc"                                         \
+    #define ADDSUB_RI_BASE(Opcode, Rd, Rs, Immediate)        \
+      asm THUMBLIB_OP_FLAGS (                                \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, Opcode) \
+        Opcode " %[_Rd], %[_Rs], %[_Immediate]"              \
+        : [_Rd] "=l" (Rd)                                    \
+        : [_Rs] "l" (Rs), [_Immediate] "L" (Immediate)       \
+        : "cc"                                               \
       );
 
     #define ADDSUB_RI_3(Opcode, Rd, Immediate, ...) ADDSUB_RI_BASE(Opcode, Rd, Rd, Immediate)
@@ -52,51 +55,57 @@
   // `addition/subtraction` with one register
   // and a large immediate
 
-    #define ADDSUB_I_BASE(Opcode, Rd, Immediate) \
-      asm THUMBLIB_OP_FLAGS (                    \
-        Opcode " %[_Rd], %[_Immediate]"          \
-        : [_Rd] "+l" (Rd)                        \
-        : [_Immediate] "I" (Immediate)           \
-        : "cc"                                   \
+    #define ADDSUB_I_BASE(Opcode, Rd, Immediate)             \
+      asm THUMBLIB_OP_FLAGS (                                \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, Opcode) \
+        Opcode " %[_Rd], %[_Immediate]"                      \
+        : [_Rd] "+l" (Rd)                                    \
+        : [_Immediate] "I" (Immediate)                       \
+        : "cc"                                               \
       );
 
   // `arithmetic logic unit` with return value
 
-    #define ALU_BASE(Opcode, Rd, Rs) \
-      asm THUMBLIB_OP_FLAGS (        \
-        Opcode " %[_Rd], %[_Rs]"     \
-        : [_Rd] "+l" (Rd)            \
-        : [_Rs] "l" (Rs)             \
-        : "cc"                       \
+    #define ALU_BASE(Opcode, Rd, Rs)                        \
+      asm THUMBLIB_OP_FLAGS (                               \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_ALU, 1, Opcode) \
+        Opcode " %[_Rd], %[_Rs]"                            \
+        : [_Rd] "+l" (Rd)                                   \
+        : [_Rs] "l" (Rs)                                    \
+        : "cc"                                              \
       );
 
   // `arithmetic logic unit` with one parameter
 
-    #define ALU_1_BASE(Opcode, Rd, Rs) \
-      asm THUMBLIB_OP_FLAGS (          \
-        Opcode " %[_Rd], %[_Rs]"       \
-        : [_Rd] "=l" (Rd)              \
-        : [_Rs] "l" (Rs)               \
-        : "cc"                         \
+    #define ALU_1_BASE(Opcode, Rd, Rs)                       \
+      asm THUMBLIB_OP_FLAGS (                                \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, Opcode) \
+        Opcode " %[_Rd], %[_Rs]"                             \
+        : [_Rd] "=l" (Rd)                                    \
+        : [_Rs] "l" (Rs)                                     \
+        : "cc"                                               \
       );
 
   // `arithmetic logic unit` with no output
 
-    #define ALU_VOID_BASE(Opcode, Rd, Rs) \
-      asm THUMBLIB_OP_FLAGS (             \
-        Opcode " %[_Rd], %[_Rs]"          \
-        :                                 \
-        : [_Rd] "l" (Rd), [_Rs] "l" (Rs)  \
-        : "cc"                            \
+    #define ALU_VOID_BASE(Opcode, Rd, Rs)                    \
+      asm THUMBLIB_OP_FLAGS (                                \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, Opcode) \
+        Opcode " %[_Rd], %[_Rs]"                             \
+        :                                                    \
+        : [_Rd] "l" (Rd), [_Rs] "l" (Rs)                     \
+        : "cc"                                               \
       );
 
   // `store` with 3 registers
 
-    #define STR_BASE(Opcode, Size, Rd, Rb, Ro)           \
-      asm THUMBLIB_OP_FLAGS (                            \
-        Opcode " %[_Rd], [%[_Rb], %[_Ro]]"               \
-        : "=m" (*(Size*)((int)Rb + (int)Ro))             \
-        : [_Rd] "l" (Rd), [_Rb] "l" (Rb), [_Ro] "l" (Ro) \
+    #define STR_BASE(Opcode, Size, Rd, Rb, Ro)                 \
+      asm THUMBLIB_OP_FLAGS (                                  \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_STORE, 1, Opcode)  \
+        Opcode " %[_Rd], [%[_Rb], %[_Ro]]"                     \
+        : _THUMBLIB_MEM_OPERAND("=m", Size, (int)Rb + (int)Ro) \
+        : [_Rd] "l" (Rd), [_Rb] "l" (Rb), [_Ro] "l" (Ro)       \
+        : _THUMBLIB_MEM_CLOBBER                                \
       );
 
   // `store` with 2 registers and an immediate
@@ -106,9 +115,11 @@
     // spit the error itself.
     #define STR_I_BASE(Opcode, Size, Rd, Rb, Immediate)                \
       asm THUMBLIB_OP_FLAGS (                                          \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_STORE, 1, Opcode)          \
         Opcode " %[_Rd], [%[_Rb], %[_Immediate]]"                      \
-        : "=m" (*(Size*)((int)Rb + Immediate))                         \
+        : _THUMBLIB_MEM_OPERAND("=m", Size, (int)Rb + Immediate)       \
         : [_Rd] "l" (Rd), [_Rb] "l" (Rb), [_Immediate] "I" (Immediate) \
+        : _THUMBLIB_MEM_CLOBBER                                        \
       );
 
     #define STR_I_4(Opcode, Size, Rd, Rb, ...) STR_I_BASE(Opcode, Size, Rd, Rb, 0)
@@ -121,21 +132,25 @@
 
   // `load` with 3 registers
 
-    #define LDR_BASE(Opcode, Size, Rd, Rb, Ro)                              \
-      asm THUMBLIB_OP_FLAGS (                                               \
-        Opcode " %[_Rd], [%[_Rb], %[_Ro]]"                                  \
-        : [_Rd] "=l" (Rd)                                                   \
-        : [_Rb] "l" (Rb), [_Ro] "l" (Ro), "m" (*(Size*)((int)Rb + (int)Ro)) \
+    #define LDR_BASE(Opcode, Size, Rd, Rb, Ro)                                                    \
+      asm THUMBLIB_OP_FLAGS (                                                                     \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_LOAD, 1, Opcode)                                      \
+        Opcode " %[_Rd], [%[_Rb], %[_Ro]]"                                                        \
+        : [_Rd] "=l" (Rd)                                                                         \
+        : [_Rb] "l" (Rb), [_Ro] "l" (Ro) _THUMBLIB_MEM_OPERAND_NEXT("m", Size, (int)Rb + (int)Ro) \
+        : _THUMBLIB_MEM_CLOBBER                                                                   \
       );
 
   // `load` with 2 registers and an immediate
 
     // See `STR_I_BASE` comments.
-    #define LDR_I_BASE(Opcode, Size, Rd, Rb, Immediate)                                     \
-      asm THUMBLIB_OP_FLAGS (                                                               \
-        Opcode " %[_Rd], [%[_Rb], %[_Immediate]]"                                           \
-        : [_Rd] "=l" (Rd)                                                                   \
-        : [_Rb] "l" (Rb), [_Immediate] "I" (Immediate), "m" (*(Size*)((int)Rb + Immediate)) \
+    #define LDR_I_BASE(Opcode, Size, Rd, Rb, Immediate)                                                           \
+      asm THUMBLIB_OP_FLAGS (                                                                                     \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_LOAD, 1, Opcode)                                                      \
+        Opcode " %[_Rd], [%[_Rb], %[_Immediate]]"                                                                 \
+        : [_Rd] "=l" (Rd)                                                                                         \
+        : [_Rb] "l" (Rb), [_Immediate] "I" (Immediate) _THUMBLIB_MEM_OPERAND_NEXT("m", Size, (int)Rb + Immediate) \
+        : _THUMBLIB_MEM_CLOBBER                                                                                   \
       );
 
     #define LDR_I_4(Opcode, Size, Rd, Rb, ...) LDR_I_BASE(Opcode, Size, Rd, Rb, 0)
@@ -148,23 +163,25 @@
 
   // stack pointer relative memory access
 
-    #define STR_SP_BASE(Rd, Immediate)                 \
-      asm THUMBLIB_OP_FLAGS (                          \
-        "str %[_Rd], [sp, %[_Immediate]]"              \
-        :                                              \
-        : [_Rd] "l" (Rd), [_Immediate] "M" (Immediate) \
-        : "memory"                                     \
+    #define STR_SP_BASE(Rd, Immediate)                             \
+      asm THUMBLIB_OP_FLAGS (                                      \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_STORE_STACK, 1, "str") \
+        "str %[_Rd], [sp, %[_Immediate]]"                          \
+        :                                                          \
+        : [_Rd] "l" (Rd), [_Immediate] "M" (Immediate)             \
+        : "memory"                                                 \
       );
 
     #define STR_SP_2(Opcode, Rd, ...) STR_SP_BASE(Rd, 0)
     #define STR_SP_3(Opcode, Rd, Immediate, ...) STR_SP_BASE(Rd, Immediate)
 
-    #define LDR_SP_BASE(Rd, Immediate)    \
-      asm THUMBLIB_OP_FLAGS (             \
-        "ldr %[_Rd], [sp, %[_Immediate]]" \
-        : [_Rd] "=l" (Rd)                 \
-        : [_Immediate] "M" (Immediate)    \
-        : "memory"                        \
+    #define LDR_SP_BASE(Rd, Immediate)                            \
+      asm THUMBLIB_OP_FLAGS (                                     \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_LOAD_STACK, 1, "ldr") \
+        "ldr %[_Rd], [sp, %[_Immediate]]"                         \
+        : [_Rd] "=l" (Rd)                                         \
+        : [_Immediate] "M" (Immediate)                            \
+        : "memory"                                                \
       );
 
     #define LDR_SP_2(Opcode, Rd, ...) LDR_SP_BASE(Rd, 0)
@@ -172,11 +189,12 @@
 
   // `get relative address`
 
-    #define GRA_BASE(Opcode, Register, Rd, Immediate) \
-      asm THUMBLIB_OP_FLAGS (                         \
-        Opcode " %[_Rd], " Register ", %[_Immediate]" \
-        : [_Rd] "=l" (Rd)                             \
-        : [_Immediate] "M" (Immediate)                \
+    #define GRA_BASE(Opcode, Register, Rd, Immediate)        \
+      asm THUMBLIB_OP_FLAGS (                                \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, Opcode) \
+        Opcode " %[_Rd], " Register ", %[_Immediate]"        \
+        : [_Rd] "=l" (Rd)                                    \
+        : [_Immediate] "M" (Immediate)                       \
       );
 
     #define GRA_3(Opcode, Register, Rd, ...) GRA_BASE(Opcode, Register, Rd, 0)
@@ -184,12 +202,13 @@
 
   // load PC relative
 
-    #define LDR_PC_BASE(Rd, Immediate)    \
-      asm THUMBLIB_OP_FLAGS (             \
-        "ldr %[_Rd], [pc, %[_Immediate]]" \
-        : [_Rd] "=l" (Rd)                 \
-        : [_Immediate] "M" (Immediate)    \
-        : "memory"                        \
+    #define LDR_PC_BASE(Rd, Immediate)                           \
+      asm THUMBLIB_OP_FLAGS (                                    \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_LOAD_CODE, 1, "ldr") \
+        "ldr %[_Rd], [pc, %[_Immediate]]"                        \
+        : [_Rd] "=l" (Rd)                                        \
+        : [_Immediate] "M" (Immediate)                           \
+        : "memory"                                               \
       );
 
     #define LDR_PC_2(Opcode, Rd, ...) LDR_PC_BASE(Rd, 0)
@@ -197,21 +216,23 @@
 
   // conditional branches
 
-    #define BRANCH_BASE(Opcode, Label) \
-      asm goto THUMBLIB_OP_FLAGS (     \
-        Opcode " %l0"                  \
-        :                              \
-        :                              \
-        : "memory"                     \
-        : Label                        \
+    #define BRANCH_BASE(Opcode, Label)                              \
+      asm goto THUMBLIB_OP_FLAGS (                                  \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_BRANCH_COND, 1, Opcode) \
+        Opcode " %l0"                                               \
+        :                                                           \
+        :                                                           \
+        : "memory"                                                  \
+        : Label                                                     \
       );
 
     // Absolute rather than label, for external symbols
-    #define BRANCH_ABS_BASE(Opcode, Position) \
-      asm THUMBLIB_OP_FLAGS (                 \
-        Opcode " %c0"                         \
-        :                                     \
-        : "i" (Position)                      \
+    #define BRANCH_ABS_BASE(Opcode, Position)                       \
+      asm THUMBLIB_OP_FLAGS (                                       \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_BRANCH_COND, 1, Opcode) \
+        Opcode " %c0"                                               \
+        :                                                           \
+        : "i" (Position)                                            \
       );
 
 #endif // THUMBLIB_3_BASES
@@ -0,0 +1,177 @@
+
+#ifndef THUMBLIB_3_BIOS
+#define THUMBLIB_3_BIOS
+
+  /* THUMBLIB3 BIOS call wrappers
+   *
+   * This file defines wrappers around the GBA BIOS calls
+   * that tell the compiler exactly which registers each call
+   * reads, writes and destroys. `SWI(Index)` alone says
+   * nothing about r0-r3, so the only safe thing to do around
+   * it is to save everything.
+   *
+   * Each wrapper loads its parameters into r0-r3, issues the
+   * `swi` and copies any results back out. Parameters that
+   * already live in the right registers (through `register`
+   * variables bound with `asm("r0")` and so on) cost nothing;
+   * anything else costs a `mov`. Parameters are evaluated
+   * before any of r0-r3 is written, so they may come from
+   * any of those registers in any order.
+   *
+   * r4-r7, sp and lr are always preserved, so values kept in
+   * r4-r7 survive every call below without a push or pop.
+   * The registers listed as destroyed must not hold anything
+   * that's needed afterwards.
+   *
+   * These are THUMB `swi`s. In ARM state, use
+   * `ARM_SWI(Cond, Index)` and save r0-r3 yourself.
+   */
+
+  /* Wrapper cheat sheet
+   *
+   * THUMBLIB syntax                        | swi | Reads      | Writes           | Destroys
+   *                                        |     |            |                  |
+   * BIOS_DIV(Quot, Rem, Number, Denom)     | 06  | r0, r1     | Quot=r0, Rem=r1  | r2, r3
+   * BIOS_SQRT(Rd, Value)                   | 08  | r0         | Rd=r0            | r1, r2, r3
+   * BIOS_ARCTAN2(Rd, X, Y)                 | 0A  | r0, r1     | Rd=r0            | r1, r2, r3
+   * BIOS_CPU_SET(Src, Dst, Control)        | 0B  | r0, r1, r2 | memory           | r0, r1, r2, r3
+   * BIOS_CPU_FAST_SET(Src, Dst, Control)   | 0C  | r0, r1, r2 | memory           | r0, r1, r2, r3
+   * BIOS_BG_AFFINE_SET(Src, Dst, Count)    | 0E  | r0, r1, r2 | memory           | r0, r1, r2, r3
+   * BIOS_LZ77_UNCOMP_WRAM(Src, Dst)        | 11  | r0, r1     | memory           | r0, r1, r2, r3
+   * BIOS_LZ77_UNCOMP_VRAM(Src, Dst)        | 12  | r0, r1     | memory           | r0, r1, r2, r3
+   * BIOS_RL_UNCOMP_WRAM(Src, Dst)          | 14  | r0, r1     | memory           | r0, r1, r2, r3
+   * BIOS_RL_UNCOMP_VRAM(Src, Dst)          | 15  | r0, r1     | memory           | r0, r1, r2, r3
+   *
+   * Notes:
+   * Div      -> signed, also leaves abs(Quot) in r3
+   * Sqrt     -> unsigned, the result is 16 bits
+   * ArcTan2  -> the result is 0-0xFFFF for 0-2pi
+   * CpuSet   -> Control is the count in bits 0-20, fill in
+   *             bit 24 and 32-bit units in bit 26
+   * CpuFastSet -> Control is the word count, rounded up to
+   *             8, and fill in bit 24
+   *
+   * Every wrapper also affects cpsr.
+   */
+
+  // Internal helpers
+
+    #define _THUMBLIB_BIOS_INDEX_DIV               0x06
+    #define _THUMBLIB_BIOS_INDEX_SQRT              0x08
+    #define _THUMBLIB_BIOS_INDEX_ARCTAN2           0x0A
+    #define _THUMBLIB_BIOS_INDEX_CPU_SET           0x0B
+    #define _THUMBLIB_BIOS_INDEX_CPU_FAST_SET      0x0C
+    #define _THUMBLIB_BIOS_INDEX_BG_AFFINE_SET     0x0E
+    #define _THUMBLIB_BIOS_INDEX_LZ77_UNCOMP_WRAM  0x11
+    #define _THUMBLIB_BIOS_INDEX_LZ77_UNCOMP_VRAM  0x12
+    #define _THUMBLIB_BIOS_INDEX_RL_UNCOMP_WRAM    0x14
+    #define _THUMBLIB_BIOS_INDEX_RL_UNCOMP_VRAM    0x15
+
+    /* _THUMBLIB_BIOS_ARGS_N(Args...)
+     *
+     * Evaluates `N` parameters into temporaries, then binds
+     * r0-r3 to them, leaving the remaining registers unset.
+     */
+    #define _THUMBLIB_BIOS_ARGS_1(Arg0)                \
+      const unsigned int _Arg0 = (unsigned int)(Arg0); \
+      register unsigned int _R0 asm("r0") = _Arg0;     \
+      register unsigned int _R1 asm("r1");             \
+      register unsigned int _R2 asm("r2");             \
+      register unsigned int _R3 asm("r3");
+
+    #define _THUMBLIB_BIOS_ARGS_2(Arg0, Arg1)          \
+      const unsigned int _Arg0 = (unsigned int)(Arg0); \
+      const unsigned int _Arg1 = (unsigned int)(Arg1); \
+      register unsigned int _R0 asm("r0") = _Arg0;     \
+      register unsigned int _R1 asm("r1") = _Arg1;     \
+      register unsigned int _R2 asm("r2");             \
+      register unsigned int _R3 asm("r3");
+
+    #define _THUMBLIB_BIOS_ARGS_3(Arg0, Arg1, Arg2)    \
+      const unsigned int _Arg0 = (unsigned int)(Arg0); \
+      const unsigned int _Arg1 = (unsigned int)(Arg1); \
+      const unsigned int _Arg2 = (unsigned int)(Arg2); \
+      register unsigned int _R0 asm("r0") = _Arg0;     \
+      register unsigned int _R1 asm("r1") = _Arg1;     \
+      register unsigned int _R2 asm("r2") = _Arg2;     \
+      register unsigned int _R3 asm("r3");
+
+    /* _THUMBLIB_BIOS_SWI(Index, Flags, R1, R2, Clobbers...)
+     *
+     * The `swi` itself. r0 is always read and r3 never is; `R1`
+     * and `R2` are "+r" for registers the call reads and "=r"
+     * for ones it doesn't.
+     */
+    #define _THUMBLIB_BIOS_SWI(Index, Flags, R1, R2, Clobbers...) \
+      asm Flags (                                                 \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_SWI, 1, "swi")        \
+        "swi %[_Index]"                                           \
+        : "+r" (_R0), R1 (_R1), R2 (_R2), "=r" (_R3)              \
+        : [_Index] "I" (Index)                                    \
+        : Clobbers                                                \
+      );
+
+    // A call that writes memory, reading r0-r2
+    #define _THUMBLIB_BIOS_TRANSFER_3(Index, Src, Dst, Arg2)                \
+      {                                                                     \
+        _THUMBLIB_BIOS_ARGS_3(Src, Dst, Arg2)                               \
+        _THUMBLIB_BIOS_SWI(Index, __volatile__, "+r", "+r", "memory", "cc") \
+      }
+
+    // A call that writes memory, reading r0 and r1
+    #define _THUMBLIB_BIOS_TRANSFER_2(Index, Src, Dst)                      \
+      {                                                                     \
+        _THUMBLIB_BIOS_ARGS_2(Src, Dst)                                     \
+        _THUMBLIB_BIOS_SWI(Index, __volatile__, "+r", "=r", "memory", "cc") \
+      }
+
+  /* BIOS_DIV(Quotient, Remainder, Number, Denominator)
+   *
+   * Signed division, rounding towards 0. A `Denominator` of 0
+   * hangs the BIOS. For constant denominators, `DIV_CONST`
+   * is much faster.
+   */
+  #define BIOS_DIV(Quotient, Remainder, Number, Denominator)                            \
+    {                                                                                   \
+      _THUMBLIB_BIOS_ARGS_2(Number, Denominator)                                        \
+      _THUMBLIB_BIOS_SWI(_THUMBLIB_BIOS_INDEX_DIV, THUMBLIB_OP_FLAGS, "+r", "=r", "cc") \
+      Quotient = _R0;                                                                   \
+      Remainder = _R1;                                                                  \
+    }
+
+  #define BIOS_SQRT(Rd, Value)                                                           \
+    {                                                                                    \
+      _THUMBLIB_BIOS_ARGS_1(Value)                                                       \
+      _THUMBLIB_BIOS_SWI(_THUMBLIB_BIOS_INDEX_SQRT, THUMBLIB_OP_FLAGS, "=r", "=r", "cc") \
+      Rd = _R0;                                                                          \
+    }
+
+  #define BIOS_ARCTAN2(Rd, X, Y)                                                            \
+    {                                                                                       \
+      _THUMBLIB_BIOS_ARGS_2(X, Y)                                                           \
+      _THUMBLIB_BIOS_SWI(_THUMBLIB_BIOS_INDEX_ARCTAN2, THUMBLIB_OP_FLAGS, "+r", "=r", "cc") \
+      Rd = _R0;                                                                             \
+    }
+
+  #define BIOS_CPU_SET(Src, Dst, Control) \
+    _THUMBLIB_BIOS_TRANSFER_3(_THUMBLIB_BIOS_INDEX_CPU_SET, Src, Dst, Control)
+
+  #define BIOS_CPU_FAST_SET(Src, Dst, Control) \
+    _THUMBLIB_BIOS_TRANSFER_3(_THUMBLIB_BIOS_INDEX_CPU_FAST_SET, Src, Dst, Control)
+
+  #define BIOS_BG_AFFINE_SET(Src, Dst, Count) \
+    _THUMBLIB_BIOS_TRANSFER_3(_THUMBLIB_BIOS_INDEX_BG_AFFINE_SET, Src, Dst, Count)
+
+  #define BIOS_LZ77_UNCOMP_WRAM(Src, Dst) \
+    _THUMBLIB_BIOS_TRANSFER_2(_THUMBLIB_BIOS_INDEX_LZ77_UNCOMP_WRAM, Src, Dst)
+
+  #define BIOS_LZ77_UNCOMP_VRAM(Src, Dst) \
+    _THUMBLIB_BIOS_TRANSFER_2(_THUMBLIB_BIOS_INDEX_LZ77_UNCOMP_VRAM, Src, Dst)
+
+  #define BIOS_RL_UNCOMP_WRAM(Src, Dst) \
+    _THUMBLIB_BIOS_TRANSFER_2(_THUMBLIB_BIOS_INDEX_RL_UNCOMP_WRAM, Src, Dst)
+
+  #define BIOS_RL_UNCOMP_VRAM(Src, Dst) \
+    _THUMBLIB_BIOS_TRANSFER_2(_THUMBLIB_BIOS_INDEX_RL_UNCOMP_VRAM, Src, Dst)
+
+#endif // THUMBLIB_3_BIOS
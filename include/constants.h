@@ -0,0 +1,336 @@
+
+#ifndef THUMBLIB_3_CONSTANTS
+#define THUMBLIB_3_CONSTANTS
+
+  /* THUMBLIB3 constant synthesis macros
+   *
+   * This file defines macros that build compile-time constants
+   * out of immediate opcodes instead of loading them from the
+   * literal pool.
+   *
+   * `LDR_POOL` costs 2 bytes of code, 4 bytes of pool (plus up
+   * to 2 bytes of padding) and, when run from ROM, a
+   * nonsequential 32-bit data access. Any sequence of up to 3
+   * opcodes is no larger and always faster, so `MOV_CONST`
+   * only falls back to the pool when no such sequence exists
+   * or when `Value` isn't known until link time (such as the
+   * address of a symbol).
+   *
+   * `LSL_I` and the other overloaded opcodes can't be used
+   * within an overloaded macro, so the macros here use their
+   * base macros instead.
+   *
+   * Every macro here affects cpsr, except `ADD_CONST` and
+   * `SUB_CONST` by 0, which emit nothing.
+   */
+
+  // Internal helpers
+
+    #define _THUMBLIB_U32(Value) ((unsigned int)(Value))
+
+    // Number of trailing zero bits, 0 for 0
+    #define _THUMBLIB_CTZ(Value) (_THUMBLIB_U32(Value) ? __builtin_ctz(_THUMBLIB_U32(Value)) : 0)
+
+    #define _THUMBLIB_IS_POW2(Value) ((_THUMBLIB_U32(Value) & (_THUMBLIB_U32(Value) - 1)) == 0)
+
+    #define _THUMBLIB_IS_IMM8(Value) (_THUMBLIB_U32(Value) < 256)
+
+    // `Value` is an 8-bit immediate shifted left
+    #define _THUMBLIB_IS_SHIFTED_IMM8(Value) \
+      (_THUMBLIB_U32(Value) != 0 && (_THUMBLIB_U32(Value) >> _THUMBLIB_CTZ(Value)) < 256)
+
+    // The 8-bit immediate and shift of a shifted immediate,
+    // always in range so that unused branches still compile
+    #define _THUMBLIB_IMM8_OF(Value) ((_THUMBLIB_U32(Value) >> _THUMBLIB_CTZ(Value)) & 0xFF)
+    #define _THUMBLIB_SHIFT_OF(Value) (_THUMBLIB_CTZ(Value) & 31)
+
+    // `Value` without its low byte
+    #define _THUMBLIB_HIGH_OF(Value) (_THUMBLIB_U32(Value) & ~0xFFu)
+
+    /* _THUMBLIB_CONST_METHOD(Value)
+     *
+     * Chooses how `MOV_CONST` builds `Value`, trying shorter
+     * sequences first. There is no `mov, neg` method, since
+     * any such value is also covered by `mov, mvn`.
+     */
+
+    #define _THUMBLIB_CONST_MOV         0 // mov
+    #define _THUMBLIB_CONST_MOV_LSL     1 // mov, lsl
+    #define _THUMBLIB_CONST_MOV_MVN     2 // mov, mvn
+    #define _THUMBLIB_CONST_MOV_ADD     3 // mov #255, add
+    #define _THUMBLIB_CONST_MOV_LSL_ADD 4 // mov, lsl, add
+    #define _THUMBLIB_CONST_MOV_LSL_MVN 5 // mov, lsl, mvn
+    #define _THUMBLIB_CONST_MOV_LSL_NEG 6 // mov, lsl, neg
+    #define _THUMBLIB_CONST_POOL        7 // ldr =Value
+
+    #define _THUMBLIB_CONST_METHOD(Value)                                                  \
+      (!__builtin_constant_p(Value)                        ? _THUMBLIB_CONST_POOL        : \
+       _THUMBLIB_IS_IMM8(Value)                            ? _THUMBLIB_CONST_MOV         : \
+       _THUMBLIB_IS_SHIFTED_IMM8(Value)                    ? _THUMBLIB_CONST_MOV_LSL     : \
+       _THUMBLIB_IS_IMM8(~_THUMBLIB_U32(Value))            ? _THUMBLIB_CONST_MOV_MVN     : \
+       _THUMBLIB_IS_IMM8(_THUMBLIB_U32(Value) - 255)       ? _THUMBLIB_CONST_MOV_ADD     : \
+       _THUMBLIB_IS_SHIFTED_IMM8(_THUMBLIB_HIGH_OF(Value)) ? _THUMBLIB_CONST_MOV_LSL_ADD : \
+       _THUMBLIB_IS_SHIFTED_IMM8(~_THUMBLIB_U32(Value))    ? _THUMBLIB_CONST_MOV_LSL_MVN : \
+       _THUMBLIB_IS_SHIFTED_IMM8(-_THUMBLIB_U32(Value))    ? _THUMBLIB_CONST_MOV_LSL_NEG : \
+                                                             _THUMBLIB_CONST_POOL)
+
+  /* MOV_CONST_SIZE(Value)
+   *
+   * The number of bytes of code `MOV_CONST(Rd, Value)` takes,
+   * counting the literal pool entry but not its padding. This
+   * is a constant expression and can be used to plan code
+   * against a size budget.
+   */
+  #define MOV_CONST_SIZE(Value)                                  \
+    (_THUMBLIB_CONST_METHOD(Value) == _THUMBLIB_CONST_POOL ? 6 : \
+     _THUMBLIB_CONST_METHOD(Value) == _THUMBLIB_CONST_MOV  ? 2 : \
+     _THUMBLIB_CONST_METHOD(Value) >= _THUMBLIB_CONST_MOV_LSL_ADD ? 6 : 4)
+
+  /* MOV_CONST(Rd, Value)
+   *
+   * Sets `Rd` to `Value` using the shortest of:
+   *
+   * mov Rd, #nn                      | 0 to 255
+   * mov Rd, #nn; lsl Rd, #s          | nn << s
+   * mov Rd, #nn; mvn Rd, Rd          | NOT nn
+   * mov Rd, #255; add Rd, #nn        | 256 to 510
+   * mov Rd, #nn; lsl Rd, #s; add #mm | (nn << s) + mm
+   * mov Rd, #nn; lsl Rd, #s; mvn     | NOT (nn << s)
+   * mov Rd, #nn; lsl Rd, #s; neg     | -(nn << s)
+   * ldr Rd, =Value                   | anything else
+   */
+  #define MOV_CONST(Rd, Value)                                                \
+    {                                                                         \
+      const int _Method = _THUMBLIB_CONST_METHOD(Value);                      \
+      if (_Method == _THUMBLIB_CONST_MOV) {                                   \
+        MOV_I(Rd, _THUMBLIB_U32(Value) & 0xFF)                                \
+      } else if (_Method == _THUMBLIB_CONST_MOV_LSL) {                        \
+        MOV_I(Rd, _THUMBLIB_IMM8_OF(Value))                                   \
+        MSR_BASE("lsl", Rd, Rd, _THUMBLIB_SHIFT_OF(Value))                    \
+      } else if (_Method == _THUMBLIB_CONST_MOV_MVN) {                        \
+        MOV_I(Rd, ~_THUMBLIB_U32(Value) & 0xFF)                               \
+        MVN(Rd, Rd)                                                           \
+      } else if (_Method == _THUMBLIB_CONST_MOV_ADD) {                        \
+        MOV_I(Rd, 255)                                                        \
+        ADD_I(Rd, (_THUMBLIB_U32(Value) - 255) & 0xFF)                        \
+      } else if (_Method == _THUMBLIB_CONST_MOV_LSL_ADD) {                    \
+        MOV_I(Rd, _THUMBLIB_IMM8_OF(_THUMBLIB_HIGH_OF(Value)))                \
+        MSR_BASE("lsl", Rd, Rd, _THUMBLIB_SHIFT_OF(_THUMBLIB_HIGH_OF(Value))) \
+        ADD_I(Rd, _THUMBLIB_U32(Value) & 0xFF)                                \
+      } else if (_Method == _THUMBLIB_CONST_MOV_LSL_MVN) {                    \
+        MOV_I(Rd, _THUMBLIB_IMM8_OF(~_THUMBLIB_U32(Value)))                   \
+        MSR_BASE("lsl", Rd, Rd, _THUMBLIB_SHIFT_OF(~_THUMBLIB_U32(Value)))    \
+        MVN(Rd, Rd)                                                           \
+      } else if (_Method == _THUMBLIB_CONST_MOV_LSL_NEG) {                    \
+        MOV_I(Rd, _THUMBLIB_IMM8_OF(-_THUMBLIB_U32(Value)))                   \
+        MSR_BASE("lsl", Rd, Rd, _THUMBLIB_SHIFT_OF(-_THUMBLIB_U32(Value)))    \
+        NEG(Rd, Rd)                                                           \
+      } else {                                                                \
+        LDR_POOL(Rd, Value)                                                   \
+      }                                                                       \
+    }
+
+  /* ADD_CONST(Rd, Value)
+   * ADD_CONST(Rd, Value, Scratch)
+   * SUB_CONST(Rd, Value)
+   * SUB_CONST(Rd, Value, Scratch)
+   *
+   * Adds or subtracts the compile-time constant `Value`, which
+   * may be negative, to `Rd`. Values up to 765 away from 0 are
+   * handled with up to 3 `ADD_I`/`SUB_I`s of at most 255 each.
+   * Larger values need a low `Scratch` register, and fail to
+   * compile without one. `Scratch` is set with `MOV_CONST` to
+   * whichever of `Value` and `-Value` is cheaper to build,
+   * then added or subtracted.
+   */
+
+  #define ADD_CONST(...) _THUMBLIB_APPLY_OVERLOAD(ADD_CONST_, "add", __VA_ARGS__)
+  #define SUB_CONST(...) _THUMBLIB_APPLY_OVERLOAD(SUB_CONST_, "sub", __VA_ARGS__)
+
+    // Absolute value of `Value`, and the part of it left for
+    // the `Step`th `ADD_I`/`SUB_I` (0 to 2)
+    #define _THUMBLIB_ABS(Value) ((int)(Value) < 0 ? -_THUMBLIB_U32(Value) : _THUMBLIB_U32(Value))
+    #define _THUMBLIB_STEP_OF(Value, Step)         \
+      (_THUMBLIB_ABS(Value) <= 255u * (Step) ? 0 : \
+       _THUMBLIB_ABS(Value) - 255u * (Step) > 255 ? 255 : _THUMBLIB_ABS(Value) - 255u * (Step))
+
+    // Immediate steps, `Value` must be within -765 to 765
+    #define _THUMBLIB_ADD_STEPS(Rd, Value)         \
+      {                                            \
+        if ((int)(Value) > 0) {                    \
+          ADD_I(Rd, _THUMBLIB_STEP_OF(Value, 0))   \
+          if (_THUMBLIB_STEP_OF(Value, 1))         \
+            ADD_I(Rd, _THUMBLIB_STEP_OF(Value, 1)) \
+          if (_THUMBLIB_STEP_OF(Value, 2))         \
+            ADD_I(Rd, _THUMBLIB_STEP_OF(Value, 2)) \
+        } else if ((int)(Value) < 0) {             \
+          SUB_I(Rd, _THUMBLIB_STEP_OF(Value, 0))   \
+          if (_THUMBLIB_STEP_OF(Value, 1))         \
+            SUB_I(Rd, _THUMBLIB_STEP_OF(Value, 1)) \
+          if (_THUMBLIB_STEP_OF(Value, 2))         \
+            SUB_I(Rd, _THUMBLIB_STEP_OF(Value, 2)) \
+        }                                          \
+      }
+
+    // Without `Scratch`, values past 765 away from 0 fail to
+    // compile with a negative array size.
+    #define ADD_CONST_3(Opcode, Rd, Value, ...)                            \
+      {                                                                    \
+        typedef char _thumblib_ADD_CONST_SUB_CONST_need_a_Scratch_past_765 \
+          [_THUMBLIB_ABS(Value) <= 765 ? 1 : -1] __attribute__((unused));  \
+        _THUMBLIB_ADD_STEPS(Rd, Value)                                     \
+      }
+
+    #define ADD_CONST_4(Opcode, Rd, Value, Scratch, ...)                             \
+      {                                                                              \
+        if (_THUMBLIB_ABS(Value) <= 765) {                                           \
+          _THUMBLIB_ADD_STEPS(Rd, Value)                                             \
+        } else if (MOV_CONST_SIZE(Value) <= MOV_CONST_SIZE(-_THUMBLIB_U32(Value))) { \
+          MOV_CONST(Scratch, Value)                                                  \
+          ADD(Rd, Scratch)                                                           \
+        } else {                                                                     \
+          MOV_CONST(Scratch, -_THUMBLIB_U32(Value))                                  \
+          SUB(Rd, Scratch)                                                           \
+        }                                                                            \
+      }
+
+    #define SUB_CONST_3(Opcode, Rd, Value, ...) ADD_CONST_3(Opcode, Rd, -_THUMBLIB_U32(Value))
+    #define SUB_CONST_4(Opcode, Rd, Value, Scratch, ...) ADD_CONST_4(Opcode, Rd, -_THUMBLIB_U32(Value), Scratch)
+
+  /* MUL_CONST(Rd, Rs, Value, Scratch)
+   *
+   * Sets the low register `Rd` to `Rs` times the compile-time
+   * constant `Value`, using the cheapest of:
+   *
+   * - Shifts and adds/subs over the non-adjacent form of
+   *   `Value` (powers of 2 with digits of 1 or -1, no two of
+   *   them next to each other), for up to 4 digits:
+   *   72 = 64 + 8 -> lsl Rd, Rs, #3; add Rd, Rs; lsl Rd, #3
+   * - Two factors of the form 2^n + 1 or 2^n - 1, which needs
+   *   the low `Scratch` register:
+   *   325 = 65 * 5 -> lsl Rd, Rs, #6; add Rd, Rs;
+   *                   lsl Scratch, Rd, #2; add Rd, Scratch, Rd
+   * - `MOV_CONST(Rd, Value)` and `mul Rd, Rs`, only when it's
+   *   cheaper than both of the above, as for 45 = 15 * 3:
+   *   45 -> mov Rd, #45; mul Rd, Rs
+   *
+   * Costs are counted as opcodes plus the internal cycles of
+   * `mul`, which depend on the size of `Value`. Negative
+   * values are built from their absolute value and a `neg`.
+   * `Rd` must differ from `Rs` and `Scratch`.
+   */
+
+    // Non-adjacent form of the absolute value of `Value`,
+    // as masks of its 1 and -1 digits
+    #define _THUMBLIB_NAF_POS(Value) (((3ULL * (Value)) & ~(unsigned long long)(Value)) >> 1)
+    #define _THUMBLIB_NAF_NEG(Value) (((unsigned long long)(Value) & ~(3ULL * (Value))) >> 1)
+
+    // Highest set bit of a nonzero mask
+    #define _THUMBLIB_TOP_BIT(Mask) (63 - __builtin_clzll(Mask))
+
+    // Internal cycles of `mul` with `Value` as the multiplier
+    #define _THUMBLIB_MUL_CYCLES(Value)                                                  \
+      ((_THUMBLIB_U32(Value) >> 8) == 0 || (_THUMBLIB_U32(Value) >> 8) == 0xFFFFFF ? 1 : \
+       (_THUMBLIB_U32(Value) >> 16) == 0 || (_THUMBLIB_U32(Value) >> 16) == 0xFFFF ? 2 : \
+       (_THUMBLIB_U32(Value) >> 24) == 0 || (_THUMBLIB_U32(Value) >> 24) == 0xFF ? 3 : 4)
+
+    // `Odd` is `Factor` times 2^n + 1 or 2^n - 1, for n > 0
+    #define _THUMBLIB_MUL_SPLITS(Odd, Factor)            \
+      ((Odd) % (Factor) == 0 && (Odd) / (Factor) >= 3 && \
+       (_THUMBLIB_IS_POW2((Odd) / (Factor) - 1) || _THUMBLIB_IS_POW2((Odd) / (Factor) + 1)))
+
+    // Tries 2^n + 1 and 2^n - 1 as the second factor of
+    // `Odd`, for n from 1 to 16, or 0 if none fits
+    #define _THUMBLIB_MUL_FACTOR_N(Odd, N)                            \
+      (_THUMBLIB_MUL_SPLITS(Odd, (1u << (N)) + 1) ? (1u << (N)) + 1 : \
+       (N) > 1 && _THUMBLIB_MUL_SPLITS(Odd, (1u << (N)) - 1) ? (1u << (N)) - 1 : 0)
+
+    #define _THUMBLIB_MUL_FACTOR(Odd)                                      \
+      (_THUMBLIB_MUL_FACTOR_N(Odd, 1)  ? _THUMBLIB_MUL_FACTOR_N(Odd, 1)  : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 2)  ? _THUMBLIB_MUL_FACTOR_N(Odd, 2)  : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 3)  ? _THUMBLIB_MUL_FACTOR_N(Odd, 3)  : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 4)  ? _THUMBLIB_MUL_FACTOR_N(Odd, 4)  : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 5)  ? _THUMBLIB_MUL_FACTOR_N(Odd, 5)  : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 6)  ? _THUMBLIB_MUL_FACTOR_N(Odd, 6)  : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 7)  ? _THUMBLIB_MUL_FACTOR_N(Odd, 7)  : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 8)  ? _THUMBLIB_MUL_FACTOR_N(Odd, 8)  : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 9)  ? _THUMBLIB_MUL_FACTOR_N(Odd, 9)  : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 10) ? _THUMBLIB_MUL_FACTOR_N(Odd, 10) : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 11) ? _THUMBLIB_MUL_FACTOR_N(Odd, 11) : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 12) ? _THUMBLIB_MUL_FACTOR_N(Odd, 12) : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 13) ? _THUMBLIB_MUL_FACTOR_N(Odd, 13) : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 14) ? _THUMBLIB_MUL_FACTOR_N(Odd, 14) : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 15) ? _THUMBLIB_MUL_FACTOR_N(Odd, 15) : \
+       _THUMBLIB_MUL_FACTOR_N(Odd, 16))
+
+    // Rd = Rs << Shift, then adds or subtracts Rn
+    #define _THUMBLIB_MUL_STEP(Rd, Rs, Shift, Rn, IsNegative) \
+      {                                                       \
+        MSR_BASE("lsl", Rd, Rs, (Shift) & 31)                 \
+        if (IsNegative)                                       \
+          ADDSUB_R_BASE("sub", Rd, Rd, Rn)                    \
+        else                                                  \
+          ADDSUB_R_BASE("add", Rd, Rd, Rn)                    \
+      }
+
+  #define MUL_CONST(Rd, Rs, Value, Scratch)                                                 \
+    {                                                                                       \
+      const int _IsNegative = (int)(Value) < 0;                                             \
+      const unsigned int _Abs = _IsNegative ? -_THUMBLIB_U32(Value) : _THUMBLIB_U32(Value); \
+      const unsigned long long _Pos = _THUMBLIB_NAF_POS(_Abs);                              \
+      const unsigned long long _Digits = _Pos | _THUMBLIB_NAF_NEG(_Abs);                    \
+      const int _Count = __builtin_popcountll(_Digits);                                     \
+      const int _Shift1 = _Digits ? _THUMBLIB_TOP_BIT(_Digits) : 0;                         \
+      const unsigned long long _Digits2 = _Digits & ~(1ULL << _Shift1);                     \
+      const int _Shift2 = _Digits2 ? _THUMBLIB_TOP_BIT(_Digits2) : 0;                       \
+      const unsigned long long _Digits3 = _Digits2 & ~(1ULL << _Shift2);                    \
+      const int _Shift3 = _Digits3 ? _THUMBLIB_TOP_BIT(_Digits3) : 0;                       \
+      const unsigned long long _Digits4 = _Digits3 & ~(1ULL << _Shift3);                    \
+      const int _Shift4 = _Digits4 ? _THUMBLIB_TOP_BIT(_Digits4) : 0;                       \
+      const int _Low = _THUMBLIB_CTZ(_Abs);                                                 \
+      const unsigned int _Odd = _Abs >> _Low;                                               \
+      const unsigned int _Factor = _THUMBLIB_MUL_FACTOR(_Odd);                              \
+      const unsigned int _Rest = _Odd / (_Factor ? _Factor : 1);                            \
+      const int _ShiftCost = _Count <= 1 ? 1 : 2 * (_Count - 1) + (_Low != 0);              \
+      const int _FactorCost = 4 + (_Low != 0);                                              \
+      const int _MulCost = MOV_CONST_SIZE(Value) / 2 + 1 + _THUMBLIB_MUL_CYCLES(Value);     \
+      if (_Abs == 0) {                                                                      \
+        MOV_I(Rd, 0)                                                                        \
+      } else if (_Count <= 4 && _ShiftCost + _IsNegative <= _MulCost                        \
+                 && (!_Factor || _ShiftCost <= _FactorCost)) {                              \
+        if (_Count == 1) {                                                                  \
+          MSR_BASE("lsl", Rd, Rs, _Shift1 & 31)                                             \
+        } else {                                                                            \
+          _THUMBLIB_MUL_STEP(Rd, Rs, _Shift1 - _Shift2, Rs, !(_Pos >> _Shift2 & 1))         \
+          if (_Count >= 3)                                                                  \
+            _THUMBLIB_MUL_STEP(Rd, Rd, _Shift2 - _Shift3, Rs, !(_Pos >> _Shift3 & 1))       \
+          if (_Count >= 4)                                                                  \
+            _THUMBLIB_MUL_STEP(Rd, Rd, _Shift3 - _Shift4, Rs, !(_Pos >> _Shift4 & 1))       \
+          if (_Low)                                                                         \
+            MSR_BASE("lsl", Rd, Rd, _Low & 31)                                              \
+        }                                                                                   \
+        if (_IsNegative)                                                                    \
+          NEG(Rd, Rd)                                                                       \
+      } else if (_Factor && _FactorCost + _IsNegative <= _MulCost) {                        \
+        if (_THUMBLIB_IS_POW2(_Rest - 1))                                                   \
+          _THUMBLIB_MUL_STEP(Rd, Rs, _THUMBLIB_CTZ(_Rest - 1), Rs, 0)                       \
+        else                                                                                \
+          _THUMBLIB_MUL_STEP(Rd, Rs, _THUMBLIB_CTZ(_Rest + 1), Rs, 1)                       \
+        if (_THUMBLIB_IS_POW2(_Factor - 1)) {                                               \
+          MSR_BASE("lsl", Scratch, Rd, _THUMBLIB_CTZ(_Factor - 1) & 31)                     \
+          ADDSUB_R_BASE("add", Rd, Scratch, Rd)                                             \
+        } else {                                                                            \
+          MSR_BASE("lsl", Scratch, Rd, _THUMBLIB_CTZ(_Factor + 1) & 31)                     \
+          ADDSUB_R_BASE("sub", Rd, Scratch, Rd)                                             \
+        }                                                                                   \
+        if (_Low)                                                                           \
+          MSR_BASE("lsl", Rd, Rd, _Low & 31)                                                \
+        if (_IsNegative)                                                                    \
+          NEG(Rd, Rd)                                                                       \
+      } else {                                                                              \
+        MOV_CONST(Rd, Value)                                                                \
+        MUL(Rd, Rs)                                                                         \
+      }                                                                                     \
+    }
+
+#endif // THUMBLIB_3_CONSTANTS
@@ -0,0 +1,264 @@
+
+#ifndef THUMBLIB_3_CONTROL
+#define THUMBLIB_3_CONTROL
+
+  /* THUMBLIB3 control flow macros
+   *
+   * This file defines loop and branching constructs that are
+   * awkward to write by hand with labels and branches.
+   *
+   * Every macro here expands to a block with its own local
+   * labels, so it may be used several times within one
+   * function.
+   */
+
+  // Internal helpers
+
+    // One entry of a branch table, for use within an
+    // `asm goto` that lists `Label`
+    #define _THUMBLIB_TABLE_B(Label)                      \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_BRANCH, 1, "b") \
+      "b %l[" #Label "]\n\t"
+
+    // One entry of an offset table for `SWITCH_TABLE`. `add pc`
+    // reads pc as the table's address + 2.
+    #define _THUMBLIB_TABLE_ENTRY(Directive, Label) \
+      Directive " (%l[" #Label "] - .Lthumblib_table_%= - 2) / 2\n\t"
+
+  /* LOOP_UNROLLED(Counter, N, Scratch, Body...)
+   *
+   * Runs `Body` `Counter` times, with `N` copies of `Body` per
+   * trip around the loop. `N` must be written as one of the
+   * literals 2, 4, 8 or 16.
+   *
+   * Like Duff's device, the loop is entered partway through
+   * its copies so that the first trip runs only the remainder
+   * of `Counter` divided by `N`. The entry point is chosen
+   * with `add pc, Scratch` into a table of `b` opcodes, one
+   * per copy, after which every trip costs a single `sub` and
+   * `bne` for `N` bodies instead of a compare and branch for
+   * each. The `sub` sets the flags for the `bne`, so `Body`
+   * may freely clobber them.
+   *
+   * `Counter` and `Scratch` are low registers. `Counter` may be
+   * 0, and is 0 after the loop, while `Scratch` is clobbered
+   * before the first copy and may be used by `Body`. `Body`
+   * must not change `Counter`, and any labels within it need
+   * their own `__label__` block, since it is copied.
+   *
+   * The loop costs N + 10 opcodes plus N copies of `Body`:
+   * 6 to find the entry point, the `add pc`, a `nop` and N
+   * `b` for the table, and the `sub` and `bne`. Entering it
+   * takes 8 opcodes and 2 taken branches, so it pays off once
+   * `Counter` is a few times `N`.
+   *
+   * The `bne` back to the first copy reaches at most 256 bytes
+   * back from its own address + 4, so the N copies of `Body`
+   * and the `sub` must stay within that reach, which leaves
+   * 250 bytes for the copies, or 250 / N for each `Body`.
+   * Otherwise the assembler reports the branch out of range.
+   */
+  #define LOOP_UNROLLED(Counter, N, Scratch, Body...) \
+    _THUMBLIB_CONCAT(_THUMBLIB_UNROLL_, N)(Counter, Scratch, Body)
+
+    // Splits `Counter` into the number of trips, left in
+    // `Counter`, and the entry offset into the branch table,
+    // left in `Scratch`. Skips the loop when `Counter` is 0.
+    #define _THUMBLIB_UNROLL_ENTRY(Counter, Scratch, N, Shift) \
+      ADD_I(Counter, (N) - 1)                                  \
+      LSL_I3(Scratch, Counter, 32 - (Shift))                   \
+      LSR_I2(Scratch, 32 - (Shift))                            \
+      LSR_I2(Counter, Shift)                                   \
+      BEQ(_Done)                                               \
+      LSL_I2(Scratch, 1)
+
+    // `add pc` reads pc as its own address + 4, so the table
+    // starts after the `nop` that follows it.
+    #define _THUMBLIB_UNROLL_TABLE(Scratch, Entries, Labels...)         \
+      asm goto THUMBLIB_OP_FLAGS (                                      \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_PC_WRITE, 1, "add")         \
+        "add pc, %[_Rs]\n\t"                                            \
+        _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "mov")             \
+        "mov r8, r8\n\t"                                                \
+        Entries                                                         \
+        :                                                               \
+        : [_Rs] "l" (Scratch)                                           \
+        : "memory"                                                      \
+        : Labels                                                        \
+      );
+
+    #define _THUMBLIB_UNROLL_2(Counter, Scratch, Body...)                                  \
+      {                                                                                    \
+        __label__ _Copy0, _Copy1, _Done;                                                   \
+        _THUMBLIB_UNROLL_ENTRY(Counter, Scratch, 2, 1)                                     \
+        _THUMBLIB_UNROLL_TABLE(Scratch,                                                    \
+          _THUMBLIB_TABLE_B(_Copy1) _THUMBLIB_TABLE_B(_Copy0),                             \
+          _Copy0, _Copy1)                                                                  \
+        _Copy0:; Body                                                                      \
+        _Copy1:; Body                                                                      \
+        SUB_I(Counter, 1)                                                                  \
+        BNE(_Copy0)                                                                        \
+        _Done:;                                                                            \
+      }
+
+    #define _THUMBLIB_UNROLL_4(Counter, Scratch, Body...)                                  \
+      {                                                                                    \
+        __label__ _Copy0, _Copy1, _Copy2, _Copy3, _Done;                                   \
+        _THUMBLIB_UNROLL_ENTRY(Counter, Scratch, 4, 2)                                     \
+        _THUMBLIB_UNROLL_TABLE(Scratch,                                                    \
+          _THUMBLIB_TABLE_B(_Copy3) _THUMBLIB_TABLE_B(_Copy2)                              \
+          _THUMBLIB_TABLE_B(_Copy1) _THUMBLIB_TABLE_B(_Copy0),                             \
+          _Copy0, _Copy1, _Copy2, _Copy3)                                                  \
+        _Copy0:; Body                                                                      \
+        _Copy1:; Body                                                                      \
+        _Copy2:; Body                                                                      \
+        _Copy3:; Body                                                                      \
+        SUB_I(Counter, 1)                                                                  \
+        BNE(_Copy0)                                                                        \
+        _Done:;                                                                            \
+      }
+
+    #define _THUMBLIB_UNROLL_8(Counter, Scratch, Body...)                                  \
+      {                                                                                    \
+        __label__ _Copy0, _Copy1, _Copy2, _Copy3, _Copy4, _Copy5, _Copy6, _Copy7, _Done;   \
+        _THUMBLIB_UNROLL_ENTRY(Counter, Scratch, 8, 3)                                     \
+        _THUMBLIB_UNROLL_TABLE(Scratch,                                                    \
+          _THUMBLIB_TABLE_B(_Copy7) _THUMBLIB_TABLE_B(_Copy6)                              \
+          _THUMBLIB_TABLE_B(_Copy5) _THUMBLIB_TABLE_B(_Copy4)                              \
+          _THUMBLIB_TABLE_B(_Copy3) _THUMBLIB_TABLE_B(_Copy2)                              \
+          _THUMBLIB_TABLE_B(_Copy1) _THUMBLIB_TABLE_B(_Copy0),                             \
+          _Copy0, _Copy1, _Copy2, _Copy3, _Copy4, _Copy5, _Copy6, _Copy7)                  \
+        _Copy0:; Body                                                                      \
+        _Copy1:; Body                                                                      \
+        _Copy2:; Body                                                                      \
+        _Copy3:; Body                                                                      \
+        _Copy4:; Body                                                                      \
+        _Copy5:; Body                                                                      \
+        _Copy6:; Body                                                                      \
+        _Copy7:; Body                                                                      \
+        SUB_I(Counter, 1)                                                                  \
+        BNE(_Copy0)                                                                        \
+        _Done:;                                                                            \
+      }
+
+    #define _THUMBLIB_UNROLL_16(Counter, Scratch, Body...)                                 \
+      {                                                                                    \
+        __label__ _Copy0, _Copy1, _Copy2, _Copy3, _Copy4, _Copy5, _Copy6, _Copy7,          \
+          _Copy8, _Copy9, _Copy10, _Copy11, _Copy12, _Copy13, _Copy14, _Copy15, _Done;     \
+        _THUMBLIB_UNROLL_ENTRY(Counter, Scratch, 16, 4)                                    \
+        _THUMBLIB_UNROLL_TABLE(Scratch,                                                    \
+          _THUMBLIB_TABLE_B(_Copy15) _THUMBLIB_TABLE_B(_Copy14)                            \
+          _THUMBLIB_TABLE_B(_Copy13) _THUMBLIB_TABLE_B(_Copy12)                            \
+          _THUMBLIB_TABLE_B(_Copy11) _THUMBLIB_TABLE_B(_Copy10)                            \
+          _THUMBLIB_TABLE_B(_Copy9) _THUMBLIB_TABLE_B(_Copy8)                              \
+          _THUMBLIB_TABLE_B(_Copy7) _THUMBLIB_TABLE_B(_Copy6)                              \
+          _THUMBLIB_TABLE_B(_Copy5) _THUMBLIB_TABLE_B(_Copy4)                              \
+          _THUMBLIB_TABLE_B(_Copy3) _THUMBLIB_TABLE_B(_Copy2)                              \
+          _THUMBLIB_TABLE_B(_Copy1) _THUMBLIB_TABLE_B(_Copy0),                             \
+          _Copy0, _Copy1, _Copy2, _Copy3, _Copy4, _Copy5, _Copy6, _Copy7,                  \
+          _Copy8, _Copy9, _Copy10, _Copy11, _Copy12, _Copy13, _Copy14, _Copy15)            \
+        _Copy0:; Body                                                                      \
+        _Copy1:; Body                                                                      \
+        _Copy2:; Body                                                                      \
+        _Copy3:; Body                                                                      \
+        _Copy4:; Body                                                                      \
+        _Copy5:; Body                                                                      \
+        _Copy6:; Body                                                                      \
+        _Copy7:; Body                                                                      \
+        _Copy8:; Body                                                                      \
+        _Copy9:; Body                                                                      \
+        _Copy10:; Body                                                                     \
+        _Copy11:; Body                                                                     \
+        _Copy12:; Body                                                                     \
+        _Copy13:; Body                                                                     \
+        _Copy14:; Body                                                                     \
+        _Copy15:; Body                                                                     \
+        SUB_I(Counter, 1)                                                                  \
+        BNE(_Copy0)                                                                        \
+        _Done:;                                                                            \
+      }
+
+  /* SWITCH_TABLE(Index, Default, Labels...)
+   * SWITCH_TABLE_H(Index, Default, Labels...)
+   *
+   * Jumps to the `Index`th label of `Labels`, or to `Default`
+   * when `Index` is out of range, in constant time. Up to 16
+   * labels may be given. `asm goto` doesn't allow a label to
+   * be listed twice, so cases that share code need a label
+   * each, placed next to each other.
+   *
+   * Both macros emit a bounds check followed by a table of
+   * label offsets, which is indexed with `ldrb`/`ldrh` and
+   * jumped through with `add pc`:
+   *
+   * cmp Index, #count       | bcs Default
+   * add Index, pc           | lsl Index, #1
+   * ldrb Index, [Index, #4] | add Index, pc
+   * lsl Index, #1           | ldrh Index, [Index, #4]
+   * add pc, Index           | lsl Index, #1
+   * .byte ...               | add pc, Index
+   *                         | .2byte ...
+   *
+   * `SWITCH_TABLE` uses byte offsets and is the smaller of
+   * the two, but its labels must be within 512 bytes after
+   * the table. `SWITCH_TABLE_H` reaches labels up to 128KiB
+   * after it. The assembler can't choose between them, since
+   * the offsets aren't known until the table has been sized,
+   * so it reports an error when a byte offset doesn't fit.
+   *
+   * `Index` is a low register, and is clobbered. `Default`
+   * must be within reach of `bcs` (-256 to 254 bytes) and
+   * `Labels` must all come after the macro.
+   *
+   * Outputs of `asm goto` require GCC 11 or newer.
+   */
+
+  #define SWITCH_TABLE(Index, Default, Labels...)                                        \
+    asm goto THUMBLIB_OP_FLAGS (                                                         \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "cmp")                                \
+      "cmp %[_Index], %[_Count]\n\t"                                                     \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_BRANCH_COND, 1, "bcs")                         \
+      "bcs %l[" #Default "]\n\t"                                                         \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "add")                                \
+      "add %[_Index], pc\n\t"                                                            \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_LOAD_CODE, 1, "ldrb")                          \
+      "ldrb %[_Index], [%[_Index], #4]\n\t"                                              \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "lsl")                                \
+      "lsl %[_Index], #1\n\t"                                                            \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_PC_WRITE, 1, "add")                            \
+      "add pc, %[_Index]\n"                                                              \
+      ".Lthumblib_table_%=:\n\t"                                                         \
+      _THUMBLIB_FOR_EACH(_THUMBLIB_TABLE_ENTRY, ".byte", Labels)                         \
+      ".balign 2"                                                                        \
+      : [_Index] "+l" (Index)                                                            \
+      : [_Count] "I" (_THUMBLIB_NARG(Labels))                                            \
+      : "cc", "memory"                                                                   \
+      : Default, Labels                                                                  \
+    );
+
+  #define SWITCH_TABLE_H(Index, Default, Labels...)                                      \
+    asm goto THUMBLIB_OP_FLAGS (                                                         \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "cmp")                                \
+      "cmp %[_Index], %[_Count]\n\t"                                                     \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_BRANCH_COND, 1, "bcs")                         \
+      "bcs %l[" #Default "]\n\t"                                                         \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "lsl")                                \
+      "lsl %[_Index], #1\n\t"                                                            \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "add")                                \
+      "add %[_Index], pc\n\t"                                                            \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_LOAD_CODE, 1, "ldrh")                          \
+      "ldrh %[_Index], [%[_Index], #4]\n\t"                                              \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "lsl")                                \
+      "lsl %[_Index], #1\n\t"                                                            \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_PC_WRITE, 1, "add")                            \
+      "add pc, %[_Index]\n"                                                              \
+      ".Lthumblib_table_%=:\n\t"                                                         \
+      _THUMBLIB_FOR_EACH(_THUMBLIB_TABLE_ENTRY, ".2byte", Labels)                        \
+      ""                                                                                 \
+      : [_Index] "+l" (Index)                                                            \
+      : [_Count] "I" (_THUMBLIB_NARG(Labels))                                            \
+      : "cc", "memory"                                                                   \
+      : Default, Labels                                                                  \
+    );
+
+#endif // THUMBLIB_3_CONTROL
@@ -0,0 +1,342 @@
+
+#ifndef THUMBLIB_3_DIVIDE
+#define THUMBLIB_3_DIVIDE
+
+  /* THUMBLIB3 division by constants
+   *
+   * This file defines macros that divide by a compile-time
+   * constant by multiplying with its reciprocal. The ARM7TDMI
+   * has no divide opcode, and the BIOS `Div` call takes
+   * dozens to hundreds of cycles, while these take a handful.
+   *
+   * For a divisor d that isn't a power of 2, the quotient is
+   * (x * m) >> s, where the multiplier m = ceil(2^s / d) is
+   * chosen at compile time along with s. Powers of 2 only
+   * need shifts.
+   *
+   * THUMB `mul` keeps only the low 32 bits of the product, so
+   * the THUMB macros only handle dividends of up to `Bits`
+   * bits (15 by default, at most 15), which is enough for
+   * stats, HP and damage. A smaller `Bits` lets the macros
+   * pick a smaller m, which is cheaper to build with
+   * `MOV_CONST`. The `ARM_` macros use `umull` and `smull`
+   * and handle any 32-bit dividend, and can be used from
+   * THUMB code between `ENTER_ARM()` and `ENTER_THUMB(Rs)`.
+   *
+   * The signed macros round towards 0, and the remainder
+   * takes the sign of the dividend, as with C's `/` and `%`.
+   *
+   * `Divisor` must be a positive compile-time constant, below
+   * 65536 for the THUMB macros and below 2^31 for the ARM
+   * macros. `Rd` must differ from `Rs` and `Scratch`.
+   *
+   * Every macro here affects cpsr.
+   */
+
+  /* Macro cheat sheet
+   *
+   * THUMBLIB syntax                                 | Explanation
+   *                                                 |
+   * DIV_CONST(Rd, Rs, Divisor[, Bits])              | Rd = Rs / Divisor, unsigned
+   * MOD_CONST(Rd, Rs, Divisor, Scratch[, Bits])     | Rd = Rs % Divisor, unsigned
+   * DIV_CONST_S(Rd, Rs, Divisor, Scratch[, Bits])   | Rd = Rs / Divisor, signed
+   * MOD_CONST_S(Rd, Rs, Divisor, Scratch[, Bits])   | Rd = Rs % Divisor, signed
+   * ARM_DIV_CONST(Rd, Rs, Divisor, Scratch)         | Rd = Rs / Divisor, unsigned
+   * ARM_MOD_CONST(Rd, Rs, Divisor, Scratch)         | Rd = Rs % Divisor, unsigned
+   * ARM_DIV_CONST_S(Rd, Rs, Divisor, Scratch)       | Rd = Rs / Divisor, signed
+   * ARM_MOD_CONST_S(Rd, Rs, Divisor, Scratch)       | Rd = Rs % Divisor, signed
+   *
+   * Notes:
+   * Bits      -> 1-15, the unsigned dividend is below 2^Bits
+   *              and the signed dividend is within
+   *              -(2^Bits - 1) to 2^Bits - 1
+   *
+   * Typical sequences:
+   *
+   * DIV_CONST    | mov_const Rd, m; mul Rd, Rs; lsr Rd, #s
+   * DIV_CONST_S  | mov_const Rd, m; mul Rd, Rs; asr Rd, #s;
+   *              | lsr Scratch, Rs, #31; add Rd, Scratch
+   * MOD_CONST(_S)| DIV_CONST(_S); mov_const Scratch, d;
+   *              | mul Rd, Scratch; sub Rd, Rs, Rd
+   * ARM_DIV_CONST| ldr Scratch, =m; umull Scratch, Rd, Rs, Scratch;
+   *              | mov Rd, Rd, lsr #s
+   */
+
+  // Internal helpers
+
+    // ceil(log2(Value)), 0 for 0 and 1
+    #define _THUMBLIB_LOG2_CEIL(Value) (_THUMBLIB_U32(Value) <= 1 ? 0u : 32u - __builtin_clz(_THUMBLIB_U32(Value) - 1))
+
+    // m = ceil(2^Shift / Divisor), and the error m * Divisor - 2^Shift
+    #define _THUMBLIB_DIV_MAGIC(Divisor, Shift) \
+      (((1ULL << (Shift)) + _THUMBLIB_U32(Divisor) - 1) / _THUMBLIB_U32(Divisor))
+    #define _THUMBLIB_DIV_ERROR(Divisor, Shift) \
+      (_THUMBLIB_DIV_MAGIC(Divisor, Shift) * _THUMBLIB_U32(Divisor) - (1ULL << (Shift)))
+
+    // (x * m) >> Shift is exact for every x below 2^Bits
+    #define _THUMBLIB_DIV_FITS(Divisor, Bits, Shift) \
+      (((1ULL << (Bits)) - 1) * _THUMBLIB_DIV_ERROR(Divisor, Shift) < (1ULL << (Shift)))
+
+    /* _THUMBLIB_DIV_SHIFT(Divisor, Bits, Log)
+     *
+     * The smallest shift from `Log` (ceil(log2(Divisor))) to
+     * `Log + Bits` that fits. `Log + Bits` always does.
+     */
+    #define _THUMBLIB_DIV_SHIFT(Divisor, Bits, Log)                               \
+      (_THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 0)  ? (Log) + 0  :               \
+       _THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 1)  ? (Log) + 1  :               \
+       _THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 2)  ? (Log) + 2  :               \
+       _THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 3)  ? (Log) + 3  :               \
+       _THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 4)  ? (Log) + 4  :               \
+       _THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 5)  ? (Log) + 5  :               \
+       _THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 6)  ? (Log) + 6  :               \
+       _THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 7)  ? (Log) + 7  :               \
+       _THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 8)  ? (Log) + 8  :               \
+       _THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 9)  ? (Log) + 9  :               \
+       _THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 10) ? (Log) + 10 :               \
+       _THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 11) ? (Log) + 11 :               \
+       _THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 12) ? (Log) + 12 :               \
+       _THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 13) ? (Log) + 13 :               \
+       _THUMBLIB_DIV_FITS(Divisor, Bits, (Log) + 14) ? (Log) + 14 :               \
+                                                       (Log) + (Bits))
+
+  /* DIV_CONST(Rd, Rs, Divisor)
+   * DIV_CONST(Rd, Rs, Divisor, Bits)
+   * DIV_CONST_S(Rd, Rs, Divisor, Scratch)
+   * DIV_CONST_S(Rd, Rs, Divisor, Scratch, Bits)
+   *
+   * Divides the low register `Rs` by `Divisor` into the low
+   * register `Rd`. The signed form adds 1 to the quotient of
+   * negative dividends, which turns the rounding of `asr`
+   * towards minus infinity into rounding towards 0, and
+   * needs a low `Scratch` register for the sign.
+   */
+
+  #define DIV_CONST(...) _THUMBLIB_APPLY_OVERLOAD(DIV_CONST_, "lsr", __VA_ARGS__)
+  #define DIV_CONST_S(...) _THUMBLIB_APPLY_OVERLOAD(DIV_CONST_S_, "asr", __VA_ARGS__)
+
+    #define DIV_CONST_4(Opcode, Rd, Rs, Divisor, ...) DIV_CONST_5(Opcode, Rd, Rs, Divisor, 15)
+
+    #define DIV_CONST_5(Opcode, Rd, Rs, Divisor, Bits, ...)                                \
+      {                                                                                    \
+        const unsigned int _Log = _THUMBLIB_LOG2_CEIL(Divisor);                            \
+        if (_THUMBLIB_IS_POW2(Divisor)) {                                                  \
+          if (_Log)                                                                        \
+            MSR_BASE(Opcode, Rd, Rs, _Log & 31)                                            \
+          else                                                                             \
+            ADDSUB_RI_BASE("add", Rd, Rs, 0)                                               \
+        } else {                                                                           \
+          const unsigned int _Shift = _THUMBLIB_DIV_SHIFT(Divisor, Bits, _Log);            \
+          MOV_CONST(Rd, _THUMBLIB_U32(_THUMBLIB_DIV_MAGIC(Divisor, _Shift)))               \
+          MUL(Rd, Rs)                                                                      \
+          MSR_BASE(Opcode, Rd, Rd, _Shift & 31)                                            \
+        }                                                                                  \
+      }
+
+    #define DIV_CONST_S_5(Opcode, Rd, Rs, Divisor, Scratch, ...) DIV_CONST_S_6(Opcode, Rd, Rs, Divisor, Scratch, 15)
+
+    #define DIV_CONST_S_6(Opcode, Rd, Rs, Divisor, Scratch, Bits, ...)                     \
+      {                                                                                    \
+        const unsigned int _Log = _THUMBLIB_LOG2_CEIL(Divisor);                            \
+        if (_THUMBLIB_IS_POW2(Divisor)) {                                                  \
+          if (_Log == 0) {                                                                 \
+            ADDSUB_RI_BASE("add", Rd, Rs, 0)                                               \
+          } else {                                                                         \
+            if (_Log == 1) {                                                               \
+              MSR_BASE("lsr", Scratch, Rs, 31)                                             \
+            } else {                                                                       \
+              MSR_BASE("asr", Scratch, Rs, 31)                                             \
+              MSR_BASE("lsr", Scratch, Scratch, (32 - _Log) & 31)                          \
+            }                                                                              \
+            ADDSUB_R_BASE("add", Rd, Rs, Scratch)                                          \
+            MSR_BASE(Opcode, Rd, Rd, _Log & 31)                                            \
+          }                                                                                \
+        } else {                                                                           \
+          const unsigned int _Shift = _THUMBLIB_DIV_SHIFT(Divisor, Bits, _Log);            \
+          MOV_CONST(Rd, _THUMBLIB_U32(_THUMBLIB_DIV_MAGIC(Divisor, _Shift)))               \
+          MUL(Rd, Rs)                                                                      \
+          MSR_BASE(Opcode, Rd, Rd, _Shift & 31)                                            \
+          MSR_BASE("lsr", Scratch, Rs, 31)                                                 \
+          ADD(Rd, Scratch)                                                                 \
+        }                                                                                  \
+      }
+
+  /* MOD_CONST(Rd, Rs, Divisor, Scratch)
+   * MOD_CONST(Rd, Rs, Divisor, Scratch, Bits)
+   * MOD_CONST_S(Rd, Rs, Divisor, Scratch)
+   * MOD_CONST_S(Rd, Rs, Divisor, Scratch, Bits)
+   *
+   * Sets the low register `Rd` to the remainder of `Rs` divided
+   * by `Divisor`, computed as Rs - (Rs / Divisor) * Divisor.
+   * The quotient is the multiplier of the second `mul`, so it
+   * terminates early. Unsigned powers of 2 only mask `Rs` and
+   * don't touch `Scratch`.
+   */
+
+  #define MOD_CONST(...) _THUMBLIB_APPLY_OVERLOAD(MOD_CONST_, "lsr", __VA_ARGS__)
+  #define MOD_CONST_S(...) _THUMBLIB_APPLY_OVERLOAD(MOD_CONST_S_, "asr", __VA_ARGS__)
+
+    #define MOD_CONST_5(Opcode, Rd, Rs, Divisor, Scratch, ...) MOD_CONST_6(Opcode, Rd, Rs, Divisor, Scratch, 15)
+
+    #define MOD_CONST_6(Opcode, Rd, Rs, Divisor, Scratch, Bits, ...)                       \
+      {                                                                                    \
+        if (_THUMBLIB_U32(Divisor) == 1) {                                                 \
+          MOV_I(Rd, 0)                                                                     \
+        } else if (_THUMBLIB_IS_POW2(Divisor)) {                                           \
+          MSR_BASE("lsl", Rd, Rs, (32 - _THUMBLIB_LOG2_CEIL(Divisor)) & 31)                \
+          MSR_BASE(Opcode, Rd, Rd, (32 - _THUMBLIB_LOG2_CEIL(Divisor)) & 31)               \
+        } else {                                                                           \
+          DIV_CONST_5(Opcode, Rd, Rs, Divisor, Bits)                                       \
+          MOV_CONST(Scratch, Divisor)                                                      \
+          MUL(Rd, Scratch)                                                                 \
+          ADDSUB_R_BASE("sub", Rd, Rs, Rd)                                                 \
+        }                                                                                  \
+      }
+
+    #define MOD_CONST_S_5(Opcode, Rd, Rs, Divisor, Scratch, ...) MOD_CONST_S_6(Opcode, Rd, Rs, Divisor, Scratch, 15)
+
+    #define MOD_CONST_S_6(Opcode, Rd, Rs, Divisor, Scratch, Bits, ...)                     \
+      {                                                                                    \
+        if (_THUMBLIB_U32(Divisor) == 1) {                                                 \
+          MOV_I(Rd, 0)                                                                     \
+        } else {                                                                           \
+          DIV_CONST_S_6(Opcode, Rd, Rs, Divisor, Scratch, Bits)                            \
+          if (_THUMBLIB_IS_POW2(Divisor)) {                                                \
+            MSR_BASE("lsl", Rd, Rd, _THUMBLIB_LOG2_CEIL(Divisor) & 31)                     \
+          } else {                                                                         \
+            MOV_CONST(Scratch, Divisor)                                                    \
+            MUL(Rd, Scratch)                                                               \
+          }                                                                                \
+          ADDSUB_R_BASE("sub", Rd, Rs, Rd)                                                 \
+        }                                                                                  \
+      }
+
+  /* ARM_DIV_CONST(Rd, Rs, Divisor, Scratch)
+   * ARM_DIV_CONST_S(Rd, Rs, Divisor, Scratch)
+   *
+   * Divides any 32-bit `Rs` by `Divisor` into `Rd` in ARM
+   * state, using the high word of a `umull` or `smull` by a
+   * 32-bit m loaded into `Scratch`.
+   *
+   * When no 32-bit m is exact for every dividend (as for 7),
+   * the unsigned form uses m - 2^32 instead and adds the
+   * dividend back in without overflowing:
+   *
+   * t = (Rs * m) >> 32; Rd = (t + ((Rs - t) >> 1)) >> (s - 1)
+   *
+   * The signed form adds the dividend back in when m doesn't
+   * fit in 31 bits, then adds 1 to the quotient of negative
+   * dividends like `DIV_CONST_S`.
+   *
+   * `Rd`, `Rs` and `Scratch` must be three different registers:
+   * the `umull` puts the low word in `Scratch` and the high
+   * word in `Rd`, and the ARM7TDMI needs both to differ from
+   * the dividend. The build fails with an assembler error
+   * otherwise.
+   */
+
+    // A 32-bit m with s = 31 + Log is exact for every unsigned
+    // dividend, and one with s = 30 + Log for every signed one
+    #define _THUMBLIB_ARM_DIV_SHORT(Divisor, Log) \
+      (_THUMBLIB_DIV_ERROR(Divisor, 31 + (Log)) <= (1ULL << (((Log) - 1) & 63)))
+    #define _THUMBLIB_ARM_DIV_SHORT_S(Divisor, Log) \
+      (_THUMBLIB_DIV_ERROR(Divisor, 30 + (Log)) <= (1ULL << (((Log) - 1) & 63)))
+
+  #define ARM_DIV_CONST(Rd, Rs, Divisor, Scratch)                                                \
+    {                                                                                            \
+      const unsigned int _Log = _THUMBLIB_LOG2_CEIL(Divisor);                                    \
+      if (_THUMBLIB_IS_POW2(Divisor)) {                                                          \
+        if (_Log)                                                                                \
+          ARM_DP2_SHIFT_BASE("mov", "", AL, Rd, Rs, LSR, _Log & 31)                              \
+        else                                                                                     \
+          ARM_DP2_R_BASE("mov", "", AL, Rd, Rs)                                                  \
+      } else if (_THUMBLIB_ARM_DIV_SHORT(Divisor, _Log)) {                                       \
+        ARM_LDR_POOL(AL, Scratch, _THUMBLIB_U32(_THUMBLIB_DIV_MAGIC(Divisor, 31 + _Log)))        \
+        ARM_MULL_BASE("umull", "", AL, Scratch, Rd, Rs, Scratch)                                 \
+        ARM_DP2_SHIFT_BASE("mov", "", AL, Rd, Rd, LSR, (_Log - 1) & 31)                          \
+      } else {                                                                                   \
+        ARM_LDR_POOL(AL, Scratch, _THUMBLIB_U32(_THUMBLIB_DIV_MAGIC(Divisor, 32 + _Log)))        \
+        ARM_MULL_BASE("umull", "", AL, Scratch, Rd, Rs, Scratch)                                 \
+        ARM_DP3_R_BASE("sub", "", AL, Scratch, Rs, Rd)                                           \
+        ARM_DP3_SHIFT_BASE("add", "", AL, Rd, Rd, Scratch, LSR, 1)                               \
+        ARM_DP2_SHIFT_BASE("mov", "", AL, Rd, Rd, LSR, (_Log - 1) & 31)                          \
+      }                                                                                          \
+    }
+
+  #define ARM_DIV_CONST_S(Rd, Rs, Divisor, Scratch)                                              \
+    {                                                                                            \
+      const unsigned int _Log = _THUMBLIB_LOG2_CEIL(Divisor);                                    \
+      if (_THUMBLIB_IS_POW2(Divisor)) {                                                          \
+        if (_Log == 0) {                                                                         \
+          ARM_DP2_R_BASE("mov", "", AL, Rd, Rs)                                                  \
+        } else {                                                                                 \
+          if (_Log == 1) {                                                                       \
+            ARM_DP3_SHIFT_BASE("add", "", AL, Rd, Rs, Rs, LSR, 31)                               \
+          } else {                                                                               \
+            ARM_DP2_SHIFT_BASE("mov", "", AL, Scratch, Rs, ASR, 31)                              \
+            ARM_DP3_SHIFT_BASE("add", "", AL, Rd, Rs, Scratch, LSR, (32 - _Log) & 31)            \
+          }                                                                                      \
+          ARM_DP2_SHIFT_BASE("mov", "", AL, Rd, Rd, ASR, _Log & 31)                              \
+        }                                                                                        \
+      } else {                                                                                   \
+        const int _Short = _THUMBLIB_ARM_DIV_SHORT_S(Divisor, _Log);                             \
+        const unsigned int _Shift = _Short ? _Log - 2 : _Log - 1;                                \
+        ARM_LDR_POOL(AL, Scratch, _THUMBLIB_U32(_THUMBLIB_DIV_MAGIC(Divisor, 32 + _Shift)))      \
+        ARM_MULL_BASE("smull", "", AL, Scratch, Rd, Rs, Scratch)                                 \
+        if (!_Short)                                                                             \
+          ARM_DP3_R_BASE("add", "", AL, Rd, Rd, Rs)                                              \
+        if (_Shift)                                                                              \
+          ARM_DP2_SHIFT_BASE("mov", "", AL, Rd, Rd, ASR, _Shift & 31)                            \
+        ARM_DP3_SHIFT_BASE("add", "", AL, Rd, Rd, Rs, LSR, 31)                                   \
+      }                                                                                          \
+    }
+
+  /* ARM_MOD_CONST(Rd, Rs, Divisor, Scratch)
+   * ARM_MOD_CONST_S(Rd, Rs, Divisor, Scratch)
+   *
+   * Sets `Rd` to the remainder of `Rs` divided by `Divisor` in
+   * ARM state. Unsigned powers of 2 up to 256 take a single
+   * `and`, and signed ones subtract the shifted quotient
+   * directly. The registers must differ as for `ARM_DIV_CONST`.
+   */
+
+    // Rd = Rs - Rd * Divisor
+    #define _THUMBLIB_ARM_MOD_REST(Rd, Rs, Divisor, Scratch)                                     \
+      {                                                                                          \
+        if (_THUMBLIB_U32(Divisor) < 256)                                                        \
+          ARM_MOV_I(AL, Scratch, _THUMBLIB_U32(Divisor) & 0xFF)                                  \
+        else                                                                                     \
+          ARM_LDR_POOL(AL, Scratch, _THUMBLIB_U32(Divisor))                                      \
+        ARM_MUL_BASE("mul", "", AL, Scratch, Rd, Scratch)                                        \
+        ARM_DP3_R_BASE("sub", "", AL, Rd, Rs, Scratch)                                           \
+      }
+
+  #define ARM_MOD_CONST(Rd, Rs, Divisor, Scratch)                                                \
+    {                                                                                            \
+      if (_THUMBLIB_U32(Divisor) == 1) {                                                         \
+        ARM_MOV_I(AL, Rd, 0)                                                                     \
+      } else if (_THUMBLIB_IS_POW2(Divisor) && _THUMBLIB_U32(Divisor) <= 256) {                  \
+        ARM_DP3_I_BASE("and", "", AL, Rd, Rs, (_THUMBLIB_U32(Divisor) - 1) & 0xFF)               \
+      } else if (_THUMBLIB_IS_POW2(Divisor)) {                                                   \
+        ARM_DP2_SHIFT_BASE("mov", "", AL, Rd, Rs, LSL, (32 - _THUMBLIB_LOG2_CEIL(Divisor)) & 31) \
+        ARM_DP2_SHIFT_BASE("mov", "", AL, Rd, Rd, LSR, (32 - _THUMBLIB_LOG2_CEIL(Divisor)) & 31) \
+      } else {                                                                                   \
+        ARM_DIV_CONST(Rd, Rs, Divisor, Scratch)                                                  \
+        _THUMBLIB_ARM_MOD_REST(Rd, Rs, Divisor, Scratch)                                         \
+      }                                                                                          \
+    }
+
+  #define ARM_MOD_CONST_S(Rd, Rs, Divisor, Scratch)                                              \
+    {                                                                                            \
+      if (_THUMBLIB_U32(Divisor) == 1) {                                                         \
+        ARM_MOV_I(AL, Rd, 0)                                                                     \
+      } else if (_THUMBLIB_IS_POW2(Divisor)) {                                                   \
+        ARM_DIV_CONST_S(Rd, Rs, Divisor, Scratch)                                                \
+        ARM_DP3_SHIFT_BASE("sub", "", AL, Rd, Rs, Rd, LSL, _THUMBLIB_LOG2_CEIL(Divisor) & 31)    \
+      } else {                                                                                   \
+        ARM_DIV_CONST_S(Rd, Rs, Divisor, Scratch)                                                \
+        _THUMBLIB_ARM_MOD_REST(Rd, Rs, Divisor, Scratch)                                         \
+      }                                                                                          \
+    }
+
+#endif // THUMBLIB_3_DIVIDE
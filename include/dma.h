@@ -0,0 +1,154 @@
+
+#ifndef THUMBLIB_3_DMA
+#define THUMBLIB_3_DMA
+
+  /* THUMBLIB3 DMA macros
+   *
+   * This file defines macros that start a transfer on one of
+   * the four DMA channels. Each one loads the address of the
+   * channel's registers and its control word, then writes
+   * source, destination and control with a single `STMIA`.
+   *
+   * Immediate transfers halt the CPU until they're done, but
+   * move a unit every sequential cycle, with no opcode fetches
+   * in between. This beats any CPU loop for large VRAM,
+   * palette and OAM uploads, even from IWRAM.
+   *
+   * `Channel` (0-3), the timing and `Count` are compile-time
+   * constants. `Count` is in 16 or 32-bit units, up to 0x4000
+   * for channels 0-2 and 0x10000 for channel 3, where 0 means
+   * the maximum. Channel 0 can't read from ROM.
+   *
+   * `Src`, `Dst` and `Scratch` must be low registers in
+   * ascending order (such as r1, r2 and r3), as required by
+   * `STMIA`. `Base` is any other low register. `Base` and
+   * `Scratch` are clobbered, `Src` and `Dst` are not.
+   */
+
+  /* Macro cheat sheet
+   *
+   * THUMBLIB syntax                                              | Transfer
+   *                                                              |
+   * DMA_START(Channel, Control, Src, Dst, Base, Scratch)         | any, `Control` built with `DMA_CONTROL`
+   * DMA_COPY16(Channel, Timing, Src, Dst, Count, Base, Scratch)  | Count halfwords from Src to Dst
+   * DMA_COPY32(Channel, Timing, Src, Dst, Count, Base, Scratch)  | Count words from Src to Dst
+   * DMA_FILL16(Channel, Timing, Src, Dst, Count, Base, Scratch)  | Count copies of HALFWORD[Src] to Dst
+   * DMA_FILL32(Channel, Timing, Src, Dst, Count, Base, Scratch)  | Count copies of WORD[Src] to Dst
+   * HBLANK_DMA(Channel, Src, Dst, Count, Base, Scratch)          | Count halfwords to Dst every HBlank
+   * HBLANK_DMA32(Channel, Src, Dst, Count, Base, Scratch)        | Count words to Dst every HBlank
+   *
+   * Timing is one of:
+   *
+   * THUMBLIB_DMA_NOW         | immediately
+   * THUMBLIB_DMA_VBLANK      | at the start of the next VBlank
+   * THUMBLIB_DMA_HBLANK      | at the start of the next HBlank
+   * THUMBLIB_DMA_SPECIAL     | sound FIFO (channels 1-2) or video capture (channel 3)
+   *
+   * Flags for `DMA_CONTROL(Timing, Flags, Count)`, combined
+   * with `|`:
+   *
+   * THUMBLIB_DMA_32          | 32-bit units
+   * THUMBLIB_DMA_SRC_FIXED   | don't advance the source
+   * THUMBLIB_DMA_SRC_DEC     | move the source backwards
+   * THUMBLIB_DMA_DST_FIXED   | don't advance the destination
+   * THUMBLIB_DMA_DST_DEC     | move the destination backwards
+   * THUMBLIB_DMA_DST_RELOAD  | restore the destination on each repeat
+   * THUMBLIB_DMA_REPEAT      | run again at every VBlank/HBlank
+   * THUMBLIB_DMA_IRQ         | raise an interrupt when done
+   */
+
+  #define THUMBLIB_DMA_NOW     0
+  #define THUMBLIB_DMA_VBLANK  1
+  #define THUMBLIB_DMA_HBLANK  2
+  #define THUMBLIB_DMA_SPECIAL 3
+
+  #define THUMBLIB_DMA_DST_DEC    0x0020
+  #define THUMBLIB_DMA_DST_FIXED  0x0040
+  #define THUMBLIB_DMA_DST_RELOAD 0x0060
+  #define THUMBLIB_DMA_SRC_DEC    0x0080
+  #define THUMBLIB_DMA_SRC_FIXED  0x0100
+  #define THUMBLIB_DMA_REPEAT     0x0200
+  #define THUMBLIB_DMA_32         0x0400
+  #define THUMBLIB_DMA_IRQ        0x4000
+
+  // Internal helpers
+
+    #define _THUMBLIB_DMA_ENABLE 0x8000
+
+    // Address of the source register of `Channel`, which is
+    // followed by the destination, count and control registers
+    #define _THUMBLIB_DMA_BASE(Channel) (0x040000B0 + 12 * (Channel))
+
+    // Offset of the control register from the source register
+    #define _THUMBLIB_DMA_CNT_H 10
+
+  /* DMA_CONTROL(Timing, Flags, Count)
+   *
+   * The value written to the count and control registers of
+   * a channel, which starts it. This is a constant expression.
+   */
+  #define DMA_CONTROL(Timing, Flags, Count) \
+    (((unsigned int)(_THUMBLIB_DMA_ENABLE | ((Timing) << 12) | (Flags)) << 16) | ((Count) & 0xFFFF))
+
+  /* DMA_START(Channel, Control, Src, Dst, Base, Scratch)
+   *
+   * Starts `Channel` with the control word `Control`. The
+   * other macros here are built on this one.
+   */
+  #define DMA_START(Channel, Control, Src, Dst, Base, Scratch) \
+    {                                                          \
+      MOV_CONST(Base, _THUMBLIB_DMA_BASE(Channel))             \
+      MOV_CONST(Scratch, Control)                              \
+      STMIA(Base, Src, Dst, Scratch)                           \
+    }
+
+  #define DMA_COPY16(Channel, Timing, Src, Dst, Count, Base, Scratch) \
+    DMA_START(Channel, DMA_CONTROL(Timing, 0, Count), Src, Dst, Base, Scratch)
+
+  #define DMA_COPY32(Channel, Timing, Src, Dst, Count, Base, Scratch) \
+    DMA_START(Channel, DMA_CONTROL(Timing, THUMBLIB_DMA_32, Count), Src, Dst, Base, Scratch)
+
+  /* DMA_FILL16(Channel, Timing, Src, Dst, Count, Base, Scratch)
+   * DMA_FILL32(Channel, Timing, Src, Dst, Count, Base, Scratch)
+   *
+   * Fill `Dst` with the halfword or word that `Src` points to,
+   * which must stay in place until the transfer is done.
+   */
+
+  #define DMA_FILL16(Channel, Timing, Src, Dst, Count, Base, Scratch) \
+    DMA_START(Channel, DMA_CONTROL(Timing, THUMBLIB_DMA_SRC_FIXED, Count), Src, Dst, Base, Scratch)
+
+  #define DMA_FILL32(Channel, Timing, Src, Dst, Count, Base, Scratch)                        \
+    DMA_START(Channel, DMA_CONTROL(Timing, THUMBLIB_DMA_32 | THUMBLIB_DMA_SRC_FIXED, Count), \
+              Src, Dst, Base, Scratch)
+
+  /* HBLANK_DMA(Channel, Src, Dst, Count, Base, Scratch)
+   * HBLANK_DMA32(Channel, Src, Dst, Count, Base, Scratch)
+   *
+   * Copies `Count` units from the table at `Src` to the I/O
+   * registers at `Dst` at every HBlank, moving on through the
+   * table while `Dst` is restored each time, as used for
+   * per-line scrolling and window effects.
+   *
+   * The channel is stopped first, because the addresses are
+   * only reloaded when a channel is enabled. This makes it
+   * safe to restart the effect every frame from VBlank.
+   */
+
+    #define _THUMBLIB_HBLANK_DMA(Channel, Flags, Src, Dst, Count, Base, Scratch)                        \
+      {                                                                                                 \
+        MOV_CONST(Base, _THUMBLIB_DMA_BASE(Channel))                                                    \
+        MOV_I(Scratch, 0)                                                                               \
+        STRH_I3(Scratch, Base, _THUMBLIB_DMA_CNT_H)                                                     \
+        MOV_CONST(Scratch, DMA_CONTROL(THUMBLIB_DMA_HBLANK,                                             \
+                                       THUMBLIB_DMA_REPEAT | THUMBLIB_DMA_DST_RELOAD | (Flags), Count)) \
+        STMIA(Base, Src, Dst, Scratch)                                                                  \
+      }
+
+  #define HBLANK_DMA(Channel, Src, Dst, Count, Base, Scratch) \
+    _THUMBLIB_HBLANK_DMA(Channel, 0, Src, Dst, Count, Base, Scratch)
+
+  #define HBLANK_DMA32(Channel, Src, Dst, Count, Base, Scratch) \
+    _THUMBLIB_HBLANK_DMA(Channel, THUMBLIB_DMA_32, Src, Dst, Count, Base, Scratch)
+
+#endif // THUMBLIB_3_DMA
@@ -0,0 +1,90 @@
+#ifndef THUMBLIB_3_FRAGMENT
+#define THUMBLIB_3_FRAGMENT
+
+  /* THUMBLIB3 inline fragments
+   *
+   * `THUMBLIB_FUNC` routines are naked and can only be reached
+   * with `BL`, so a short helper costs a `BL`, a `PUSH_LR` and
+   * a `POP_PC` on every use on top of its own opcodes. This
+   * file defines `THUMBLIB_FRAGMENT`, for writing such helpers
+   * as macros that are expanded inline within the function
+   * that uses them instead.
+   */
+
+  // Internal helpers
+
+    #define _THUMBLIB_UNPAREN(List...) List
+
+    // Checks one `(Var, Reg)` pair of a fragment's registers.
+    // Emits no code, only an assembler error when GCC prints
+    // `Var` as some other register.
+    #define _THUMBLIB_FRAGMENT_CHECK(Name, Binding) \
+      _THUMBLIB_FRAGMENT_CHECK_(Name, _THUMBLIB_UNPAREN Binding)
+
+    #define _THUMBLIB_FRAGMENT_CHECK_(Binding...) \
+      _THUMBLIB_FRAGMENT_REG(Binding)
+
+    #define _THUMBLIB_FRAGMENT_REG(Name, Var, Reg)                              \
+      asm __volatile__ (                                                        \
+        ".ifnc %[_Var], " #Reg "\n\t"                                           \
+        ".error \"" #Name ": " #Var " is in %[_Var] rather than " #Reg "\"\n\t" \
+        ".endif"                                                                \
+        :                                                                       \
+        : [_Var] "r" (Var)                                                      \
+      );
+
+  /* THUMBLIB_FRAGMENT(Name, Registers, Body...)
+   *
+   * Expands to `Body` within a block of its own, after checking
+   * that each variable given in `Registers` is in the register
+   * the fragment expects. `Registers` is a parenthesized list
+   * of up to 16 `(Var, Reg)` pairs, where `Var` is a register
+   * variable of the caller and `Reg` is the register as GCC
+   * prints it: r0 to r9, sl, fp, ip, sp, lr or pc.
+   *
+   * Fragments are meant to be wrapped in a macro that takes
+   * the caller's variables, for example
+   *
+   * #define CLEAR_WORDS(Dest, Count, Zero)     \
+   *   THUMBLIB_FRAGMENT(CLEAR_WORDS,           \
+   *     ((Dest, r0), (Count, r1), (Zero, r2)), \
+   *     __label__ _Loop;                       \
+   *     MOV_I(Zero, 0)                         \
+   *     _Loop:;                                \
+   *       STMIA(Dest, Zero)                    \
+   *       SUB_I(Count, 1)                      \
+   *       BNE(_Loop)                           \
+   *   )
+   *
+   * Since the fragment is copied into every function that uses
+   * it, any labels within `Body` must be declared with a
+   * `__label__` statement at its start, which makes GCC give
+   * them a new name for each expansion. Labels within a single
+   * `asm` statement may use `%=` instead, as in `SWITCH_TABLE`.
+   *
+   * The register check runs at assembly time rather than
+   * compile time, since GCC only chooses registers after the
+   * C has been compiled. It uses `.ifnc` on the register GCC
+   * printed for each variable, so binding a fragment to a
+   * register variable in the wrong register fails the build,
+   * with an error naming the fragment and the variable. For
+   * anything else, such as a function parameter, the check
+   * only fails if GCC happens to pick some other register, so
+   * bind parameters through register variables first. It
+   * doesn't check that `Body` leaves other registers alone,
+   * which is up to the fragment's documentation.
+   *
+   * Unlike a `THUMBLIB_FUNC`, a fragment can't be reached with
+   * `BL`, so it costs no call, but its opcodes are repeated
+   * for every use. Fragments that call other functions need
+   * the function using them to save lr.
+   */
+
+  #define THUMBLIB_FRAGMENT(Name, Registers, Body...)    \
+    {                                                    \
+      _THUMBLIB_FOR_EACH(_THUMBLIB_FRAGMENT_CHECK, Name, \
+        _THUMBLIB_UNPAREN Registers)                     \
+      { Body }                                           \
+    }
+
+#endif // THUMBLIB_3_FRAGMENT
@@ -30,6 +30,21 @@
 
     #define THUMBLIB_OP_FLAGS THUMBLIB_VOLATILE_OP
 
+    /* THUMBLIB_ANNOTATE
+     *
+     * When defined, every THUMBLIB opcode will also emit a
+     * small record describing its instruction into the
+     * non-loaded `.thumblib.annotations` section. The generated
+     * code is unchanged. These records are read by the host
+     * tools in the /tools folder, such as `thumbcycles`, and
+     * `thumbverify` uses them to find instructions that GCC
+     * inserted between opcodes.
+     *
+     * You can pass in `-D THUMBLIB_ANNOTATE` from the
+     * commandline or `#define THUMBLIB_ANNOTATE` before
+     * including thumblib.h to enable this.
+     */
+
     /* THUMBLIB_OPTIMIZE_OVERRIDE
      *
      * When defined, this should be either an optimization
@@ -49,12 +64,84 @@
       #define THUMBLIB_OPTIMIZE_SETTING 3
     #endif // THUMBLIB_OPTIMIZE_OVERRIDE
 
+    /* THUMBLIB_MEMORY_MODEL
+     *
+     * Selects how loads and stores tell the compiler which
+     * memory they touch. This should be one of:
+     *
+     * THUMBLIB_MEMORY_OPERANDS  -> (default) each load or store
+     *                              passes the word it accesses as
+     *                              an "m" operand. This is the most
+     *                              precise, but GCC may compute the
+     *                              address into another register or
+     *                              reload values around the opcode.
+     * THUMBLIB_MEMORY_CLOBBER   -> loads and stores clobber "memory"
+     *                              instead. Only registers are
+     *                              passed, at the cost of values
+     *                              that C code keeps in memory being
+     *                              reloaded after each opcode.
+     * THUMBLIB_MEMORY_REGISTERS -> only registers are passed and
+     *                              the compiler knows nothing of
+     *                              the memory accessed. Loads may
+     *                              then be merged or moved across
+     *                              stores, so combine this with
+     *                              `THUMBLIB_VOLATILE` unless the
+     *                              function is made of nothing but
+     *                              THUMBLIB opcodes.
+     *
+     * Opcodes that already clobber "memory", such as `LDMIA`,
+     * `PUSH` and the shifted ARM loads and stores, are the same
+     * in every model. `examples/bench/memory_models.sh` counts
+     * the instructions emitted for the examples with each one.
+     *
+     * You can pass in, for example,
+     * `-D THUMBLIB_MEMORY_MODEL=THUMBLIB_MEMORY_CLOBBER` from
+     * the commandline or define it before including thumblib.h
+     * to change this.
+     */
+
+    #define THUMBLIB_MEMORY_OPERANDS  0
+    #define THUMBLIB_MEMORY_CLOBBER   1
+    #define THUMBLIB_MEMORY_REGISTERS 2
+
+    #ifndef THUMBLIB_MEMORY_MODEL
+      #define THUMBLIB_MEMORY_MODEL THUMBLIB_MEMORY_OPERANDS
+    #endif // THUMBLIB_MEMORY_MODEL
+
+    /* _THUMBLIB_MEM_OPERAND(Constraint, Size, Address)
+     * _THUMBLIB_MEM_OPERAND_NEXT(Constraint, Size, Address)
+     * _THUMBLIB_MEM_CLOBBER
+     *
+     * The memory operand of a load or store, and the clobber
+     * that goes with it, for the selected memory model. Use
+     * `_NEXT` when the operand follows other operands, since it
+     * comes with its own leading comma.
+     */
+    #if THUMBLIB_MEMORY_MODEL == THUMBLIB_MEMORY_OPERANDS
+      #define _THUMBLIB_MEM_OPERAND(Constraint, Size, Address) Constraint (*(Size*)(Address))
+      #define _THUMBLIB_MEM_OPERAND_NEXT(Constraint, Size, Address) , Constraint (*(Size*)(Address))
+      #define _THUMBLIB_MEM_CLOBBER
+    #elif THUMBLIB_MEMORY_MODEL == THUMBLIB_MEMORY_CLOBBER
+      #define _THUMBLIB_MEM_OPERAND(Constraint, Size, Address)
+      #define _THUMBLIB_MEM_OPERAND_NEXT(Constraint, Size, Address)
+      #define _THUMBLIB_MEM_CLOBBER "memory"
+    #elif THUMBLIB_MEMORY_MODEL == THUMBLIB_MEMORY_REGISTERS
+      #define _THUMBLIB_MEM_OPERAND(Constraint, Size, Address)
+      #define _THUMBLIB_MEM_OPERAND_NEXT(Constraint, Size, Address)
+      #define _THUMBLIB_MEM_CLOBBER
+    #else
+      #error "THUMBLIB_MEMORY_MODEL must be THUMBLIB_MEMORY_OPERANDS, THUMBLIB_MEMORY_CLOBBER or THUMBLIB_MEMORY_REGISTERS"
+    #endif // THUMBLIB_MEMORY_MODEL
+
   // Function attribute helpers
 
     // Aliases
     #define THUMBLIB_NAKED __attribute__((naked))
     #define THUMBLIB_OPTIMIZE(level) __attribute__((optimize (level)))
     #define THUMBLIB_USED __attribute__((used))
+    #define THUMBLIB_SECTION(name) __attribute__((section (name)))
+    #define THUMBLIB_LONG_CALL __attribute__((long_call))
+    #define THUMBLIB_ARM __attribute__((target ("arm")))
 
     /* THUMBLIB_FUNC
      *
@@ -64,6 +151,62 @@
      */
     #define THUMBLIB_FUNC THUMBLIB_NAKED THUMBLIB_OPTIMIZE(THUMBLIB_OPTIMIZE_SETTING) THUMBLIB_USED
 
+    /* THUMBLIB_IWRAM_FUNC
+     *
+     * Like `THUMBLIB_FUNC`, but places the function in the
+     * `.iwram` section so that it runs from 32-bit, zero
+     * waitstate memory. Copying the section into IWRAM
+     * is up to your linker script or loader.
+     *
+     * ROM code can't reach IWRAM with a plain `bl` or `b`,
+     * so each file that calls an IWRAM function must also
+     * use `THUMBLIB_IWRAM_VENEER` on it.
+     */
+    #define THUMBLIB_IWRAM_FUNC THUMBLIB_FUNC THUMBLIB_SECTION(".iwram") THUMBLIB_LONG_CALL
+
+    /* THUMBLIB_ARM_FUNC and THUMBLIB_IWRAM_ARM_FUNC
+     *
+     * Like `THUMBLIB_FUNC` and `THUMBLIB_IWRAM_FUNC`, but the
+     * function is assembled in ARM state. Use the `ARM_*` opcodes
+     * from `include/arm_opcodes.h` within these functions.
+     */
+    #define THUMBLIB_ARM_FUNC THUMBLIB_FUNC THUMBLIB_ARM
+    #define THUMBLIB_IWRAM_ARM_FUNC THUMBLIB_IWRAM_FUNC THUMBLIB_ARM
+
+    /* THUMBLIB_IWRAM_VENEER(Name)
+     *
+     * Emits a long-call veneer for the IWRAM function `Name`
+     * into this file's ROM code. Use it at file scope, before
+     * any functions that call `Name`:
+     *
+     * `THUMBLIB_IWRAM_VENEER(CopyText)`
+     *
+     * Afterwards, `BL(CopyText)` and `B_SYM(CopyText)` in this
+     * file are redirected through the veneer automatically.
+     * The veneer preserves every register except r12 (ip),
+     * including lr, so it works for tail calls as well.
+     *
+     * Calls between two IWRAM functions also go through the
+     * veneer once it exists, which costs a round trip to ROM.
+     */
+    #define THUMBLIB_IWRAM_VENEER(Name)                                         \
+      asm (                                                                     \
+        ".pushsection .text.__thumblib_veneer_" #Name ", \"ax\", %progbits\n\t" \
+        ".balign 4\n\t"                                                         \
+        ".thumb\n\t"                                                            \
+        ".thumb_func\n"                                                         \
+        "__thumblib_veneer_" #Name ":\n\t"                                      \
+        "bx pc\n\t"                                                             \
+        "nop\n\t"                                                               \
+        ".arm\n\t"                                                              \
+        "ldr ip, .L__thumblib_veneer_" #Name "_target\n\t"                      \
+        "bx ip\n"                                                               \
+        ".L__thumblib_veneer_" #Name "_target:\n\t"                             \
+        ".word " #Name "\n\t"                                                   \
+        ".thumb\n\t"                                                            \
+        ".popsection"                                                           \
+      );
+
   // Internal variadic macro helpers
 
     // Taken from https://embeddedartistry.com/blog/2020/07/27/exploiting-the-preprocessor-for-fun-and-profit/
@@ -92,17 +235,88 @@
      * #define MSR_I_4(Opcode, Rd, Rs, Immediate, ...) MSR_BASE(Opcode, Rd, Rs, Immediate)
      */
 
-    #define _THUMBLIB_NARG(...) _THUMBLIB_NARG_(__VA_ARGS__, _THUMBLIB_RSEQ_N())
-    #define _THUMBLIB_NARG_(...) _THUMBLIB_ARG_N(__VA_ARGS__)
+    // Every opcode goes through these, and each level of
+    // macro rescans all of its arguments, so they are kept as
+    // shallow as possible: the count sequence is spelled out
+    // instead of coming from a macro, and the overload is
+    // pasted directly. Where the preprocessor still shows up
+    // in build times, see the fixed-arity opcodes in
+    // `include/opcodes.h`, which skip the count altogether.
 
-    #define _THUMBLIB_RSEQ_N() 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
-    #define _THUMBLIB_ARG_N(_1, _2, _3, _4, _5, _6, _7, _8, _9, N, ...) N
+    #define _THUMBLIB_NARG(...) _THUMBLIB_ARG_N(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+    #define _THUMBLIB_ARG_N(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, N, ...) N
 
     #define _THUMBLIB_CONCAT_(x, y) x ## y
     #define _THUMBLIB_CONCAT(x, y) _THUMBLIB_CONCAT_(x, y)
 
-    #define _THUMBLIB_OVERLOAD(Macro, ...) _THUMBLIB_CONCAT(Macro, _THUMBLIB_NARG(__VA_ARGS__))
-    #define _THUMBLIB_APPLY_OVERLOAD(Base, Opcode, ...) _THUMBLIB_OVERLOAD(Base, Opcode, __VA_ARGS__)(Opcode, __VA_ARGS__)
+    #define _THUMBLIB_APPLY_OVERLOAD(Base, Opcode, ...) _THUMBLIB_CONCAT(Base, _THUMBLIB_NARG(Opcode, __VA_ARGS__))(Opcode, __VA_ARGS__)
+
+  // Internal annotation helpers
+
+    #define _THUMBLIB_STR_(x) #x
+    #define _THUMBLIB_STR(x) _THUMBLIB_STR_(x)
+
+    /* _THUMBLIB_ANNOTATION(Kind, Count, Mnemonic)
+     *
+     * This macro expands to a string that is placed at the
+     * start of an opcode's assembler template. When
+     * `THUMBLIB_ANNOTATE` is defined it emits the following
+     * record into `.thumblib.annotations`, otherwise it
+     * expands to an empty string:
+     *
+     * .4byte  address of the instruction
+     * .2byte  source line of the opcode macro
+     * .byte   Kind, Count
+     * .asciz  Mnemonic
+     *
+     * `Kind` is one of the `_THUMBLIB_KIND_*` values below,
+     * `Count` is an assembler expression (the number of registers
+     * for register list opcodes, the number of words for
+     * stack pointer adjustments, and 1 otherwise) and
+     * `Mnemonic` is the opcode's name as a string.
+     *
+     * Keep the kinds in sync with `tools/annotations.h`.
+     */
+
+    #define _THUMBLIB_KIND_DATA            0  // Single cycle data processing
+    #define _THUMBLIB_KIND_ALU             1  // `ALU_BASE` family, refined by mnemonic
+    #define _THUMBLIB_KIND_LOAD            2  // ldr/ldrb/ldrh/ldsb/ldsh
+    #define _THUMBLIB_KIND_STORE           3  // str/strb/strh
+    #define _THUMBLIB_KIND_LOAD_CODE       4  // pc relative/literal pool loads
+    #define _THUMBLIB_KIND_LOAD_STACK      5  // sp relative loads
+    #define _THUMBLIB_KIND_STORE_STACK     6  // sp relative stores
+    #define _THUMBLIB_KIND_LOAD_MULTIPLE   7  // ldmia, Count registers
+    #define _THUMBLIB_KIND_STORE_MULTIPLE  8  // stmia, Count registers
+    #define _THUMBLIB_KIND_PUSH            9  // push, Count registers
+    #define _THUMBLIB_KIND_POP             10 // pop, Count registers
+    #define _THUMBLIB_KIND_POP_PC          11 // pop including pc, Count registers
+    #define _THUMBLIB_KIND_SP_ADJUST       12 // add sp, Count words
+    #define _THUMBLIB_KIND_SP_ADJUST_R     13 // add sp by a register
+    #define _THUMBLIB_KIND_BRANCH          14 // b
+    #define _THUMBLIB_KIND_BRANCH_COND     15 // bxx
+    #define _THUMBLIB_KIND_BRANCH_LINK     16 // bl
+    #define _THUMBLIB_KIND_BRANCH_EXCHANGE 17 // bx
+    #define _THUMBLIB_KIND_PC_WRITE        18 // add/mov pc, half of a bl
+    #define _THUMBLIB_KIND_SWI             19 // swi
+    #define _THUMBLIB_KIND_DATA_SHIFT_R    20 // ARM data processing shifted by a register
+    #define _THUMBLIB_KIND_MULTIPLY        21 // ARM multiplies, Count extra internal cycles
+
+    // Flags that may be combined with a kind
+    #define _THUMBLIB_KIND_ARM             0x80 // ARM state instruction
+    #define _THUMBLIB_KIND_CONDITIONAL     0x40 // ARM conditionally executed instruction
+
+    #ifdef THUMBLIB_ANNOTATE
+      #define _THUMBLIB_ANNOTATION(Kind, Count, Mnemonic)             \
+        ".pushsection .thumblib.annotations, \"\"\n\t"                \
+        ".4byte 1729f\n\t"                                            \
+        ".2byte " _THUMBLIB_STR(__LINE__) "\n\t"                      \
+        ".byte " _THUMBLIB_STR(Kind) ", " _THUMBLIB_STR(Count) "\n\t" \
+        ".asciz \"" Mnemonic "\"\n\t"                                 \
+        ".popsection\n"                                               \
+        "1729:\n\t"
+    #else // THUMBLIB_ANNOTATE
+      #define _THUMBLIB_ANNOTATION(Kind, Count, Mnemonic) ""
+    #endif // THUMBLIB_ANNOTATE
 
   // Internal register list helpers
 
@@ -130,9 +344,21 @@
     #define _THUMBLIB_RL_7(Body, Final, i, List...) Body(i) _THUMBLIB_RL_6(Body, Final, List)
     #define _THUMBLIB_RL_8(Body, Final, i, List...) Body(i) _THUMBLIB_RL_7(Body, Final, List)
 
-    #define _THUMBLIB_GET(_0, _1, _2, _3, _4, _5, _6, _7, _8, NAME, ...) NAME
+    // ARM register lists may hold up to 16 registers
+    #define _THUMBLIB_RL_9(Body, Final, i, List...)  Body(i) _THUMBLIB_RL_8(Body, Final, List)
+    #define _THUMBLIB_RL_10(Body, Final, i, List...) Body(i) _THUMBLIB_RL_9(Body, Final, List)
+    #define _THUMBLIB_RL_11(Body, Final, i, List...) Body(i) _THUMBLIB_RL_10(Body, Final, List)
+    #define _THUMBLIB_RL_12(Body, Final, i, List...) Body(i) _THUMBLIB_RL_11(Body, Final, List)
+    #define _THUMBLIB_RL_13(Body, Final, i, List...) Body(i) _THUMBLIB_RL_12(Body, Final, List)
+    #define _THUMBLIB_RL_14(Body, Final, i, List...) Body(i) _THUMBLIB_RL_13(Body, Final, List)
+    #define _THUMBLIB_RL_15(Body, Final, i, List...) Body(i) _THUMBLIB_RL_14(Body, Final, List)
+    #define _THUMBLIB_RL_16(Body, Final, i, List...) Body(i) _THUMBLIB_RL_15(Body, Final, List)
+
+    #define _THUMBLIB_GET(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, NAME, ...) NAME
     #define _THUMBLIB_FOR_EACH_REG(Body, Final, List...) \
       _THUMBLIB_GET(_0, List, \
+        _THUMBLIB_RL_16, _THUMBLIB_RL_15, _THUMBLIB_RL_14, _THUMBLIB_RL_13, \
+        _THUMBLIB_RL_12, _THUMBLIB_RL_11, _THUMBLIB_RL_10, _THUMBLIB_RL_9, \
         _THUMBLIB_RL_8, _THUMBLIB_RL_7, _THUMBLIB_RL_6, _THUMBLIB_RL_5, \
         _THUMBLIB_RL_4, _THUMBLIB_RL_3, _THUMBLIB_RL_2, _THUMBLIB_RL_1, _THUMBLIB_RL_0 \
         )(Body, Final, List)
@@ -165,4 +391,40 @@
       #define _THUMBLIB_REGLIST(Reg) "%[_" #Reg "], "
       #define _THUMBLIB_REGLIST_LAST(Reg) "%[_" #Reg "]"
 
+      // Expands to the first register of a list.
+      #define _THUMBLIB_FIRST(Reg, ...) Reg
+
+  // Internal statement list helpers
+
+    /* _THUMBLIB_FOR_EACH(Macro, Arg, List...)
+     *
+     * This macro expands to `Macro(Arg, Item)` for each
+     * item of a list of up to 16 items, in order. Unlike
+     * `_THUMBLIB_FOR_EACH_REG` it's meant for building a
+     * sequence of opcodes rather than a single template,
+     * for example
+     *
+     * `_THUMBLIB_FOR_EACH(_THUMBLIB_MOV_FROM, Value, r3, r4)`
+     */
+
+    #define _THUMBLIB_FE_1(Macro, Arg, i)          Macro(Arg, i)
+    #define _THUMBLIB_FE_2(Macro, Arg, i, List...) Macro(Arg, i) _THUMBLIB_FE_1(Macro, Arg, List)
+    #define _THUMBLIB_FE_3(Macro, Arg, i, List...) Macro(Arg, i) _THUMBLIB_FE_2(Macro, Arg, List)
+    #define _THUMBLIB_FE_4(Macro, Arg, i, List...) Macro(Arg, i) _THUMBLIB_FE_3(Macro, Arg, List)
+    #define _THUMBLIB_FE_5(Macro, Arg, i, List...) Macro(Arg, i) _THUMBLIB_FE_4(Macro, Arg, List)
+    #define _THUMBLIB_FE_6(Macro, Arg, i, List...) Macro(Arg, i) _THUMBLIB_FE_5(Macro, Arg, List)
+    #define _THUMBLIB_FE_7(Macro, Arg, i, List...) Macro(Arg, i) _THUMBLIB_FE_6(Macro, Arg, List)
+    #define _THUMBLIB_FE_8(Macro, Arg, i, List...) Macro(Arg, i) _THUMBLIB_FE_7(Macro, Arg, List)
+    #define _THUMBLIB_FE_9(Macro, Arg, i, List...)  Macro(Arg, i) _THUMBLIB_FE_8(Macro, Arg, List)
+    #define _THUMBLIB_FE_10(Macro, Arg, i, List...) Macro(Arg, i) _THUMBLIB_FE_9(Macro, Arg, List)
+    #define _THUMBLIB_FE_11(Macro, Arg, i, List...) Macro(Arg, i) _THUMBLIB_FE_10(Macro, Arg, List)
+    #define _THUMBLIB_FE_12(Macro, Arg, i, List...) Macro(Arg, i) _THUMBLIB_FE_11(Macro, Arg, List)
+    #define _THUMBLIB_FE_13(Macro, Arg, i, List...) Macro(Arg, i) _THUMBLIB_FE_12(Macro, Arg, List)
+    #define _THUMBLIB_FE_14(Macro, Arg, i, List...) Macro(Arg, i) _THUMBLIB_FE_13(Macro, Arg, List)
+    #define _THUMBLIB_FE_15(Macro, Arg, i, List...) Macro(Arg, i) _THUMBLIB_FE_14(Macro, Arg, List)
+    #define _THUMBLIB_FE_16(Macro, Arg, i, List...) Macro(Arg, i) _THUMBLIB_FE_15(Macro, Arg, List)
+
+    #define _THUMBLIB_FOR_EACH(Macro, Arg, List...) \
+      _THUMBLIB_CONCAT(_THUMBLIB_FE_, _THUMBLIB_NARG(List))(Macro, Arg, List)
+
 #endif // THUMBLIB_3_HELPERS
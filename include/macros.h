@@ -31,8 +31,37 @@
   // literal pool.
   #define LTORG() asm volatile (".ltorg" ::: "memory");
 
+  /* THUMBLIB_SIZE_LIMIT(Function, Bytes)
+   *
+   * Flushes the literal pool like `LTORG()`, then makes the
+   * assembler fail if `Function` is more than `Bytes` long up
+   * to this point. Use it as the last line of a function, so
+   * that the check covers its code and its pool:
+   *
+   * `THUMBLIB_SIZE_LIMIT(DrawTextHook, 0x2BB8 - 0x2B80)`
+   *
+   * The check is made once the assembler has laid out the
+   * section, so an overflow is reported as "division by zero
+   * when setting `.LDrawTextHook_over_size_limit'".
+   *
+   * The limit is also recorded in the non-loaded
+   * `.thumblib.sizes` section, where `tools/thumbsize` reads
+   * it to report how many bytes are left.
+   */
+  #define THUMBLIB_SIZE_LIMIT(Function, Bytes)                                            \
+    asm volatile (                                                                        \
+      ".ltorg\n\t"                                                                        \
+      ".set .L%c[_Function]_over_size_limit, 1 / ((. - %c[_Function]) <= %c[_Bytes])\n\t" \
+      ".pushsection .thumblib.sizes, \"\"\n\t"                                            \
+      ".4byte %c[_Function], %c[_Bytes]\n\t"                                              \
+      ".popsection"                                                                       \
+      :                                                                                   \
+      : [_Function] "i" (Function), [_Bytes] "i" (Bytes)                                  \
+      : "memory"                                                                          \
+    );
+
   // Long-calls the function pointed to by the link register,
   // setting the link register to after the jump.
-  #define BL_LR() asm THUMBLIB_OP_FLAGS (".byte 0x00, 0xF8" ::: "lr", "memory");
+  #define BL_LR() asm THUMBLIB_OP_FLAGS (_THUMBLIB_ANNOTATION(_THUMBLIB_KIND_PC_WRITE, 1, "bl") ".byte 0x00, 0xF8" ::: "lr", "memory");
 
 #endif // THUMBLIB_3_MACROS
@@ -79,6 +79,7 @@
    * MUL(Rd, Rs)                  | mul Rd, Rs         | Rd = Rd * Rs
    * B(Label)                     | b Label            | pc = &&Label
    * B_ABS(Position)              | b Position         | pc = Position
+   * B_SYM(Symbol)                | b Symbol           | pc = Symbol, through its veneer if any
    * BL(Label)                    | bl Label           | pc = &&Label, lr = $ + 5
    * BEQ(Label)                   | beq Label          | if cond: pc = &&Label
    * BNE(Label)                   | bne Label          | if cond: pc = &&Label
@@ -171,36 +172,66 @@
    * low registers.
    */
 
+  /* Fixed-arity opcodes
+   *
+   * Each overloaded opcode also has one name per overload,
+   * ending in its number of arguments, such as `LSL_I2(Rd, Imm)`
+   * and `LSL_I3(Rd, Rs, Imm)`. They expand straight to the
+   * overload without counting the arguments, so they're
+   * cheaper to preprocess, and the code is the same. Large
+   * sources can use them where preprocessing dominates build
+   * times, see `examples/bench/preprocess.sh`.
+   */
+
   #define LSL_I(...) _THUMBLIB_APPLY_OVERLOAD(MSR_I_, "lsl", __VA_ARGS__)
   #define LSR_I(...) _THUMBLIB_APPLY_OVERLOAD(MSR_I_, "lsr", __VA_ARGS__)
   #define ASR_I(...) _THUMBLIB_APPLY_OVERLOAD(MSR_I_, "asr", __VA_ARGS__)
 
+  #define LSL_I2(Rd, Immediate) MSR_BASE("lsl", Rd, Rd, Immediate)
+  #define LSR_I2(Rd, Immediate) MSR_BASE("lsr", Rd, Rd, Immediate)
+  #define ASR_I2(Rd, Immediate) MSR_BASE("asr", Rd, Rd, Immediate)
+  #define LSL_I3(Rd, Rs, Immediate) MSR_BASE("lsl", Rd, Rs, Immediate)
+  #define LSR_I3(Rd, Rs, Immediate) MSR_BASE("lsr", Rd, Rs, Immediate)
+  #define ASR_I3(Rd, Rs, Immediate) MSR_BASE("asr", Rd, Rs, Immediate)
+
   #define ADD_R(...) _THUMBLIB_APPLY_OVERLOAD(ADDSUB_R_, "add", __VA_ARGS__)
   #define SUB_R(...) _THUMBLIB_APPLY_OVERLOAD(ADDSUB_R_, "sub", __VA_ARGS__)
 
+  #define ADD_R2(Rd, Rn) ADDSUB_R_BASE("add", Rd, Rd, Rn)
+  #define SUB_R2(Rd, Rn) ADDSUB_R_BASE("sub", Rd, Rd, Rn)
+  #define ADD_R3(Rd, Rs, Rn) ADDSUB_R_BASE("add", Rd, Rs, Rn)
+  #define SUB_R3(Rd, Rs, Rn) ADDSUB_R_BASE("sub", Rd, Rs, Rn)
+
   #define ADD_RI(...) _THUMBLIB_APPLY_OVERLOAD(ADDSUB_RI_, "add", __VA_ARGS__)
   #define SUB_RI(...) _THUMBLIB_APPLY_OVERLOAD(ADDSUB_RI_, "sub", __VA_ARGS__)
 
+  #define ADD_RI2(Rd, Immediate) ADDSUB_RI_BASE("add", Rd, Rd, Immediate)
+  #define SUB_RI2(Rd, Immediate) ADDSUB_RI_BASE("sub", Rd, Rd, Immediate)
+  #define ADD_RI3(Rd, Rs, Immediate) ADDSUB_RI_BASE("add", Rd, Rs, Immediate)
+  #define SUB_RI3(Rd, Rs, Immediate) ADDSUB_RI_BASE("sub", Rd, Rs, Immediate)
+
   // Pseudoinstruction, affects cpsr
-  #define MOV(Rd, Rs) ADD_RI(Rd, Rs, 0)
+  #define MOV(Rd, Rs) ADD_RI3(Rd, Rs, 0)
 
-  #define MOV_I(Rd, Immediate)       \
-    asm THUMBLIB_OP_FLAGS (          \
-      "mov %[_Rd], %[_Immediate]"    \
-      : [_Rd] "=l" (Rd)              \
-      : [_Immediate] "I" (Immediate) \
-      : "cc"                         \
+  #define MOV_I(Rd, Immediate)                            \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "mov") \
+      "mov %[_Rd], %[_Immediate]"                         \
+      : [_Rd] "=l" (Rd)                                   \
+      : [_Immediate] "I" (Immediate)                      \
+      : "cc"                                              \
     );
 
   #define ADD_I(Rd, Immediate) ADDSUB_I_BASE("add", Rd, Immediate)
   #define SUB_I(Rd, Immediate) ADDSUB_I_BASE("sub", Rd, Immediate)
 
-  #define CMP_I(Rd, Immediate)                       \
-    asm THUMBLIB_OP_FLAGS (                          \
-      "cmp %[_Rd], %[_Immediate]"                    \
-      :                                              \
-      : [_Rd] "l" (Rd), [_Immediate] "I" (Immediate) \
-      : "cc"                                         \
+  #define CMP_I(Rd, Immediate)                            \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "cmp") \
+      "cmp %[_Rd], %[_Immediate]"                         \
+      :                                                   \
+      : [_Rd] "l" (Rd), [_Immediate] "I" (Immediate)      \
+      : "cc"                                              \
     );
 
   #define AND(Rd, Rs) ALU_BASE("and", Rd, Rs)
@@ -226,217 +257,264 @@
   #define ADD(Rd, Rs) ADDSUB_R_3("add", Rd, Rs)
   #define SUB(Rd, Rs) ADDSUB_R_3("sub", Rd, Rs)
 
-  #define ADD_H(Rd, Rs)     \
-    asm THUMBLIB_OP_FLAGS ( \
-      "add %[_Rd], %[_Rs]"  \
-      : [_Rd] "+lh" (Rd)    \
-      : [_Rs] "lh" (Rs)     \
+  #define ADD_H(Rd, Rs)                                   \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "add") \
+      "add %[_Rd], %[_Rs]"                                \
+      : [_Rd] "+lh" (Rd)                                  \
+      : [_Rs] "lh" (Rs)                                   \
     );
 
-  #define CMP_H(Rd, Rs)                  \
-    asm THUMBLIB_OP_FLAGS (              \
-      "cmp %[_Rd], %[_Rs]"               \
-      :                                  \
-      : [_Rd] "lh" (Rd), [_Rs] "lh" (Rs) \
-      : "cc"                             \
+  #define CMP_H(Rd, Rs)                                   \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "cmp") \
+      "cmp %[_Rd], %[_Rs]"                                \
+      :                                                   \
+      : [_Rd] "lh" (Rd), [_Rs] "lh" (Rs)                  \
+      : "cc"                                              \
     );
 
-  #define MOV_H(Rd, Rs)     \
-    asm THUMBLIB_OP_FLAGS ( \
-      "mov %[_Rd], %[_Rs]"  \
-      : [_Rd] "=lh" (Rd)    \
-      : [_Rs] "lh" (Rs)     \
+  #define MOV_H(Rd, Rs)                                   \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "mov") \
+      "mov %[_Rd], %[_Rs]"                                \
+      : [_Rd] "=lh" (Rd)                                  \
+      : [_Rs] "lh" (Rs)                                   \
     );
 
   // Hardcoded high register variants because
   // GCC really doesn't want you specifying these.
   // Use at your own risk.
 
-  #define ADD_SP(Rd)        \
-    asm THUMBLIB_OP_FLAGS ( \
-      "add %[_Rd], sp"      \
-      : [_Rd] "+lh" (Rd)    \
-      :                     \
-      :                     \
+  #define ADD_SP(Rd)                                      \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "add") \
+      "add %[_Rd], sp"                                    \
+      : [_Rd] "+lh" (Rd)                                  \
+      :                                                   \
+      :                                                   \
     );
 
   // Different name to avoid shadowing dedicated
   // SP-adjusting opcode
-  #define ADD_TO_SP_H(Rs)   \
-    asm THUMBLIB_OP_FLAGS ( \
-      "add sp, %[_Rs]"      \
-      :                     \
-      : [_Rs] "lh" (Rs)     \
-      :                     \
-    );
-
-  #define ADD_LR(Rd)        \
-    asm THUMBLIB_OP_FLAGS ( \
-      "add %[_Rd], lr"      \
-      : [_Rd] "+lh" (Rd)    \
-      :                     \
-      :                     \
-    );
-
-  #define ADD_TO_LR(Rs)     \
-    asm THUMBLIB_OP_FLAGS ( \
-      "add lr, %[_Rs]"      \
-      :                     \
-      : [_Rs] "lh" (Rs)     \
-      : "lr"                \
-    );
-
-  #define ADD_PC(Rd)        \
-    asm THUMBLIB_OP_FLAGS ( \
-      "add %[_Rd], pc"      \
-      : [_Rd] "+lh" (Rd)    \
-      :                     \
-      :                     \
-    );
-
-  #define ADD_TO_PC(Rs)     \
-    asm THUMBLIB_OP_FLAGS ( \
-      "add pc, %[_Rs]"      \
-      :                     \
-      : [_Rs] "lh" (Rs)     \
-      : "pc", "memory"      \
-    );
-
-  #define MOV_SP(Rd)        \
-    asm THUMBLIB_OP_FLAGS ( \
-      "mov %[_Rd], sp"      \
-      : [_Rd] "+lh" (Rd)    \
-      :                     \
-      :                     \
-    );
-
-  #define MOV_TO_SP(Rs)     \
-    asm THUMBLIB_OP_FLAGS ( \
-      "mov sp, %[_Rs]"      \
-      :                     \
-      : [_Rs] "lh" (Rs)     \
-      :                     \
-    );
-
-  #define MOV_LR(Rd)        \
-    asm THUMBLIB_OP_FLAGS ( \
-      "mov %[_Rd], lr"      \
-      : [_Rd] "+lh" (Rd)    \
-      :                     \
-      :                     \
-    );
-
-  #define MOV_TO_LR(Rs)     \
-    asm THUMBLIB_OP_FLAGS ( \
-      "mov lr, %[_Rs]"      \
-      :                     \
-      : [_Rs] "lh" (Rs)     \
-      : "lr"                \
-    );
-
-  #define MOV_PC(Rd)        \
-    asm THUMBLIB_OP_FLAGS ( \
-      "mov %[_Rd], pc"      \
-      : [_Rd] "=lh" (Rd)    \
-      :                     \
-      :                     \
-    );
-
-  #define MOV_TO_PC(Rs)     \
-    asm THUMBLIB_OP_FLAGS ( \
-      "mov pc, %[_Rs]"      \
-      :                     \
-      : [_Rs] "lh" (Rs)     \
-      : "pc", "memory"      \
-    );
+  #define ADD_TO_SP_H(Rs)                                        \
+    asm THUMBLIB_OP_FLAGS (                                      \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_SP_ADJUST_R, 1, "add") \
+      "add sp, %[_Rs]"                                           \
+      :                                                          \
+      : [_Rs] "lh" (Rs)                                          \
+      :                                                          \
+    );
+
+  #define ADD_LR(Rd)                                      \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "add") \
+      "add %[_Rd], lr"                                    \
+      : [_Rd] "+lh" (Rd)                                  \
+      :                                                   \
+      :                                                   \
+    );
+
+  #define ADD_TO_LR(Rs)                                   \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "add") \
+      "add lr, %[_Rs]"                                    \
+      :                                                   \
+      : [_Rs] "lh" (Rs)                                   \
+      : "lr"                                              \
+    );
+
+  #define ADD_PC(Rd)                                      \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "add") \
+      "add %[_Rd], pc"                                    \
+      : [_Rd] "+lh" (Rd)                                  \
+      :                                                   \
+      :                                                   \
+    );
+
+  #define ADD_TO_PC(Rs)                                       \
+    asm THUMBLIB_OP_FLAGS (                                   \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_PC_WRITE, 1, "add") \
+      "add pc, %[_Rs]"                                        \
+      :                                                       \
+      : [_Rs] "lh" (Rs)                                       \
+      : "pc", "memory"                                        \
+    );
+
+  #define MOV_SP(Rd)                                      \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "mov") \
+      "mov %[_Rd], sp"                                    \
+      : [_Rd] "+lh" (Rd)                                  \
+      :                                                   \
+      :                                                   \
+    );
+
+  #define MOV_TO_SP(Rs)                                          \
+    asm THUMBLIB_OP_FLAGS (                                      \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_SP_ADJUST_R, 1, "mov") \
+      "mov sp, %[_Rs]"                                           \
+      :                                                          \
+      : [_Rs] "lh" (Rs)                                          \
+      :                                                          \
+    );
+
+  #define MOV_LR(Rd)                                      \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "mov") \
+      "mov %[_Rd], lr"                                    \
+      : [_Rd] "+lh" (Rd)                                  \
+      :                                                   \
+      :                                                   \
+    );
+
+  #define MOV_TO_LR(Rs)                                   \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "mov") \
+      "mov lr, %[_Rs]"                                    \
+      :                                                   \
+      : [_Rs] "lh" (Rs)                                   \
+      : "lr"                                              \
+    );
+
+  #define MOV_PC(Rd)                                      \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "mov") \
+      "mov %[_Rd], pc"                                    \
+      : [_Rd] "=lh" (Rd)                                  \
+      :                                                   \
+      :                                                   \
+    );
+
+  #define MOV_TO_PC(Rs)                                       \
+    asm THUMBLIB_OP_FLAGS (                                   \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_PC_WRITE, 1, "mov") \
+      "mov pc, %[_Rs]"                                        \
+      :                                                       \
+      : [_Rs] "lh" (Rs)                                       \
+      : "pc", "memory"                                        \
+    );
+
+  #define CMP_SP(Rd)                                      \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "cmp") \
+      "cmp %[_Rd], sp"                                    \
+      :                                                   \
+      : [_Rd] "lh" (Rd)                                   \
+      : "cc"                                              \
+    );
+
+  #define CMP_TO_SP(Rs)                                   \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "cmp") \
+      "cmp sp, %[_Rs]"                                    \
+      :                                                   \
+      : [_Rs] "lh" (Rs)                                   \
+      : "cc"                                              \
+    );
+
+  #define CMP_LR(Rd)                                      \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "cmp") \
+      "cmp %[_Rd], lr"                                    \
+      :                                                   \
+      : [_Rd] "lh" (Rd)                                   \
+      : "cc"                                              \
+    );
+
+  #define CMP_TO_LR(Rs)                                   \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "cmp") \
+      "cmp lr, %[_Rs]"                                    \
+      :                                                   \
+      : [_Rs] "lh" (Rs)                                   \
+      : "cc"                                              \
+    );
+
+  #define CMP_PC(Rd)                                      \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "cmp") \
+      "cmp %[_Rd], pc"                                    \
+      :                                                   \
+      : [_Rd] "lh" (Rd)                                   \
+      : "cc"                                              \
+    );
 
-  #define CMP_SP(Rd)        \
-    asm THUMBLIB_OP_FLAGS ( \
-      "cmp %[_Rd], sp"      \
-      :                     \
-      : [_Rd] "lh" (Rd)     \
-      : "cc"                \
-    );
-
-  #define CMP_TO_SP(Rs)     \
-    asm THUMBLIB_OP_FLAGS ( \
-      "cmp sp, %[_Rs]"      \
-      :                     \
-      : [_Rs] "lh" (Rs)     \
-      : "cc"                \
-    );
-
-  #define CMP_LR(Rd)        \
-    asm THUMBLIB_OP_FLAGS ( \
-      "cmp %[_Rd], lr"      \
-      :                     \
-      : [_Rd] "lh" (Rd)     \
-      : "cc"                \
-    );
-
-  #define CMP_TO_LR(Rs)     \
-    asm THUMBLIB_OP_FLAGS ( \
-      "cmp lr, %[_Rs]"      \
-      :                     \
-      : [_Rs] "lh" (Rs)     \
-      : "cc"                \
-    );
-
-  #define CMP_PC(Rd)        \
-    asm THUMBLIB_OP_FLAGS ( \
-      "cmp %[_Rd], pc"      \
-      :                     \
-      : [_Rd] "lh" (Rd)     \
-      : "cc"                \
-    );
-
-  #define CMP_TO_PC(Rs)     \
-    asm THUMBLIB_OP_FLAGS ( \
-      "cmp pc, %[_Rs]"      \
-      :                     \
-      : [_Rs] "lh" (Rs)     \
-      : "cc"                \
+  #define CMP_TO_PC(Rs)                                   \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "cmp") \
+      "cmp pc, %[_Rs]"                                    \
+      :                                                   \
+      : [_Rs] "lh" (Rs)                                   \
+      : "cc"                                              \
     );
 
 
   // Pseudoinstruction, defined like this to
   // avoid needing to initialize r8.
-  #define NOP() asm THUMBLIB_OP_FLAGS ("mov r8, r8");
+  #define NOP() asm THUMBLIB_OP_FLAGS (_THUMBLIB_ANNOTATION(_THUMBLIB_KIND_DATA, 1, "mov") "mov r8, r8");
 
-  #define BX(Rs)            \
-    asm THUMBLIB_OP_FLAGS ( \
-      "bx %[_Rs]"           \
-      :                     \
-      : [_Rs] "lh" (Rs)     \
-      : "pc"                \
+  #define BX(Rs)                                                    \
+    asm THUMBLIB_OP_FLAGS (                                         \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_BRANCH_EXCHANGE, 1, "bx") \
+      "bx %[_Rs]"                                                   \
+      :                                                             \
+      : [_Rs] "lh" (Rs)                                             \
+      : "pc"                                                        \
     );
 
-  #define BX_SP() asm THUMBLIB_OP_FLAGS ("bx sp" ::: "pc");
-  #define BX_LR() asm THUMBLIB_OP_FLAGS ("bx lr" ::: "pc");
-  #define BX_PC() asm THUMBLIB_OP_FLAGS ("bx pc" ::: "pc");
+  #define BX_SP() asm THUMBLIB_OP_FLAGS (_THUMBLIB_ANNOTATION(_THUMBLIB_KIND_BRANCH_EXCHANGE, 1, "bx") "bx sp" ::: "pc");
+  #define BX_LR() asm THUMBLIB_OP_FLAGS (_THUMBLIB_ANNOTATION(_THUMBLIB_KIND_BRANCH_EXCHANGE, 1, "bx") "bx lr" ::: "pc");
+  #define BX_PC() asm THUMBLIB_OP_FLAGS (_THUMBLIB_ANNOTATION(_THUMBLIB_KIND_BRANCH_EXCHANGE, 1, "bx") "bx pc" ::: "pc");
 
-  #define LDR_POOL(Rd, Value)   \
-    asm THUMBLIB_OP_FLAGS (     \
-      "ldr %[_Rd], =%[_Value]" \
-      : [_Rd] "=l" (Rd)         \
-      : [_Value] "i" (Value)    \
-      : "memory"                \
+  #define LDR_POOL(Rd, Value)                                  \
+    asm THUMBLIB_OP_FLAGS (                                    \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_LOAD_CODE, 1, "ldr") \
+      "ldr %[_Rd], =%[_Value]"                                 \
+      : [_Rd] "=l" (Rd)                                        \
+      : [_Value] "i" (Value)                                   \
+      : "memory"                                               \
     );
 
   #define LDR_PC(...) _THUMBLIB_APPLY_OVERLOAD(LDR_PC_, "ldr", __VA_ARGS__)
 
+  #define LDR_PC1(Rd) LDR_PC_BASE(Rd, 0)
+  #define LDR_PC2(Rd, Immediate) LDR_PC_BASE(Rd, Immediate)
+
   #define STR(...) _THUMBLIB_APPLY_OVERLOAD(STR_, "str", u32, __VA_ARGS__)
   #define STRB(...) _THUMBLIB_APPLY_OVERLOAD(STR_, "strb", u8, __VA_ARGS__)
   #define STRH(...) _THUMBLIB_APPLY_OVERLOAD(STR_, "strh", u16, __VA_ARGS__)
 
+  #define STR2(Rd, Rb) STR_I_BASE("str", u32, Rd, Rb, 0)
+  #define STRB2(Rd, Rb) STR_I_BASE("strb", u8, Rd, Rb, 0)
+  #define STRH2(Rd, Rb) STR_I_BASE("strh", u16, Rd, Rb, 0)
+  #define STR3(Rd, Rb, Ro) STR_BASE("str", u32, Rd, Rb, Ro)
+  #define STRB3(Rd, Rb, Ro) STR_BASE("strb", u8, Rd, Rb, Ro)
+  #define STRH3(Rd, Rb, Ro) STR_BASE("strh", u16, Rd, Rb, Ro)
+
   #define STR_I(...) _THUMBLIB_APPLY_OVERLOAD(STR_I_, "str", u32, __VA_ARGS__)
   #define STRB_I(...) _THUMBLIB_APPLY_OVERLOAD(STR_I_, "strb", u8, __VA_ARGS__)
   #define STRH_I(...) _THUMBLIB_APPLY_OVERLOAD(STR_I_, "strh", u16, __VA_ARGS__)
 
+  #define STR_I2(Rd, Rb) STR_I_BASE("str", u32, Rd, Rb, 0)
+  #define STRB_I2(Rd, Rb) STR_I_BASE("strb", u8, Rd, Rb, 0)
+  #define STRH_I2(Rd, Rb) STR_I_BASE("strh", u16, Rd, Rb, 0)
+  #define STR_I3(Rd, Rb, Immediate) STR_I_BASE("str", u32, Rd, Rb, Immediate)
+  #define STRB_I3(Rd, Rb, Immediate) STR_I_BASE("strb", u8, Rd, Rb, Immediate)
+  #define STRH_I3(Rd, Rb, Immediate) STR_I_BASE("strh", u16, Rd, Rb, Immediate)
+
   #define LDR(...) _THUMBLIB_APPLY_OVERLOAD(LDR_, "ldr", u32, __VA_ARGS__)
   #define LDRB(...) _THUMBLIB_APPLY_OVERLOAD(LDR_, "ldrb", u8, __VA_ARGS__)
   #define LDRH(...) _THUMBLIB_APPLY_OVERLOAD(LDR_, "ldrh", u16, __VA_ARGS__)
 
+  #define LDR2(Rd, Rb) LDR_I_BASE("ldr", u32, Rd, Rb, 0)
+  #define LDRB2(Rd, Rb) LDR_I_BASE("ldrb", u8, Rd, Rb, 0)
+  #define LDRH2(Rd, Rb) LDR_I_BASE("ldrh", u16, Rd, Rb, 0)
+  #define LDR3(Rd, Rb, Ro) LDR_BASE("ldr", u32, Rd, Rb, Ro)
+  #define LDRB3(Rd, Rb, Ro) LDR_BASE("ldrb", u8, Rd, Rb, Ro)
+  #define LDRH3(Rd, Rb, Ro) LDR_BASE("ldrh", u16, Rd, Rb, Ro)
+
   #define LDSB(Rd, Rb, Ro) LDR_BASE("ldsb", s8, Rd, Rb, Ro)
   #define LDSH(Rd, Rb, Ro) LDR_BASE("ldsh", s16, Rd, Rb, Ro)
 
@@ -444,22 +522,40 @@
   #define LDRB_I(...) _THUMBLIB_APPLY_OVERLOAD(LDR_I_, "ldrb", u8, __VA_ARGS__)
   #define LDRH_I(...) _THUMBLIB_APPLY_OVERLOAD(LDR_I_, "ldrh", u16, __VA_ARGS__)
 
+  #define LDR_I2(Rd, Rb) LDR_I_BASE("ldr", u32, Rd, Rb, 0)
+  #define LDRB_I2(Rd, Rb) LDR_I_BASE("ldrb", u8, Rd, Rb, 0)
+  #define LDRH_I2(Rd, Rb) LDR_I_BASE("ldrh", u16, Rd, Rb, 0)
+  #define LDR_I3(Rd, Rb, Immediate) LDR_I_BASE("ldr", u32, Rd, Rb, Immediate)
+  #define LDRB_I3(Rd, Rb, Immediate) LDR_I_BASE("ldrb", u8, Rd, Rb, Immediate)
+  #define LDRH_I3(Rd, Rb, Immediate) LDR_I_BASE("ldrh", u16, Rd, Rb, Immediate)
+
   #define STR_SP(...) _THUMBLIB_APPLY_OVERLOAD(STR_SP_, "str", __VA_ARGS__)
   #define LDR_SP(...) _THUMBLIB_APPLY_OVERLOAD(LDR_SP_, "ldr", __VA_ARGS__)
 
+  #define STR_SP1(Rd) STR_SP_BASE(Rd, 0)
+  #define LDR_SP1(Rd) LDR_SP_BASE(Rd, 0)
+  #define STR_SP2(Rd, Immediate) STR_SP_BASE(Rd, Immediate)
+  #define LDR_SP2(Rd, Immediate) LDR_SP_BASE(Rd, Immediate)
+
   // These are the `add, Rd, pc/sp, #NN` instructions.
 
   #define PCR(...) _THUMBLIB_APPLY_OVERLOAD(GRA_, "add", "pc", __VA_ARGS__)
   #define SPR(...) _THUMBLIB_APPLY_OVERLOAD(GRA_, "add", "sp", __VA_ARGS__)
 
+  #define PCR1(Rd) GRA_BASE("add", "pc", Rd, 0)
+  #define SPR1(Rd) GRA_BASE("add", "sp", Rd, 0)
+  #define PCR2(Rd, Immediate) GRA_BASE("add", "pc", Rd, Immediate)
+  #define SPR2(Rd, Immediate) GRA_BASE("add", "sp", Rd, Immediate)
+
   // GCC actually doesn't let you say that you're
   // clobbering SP, so the optimizer might just do
   // anything here.
-  #define ADD_TO_SP(Immediate)       \
-    asm THUMBLIB_OP_FLAGS (          \
-      "add sp, %[_Immediate]"        \
-      :                              \
-      : [_Immediate] "O" (Immediate) \
+  #define ADD_TO_SP(Immediate)                                                    \
+    asm THUMBLIB_OP_FLAGS (                                                       \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_SP_ADJUST, (%c[_Immediate]) / 4, "add") \
+      "add sp, %[_Immediate]"                                                     \
+      :                                                                           \
+      : [_Immediate] "O" (Immediate)                                              \
     );
 
   #define SUB_FROM_SP(Immediate) ADD_TO_SP(-Immediate)
@@ -467,6 +563,7 @@
   // If you need to push lr, see `PUSH_WITH_LR` and `PUSH_LR`.
   #define PUSH(Registers...)                                                                    \
     asm THUMBLIB_OP_FLAGS (                                                                     \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_PUSH, _THUMBLIB_NARG(Registers), "push")              \
       "push {" _THUMBLIB_FOR_EACH_REG(_THUMBLIB_REGLIST, _THUMBLIB_REGLIST_LAST, Registers) "}" \
       :                                                                                         \
       : _THUMBLIB_FOR_EACH_REG(_THUMBLIB_INPUT, _THUMBLIB_INPUT_LAST, Registers)                \
@@ -475,23 +572,26 @@
 
   #define PUSH_WITH_LR(Registers...)                                                                \
     asm THUMBLIB_OP_FLAGS (                                                                         \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_PUSH, _THUMBLIB_NARG(Registers) + 1, "push")              \
       "push {" _THUMBLIB_FOR_EACH_REG(_THUMBLIB_REGLIST, _THUMBLIB_REGLIST_LAST, Registers) ", lr}" \
       :                                                                                             \
       : _THUMBLIB_FOR_EACH_REG(_THUMBLIB_INPUT, _THUMBLIB_INPUT_LAST, Registers)                    \
       : "memory"                                                                                    \
     );
 
-  #define PUSH_LR()         \
-    asm THUMBLIB_OP_FLAGS ( \
-      "push {lr}"           \
-      :                     \
-      :                     \
-      : "memory"            \
+  #define PUSH_LR()                                        \
+    asm THUMBLIB_OP_FLAGS (                                \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_PUSH, 1, "push") \
+      "push {lr}"                                          \
+      :                                                    \
+      :                                                    \
+      : "memory"                                           \
     );
 
   // If you need to pop pc, see `POP_WITH_PC` `POP_PC`.
   #define POP(Registers...)                                                                    \
     asm THUMBLIB_OP_FLAGS (                                                                    \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_POP, _THUMBLIB_NARG(Registers), "pop")               \
       "pop {" _THUMBLIB_FOR_EACH_REG(_THUMBLIB_REGLIST, _THUMBLIB_REGLIST_LAST, Registers) "}" \
       : _THUMBLIB_FOR_EACH_REG(_THUMBLIB_OUTPUT, _THUMBLIB_OUTPUT_LAST, Registers)             \
       :                                                                                        \
@@ -500,22 +600,25 @@
 
   #define POP_WITH_PC(Registers...)                                                                \
     asm THUMBLIB_OP_FLAGS (                                                                        \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_POP_PC, _THUMBLIB_NARG(Registers) + 1, "pop")            \
       "pop {" _THUMBLIB_FOR_EACH_REG(_THUMBLIB_REGLIST, _THUMBLIB_REGLIST_LAST, Registers) ", pc}" \
       : _THUMBLIB_FOR_EACH_REG(_THUMBLIB_OUTPUT, _THUMBLIB_OUTPUT_LAST, Registers)                 \
       :                                                                                            \
       : "pc", "memory"                                                                             \
     );
 
-  #define POP_PC()          \
-    asm THUMBLIB_OP_FLAGS ( \
-      "pop {pc}"            \
-      :                     \
-      :                     \
-      : "pc", "memory"      \
+  #define POP_PC()                                          \
+    asm THUMBLIB_OP_FLAGS (                                 \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_POP_PC, 1, "pop") \
+      "pop {pc}"                                            \
+      :                                                     \
+      :                                                     \
+      : "pc", "memory"                                      \
     );
 
   #define STMIA(Rb, Registers...)                                                                         \
     asm THUMBLIB_OP_FLAGS (                                                                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_STORE_MULTIPLE, _THUMBLIB_NARG(Registers), "stmia")             \
       "stmia %[_Rb]!, {" _THUMBLIB_FOR_EACH_REG(_THUMBLIB_REGLIST, _THUMBLIB_REGLIST_LAST, Registers) "}" \
       : [_Rb] "+l" (Rb)                                                                                   \
       : _THUMBLIB_FOR_EACH_REG(_THUMBLIB_INPUT, _THUMBLIB_INPUT_LAST, Registers)                          \
@@ -524,8 +627,9 @@
 
   #define LDMIA(Rb, Registers...)                                                                         \
     asm THUMBLIB_OP_FLAGS (                                                                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_LOAD_MULTIPLE, _THUMBLIB_NARG(Registers), "ldmia")              \
       "ldmia %[_Rb]!, {" _THUMBLIB_FOR_EACH_REG(_THUMBLIB_REGLIST, _THUMBLIB_REGLIST_LAST, Registers) "}" \
-      : [_Rb] "=l" (Rb), _THUMBLIB_FOR_EACH_REG(_THUMBLIB_OUTPUT, _THUMBLIB_OUTPUT_LAST, Registers)       \
+      : [_Rb] "+l" (Rb), _THUMBLIB_FOR_EACH_REG(_THUMBLIB_OUTPUT, _THUMBLIB_OUTPUT_LAST, Registers)       \
       :                                                                                                   \
       : "memory"                                                                                          \
     );
@@ -560,35 +664,59 @@
   #define BGT_ABS(Position) BRANCH_ABS_BASE("bgt", Position)
   #define BLE_ABS(Position) BRANCH_ABS_BASE("ble", Position)
 
-  #define B(Label)               \
-    asm goto THUMBLIB_OP_FLAGS ( \
-      "b %l0"                    \
-      :                          \
-      :                          \
-      :                          \
-      : Label                    \
-    );
-
-  #define B_ABS(Position)   \
-    asm THUMBLIB_OP_FLAGS ( \
-      "b %c0"               \
-      :                     \
-      : "i" (Position)      \
-    );
-
-  #define BL(Symbol)         \
-    asm THUMBLIB_OP_FLAGS (  \
-      "bl " #Symbol          \
-      :                      \
-      :                      \
-      : "lr", "memory", "cc" \
-    );
-
-  #define SWI(Index)         \
-    asm THUMBLIB_OP_FLAGS (  \
-      "swi %[_Index]"        \
-      :                      \
-      : [_Index] "I" (Index) \
+  #define B(Label)                                        \
+    asm goto THUMBLIB_OP_FLAGS (                          \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_BRANCH, 1, "b") \
+      "b %l0"                                             \
+      :                                                   \
+      :                                                   \
+      :                                                   \
+      : Label                                             \
+    );
+
+  #define B_ABS(Position)                                 \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_BRANCH, 1, "b") \
+      "b %c0"                                             \
+      :                                                   \
+      : "i" (Position)                                    \
+    );
+
+  // `B_SYM` and `BL` are redirected through the veneer of
+  // an IWRAM function when `THUMBLIB_IWRAM_VENEER` was used
+  // for it. Both take a plain symbol, so use `B_SYM` rather
+  // than `B_ABS` to tail-branch to such a function.
+  #define B_SYM(Symbol)                                   \
+    asm THUMBLIB_OP_FLAGS (                               \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_BRANCH, 1, "b") \
+      ".ifdef __thumblib_veneer_" #Symbol "\n\t"          \
+      "b __thumblib_veneer_" #Symbol "\n\t"               \
+      ".else\n\t"                                         \
+      "b " #Symbol "\n\t"                                 \
+      ".endif"                                            \
+      :                                                   \
+      :                                                   \
+    );
+
+  #define BL(Symbol)                                            \
+    asm THUMBLIB_OP_FLAGS (                                     \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_BRANCH_LINK, 1, "bl") \
+      ".ifdef __thumblib_veneer_" #Symbol "\n\t"                \
+      "bl __thumblib_veneer_" #Symbol "\n\t"                    \
+      ".else\n\t"                                               \
+      "bl " #Symbol "\n\t"                                      \
+      ".endif"                                                  \
+      :                                                         \
+      :                                                         \
+      : "lr", "memory", "cc"                                    \
+    );
+
+  #define SWI(Index)                                     \
+    asm THUMBLIB_OP_FLAGS (                              \
+      _THUMBLIB_ANNOTATION(_THUMBLIB_KIND_SWI, 1, "swi") \
+      "swi %[_Index]"                                    \
+      :                                                  \
+      : [_Index] "I" (Index)                             \
     );
 
 #endif // THUMBLIB_3_OPCODES
@@ -0,0 +1,694 @@
+#ifndef THUMBLIB_3_OPCODES_HPP
+#define THUMBLIB_3_OPCODES_HPP
+
+  /* THUMBLIB3 C++ opcodes
+   *
+   * This file defines the THUMB opcodes of `include/opcodes.h`
+   * and `MOV_CONST` as C++17 function templates in the
+   * `thumblib` namespace, for use through `thumblib3.hpp`.
+   *
+   * Registers are typed handles, `thumblib::r0` to `r12`,
+   * `sp`, `lr` and `pc`, and immediates are template
+   * arguments. Each function checks its registers, immediate
+   * range and alignment with `static_assert`, and chooses
+   * the encoding from its operands at compile time, so that a
+   * bad operand is a compiler error pointing at the line that
+   * used it instead of an assembler error, and one name covers
+   * what the C macros split into `ADD_I`, `ADD_RI`, `ADD_H`,
+   * `SPR`, `ADD_TO_SP` and so on.
+   *
+   * Unlike the C macros, these name the registers themselves
+   * rather than binding C variables, the way `register int x
+   * asm("r2")` does. The compiler doesn't know which registers
+   * they use, so use them within `THUMBLIB_FUNC` functions
+   * only, where it emits no code of its own. There they
+   * assemble to the same instructions as the C macros, and
+   * the two can be mixed freely.
+   *
+   * Opcodes without register or immediate operands, and those
+   * that take C labels (branches, `LTORG()`, `NOP()`, `BX_LR()`,
+   * `SWITCH_TABLE`, ...), stay C macros, since labels can't be
+   * passed to functions.
+   *
+   * With `THUMBLIB_ANNOTATE`, each function emits the same
+   * annotation record as its C macro, with the line of the
+   * call. The line is an "i" operand, so the calling function
+   * must be optimized, as `THUMBLIB_FUNC` ensures.
+   */
+
+  /* Opcode cheat sheet
+   *
+   * `using namespace thumblib;` is assumed. D, S, N and B are
+   * r0-r7 unless other registers are mentioned, and Imm is a
+   * constant expression.
+   *
+   * C++ syntax                  | C macro              | THUMB syntax
+   *                             |                      |
+   * mov<Imm>(D)                 | MOV_I                | mov D, #Imm
+   * mov(D, S)                   | MOV                  | add D, S, #0
+   * mov(D, S), D/S r8-r15       | MOV_H, MOV_SP, ...   | mov D, S
+   * mov_const<Value>(D)         | MOV_CONST            | shortest of mov/lsl/mvn/add/neg or ldr =Value
+   * ldr_pool<Value>(D)          | LDR_POOL             | ldr D, =Value
+   * add<Imm>(D)                 | ADD_I, SUB_I         | add D, #Imm (sub for Imm < 0)
+   * add<Imm>(sp)                | ADD_TO_SP            | add sp, #Imm
+   * add<Imm>(D, S)              | ADD_RI, SUB_RI       | add D, S, #Imm when Imm is -7 to 7
+   * add<Imm>(D, D)              | ADD_I, SUB_I         | add D, #Imm otherwise
+   * add<Imm>(D, sp)             | SPR                  | add D, sp, #Imm
+   * add<Imm>(D, pc)             | PCR                  | add D, pc, #Imm
+   * add(D, S)                   | ADD                  | add D, D, S
+   * add(D, S), D/S r8-r15       | ADD_H, ADD_SP, ...   | add D, S
+   * add(D, S, N)                | ADD_R                | add D, S, N
+   * sub<Imm>(...)               | SUB_I, SUB_FROM_SP   | add<-Imm>(...)
+   * sub(D, S), sub(D, S, N)     | SUB, SUB_R           | sub D, D, S / sub D, S, N
+   * cmp<Imm>(D)                 | CMP_I                | cmp D, #Imm
+   * cmp(D, S), D/S r0-r15       | CMP, CMP_H, ...      | cmp D, S
+   * lsl<Imm>(D, S)              | LSL_I                | lsl D, S, #Imm
+   * lsl<Imm>(D)                 | LSL_I                | lsl D, D, #Imm
+   * lsl(D, S)                   | LSL                  | lsl D, S
+   * lsr, asr                    | LSR_I, ASR_I, ...    | as lsl
+   * and_, eor, orr, bic, adc,   | AND, EOR, ...        | and D, S ...
+   * sbc, ror, mul, neg, mvn,    |                      |
+   * tst, cmn (D, S)             |                      |
+   * ldr<Imm>(D, B)              | LDR_I                | ldr D, [B, #Imm]
+   * ldr<Imm>(D, sp)             | LDR_SP               | ldr D, [sp, #Imm]
+   * ldr<Imm>(D, pc)             | LDR_PC               | ldr D, [pc, #Imm]
+   * ldr(D, B, N)                | LDR                  | ldr D, [B, N]
+   * ldrh, ldrb, str, strh, strb | LDRH_I, ...          | as ldr, sp only for str
+   * ldsb(D, B, N), ldsh(D, B, N)| LDSB, LDSH           | ldsb D, [B, N]
+   * push(r4 | r5 | lr)          | PUSH_WITH_LR         | push {r4, r5, lr}
+   * pop(r4 | r5 | pc)           | POP_WITH_PC          | pop {r4, r5, pc}
+   * stmia(B, r1 | r2)           | STMIA                | stmia B!, {r1, r2}
+   * ldmia(B, r1 | r2)           | LDMIA                | ldmia B!, {r1, r2}
+   * bx(S), S r0-r15             | BX                   | bx S
+   * swi<Imm>()                  | SWI                  | swi Imm
+   *
+   * `Imm` defaults to 0 for loads and stores.
+   */
+
+  // Internal helpers
+
+    #define _THUMBLIB_CPP_INLINE __attribute__((always_inline)) inline
+
+    // The source line of the call, for annotation records
+    #define _THUMBLIB_CPP_LINE [[maybe_unused]] unsigned line = __builtin_LINE()
+
+    /* _THUMBLIB_CPP_ANNOTATION(Mnemonic)
+     * _THUMBLIB_CPP_RECORD(Kind, Count)
+     *
+     * Like `_THUMBLIB_ANNOTATION`, but the kind, count and line
+     * are operands, so that they can depend on template
+     * arguments. `_THUMBLIB_CPP_RECORD` adds the operands after
+     * the others, with a leading comma.
+     */
+    #ifdef THUMBLIB_ANNOTATE
+      #define _THUMBLIB_CPP_ANNOTATION(Mnemonic)       \
+        ".pushsection .thumblib.annotations, \"\"\n\t" \
+        ".4byte 1729f\n\t"                             \
+        ".2byte %c[_Line]\n\t"                         \
+        ".byte %c[_Kind], %c[_Count]\n\t"              \
+        ".asciz \"" Mnemonic "\"\n\t"                  \
+        ".popsection\n"                                \
+        "1729:\n\t"
+      #define _THUMBLIB_CPP_RECORD(Kind, Count) \
+        , [_Kind] "i" (Kind), [_Count] "i" (Count), [_Line] "i" (line)
+    #else // THUMBLIB_ANNOTATE
+      #define _THUMBLIB_CPP_ANNOTATION(Mnemonic) ""
+      #define _THUMBLIB_CPP_RECORD(Kind, Count)
+    #endif // THUMBLIB_ANNOTATE
+
+  namespace thumblib {
+
+    template <int N>
+    struct Reg {
+      static_assert(N >= 0 && N <= 15, "registers are r0-r15");
+      static constexpr int number = N;
+    };
+
+    // A register list for `push`, `pop`, `stmia` and `ldmia`,
+    // one bit per register
+    template <unsigned Mask>
+    struct RegList {
+      static constexpr unsigned mask = Mask;
+    };
+
+    inline constexpr Reg<0> r0;
+    inline constexpr Reg<1> r1;
+    inline constexpr Reg<2> r2;
+    inline constexpr Reg<3> r3;
+    inline constexpr Reg<4> r4;
+    inline constexpr Reg<5> r5;
+    inline constexpr Reg<6> r6;
+    inline constexpr Reg<7> r7;
+    inline constexpr Reg<8> r8;
+    inline constexpr Reg<9> r9;
+    inline constexpr Reg<10> r10;
+    inline constexpr Reg<11> r11;
+    inline constexpr Reg<12> r12;
+    inline constexpr Reg<13> sp;
+    inline constexpr Reg<14> lr;
+    inline constexpr Reg<15> pc;
+
+    template <int A, int B>
+    _THUMBLIB_CPP_INLINE constexpr RegList<(1u << A) | (1u << B)> operator|(Reg<A>, Reg<B>) { return {}; }
+
+    template <unsigned Mask, int B>
+    _THUMBLIB_CPP_INLINE constexpr RegList<Mask | (1u << B)> operator|(RegList<Mask>, Reg<B>) { return {}; }
+
+    namespace detail {
+
+      // Register number of a handle, -1 for anything else.
+      // Registers are deduced as types rather than numbers so
+      // that `lsl<3>(r3, r1)` can't be read as `lsl(r3, r1)`
+      // with the first register given explicitly.
+      template <class T> inline constexpr int number = -1;
+      template <int N> inline constexpr int number<Reg<N>> = N;
+
+      template <class T> inline constexpr unsigned mask = 0;
+      template <int N> inline constexpr unsigned mask<Reg<N>> = 1u << N;
+      template <unsigned Mask> inline constexpr unsigned mask<RegList<Mask>> = Mask;
+
+      constexpr bool is_low(int n) { return n >= 0 && n < 8; }
+
+      constexpr int count(unsigned mask) { return mask ? (int)(mask & 1) + count(mask >> 1) : 0; }
+
+      // `Value` is a multiple of `Scale` from 0 to `Max`
+      constexpr bool scaled(int value, int scale, int max) {
+        return value >= 0 && value <= max && value % scale == 0;
+      }
+
+      constexpr int magnitude(int value) { return value < 0 ? -value : value; }
+
+      /* add_form(D, S, Imm)
+       *
+       * Chooses the encoding of `add<Imm>(D, S)`, with S = -1
+       * for `add<Imm>(D)`, preferring the 3-operand form as
+       * `ADD_RI` does whenever both fit.
+       */
+      enum AddForm { ADD_SMALL, ADD_LARGE, ADD_SP, ADD_SP_ADDRESS, ADD_PC_ADDRESS, ADD_INVALID };
+
+      constexpr AddForm add_form(int d, int s, int imm) {
+        return d == 13 && s < 0                                      ? (imm % 4 == 0 && magnitude(imm) <= 508 ? ADD_SP : ADD_INVALID) :
+               is_low(d) && s == 13                                  ? (scaled(imm, 4, 1020) ? ADD_SP_ADDRESS : ADD_INVALID) :
+               is_low(d) && s == 15                                  ? (scaled(imm, 4, 1020) ? ADD_PC_ADDRESS : ADD_INVALID) :
+               is_low(d) && is_low(s) && magnitude(imm) <= 7         ? ADD_SMALL :
+               is_low(d) && (s < 0 || s == d) && magnitude(imm) <= 255 ? ADD_LARGE :
+                                                                         ADD_INVALID;
+      }
+
+      // Scale and largest offset of `ldr<Imm>(D, B)`, by size
+      // in bytes and base register
+      constexpr int load_scale(int size) { return size; }
+      constexpr int load_max(int size, int base) { return base == 13 || base == 15 ? 1020 : 31 * size; }
+
+    } // namespace detail
+
+    // Moves
+
+    template <int Imm, class D>
+    _THUMBLIB_CPP_INLINE void mov(D, _THUMBLIB_CPP_LINE) {
+      static_assert(detail::is_low(detail::number<D>), "mov<Imm>: D must be r0-r7");
+      static_assert(Imm >= 0 && Imm <= 255, "mov<Imm>: Imm must be 0 to 255, see mov_const");
+      asm THUMBLIB_OP_FLAGS (
+        _THUMBLIB_CPP_ANNOTATION("mov")
+        "mov r%c[_Rd], #%c[_Immediate]"
+        :
+        : [_Rd] "i" (detail::number<D>), [_Immediate] "i" (Imm)
+          _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)
+      );
+    }
+
+    template <class D, class S>
+    _THUMBLIB_CPP_INLINE void mov(D, S, _THUMBLIB_CPP_LINE) {
+      constexpr int d = detail::number<D>, s = detail::number<S>;
+      static_assert(d >= 0 && s >= 0, "mov: D and S must be registers");
+      if constexpr (detail::is_low(d) && detail::is_low(s)) {
+        asm THUMBLIB_OP_FLAGS (
+          _THUMBLIB_CPP_ANNOTATION("add")
+          "add r%c[_Rd], r%c[_Rs], #0"
+          :
+          : [_Rd] "i" (d), [_Rs] "i" (s)
+            _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)
+        );
+      } else {
+        asm THUMBLIB_OP_FLAGS (
+          _THUMBLIB_CPP_ANNOTATION("mov")
+          "mov r%c[_Rd], r%c[_Rs]"
+          :
+          : [_Rd] "i" (d), [_Rs] "i" (s)
+            _THUMBLIB_CPP_RECORD(d == 13 ? _THUMBLIB_KIND_SP_ADJUST_R : d == 15 ? _THUMBLIB_KIND_PC_WRITE : _THUMBLIB_KIND_DATA, 1)
+        );
+      }
+    }
+
+    template <auto Value, class D>
+    _THUMBLIB_CPP_INLINE void ldr_pool(D, _THUMBLIB_CPP_LINE) {
+      static_assert(detail::is_low(detail::number<D>), "ldr_pool: D must be r0-r7");
+      asm THUMBLIB_OP_FLAGS (
+        _THUMBLIB_CPP_ANNOTATION("ldr")
+        "ldr r%c[_Rd], =%c[_Value]"
+        :
+        : [_Rd] "i" (detail::number<D>), [_Value] "i" (Value)
+          _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_LOAD_CODE, 1)
+      );
+    }
+
+    // Shifts and the ALU
+
+    #define _THUMBLIB_CPP_SHIFT(Name, Opcode)                                                 \
+      template <int Imm, class D, class S>                                                    \
+      _THUMBLIB_CPP_INLINE void Name(D, S, _THUMBLIB_CPP_LINE) {                              \
+        static_assert(detail::is_low(detail::number<D>) && detail::is_low(detail::number<S>), \
+                      Opcode "<Imm>: D and S must be r0-r7");                                 \
+        static_assert(Imm >= 0 && Imm <= 31, Opcode "<Imm>: Imm must be 0 to 31");            \
+        asm THUMBLIB_OP_FLAGS (                                                               \
+          _THUMBLIB_CPP_ANNOTATION(Opcode)                                                    \
+          Opcode " r%c[_Rd], r%c[_Rs], #%c[_Offset]"                                          \
+          :                                                                                   \
+          : [_Rd] "i" (detail::number<D>), [_Rs] "i" (detail::number<S>), [_Offset] "i" (Imm) \
+            _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)                                      \
+        );                                                                                    \
+      }                                                                                       \
+                                                                                              \
+      template <int Imm, class D>                                                             \
+      _THUMBLIB_CPP_INLINE void Name(D rd, _THUMBLIB_CPP_LINE) {                              \
+        Name<Imm>(rd, rd, line);                                                              \
+      }
+
+    #define _THUMBLIB_CPP_ALU(Name, Opcode, Kind)                                             \
+      template <class D, class S>                                                             \
+      _THUMBLIB_CPP_INLINE void Name(D, S, _THUMBLIB_CPP_LINE) {                              \
+        static_assert(detail::is_low(detail::number<D>) && detail::is_low(detail::number<S>), \
+                      Opcode ": D and S must be r0-r7");                                      \
+        asm THUMBLIB_OP_FLAGS (                                                               \
+          _THUMBLIB_CPP_ANNOTATION(Opcode)                                                    \
+          Opcode " r%c[_Rd], r%c[_Rs]"                                                        \
+          :                                                                                   \
+          : [_Rd] "i" (detail::number<D>), [_Rs] "i" (detail::number<S>)                      \
+            _THUMBLIB_CPP_RECORD(Kind, 1)                                                     \
+        );                                                                                    \
+      }
+
+    _THUMBLIB_CPP_SHIFT(lsl, "lsl")
+    _THUMBLIB_CPP_SHIFT(lsr, "lsr")
+    _THUMBLIB_CPP_SHIFT(asr, "asr")
+
+    // `and` is a C++ keyword
+    _THUMBLIB_CPP_ALU(and_, "and", _THUMBLIB_KIND_ALU)
+    _THUMBLIB_CPP_ALU(eor, "eor", _THUMBLIB_KIND_ALU)
+    _THUMBLIB_CPP_ALU(lsl, "lsl", _THUMBLIB_KIND_ALU)
+    _THUMBLIB_CPP_ALU(lsr, "lsr", _THUMBLIB_KIND_ALU)
+    _THUMBLIB_CPP_ALU(asr, "asr", _THUMBLIB_KIND_ALU)
+    _THUMBLIB_CPP_ALU(adc, "adc", _THUMBLIB_KIND_ALU)
+    _THUMBLIB_CPP_ALU(sbc, "sbc", _THUMBLIB_KIND_ALU)
+    _THUMBLIB_CPP_ALU(ror, "ror", _THUMBLIB_KIND_ALU)
+    _THUMBLIB_CPP_ALU(orr, "orr", _THUMBLIB_KIND_ALU)
+    _THUMBLIB_CPP_ALU(mul, "mul", _THUMBLIB_KIND_ALU)
+    _THUMBLIB_CPP_ALU(bic, "bic", _THUMBLIB_KIND_ALU)
+    _THUMBLIB_CPP_ALU(neg, "neg", _THUMBLIB_KIND_DATA)
+    _THUMBLIB_CPP_ALU(mvn, "mvn", _THUMBLIB_KIND_DATA)
+    _THUMBLIB_CPP_ALU(tst, "tst", _THUMBLIB_KIND_DATA)
+    _THUMBLIB_CPP_ALU(cmn, "cmn", _THUMBLIB_KIND_DATA)
+
+    // Addition and subtraction
+
+    template <int Imm, class D, class S>
+    _THUMBLIB_CPP_INLINE void add(D, S, _THUMBLIB_CPP_LINE) {
+      constexpr int d = detail::number<D>, s = detail::number<S>;
+      constexpr detail::AddForm form = detail::add_form(d, s, Imm);
+      static_assert(form != detail::ADD_INVALID,
+                    "add<Imm>(D, S): Imm must be -7 to 7 for r0-r7, -255 to 255 when D is S, "
+                    "or a multiple of 4 from 0 to 1020 when S is sp or pc");
+      if constexpr (form == detail::ADD_SP_ADDRESS) {
+        asm THUMBLIB_OP_FLAGS (
+          _THUMBLIB_CPP_ANNOTATION("add")
+          "add r%c[_Rd], sp, #%c[_Immediate]"
+          :
+          : [_Rd] "i" (d), [_Immediate] "i" (Imm)
+            _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)
+        );
+      } else if constexpr (form == detail::ADD_PC_ADDRESS) {
+        asm THUMBLIB_OP_FLAGS (
+          _THUMBLIB_CPP_ANNOTATION("add")
+          "add r%c[_Rd], pc, #%c[_Immediate]"
+          :
+          : [_Rd] "i" (d), [_Immediate] "i" (Imm)
+            _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)
+        );
+      } else if constexpr (form == detail::ADD_LARGE) {
+        add<Imm>(D{}, line);
+      } else if constexpr (Imm >= 0) {
+        asm THUMBLIB_OP_FLAGS (
+          _THUMBLIB_CPP_ANNOTATION("add")
+          "add r%c[_Rd], r%c[_Rs], #%c[_Immediate]"
+          :
+          : [_Rd] "i" (d), [_Rs] "i" (s), [_Immediate] "i" (Imm)
+            _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)
+        );
+      } else {
+        asm THUMBLIB_OP_FLAGS (
+          _THUMBLIB_CPP_ANNOTATION("sub")
+          "sub r%c[_Rd], r%c[_Rs], #%c[_Immediate]"
+          :
+          : [_Rd] "i" (d), [_Rs] "i" (s), [_Immediate] "i" (-Imm)
+            _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)
+        );
+      }
+    }
+
+    template <int Imm, class D>
+    _THUMBLIB_CPP_INLINE void add(D, _THUMBLIB_CPP_LINE) {
+      constexpr int d = detail::number<D>;
+      constexpr detail::AddForm form = detail::add_form(d, -1, Imm);
+      static_assert(form != detail::ADD_INVALID,
+                    "add<Imm>(D): Imm must be -255 to 255, or a multiple of 4 from -508 to 508 for sp");
+      if constexpr (form == detail::ADD_SP) {
+        // Written as `ADD_TO_SP` writes it, `sub` for negative
+        // values is up to the assembler
+        asm THUMBLIB_OP_FLAGS (
+          _THUMBLIB_CPP_ANNOTATION("add")
+          "add sp, #%c[_Immediate]"
+          :
+          : [_Immediate] "i" (Imm)
+            _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_SP_ADJUST, Imm / 4)
+        );
+      } else if constexpr (Imm >= 0) {
+        asm THUMBLIB_OP_FLAGS (
+          _THUMBLIB_CPP_ANNOTATION("add")
+          "add r%c[_Rd], #%c[_Immediate]"
+          :
+          : [_Rd] "i" (d), [_Immediate] "i" (Imm)
+            _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)
+        );
+      } else {
+        asm THUMBLIB_OP_FLAGS (
+          _THUMBLIB_CPP_ANNOTATION("sub")
+          "sub r%c[_Rd], #%c[_Immediate]"
+          :
+          : [_Rd] "i" (d), [_Immediate] "i" (-Imm)
+            _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)
+        );
+      }
+    }
+
+    template <class D, class S>
+    _THUMBLIB_CPP_INLINE void add(D, S, _THUMBLIB_CPP_LINE) {
+      constexpr int d = detail::number<D>, s = detail::number<S>;
+      static_assert(d >= 0 && s >= 0, "add: D and S must be registers");
+      if constexpr (detail::is_low(d) && detail::is_low(s)) {
+        asm THUMBLIB_OP_FLAGS (
+          _THUMBLIB_CPP_ANNOTATION("add")
+          "add r%c[_Rd], r%c[_Rd], r%c[_Rn]"
+          :
+          : [_Rd] "i" (d), [_Rn] "i" (s)
+            _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)
+        );
+      } else {
+        asm THUMBLIB_OP_FLAGS (
+          _THUMBLIB_CPP_ANNOTATION("add")
+          "add r%c[_Rd], r%c[_Rs]"
+          :
+          : [_Rd] "i" (d), [_Rs] "i" (s)
+            _THUMBLIB_CPP_RECORD(d == 13 ? _THUMBLIB_KIND_SP_ADJUST_R : d == 15 ? _THUMBLIB_KIND_PC_WRITE : _THUMBLIB_KIND_DATA, 1)
+        );
+      }
+    }
+
+    template <class D, class S, class N>
+    _THUMBLIB_CPP_INLINE void add(D, S, N, _THUMBLIB_CPP_LINE) {
+      static_assert(detail::is_low(detail::number<D>) && detail::is_low(detail::number<S>) && detail::is_low(detail::number<N>),
+                    "add(D, S, N): registers must be r0-r7");
+      asm THUMBLIB_OP_FLAGS (
+        _THUMBLIB_CPP_ANNOTATION("add")
+        "add r%c[_Rd], r%c[_Rs], r%c[_Rn]"
+        :
+        : [_Rd] "i" (detail::number<D>), [_Rs] "i" (detail::number<S>), [_Rn] "i" (detail::number<N>)
+          _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)
+      );
+    }
+
+    template <int Imm, class D, class S>
+    _THUMBLIB_CPP_INLINE void sub(D rd, S rs, _THUMBLIB_CPP_LINE) {
+      static_assert(detail::number<S> != 13 && detail::number<S> != 15, "sub<Imm>(D, S): S can't be sp or pc");
+      add<-Imm>(rd, rs, line);
+    }
+
+    template <int Imm, class D>
+    _THUMBLIB_CPP_INLINE void sub(D rd, _THUMBLIB_CPP_LINE) {
+      add<-Imm>(rd, line);
+    }
+
+    template <class D, class S>
+    _THUMBLIB_CPP_INLINE void sub(D, S, _THUMBLIB_CPP_LINE) {
+      static_assert(detail::is_low(detail::number<D>) && detail::is_low(detail::number<S>), "sub: D and S must be r0-r7");
+      asm THUMBLIB_OP_FLAGS (
+        _THUMBLIB_CPP_ANNOTATION("sub")
+        "sub r%c[_Rd], r%c[_Rd], r%c[_Rn]"
+        :
+        : [_Rd] "i" (detail::number<D>), [_Rn] "i" (detail::number<S>)
+          _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)
+      );
+    }
+
+    template <class D, class S, class N>
+    _THUMBLIB_CPP_INLINE void sub(D, S, N, _THUMBLIB_CPP_LINE) {
+      static_assert(detail::is_low(detail::number<D>) && detail::is_low(detail::number<S>) && detail::is_low(detail::number<N>),
+                    "sub(D, S, N): registers must be r0-r7");
+      asm THUMBLIB_OP_FLAGS (
+        _THUMBLIB_CPP_ANNOTATION("sub")
+        "sub r%c[_Rd], r%c[_Rs], r%c[_Rn]"
+        :
+        : [_Rd] "i" (detail::number<D>), [_Rs] "i" (detail::number<S>), [_Rn] "i" (detail::number<N>)
+          _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)
+      );
+    }
+
+    template <int Imm, class D>
+    _THUMBLIB_CPP_INLINE void cmp(D, _THUMBLIB_CPP_LINE) {
+      static_assert(detail::is_low(detail::number<D>), "cmp<Imm>: D must be r0-r7");
+      static_assert(Imm >= 0 && Imm <= 255, "cmp<Imm>: Imm must be 0 to 255");
+      asm THUMBLIB_OP_FLAGS (
+        _THUMBLIB_CPP_ANNOTATION("cmp")
+        "cmp r%c[_Rd], #%c[_Immediate]"
+        :
+        : [_Rd] "i" (detail::number<D>), [_Immediate] "i" (Imm)
+          _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)
+      );
+    }
+
+    // The assembler picks the high register form from the
+    // register numbers, as it does for `CMP_H`
+    template <class D, class S>
+    _THUMBLIB_CPP_INLINE void cmp(D, S, _THUMBLIB_CPP_LINE) {
+      static_assert(detail::number<D> >= 0 && detail::number<S> >= 0, "cmp: D and S must be registers");
+      asm THUMBLIB_OP_FLAGS (
+        _THUMBLIB_CPP_ANNOTATION("cmp")
+        "cmp r%c[_Rd], r%c[_Rs]"
+        :
+        : [_Rd] "i" (detail::number<D>), [_Rs] "i" (detail::number<S>)
+          _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_DATA, 1)
+      );
+    }
+
+    /* mov_const<Value>(D)
+     *
+     * `MOV_CONST`, choosing the sequence with the same
+     * `_THUMBLIB_CONST_METHOD`.
+     */
+    template <unsigned Value, class D>
+    _THUMBLIB_CPP_INLINE void mov_const(D rd, _THUMBLIB_CPP_LINE) {
+      constexpr int method = _THUMBLIB_CONST_METHOD(Value);
+      if constexpr (method == _THUMBLIB_CONST_MOV) {
+        mov<Value & 0xFF>(rd, line);
+      } else if constexpr (method == _THUMBLIB_CONST_MOV_LSL) {
+        mov<_THUMBLIB_IMM8_OF(Value)>(rd, line);
+        lsl<_THUMBLIB_SHIFT_OF(Value)>(rd, rd, line);
+      } else if constexpr (method == _THUMBLIB_CONST_MOV_MVN) {
+        mov<~Value & 0xFF>(rd, line);
+        mvn(rd, rd, line);
+      } else if constexpr (method == _THUMBLIB_CONST_MOV_ADD) {
+        mov<255>(rd, line);
+        add<(Value - 255) & 0xFF>(rd, line);
+      } else if constexpr (method == _THUMBLIB_CONST_MOV_LSL_ADD) {
+        mov<_THUMBLIB_IMM8_OF(_THUMBLIB_HIGH_OF(Value))>(rd, line);
+        lsl<_THUMBLIB_SHIFT_OF(_THUMBLIB_HIGH_OF(Value))>(rd, rd, line);
+        add<Value & 0xFF>(rd, line);
+      } else if constexpr (method == _THUMBLIB_CONST_MOV_LSL_MVN) {
+        mov<_THUMBLIB_IMM8_OF(~Value)>(rd, line);
+        lsl<_THUMBLIB_SHIFT_OF(~Value)>(rd, rd, line);
+        mvn(rd, rd, line);
+      } else if constexpr (method == _THUMBLIB_CONST_MOV_LSL_NEG) {
+        mov<_THUMBLIB_IMM8_OF(-Value)>(rd, line);
+        lsl<_THUMBLIB_SHIFT_OF(-Value)>(rd, rd, line);
+        neg(rd, rd, line);
+      } else {
+        ldr_pool<Value>(rd, line);
+      }
+    }
+
+    // Loads and stores
+
+    // sp and pc are spelled out as in `LDR_SP` and `LDR_PC`
+    #define _THUMBLIB_CPP_OFFSET_ASM(Opcode, Base, Kind)       \
+      asm THUMBLIB_OP_FLAGS (                                  \
+        _THUMBLIB_CPP_ANNOTATION(Opcode)                       \
+        Opcode " r%c[_Rd], [" Base ", #%c[_Immediate]]"        \
+        :                                                      \
+        : [_Rd] "i" (d), [_Rb] "i" (b), [_Immediate] "i" (Imm) \
+          _THUMBLIB_CPP_RECORD(Kind, 1)                        \
+      );
+
+    #define _THUMBLIB_CPP_LOAD_STORE(Name, Opcode, Size, Kind, StackKind)                                            \
+      template <int Imm = 0, class D, class B>                                                                       \
+      _THUMBLIB_CPP_INLINE void Name(D, B, _THUMBLIB_CPP_LINE) {                                                     \
+        constexpr int d = detail::number<D>, b = detail::number<B>;                                                  \
+        static_assert(detail::is_low(d), Opcode "<Imm>: D must be r0-r7");                                           \
+        static_assert(detail::is_low(b) || ((Size) == 4 && (b == 13 || (b == 15 && (Kind) == _THUMBLIB_KIND_LOAD))), \
+                      Opcode "<Imm>: B must be r0-r7, or sp or pc for word loads and sp for word stores");           \
+        static_assert(detail::scaled(Imm, detail::load_scale(Size), detail::load_max(Size, b)),                      \
+                      Opcode "<Imm>: Imm must be a multiple of the size, up to 31 times it or 1020 from sp/pc");     \
+        if constexpr (b == 13)                                                                                       \
+          _THUMBLIB_CPP_OFFSET_ASM(Opcode, "sp", StackKind)                                                          \
+        else if constexpr (b == 15)                                                                                  \
+          _THUMBLIB_CPP_OFFSET_ASM(Opcode, "pc", _THUMBLIB_KIND_LOAD_CODE)                                           \
+        else                                                                                                         \
+          _THUMBLIB_CPP_OFFSET_ASM(Opcode, "r%c[_Rb]", Kind)                                                         \
+      }                                                                                                              \
+                                                                                                                     \
+      template <class D, class B, class N>                                                                           \
+      _THUMBLIB_CPP_INLINE void Name(D, B, N, _THUMBLIB_CPP_LINE) {                                                  \
+        static_assert(detail::is_low(detail::number<D>) && detail::is_low(detail::number<B>) &&                      \
+                      detail::is_low(detail::number<N>), Opcode ": registers must be r0-r7");                        \
+        asm THUMBLIB_OP_FLAGS (                                                                                      \
+          _THUMBLIB_CPP_ANNOTATION(Opcode)                                                                           \
+          Opcode " r%c[_Rd], [r%c[_Rb], r%c[_Ro]]"                                                                   \
+          :                                                                                                          \
+          : [_Rd] "i" (detail::number<D>), [_Rb] "i" (detail::number<B>), [_Ro] "i" (detail::number<N>)              \
+            _THUMBLIB_CPP_RECORD(Kind, 1)                                                                            \
+        );                                                                                                           \
+      }
+
+    _THUMBLIB_CPP_LOAD_STORE(ldr, "ldr", 4, _THUMBLIB_KIND_LOAD, _THUMBLIB_KIND_LOAD_STACK)
+    _THUMBLIB_CPP_LOAD_STORE(ldrh, "ldrh", 2, _THUMBLIB_KIND_LOAD, _THUMBLIB_KIND_LOAD_STACK)
+    _THUMBLIB_CPP_LOAD_STORE(ldrb, "ldrb", 1, _THUMBLIB_KIND_LOAD, _THUMBLIB_KIND_LOAD_STACK)
+    _THUMBLIB_CPP_LOAD_STORE(str, "str", 4, _THUMBLIB_KIND_STORE, _THUMBLIB_KIND_STORE_STACK)
+    _THUMBLIB_CPP_LOAD_STORE(strh, "strh", 2, _THUMBLIB_KIND_STORE, _THUMBLIB_KIND_STORE_STACK)
+    _THUMBLIB_CPP_LOAD_STORE(strb, "strb", 1, _THUMBLIB_KIND_STORE, _THUMBLIB_KIND_STORE_STACK)
+
+    #define _THUMBLIB_CPP_LOAD_SIGNED(Name, Opcode)                                                     \
+      template <class D, class B, class N>                                                              \
+      _THUMBLIB_CPP_INLINE void Name(D, B, N, _THUMBLIB_CPP_LINE) {                                     \
+        static_assert(detail::is_low(detail::number<D>) && detail::is_low(detail::number<B>) &&         \
+                      detail::is_low(detail::number<N>), Opcode ": registers must be r0-r7");           \
+        asm THUMBLIB_OP_FLAGS (                                                                         \
+          _THUMBLIB_CPP_ANNOTATION(Opcode)                                                              \
+          Opcode " r%c[_Rd], [r%c[_Rb], r%c[_Ro]]"                                                      \
+          :                                                                                             \
+          : [_Rd] "i" (detail::number<D>), [_Rb] "i" (detail::number<B>), [_Ro] "i" (detail::number<N>) \
+            _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_LOAD, 1)                                                \
+        );                                                                                              \
+      }
+
+    _THUMBLIB_CPP_LOAD_SIGNED(ldsb, "ldsb")
+    _THUMBLIB_CPP_LOAD_SIGNED(ldsh, "ldsh")
+
+    // Register lists
+    //
+    // These are emitted with `.inst.n`, since an assembler
+    // template can't spell out a list that depends on template
+    // arguments. The encodings are those of `push {...}` and so
+    // on, and the instructions are still code to the
+    // assembler, disassemblers and the tools.
+
+    template <class L>
+    _THUMBLIB_CPP_INLINE void push(L, _THUMBLIB_CPP_LINE) {
+      constexpr unsigned mask = detail::mask<L>;
+      static_assert(mask && !(mask & ~0x40FFu), "push: registers must be r0-r7 and lr");
+      asm THUMBLIB_OP_FLAGS (
+        _THUMBLIB_CPP_ANNOTATION("push")
+        ".inst.n %c[_Opcode] @ push"
+        :
+        : [_Opcode] "i" (0xB400 | (mask & 0xFF) | ((mask >> 14) << 8))
+          _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_PUSH, detail::count(mask))
+        : "memory"
+      );
+    }
+
+    template <class L>
+    _THUMBLIB_CPP_INLINE void pop(L, _THUMBLIB_CPP_LINE) {
+      constexpr unsigned mask = detail::mask<L>;
+      static_assert(mask && !(mask & ~0x80FFu), "pop: registers must be r0-r7 and pc");
+      asm THUMBLIB_OP_FLAGS (
+        _THUMBLIB_CPP_ANNOTATION("pop")
+        ".inst.n %c[_Opcode] @ pop"
+        :
+        : [_Opcode] "i" (0xBC00 | (mask & 0xFF) | ((mask >> 15) << 8))
+          _THUMBLIB_CPP_RECORD((mask >> 15) ? _THUMBLIB_KIND_POP_PC : _THUMBLIB_KIND_POP, detail::count(mask))
+        : "memory"
+      );
+    }
+
+    template <class B, class L>
+    _THUMBLIB_CPP_INLINE void stmia(B, L, _THUMBLIB_CPP_LINE) {
+      constexpr unsigned mask = detail::mask<L>;
+      static_assert(detail::is_low(detail::number<B>), "stmia: B must be r0-r7");
+      static_assert(mask && !(mask & ~0xFFu), "stmia: registers must be r0-r7");
+      asm THUMBLIB_OP_FLAGS (
+        _THUMBLIB_CPP_ANNOTATION("stmia")
+        ".inst.n %c[_Opcode] @ stmia"
+        :
+        : [_Opcode] "i" (0xC000 | (detail::number<B> << 8) | mask)
+          _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_STORE_MULTIPLE, detail::count(mask))
+        : "memory"
+      );
+    }
+
+    template <class B, class L>
+    _THUMBLIB_CPP_INLINE void ldmia(B, L, _THUMBLIB_CPP_LINE) {
+      constexpr unsigned mask = detail::mask<L>;
+      static_assert(detail::is_low(detail::number<B>), "ldmia: B must be r0-r7");
+      static_assert(mask && !(mask & ~0xFFu), "ldmia: registers must be r0-r7");
+      asm THUMBLIB_OP_FLAGS (
+        _THUMBLIB_CPP_ANNOTATION("ldmia")
+        ".inst.n %c[_Opcode] @ ldmia"
+        :
+        : [_Opcode] "i" (0xC800 | (detail::number<B> << 8) | mask)
+          _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_LOAD_MULTIPLE, detail::count(mask))
+        : "memory"
+      );
+    }
+
+    // Branches
+
+    template <class S>
+    _THUMBLIB_CPP_INLINE void bx(S, _THUMBLIB_CPP_LINE) {
+      static_assert(detail::number<S> >= 0, "bx: S must be a register");
+      asm THUMBLIB_OP_FLAGS (
+        _THUMBLIB_CPP_ANNOTATION("bx")
+        "bx r%c[_Rs]"
+        :
+        : [_Rs] "i" (detail::number<S>)
+          _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_BRANCH_EXCHANGE, 1)
+      );
+    }
+
+    template <int Index>
+    _THUMBLIB_CPP_INLINE void swi(_THUMBLIB_CPP_LINE) {
+      static_assert(Index >= 0 && Index <= 255, "swi<Index>: Index must be 0 to 255");
+      asm THUMBLIB_OP_FLAGS (
+        _THUMBLIB_CPP_ANNOTATION("swi")
+        "swi %c[_Index]"
+        :
+        : [_Index] "i" (Index)
+          _THUMBLIB_CPP_RECORD(_THUMBLIB_KIND_SWI, 1)
+      );
+    }
+
+    #undef _THUMBLIB_CPP_SHIFT
+    #undef _THUMBLIB_CPP_ALU
+    #undef _THUMBLIB_CPP_OFFSET_ASM
+    #undef _THUMBLIB_CPP_LOAD_STORE
+    #undef _THUMBLIB_CPP_LOAD_SIGNED
+
+  } // namespace thumblib
+
+#endif // THUMBLIB_3_OPCODES_HPP
@@ -0,0 +1,329 @@
+
+#ifndef THUMBLIB_3_OVERLAY
+#define THUMBLIB_3_OVERLAY
+
+  /* THUMBLIB3 IWRAM overlays
+   *
+   * This file lets more hot functions run from IWRAM than fit
+   * in it at once. Overlay functions are linked into ROM in a
+   * section of their own, and are copied into one of a fixed
+   * number of IWRAM slots with `LDMIA`/`STMIA` bursts the
+   * first time they're called. When every slot is taken, the
+   * least recently loaded function is evicted.
+   *
+   * That is first in, first out rather than least recently
+   * used: once a function is loaded, calls jump straight to
+   * its copy and never reach the manager, which keeps them
+   * at a single indirection but leaves nothing to record the
+   * last use in. Use `OVERLAY_LOAD` to mark a phase's hot
+   * functions as recently loaded so they're evicted last.
+   *
+   * Each overlay function has a dispatch pointer in RAM that
+   * callers always jump through. It points to a loader stub
+   * in ROM until the function is loaded, then to its copy in
+   * IWRAM, so a call costs one indirection either way.
+   *
+   * The manifest that ties this together (the ROM address and
+   * size of each function, the slots and the dispatch pointers)
+   * is generated by `tools/thumboverlay` from the sections of
+   * the compiled objects:
+   *
+   * `thumboverlay -w 0x0203F000 -i 0x03004000 -n 4 battle.o map.o > overlays.c`
+   *
+   * `overlays.c` is then compiled and linked (or installed)
+   * like any other file. Call `OVERLAY_INIT()` once before any
+   * overlay function is called, since nothing else sets up the
+   * RAM state.
+   *
+   * Overlay functions are copied as-is, so they must not
+   * depend on where they run from: `BL` and `B_ABS` out of an
+   * overlay function are resolved against its ROM address and
+   * won't reach their targets from IWRAM. Call other functions
+   * through a register instead, with `MOV_CONST` and `BX`, or
+   * through their dispatch pointers. Branches within the
+   * function, literal pools and `SWITCH_TABLE` are fine.
+   *
+   * A function must not be evicted while it's running, so
+   * make sure there are enough slots for every overlay
+   * function that can be active at once, such as a hook and
+   * everything it calls.
+   */
+
+  /* Macro cheat sheet
+   *
+   * THUMBLIB syntax                  | Purpose
+   *                                  |
+   * THUMBLIB_OVERLAY_FUNC(Name)      | function attribute, makes `Name` an overlay function
+   * THUMBLIB_OVERLAY_VENEER(Name)    | file scope, routes `BL(Name)` through the dispatch pointer
+   * OVERLAY_CALL(Name)               | `Name` as a C function pointer, through the dispatch pointer
+   * OVERLAY_INIT()                   | empties every slot
+   * OVERLAY_LOAD(Name)               | loads `Name` now, such as at the start of a phase
+   *
+   * Manifest macros, used by the files `thumboverlay` generates:
+   *
+   * THUMBLIB_OVERLAY_MANIFEST(Ram, SlotBase, SlotSize, SlotCount)
+   * THUMBLIB_OVERLAY_ENTRY(Index, Name, Size)
+   * THUMBLIB_OVERLAY_MANIFEST_END(Count)
+   */
+
+  /* Manifest layout
+   *
+   * The manifest is placed in ROM:
+   *
+   * ThumblibOverlayManifest  | RAM state, slot base, slot size and counts
+   * ThumblibOverlay[Count]   | one entry per function, in index order
+   *
+   * The RAM state is placed at `Ram`:
+   *
+   * ThumblibOverlayState     | load counter
+   * ThumblibOverlaySlot[SlotCount]
+   * dispatch pointers[Count] | one per function, in index order
+   */
+
+  typedef struct {
+    const void* rom;    // ROM address, with bit 0 set for THUMB
+    unsigned int size;  // Size in bytes, a multiple of 4
+    void** dispatch;
+    const void* stub;   // Initial value of `*dispatch`
+  } ThumblibOverlay;
+
+  typedef struct {
+    const ThumblibOverlay* overlay; // NULL if the slot is empty
+    unsigned int loaded;            // Value of `clock` when loaded
+  } ThumblibOverlaySlot;
+
+  typedef struct {
+    unsigned int clock;
+    ThumblibOverlaySlot slots[];
+  } ThumblibOverlayState;
+
+  typedef struct {
+    ThumblibOverlayState* state;
+    unsigned char* slotBase;
+    unsigned int slotSize;
+    unsigned int slotCount;
+    unsigned int count;
+    ThumblibOverlay overlays[];
+  } ThumblibOverlayManifest;
+
+  extern const ThumblibOverlayManifest __thumblib_overlay_manifest;
+
+  void __thumblib_overlay_init(void);
+  void* __thumblib_overlay_load(const ThumblibOverlay* overlay);
+
+  /* THUMBLIB_OVERLAY_FUNC(Name)
+   *
+   * Like `THUMBLIB_FUNC`, but places the function in the
+   * `.thumblib.overlay.Name` section that `thumboverlay`
+   * looks for. The function is word aligned so that its
+   * literal pools stay aligned in IWRAM.
+   *
+   * `THUMBLIB_OVERLAY_FUNC(CopyText) void CopyText(...) { ... }`
+   */
+  #define THUMBLIB_OVERLAY_FUNC(Name) \
+    THUMBLIB_FUNC THUMBLIB_SECTION(".thumblib.overlay." #Name) __attribute__((aligned (4)))
+
+  /* THUMBLIB_OVERLAY_VENEER(Name)
+   *
+   * Emits a veneer that jumps through the dispatch pointer of
+   * the overlay function `Name` into this file's ROM code.
+   * Use it at file scope, before any functions that call
+   * `Name`. Like `THUMBLIB_IWRAM_VENEER`, `BL(Name)` and
+   * `B_SYM(Name)` in this file then go through the veneer,
+   * which preserves every register except r12 (ip).
+   */
+  #define THUMBLIB_OVERLAY_VENEER(Name)                                       \
+    extern void* __thumblib_overlay_dispatch_##Name;                          \
+    asm (                                                                     \
+      ".pushsection .text.__thumblib_veneer_" #Name ", \"ax\", %progbits\n\t" \
+      ".balign 4\n\t"                                                         \
+      ".thumb\n\t"                                                            \
+      ".thumb_func\n"                                                         \
+      "__thumblib_veneer_" #Name ":\n\t"                                      \
+      "bx pc\n\t"                                                             \
+      "nop\n\t"                                                               \
+      ".arm\n\t"                                                              \
+      "ldr ip, .L__thumblib_veneer_" #Name "_dispatch\n\t"                    \
+      "ldr ip, [ip]\n\t"                                                      \
+      "bx ip\n"                                                               \
+      ".L__thumblib_veneer_" #Name "_dispatch:\n\t"                           \
+      ".word __thumblib_overlay_dispatch_" #Name "\n\t"                       \
+      ".thumb\n\t"                                                            \
+      ".popsection"                                                           \
+    );
+
+  /* OVERLAY_CALL(Name)
+   *
+   * Expands to a pointer to `Name` with its own type that
+   * goes through the dispatch pointer, for calls from C:
+   *
+   * `OVERLAY_CALL(CopyText)(dst, src);`
+   */
+  #define OVERLAY_CALL(Name)                                 \
+    (__extension__ ({                                        \
+      extern void* __thumblib_overlay_dispatch_##Name;       \
+      (__typeof__(&Name))__thumblib_overlay_dispatch_##Name; \
+    }))
+
+  /* OVERLAY_INIT()
+   * OVERLAY_LOAD(Name)
+   *
+   * `OVERLAY_INIT` empties every slot and points each dispatch
+   * pointer back at its loader stub. `OVERLAY_LOAD` loads
+   * `Name` if it isn't loaded yet and marks it as the most
+   * recently loaded function either way, so that a phase can
+   * load its functions up front rather than on their first
+   * call.
+   *
+   * These are C function calls and clobber r0-r3, r12 and lr
+   * like any other; don't use them within a `THUMBLIB_FUNC`.
+   */
+  #define OVERLAY_INIT() __thumblib_overlay_init();
+
+  #define OVERLAY_LOAD(Name)                                  \
+    {                                                         \
+      extern const ThumblibOverlay __thumblib_overlay_##Name; \
+      __thumblib_overlay_load(&__thumblib_overlay_##Name);    \
+    }
+
+  /* THUMBLIB_OVERLAY_MANIFEST(Ram, SlotBase, SlotSize, SlotCount)
+   *
+   * Starts the manifest. `Ram` is the address of the RAM state
+   * described above, `SlotBase` the IWRAM address of the first
+   * of `SlotCount` slots of `SlotSize` bytes each. All four are
+   * numbers.
+   */
+  #define THUMBLIB_OVERLAY_MANIFEST(Ram, SlotBase, SlotSize, SlotCount)              \
+    asm (                                                                            \
+      ".set __thumblib_overlay_dispatch_base, " #Ram " + 4 + 8 * " #SlotCount "\n\t" \
+      ".pushsection .rodata.__thumblib_overlay_manifest, \"a\", %progbits\n\t"       \
+      ".balign 4\n\t"                                                                \
+      ".global __thumblib_overlay_manifest\n"                                        \
+      "__thumblib_overlay_manifest:\n\t"                                             \
+      ".word " #Ram ", " #SlotBase ", " #SlotSize ", " #SlotCount "\n\t"             \
+      ".word __thumblib_overlay_count\n\t"                                           \
+      ".popsection"                                                                  \
+    );
+
+  /* THUMBLIB_OVERLAY_ENTRY(Index, Name, Size)
+   *
+   * Adds the overlay function `Name`, whose section is `Size`
+   * bytes long, as entry `Index` of the manifest. Entries must
+   * be given in index order. This also defines its dispatch
+   * pointer and its loader stub, which saves r0-r3 and lr,
+   * loads the function and jumps into it with them restored.
+   */
+  #define THUMBLIB_OVERLAY_ENTRY(Index, Name, Size)                                                       \
+    asm (                                                                                                 \
+      ".global __thumblib_overlay_dispatch_" #Name "\n\t"                                                 \
+      ".set __thumblib_overlay_dispatch_" #Name ", __thumblib_overlay_dispatch_base + 4 * " #Index "\n\t" \
+      ".pushsection .rodata.__thumblib_overlay_manifest, \"a\", %progbits\n\t"                            \
+      ".global __thumblib_overlay_" #Name "\n"                                                            \
+      "__thumblib_overlay_" #Name ":\n\t"                                                                 \
+      ".word " #Name ", (" #Size " + 3) & ~3\n\t"                                                         \
+      ".word __thumblib_overlay_dispatch_" #Name ", __thumblib_overlay_stub_" #Name "\n\t"                \
+      ".popsection\n\t"                                                                                   \
+      ".pushsection .text.__thumblib_overlay_stub_" #Name ", \"ax\", %progbits\n\t"                       \
+      ".balign 4\n\t"                                                                                     \
+      ".arm\n"                                                                                            \
+      "__thumblib_overlay_stub_" #Name ":\n\t"                                                            \
+      "stmfd sp!, {r0-r3, ip, lr}\n\t"                                                                    \
+      "ldr r0, .L__thumblib_overlay_stub_" #Name "_entry\n\t"                                             \
+      "ldr ip, .L__thumblib_overlay_stub_" #Name "_load\n\t"                                              \
+      "mov lr, pc\n\t"                                                                                    \
+      "bx ip\n\t"                                                                                         \
+      "str r0, [sp, #16]\n\t"                                                                             \
+      "ldmfd sp!, {r0-r3, ip, lr}\n\t"                                                                    \
+      "bx ip\n"                                                                                           \
+      ".L__thumblib_overlay_stub_" #Name "_entry:\n\t"                                                    \
+      ".word __thumblib_overlay_" #Name "\n"                                                              \
+      ".L__thumblib_overlay_stub_" #Name "_load:\n\t"                                                     \
+      ".word __thumblib_overlay_load\n\t"                                                                 \
+      ".thumb\n\t"                                                                                        \
+      ".popsection"                                                                                       \
+    );
+
+  /* THUMBLIB_OVERLAY_MANIFEST_END(Count)
+   *
+   * Ends the manifest after `Count` entries.
+   */
+  #define THUMBLIB_OVERLAY_MANIFEST_END(Count) \
+    asm (".set __thumblib_overlay_count, " #Count);
+
+  /* THUMBLIB_OVERLAY_MANAGER
+   *
+   * Define this before including thumblib3.h in exactly one
+   * file to get the loader, which `thumboverlay` does for the
+   * manifest file.
+   */
+  #ifdef THUMBLIB_OVERLAY_MANAGER
+
+    void __thumblib_overlay_init(void) {
+      const ThumblibOverlayManifest* manifest = &__thumblib_overlay_manifest;
+      unsigned int i;
+
+      manifest->state->clock = 0;
+      for (i = 0; i < manifest->slotCount; i++)
+        manifest->state->slots[i].overlay = 0;
+      for (i = 0; i < manifest->count; i++)
+        *manifest->overlays[i].dispatch = (void*)manifest->overlays[i].stub;
+    }
+
+    // Copies `count` words from `src` to `dst`. `COPY_WORDS`
+    // passes the flags and its pointers between opcodes, so
+    // it runs in a function of its own rather than within
+    // compiled code.
+    THUMBLIB_FUNC void __thumblib_overlay_copy(unsigned int* dst, const unsigned int* src, unsigned int count) {
+
+      register unsigned int w0 asm("r3");
+      register unsigned int w1 asm("r4");
+      register unsigned int w2 asm("r5");
+      register unsigned int w3 asm("r6");
+
+      PUSH(w1, w2, w3);
+      COPY_WORDS(dst, src, count, w0, w1, w2, w3)
+      POP(w1, w2, w3);
+      BX_LR();
+
+    }
+
+    // Returns the address to call `overlay` at, loading
+    // it into the least recently loaded slot if needed.
+    // Calls through the dispatch pointer don't come here,
+    // so `loaded` is only bumped by loads, not by uses.
+    void* __thumblib_overlay_load(const ThumblibOverlay* overlay) {
+      const ThumblibOverlayManifest* manifest = &__thumblib_overlay_manifest;
+      ThumblibOverlayState* state = manifest->state;
+      ThumblibOverlaySlot* victim = &state->slots[0];
+      unsigned int i;
+
+      for (i = 0; i < manifest->slotCount; i++) {
+        ThumblibOverlaySlot* slot = &state->slots[i];
+        if (slot->overlay == overlay) {
+          slot->loaded = ++state->clock;
+          return *overlay->dispatch;
+        }
+        if (victim->overlay && (!slot->overlay || slot->loaded < victim->loaded))
+          victim = slot;
+      }
+
+      if (victim->overlay)
+        *victim->overlay->dispatch = (void*)victim->overlay->stub;
+
+      {
+        unsigned char* base = manifest->slotBase + (victim - state->slots) * manifest->slotSize;
+
+        __thumblib_overlay_copy((unsigned int*)base,
+          (const unsigned int*)((unsigned int)overlay->rom & ~1u), overlay->size / 4);
+
+        victim->overlay = overlay;
+        victim->loaded = ++state->clock;
+        *overlay->dispatch = base + ((unsigned int)overlay->rom & 1);
+      }
+
+      return *overlay->dispatch;
+    }
+
+  #endif // THUMBLIB_OVERLAY_MANAGER
+
+#endif // THUMBLIB_3_OVERLAY
@@ -0,0 +1,277 @@
+#ifndef THUMBLIB_3_PROFILE
+#define THUMBLIB_3_PROFILE
+
+  /* THUMBLIB3 cycle profiling
+   *
+   * This file defines macros that time sections of THUMB code
+   * with a pair of cascaded hardware timers, counting CPU
+   * cycles (16.78 MHz) in 32 bits. `PROFILE_BEGIN(Id)` and
+   * `PROFILE_END(Id)` around a section add its cycles to the
+   * total and call count of `Id` in a table in RAM, and
+   * record each call in a ring buffer of recent samples.
+   *
+   * The table is meant to be read from outside the game:
+   * dump EWRAM (or take an uncompressed save state) in an
+   * emulator and run `tools/thumbprofile` on the file, which
+   * finds the table by its magic number and prints the totals
+   * per id and the most recent samples.
+   *
+   * Setup, in exactly one file:
+   *
+   * `#define THUMBLIB_PROFILER`
+   * `#include "thumblib3.h"`
+   * `THUMBLIB_PROFILE_TABLE(0x0203E000)`
+   *
+   * and call `PROFILE_INIT()` once at startup, which clears
+   * the table and starts the timers. `THUMBLIB_PROFILE_SIZE`
+   * bytes of free RAM are needed at the given address.
+   *
+   * The timers are TM2 and TM3 by default, since the sound
+   * engine drives its DMA with TM0. Define
+   * `THUMBLIB_PROFILE_TIMER` as 0 or 1 to use TM0/TM1 or
+   * TM1/TM2 instead. Like the sizes below, it must be the same
+   * in every file.
+   *
+   * `Id` is a compile-time constant below
+   * `THUMBLIB_PROFILE_IDS`. The scratch registers are low
+   * registers, and are clobbered along with the flags. Sections
+   * with the same id may not nest, but different ids can.
+   *
+   * The two timers are read a few cycles apart, so a read
+   * that straddles an overflow of the low timer comes out
+   * 0x10000 cycles early. This happens to about one read in
+   * 10000, and shows up as an outlier in the samples.
+   */
+
+  /* Macro cheat sheet
+   *
+   * THUMBLIB syntax                  | Purpose
+   *                                  |
+   * THUMBLIB_PROFILE_TABLE(Address)  | file scope, places the table at `Address`
+   * PROFILE_INIT()                   | clears the table and starts the timers
+   * PROFILE_NOW(Rd, Rs)              | Rd = cycle count, clobbers Rs
+   * PROFILE_BEGIN(Id, Ra, Rb)        | starts timing `Id`
+   * PROFILE_END(Id, Ra, Rb, Rc)      | adds the cycles since `PROFILE_BEGIN(Id)` to `Id`
+   *
+   * Cost, from ROM with the default WAITCNT: about 40 cycles
+   * for `PROFILE_BEGIN` and 150 for `PROFILE_END`, including
+   * their literal pool loads. About 40 of them fall between
+   * the two timer reads and are counted in each sample.
+   */
+
+  /* Table layout
+   *
+   * ThumblibProfile                  | magic number, sizes and ring buffer head
+   * ThumblibProfileSample[Samples]   | ring buffer, oldest sample at `head`
+   * ThumblibProfileEntry[Ids]        | totals, in id order
+   *
+   * Words are little-endian. Empty samples have an id of
+   * THUMBLIB_PROFILE_EMPTY.
+   */
+
+  // Number of ids, at most 256
+  #ifndef THUMBLIB_PROFILE_IDS
+    #define THUMBLIB_PROFILE_IDS 32
+  #endif
+
+  // 1 << THUMBLIB_PROFILE_RING_BITS samples, at most 1024
+  #ifndef THUMBLIB_PROFILE_RING_BITS
+    #define THUMBLIB_PROFILE_RING_BITS 6
+  #endif
+
+  #ifndef THUMBLIB_PROFILE_TIMER
+    #define THUMBLIB_PROFILE_TIMER 2
+  #endif
+
+  #if THUMBLIB_PROFILE_IDS < 1 || THUMBLIB_PROFILE_IDS > 256
+    #error "THUMBLIB_PROFILE_IDS must be between 1 and 256"
+  #endif
+
+  #if THUMBLIB_PROFILE_RING_BITS < 1 || THUMBLIB_PROFILE_RING_BITS > 10
+    #error "THUMBLIB_PROFILE_RING_BITS must be between 1 and 10"
+  #endif
+
+  #if THUMBLIB_PROFILE_TIMER < 0 || THUMBLIB_PROFILE_TIMER > 2
+    #error "THUMBLIB_PROFILE_TIMER must be 0, 1 or 2"
+  #endif
+
+  #define THUMBLIB_PROFILE_MAGIC 0x46504854 // "THPF"
+  #define THUMBLIB_PROFILE_EMPTY 0xFFFFFFFF
+
+  #define THUMBLIB_PROFILE_SAMPLES (1 << THUMBLIB_PROFILE_RING_BITS)
+
+  #define THUMBLIB_PROFILE_SIZE \
+    (12 + 8 * THUMBLIB_PROFILE_SAMPLES + 16 * THUMBLIB_PROFILE_IDS)
+
+  typedef struct {
+    unsigned int id;
+    unsigned int cycles;
+  } ThumblibProfileSample;
+
+  typedef struct {
+    unsigned int start;      // Cycle count at the last PROFILE_BEGIN
+    unsigned int calls;
+    unsigned int total;      // Cycles, low word
+    unsigned int totalHigh;  // Cycles, high word
+  } ThumblibProfileEntry;
+
+  typedef struct {
+    unsigned int magic;      // THUMBLIB_PROFILE_MAGIC
+    unsigned short ids;      // THUMBLIB_PROFILE_IDS
+    unsigned short samples;  // THUMBLIB_PROFILE_SAMPLES
+    unsigned int head;       // Byte offset of the next sample in `ring`
+    ThumblibProfileSample ring[THUMBLIB_PROFILE_SAMPLES];
+    ThumblibProfileEntry entries[THUMBLIB_PROFILE_IDS];
+  } ThumblibProfile;
+
+  extern ThumblibProfile __thumblib_profile;
+
+  void __thumblib_profile_init(void);
+
+  // Internal helpers
+
+    #define _THUMBLIB_TIMER_ENABLE  0x0080
+    #define _THUMBLIB_TIMER_CASCADE 0x0004
+
+    // Address of the counter of the low timer, followed by
+    // its control register and the high timer's counter
+    #define _THUMBLIB_PROFILE_TIMER_BASE (0x04000100 + 4 * THUMBLIB_PROFILE_TIMER)
+
+    #define _THUMBLIB_PROFILE_START      0
+    #define _THUMBLIB_PROFILE_CALLS      4
+    #define _THUMBLIB_PROFILE_TOTAL      8
+    #define _THUMBLIB_PROFILE_TOTAL_HIGH 12
+
+    // Offsets of a sample's fields from the ring buffer head
+    // plus the head's value
+    #define _THUMBLIB_PROFILE_SAMPLE_ID     4
+    #define _THUMBLIB_PROFILE_SAMPLE_CYCLES 8
+
+  /* THUMBLIB_PROFILE_TABLE(Address)
+   *
+   * Defines the table's symbol as `Address`, a number. Use it
+   * at file scope in one file, or define `__thumblib_profile`
+   * in your linker script instead.
+   */
+  #define THUMBLIB_PROFILE_TABLE(Address)  \
+    asm (                                  \
+      ".global __thumblib_profile\n\t"     \
+      ".set __thumblib_profile, " #Address \
+    );
+
+  /* PROFILE_INIT()
+   *
+   * A C function call, so it clobbers r0-r3, r12 and lr like
+   * any other; don't use it within a `THUMBLIB_FUNC`.
+   * Calling it again starts over.
+   */
+  #define PROFILE_INIT() __thumblib_profile_init();
+
+  /* PROFILE_NOW(Rd, Rs)
+   *
+   * Reads the high timer's counter and control register as a
+   * word, then the low timer's counter, and combines the two
+   * counters.
+   */
+  #define PROFILE_NOW(Rd, Rs)                     \
+    {                                             \
+      MOV_CONST(Rs, _THUMBLIB_PROFILE_TIMER_BASE) \
+      LDR_I3(Rd, Rs, 4)                           \
+      LDRH_I3(Rs, Rs, 0)                          \
+      LSL_I3(Rd, Rd, 16)                          \
+      ORR(Rd, Rs)                                 \
+    }
+
+  /* PROFILE_BEGIN(Id, Ra, Rb)
+   *
+   * Stores the cycle count as the start of `Id`.
+   */
+  #define PROFILE_BEGIN(Id, Ra, Rb)                 \
+    {                                               \
+      PROFILE_NOW(Rb, Ra)                           \
+      LDR_POOL(Ra, &__thumblib_profile.entries[Id]) \
+      STR_I3(Rb, Ra, _THUMBLIB_PROFILE_START)       \
+    }
+
+  /* PROFILE_END(Id, Ra, Rb, Rc)
+   *
+   * Adds the cycles since the start of `Id` to its total,
+   * counts the call and records the sample in the ring
+   * buffer, overwriting the oldest one.
+   */
+  #define PROFILE_END(Id, Ra, Rb, Rc)                 \
+    {                                                 \
+      __label__ _NoCarry;                             \
+      PROFILE_NOW(Rb, Ra)                             \
+      LDR_POOL(Ra, &__thumblib_profile.entries[Id])   \
+      LDR_I3(Rc, Ra, _THUMBLIB_PROFILE_START)         \
+      SUB_R3(Rb, Rb, Rc)                              \
+      LDR_I3(Rc, Ra, _THUMBLIB_PROFILE_CALLS)         \
+      ADD_I(Rc, 1)                                    \
+      STR_I3(Rc, Ra, _THUMBLIB_PROFILE_CALLS)         \
+      LDR_I3(Rc, Ra, _THUMBLIB_PROFILE_TOTAL)         \
+      ADD_R3(Rc, Rc, Rb)                              \
+      STR_I3(Rc, Ra, _THUMBLIB_PROFILE_TOTAL)         \
+      BCC(_NoCarry)                                   \
+        LDR_I3(Rc, Ra, _THUMBLIB_PROFILE_TOTAL_HIGH)  \
+        ADD_I(Rc, 1)                                  \
+        STR_I3(Rc, Ra, _THUMBLIB_PROFILE_TOTAL_HIGH)  \
+      _NoCarry:;                                      \
+      LDR_POOL(Ra, &__thumblib_profile.head)          \
+      LDR_I3(Rc, Ra, 0)                               \
+      ADD_R3(Rc, Rc, Ra)                              \
+      STR_I3(Rb, Rc, _THUMBLIB_PROFILE_SAMPLE_CYCLES) \
+      MOV_I(Rb, Id)                                   \
+      STR_I3(Rb, Rc, _THUMBLIB_PROFILE_SAMPLE_ID)     \
+      SUB_R3(Rc, Rc, Ra)                              \
+      ADD_I(Rc, 8)                                    \
+      LSL_I3(Rc, Rc, 29 - THUMBLIB_PROFILE_RING_BITS) \
+      LSR_I3(Rc, Rc, 29 - THUMBLIB_PROFILE_RING_BITS) \
+      STR_I3(Rc, Ra, 0)                               \
+    }
+
+  /* THUMBLIB_PROFILER
+   *
+   * Define this before including thumblib3.h in exactly one
+   * file to get `__thumblib_profile_init`.
+   */
+  #ifdef THUMBLIB_PROFILER
+
+    void __thumblib_profile_init(void) {
+      ThumblibProfile* profile = &__thumblib_profile;
+      volatile unsigned short* timer = (volatile unsigned short*)_THUMBLIB_PROFILE_TIMER_BASE;
+      int i;
+
+      // Stop both timers, the counters restart from the
+      // reload values of 0 when enabled
+      timer[1] = 0;
+      timer[3] = 0;
+      timer[0] = 0;
+      timer[2] = 0;
+
+      profile->magic = THUMBLIB_PROFILE_MAGIC;
+      profile->ids = THUMBLIB_PROFILE_IDS;
+      profile->samples = THUMBLIB_PROFILE_SAMPLES;
+      profile->head = 0;
+
+      for (i = 0; i < THUMBLIB_PROFILE_SAMPLES; i++) {
+        profile->ring[i].id = THUMBLIB_PROFILE_EMPTY;
+        profile->ring[i].cycles = 0;
+      }
+
+      for (i = 0; i < THUMBLIB_PROFILE_IDS; i++) {
+        profile->entries[i].start = 0;
+        profile->entries[i].calls = 0;
+        profile->entries[i].total = 0;
+        profile->entries[i].totalHigh = 0;
+      }
+
+      // The high timer counts the low timer's overflows, so
+      // it must be running first
+      timer[3] = _THUMBLIB_TIMER_ENABLE | _THUMBLIB_TIMER_CASCADE;
+      timer[1] = _THUMBLIB_TIMER_ENABLE;
+    }
+
+  #endif // THUMBLIB_PROFILER
+
+#endif // THUMBLIB_3_PROFILE
@@ -0,0 +1,171 @@
+
+#ifndef THUMBLIB_3_TRANSFER
+#define THUMBLIB_3_TRANSFER
+
+  /* THUMBLIB3 block transfer macros
+   *
+   * This file defines copy and fill loops built on
+   * `LDMIA`/`STMIA`. A burst of n registers costs one
+   * nonsequential and n - 1 sequential accesses, rather than
+   * n nonsequential ones, so these are much faster than
+   * per-element `LDR`/`STR` loops on the GBA's buses.
+   *
+   * Every macro here expands to a block of opcodes with its
+   * own local labels, so it may be used several times within
+   * one function. Pointers are advanced past the transfer and
+   * counts are clobbered.
+   *
+   * `Registers...` is a list of 1 to 8 low scratch registers
+   * used for each burst, in ascending order. Since the pointers
+   * and counts are low registers too, THUMB code can spare at
+   * most 5 of them. Every register in the list is clobbered.
+   */
+
+  // Internal helpers
+
+    // `Rd = Rs`, for use with `_THUMBLIB_FOR_EACH`
+    #define _THUMBLIB_MOV_FROM(Rs, Rd) MOV(Rd, Rs)
+
+  /* COPY_WORDS(Dst, Src, Count, Registers...)
+   *
+   * Copies `Count` words from `Src` to `Dst`, both of which
+   * must be word aligned. Whole bursts of `Registers` are
+   * moved first and the remaining words one at a time.
+   */
+  #define COPY_WORDS(Dst, Src, Count, Registers...) \
+    {                                               \
+      __label__ _Burst, _Tail, _Single, _Done;      \
+      SUB_I(Count, _THUMBLIB_NARG(Registers))       \
+      BCC(_Tail)                                    \
+      _Burst:;                                      \
+        LDMIA(Src, Registers)                       \
+        STMIA(Dst, Registers)                       \
+        SUB_I(Count, _THUMBLIB_NARG(Registers))     \
+        BCS(_Burst)                                 \
+      _Tail:;                                       \
+        ADD_I(Count, _THUMBLIB_NARG(Registers))     \
+        BEQ(_Done)                                  \
+      _Single:;                                     \
+        LDMIA(Src, _THUMBLIB_FIRST(Registers))      \
+        STMIA(Dst, _THUMBLIB_FIRST(Registers))      \
+        SUB_I(Count, 1)                             \
+        BNE(_Single)                                \
+      _Done:;                                       \
+    }
+
+  /* FILL_WORDS(Dst, Value, Count, Registers...)
+   *
+   * Stores `Count` copies of the word `Value` to `Dst`, which
+   * must be word aligned. `Value` is copied into each of
+   * `Registers` before the first burst.
+   */
+  #define FILL_WORDS(Dst, Value, Count, Registers...)          \
+    {                                                          \
+      __label__ _Burst, _Tail, _Single, _Done;                 \
+      _THUMBLIB_FOR_EACH(_THUMBLIB_MOV_FROM, Value, Registers) \
+      SUB_I(Count, _THUMBLIB_NARG(Registers))                  \
+      BCC(_Tail)                                               \
+      _Burst:;                                                 \
+        STMIA(Dst, Registers)                                  \
+        SUB_I(Count, _THUMBLIB_NARG(Registers))                \
+        BCS(_Burst)                                            \
+      _Tail:;                                                  \
+        ADD_I(Count, _THUMBLIB_NARG(Registers))                \
+        BEQ(_Done)                                             \
+      _Single:;                                                \
+        STMIA(Dst, _THUMBLIB_FIRST(Registers))                 \
+        SUB_I(Count, 1)                                        \
+        BNE(_Single)                                           \
+      _Done:;                                                  \
+    }
+
+  /* COPY_BYTES(Dst, Src, Count, Scratch, Registers...)
+   *
+   * Copies `Count` bytes from `Src` to `Dst` with no alignment
+   * requirements. If both pointers share the same alignment,
+   * bytes are copied one at a time until they are word aligned,
+   * then words are copied with `COPY_WORDS` and the last 0-3
+   * bytes one at a time. Otherwise, and for copies shorter than
+   * 8 bytes, every byte is copied one at a time.
+   *
+   * `Scratch` is a low register that is clobbered and must not
+   * be one of `Registers`.
+   */
+  #define COPY_BYTES(Dst, Src, Count, Scratch, Registers...) \
+    {                                                        \
+      __label__ _Head, _Words, _Bytes, _Done;                \
+      CMP_I(Count, 8)                                        \
+      BCC(_Bytes)                                            \
+      MOV(Scratch, Dst)                                      \
+      EOR(Scratch, Src)                                      \
+      LSL_I2(Scratch, 30)                                    \
+      BNE(_Bytes)                                            \
+      _Head:;                                                \
+        LSL_I3(Scratch, Dst, 30)                             \
+        BEQ(_Words)                                          \
+        LDRB2(Scratch, Src)                                  \
+        STRB2(Scratch, Dst)                                  \
+        ADD_I(Src, 1)                                        \
+        ADD_I(Dst, 1)                                        \
+        SUB_I(Count, 1)                                      \
+        B(_Head)                                             \
+      _Words:;                                               \
+        LSR_I3(Scratch, Count, 2)                            \
+        LSL_I2(Count, 30)                                    \
+        LSR_I2(Count, 30)                                    \
+        COPY_WORDS(Dst, Src, Scratch, Registers)             \
+      _Bytes:;                                               \
+        SUB_I(Count, 1)                                      \
+        BCC(_Done)                                           \
+        LDRB2(Scratch, Src)                                  \
+        STRB2(Scratch, Dst)                                  \
+        ADD_I(Src, 1)                                        \
+        ADD_I(Dst, 1)                                        \
+        B(_Bytes)                                            \
+      _Done:;                                                \
+    }
+
+  /* FILL_BYTES(Dst, Value, Count, Scratch, Registers...)
+   *
+   * Stores `Count` copies of the byte `Value` to `Dst` with
+   * no alignment requirements. Bytes are stored one at a time
+   * until `Dst` is word aligned, then `Value` is spread across
+   * a whole word and stored with `FILL_WORDS`, and the last
+   * 0-3 bytes are stored one at a time. Fills shorter than
+   * 8 bytes are done one byte at a time.
+   *
+   * `Value` and `Scratch` are clobbered, and `Scratch` must
+   * not be one of `Registers`.
+   */
+  #define FILL_BYTES(Dst, Value, Count, Scratch, Registers...) \
+    {                                                          \
+      __label__ _Head, _Words, _Bytes, _Done;                  \
+      CMP_I(Count, 8)                                          \
+      BCC(_Bytes)                                              \
+      _Head:;                                                  \
+        LSL_I3(Scratch, Dst, 30)                               \
+        BEQ(_Words)                                            \
+        STRB2(Value, Dst)                                      \
+        ADD_I(Dst, 1)                                          \
+        SUB_I(Count, 1)                                        \
+        B(_Head)                                               \
+      _Words:;                                                 \
+        LSL_I2(Value, 24)                                      \
+        LSR_I3(Scratch, Value, 8)                              \
+        ORR(Value, Scratch)                                    \
+        LSR_I3(Scratch, Value, 16)                             \
+        ORR(Value, Scratch)                                    \
+        LSR_I3(Scratch, Count, 2)                              \
+        LSL_I2(Count, 30)                                      \
+        LSR_I2(Count, 30)                                      \
+        FILL_WORDS(Dst, Value, Scratch, Registers)             \
+      _Bytes:;                                                 \
+        SUB_I(Count, 1)                                        \
+        BCC(_Done)                                             \
+        STRB2(Value, Dst)                                      \
+        ADD_I(Dst, 1)                                          \
+        B(_Bytes)                                              \
+      _Done:;                                                  \
+    }
+
+#endif // THUMBLIB_3_TRANSFER
@@ -26,5 +26,16 @@
   #include "include/bases.h"
   #include "include/opcodes.h"
   #include "include/macros.h"
+  #include "include/constants.h"
+  #include "include/control.h"
+  #include "include/fragment.h"
+  #include "include/transfer.h"
+  #include "include/bios.h"
+  #include "include/dma.h"
+  #include "include/overlay.h"
+  #include "include/profile.h"
+  #include "include/arm_bases.h"
+  #include "include/arm_opcodes.h"
+  #include "include/divide.h"
 
 #endif // THUMBLIB_3
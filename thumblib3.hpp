@@ -0,0 +1,33 @@
+
+#ifndef THUMBLIB_3_HPP
+#define THUMBLIB_3_HPP
+
+  /* THUMBLIB v3, C++ front end
+   *
+   * This header includes `thumblib3.h` and adds the opcodes
+   * as C++17 function templates in the `thumblib` namespace,
+   * with typed registers and compile-time checked immediates:
+   *
+   * `add<4>(r0, r1); ldr<8>(r2, r0); push(r4 | r5 | lr);`
+   *
+   * They assemble to the same instructions as the C macros,
+   * but each is a single template rather than a family of
+   * `_THUMBLIB_NARG` overloads, so they cost the preprocessor
+   * nothing. See `include/opcodes.hpp` for the opcodes and
+   * their limits.
+   *
+   * The C macros remain available, and are still needed for
+   * labels and branches. Source files using this header must
+   * be compiled as C++17 or later.
+   *
+   */
+
+  #if __cplusplus < 201703L
+    #error "thumblib3.hpp requires C++17"
+  #endif
+
+  #include "thumblib3.h"
+
+  #include "include/opcodes.hpp"
+
+#endif // THUMBLIB_3_HPP
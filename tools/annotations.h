@@ -0,0 +1,118 @@
+#ifndef THUMBLIB_3_TOOLS_ANNOTATIONS
+#define THUMBLIB_3_TOOLS_ANNOTATIONS
+
+  /* THUMBLIB3 annotation records
+   *
+   * Reads the `.thumblib.annotations` records that THUMBLIB
+   * opcodes emit when built with `THUMBLIB_ANNOTATE`.
+   * See `_THUMBLIB_ANNOTATION` in include/helpers.h for the
+   * record layout. Keep the kinds in sync with the
+   * `_THUMBLIB_KIND_*` values there.
+   */
+
+  #include "thumbelf.h"
+
+  #define ANNOTATION_SECTION ".thumblib.annotations"
+
+  enum {
+    KIND_DATA            = 0,
+    KIND_ALU             = 1,
+    KIND_LOAD            = 2,
+    KIND_STORE           = 3,
+    KIND_LOAD_CODE       = 4,
+    KIND_LOAD_STACK      = 5,
+    KIND_STORE_STACK     = 6,
+    KIND_LOAD_MULTIPLE   = 7,
+    KIND_STORE_MULTIPLE  = 8,
+    KIND_PUSH            = 9,
+    KIND_POP             = 10,
+    KIND_POP_PC          = 11,
+    KIND_SP_ADJUST       = 12,
+    KIND_SP_ADJUST_R     = 13,
+    KIND_BRANCH          = 14,
+    KIND_BRANCH_COND     = 15,
+    KIND_BRANCH_LINK     = 16,
+    KIND_BRANCH_EXCHANGE = 17,
+    KIND_PC_WRITE        = 18,
+    KIND_SWI             = 19,
+    KIND_DATA_SHIFT_R    = 20,
+    KIND_MULTIPLY        = 21,
+  };
+
+  // Flags that may be combined with a kind
+  #define KIND_ARM         0x80
+  #define KIND_CONDITIONAL 0x40
+  #define KIND_MASK        0x3F
+
+  typedef struct {
+    int section;           // Code section of the instruction
+    uint32_t offset;       // Offset of the instruction within `section`
+    const ElfSymbol* function;
+    uint16_t line;
+    uint8_t kind;
+    int8_t count;
+    const char* mnemonic;
+  } Annotation;
+
+  // Reads all annotation records of `elf` into a newly
+  // allocated array, returning the number of records or
+  // -1 on error. Records whose address cannot be resolved
+  // are skipped with a warning.
+  static inline int annotations_read(const ElfFile* elf, Annotation** out) {
+    int section = elf_find_section(elf, ANNOTATION_SECTION);
+    const uint8_t* data;
+    uint32_t size, position = 0;
+    int count = 0, capacity = 64;
+    Annotation* records;
+
+    *out = NULL;
+    if (section < 0) {
+      fprintf(stderr, "%s: no %s section, build with -D THUMBLIB_ANNOTATE\n", elf->path, ANNOTATION_SECTION);
+      return -1;
+    }
+
+    data = elf_section_data(elf, section);
+    size = elf->sections[section].size;
+    records = (Annotation*)malloc(capacity * sizeof(Annotation));
+
+    while (position + 8 < size) {
+      Annotation record;
+      uint32_t start = position;
+      const uint8_t* terminator = (const uint8_t*)memchr(data + position + 8, 0, size - position - 8);
+      uint32_t length;
+
+      if (!terminator) {
+        fprintf(stderr, "%s: truncated annotation record at 0x%X\n", elf->path, start);
+        break;
+      }
+
+      length = (uint32_t)(terminator - (data + position + 8));
+      record.line = elf_read16(data + position + 4);
+      record.kind = data[position + 6];
+      record.count = (int8_t)data[position + 7];
+      record.mnemonic = (const char*)data + position + 8;
+      position += 8 + length + 1;
+
+      if (elf_resolve_pointer(elf, section, start, &record.section, &record.offset) != 0) {
+        fprintf(stderr, "%s: cannot resolve annotation record at 0x%X\n", elf->path, start);
+        continue;
+      }
+      record.function = elf_function_at(elf, record.section, record.offset);
+
+      if (count == capacity) {
+        capacity *= 2;
+        records = (Annotation*)realloc(records, capacity * sizeof(Annotation));
+      }
+      records[count++] = record;
+    }
+
+    *out = records;
+    return count;
+  }
+
+  // Returns the name of the function owning `record`.
+  static inline const char* annotation_function_name(const Annotation* record) {
+    return record->function ? record->function->name : "(no function)";
+  }
+
+#endif // THUMBLIB_3_TOOLS_ANNOTATIONS
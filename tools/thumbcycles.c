@@ -0,0 +1,281 @@
+/* thumbcycles
+ *
+ * Static ARM7TDMI cycle estimator for THUMBLIB functions.
+ *
+ * Reads the annotation records of objects built with
+ * `-D THUMBLIB_ANNOTATE` and reports the N/S/I cycle cost
+ * of a single straight-line pass through each function
+ * when placed in ROM, EWRAM or IWRAM.
+ *
+ * Build:  cc -O2 -o thumbcycles tools/thumbcycles.c
+ * Usage:  thumbcycles [options] file.o...
+ *
+ * Options:
+ *   -w VALUE  WAITCNT value used for ROM timings (default 0x4317)
+ *   -d REGION data region for loads and stores: rom, ewram or
+ *             iwram (default ewram). Stack accesses always use
+ *             IWRAM and literal pool loads use the code region.
+ *   -v        list every instruction with its cost
+ *
+ * Each function gets a minimum and a maximum: the minimum
+ * assumes conditional branches fall through, conditional ARM
+ * instructions are skipped and multiplies take one internal
+ * cycle, the maximum assumes every branch is taken, every
+ * conditional ARM instruction executes and every multiply
+ * takes four. ARM instructions are fetched as 32-bit words.
+ * Loops are not unrolled, so multiply a loop body's cost by its
+ * trip count yourself.
+ * The prefetch buffer is not modelled.
+ */
+
+#include "annotations.h"
+
+typedef struct {
+  const char* name;
+  int n16, s16, n32, s32;
+} Region;
+
+typedef struct {
+  int min, max;
+} Cost;
+
+enum {
+  REGION_ROM,
+  REGION_EWRAM,
+  REGION_IWRAM,
+  REGION_COUNT,
+};
+
+static Region regions[REGION_COUNT] = {
+  {"ROM",   5, 3, 8, 6},
+  {"EWRAM", 3, 3, 6, 6},
+  {"IWRAM", 1, 1, 1, 1},
+};
+
+// Sets ROM timings from the WS0 fields of WAITCNT.
+static void set_waitcnt(unsigned waitcnt) {
+  static const int firstAccess[4] = {4, 3, 2, 8};
+  Region* rom = &regions[REGION_ROM];
+  rom->n16 = 1 + firstAccess[(waitcnt >> 2) & 3];
+  rom->s16 = 1 + (((waitcnt >> 4) & 1) ? 1 : 2);
+  rom->n32 = rom->n16 + rom->s16;
+  rom->s32 = rom->s16 * 2;
+}
+
+static int is_register_shift(const char* mnemonic) {
+  return !strcmp(mnemonic, "lsl") || !strcmp(mnemonic, "lsr") || !strcmp(mnemonic, "asr") || !strcmp(mnemonic, "ror");
+}
+
+// Non-sequential access cost for the width implied
+// by a load/store mnemonic.
+static int data_access(const Region* data, const char* mnemonic) {
+  size_t length = strlen(mnemonic);
+  if (mnemonic[length - 1] == 'b' || mnemonic[length - 1] == 'h')
+    return data->n16;
+  return data->n32;
+}
+
+static Cost cost_of(const Annotation* record, const Region* code, const Region* data) {
+  const Region* stack = &regions[REGION_IWRAM];
+  int arm = record->kind & KIND_ARM;
+  int S = arm ? code->s32 : code->s16, N = arm ? code->n32 : code->n16;
+  int count = record->count > 0 ? record->count : 1;
+  Cost cost = {S, S};
+
+  switch (record->kind & KIND_MASK) {
+    case KIND_ALU:
+      if (is_register_shift(record->mnemonic)) {
+        cost.min = cost.max = S + 1;
+      } else if (!strcmp(record->mnemonic, "mul")) {
+        cost.min = S + 1;
+        cost.max = S + 4;
+      }
+      break;
+
+    case KIND_LOAD:
+      cost.min = cost.max = S + data_access(data, record->mnemonic) + 1;
+      break;
+
+    case KIND_STORE:
+      cost.min = cost.max = N + data_access(data, record->mnemonic);
+      break;
+
+    case KIND_LOAD_CODE:
+      cost.min = cost.max = S + code->n32 + 1;
+      break;
+
+    case KIND_LOAD_STACK:
+      cost.min = cost.max = S + stack->n32 + 1;
+      break;
+
+    case KIND_STORE_STACK:
+      cost.min = cost.max = N + stack->n32;
+      break;
+
+    case KIND_LOAD_MULTIPLE:
+      cost.min = cost.max = S + data->n32 + (count - 1) * data->s32 + 1;
+      break;
+
+    case KIND_STORE_MULTIPLE:
+      cost.min = cost.max = N + data->n32 + (count - 1) * data->s32;
+      break;
+
+    case KIND_POP:
+      cost.min = cost.max = S + stack->n32 + (count - 1) * stack->s32 + 1;
+      break;
+
+    case KIND_PUSH:
+      cost.min = cost.max = N + stack->n32 + (count - 1) * stack->s32;
+      break;
+
+    case KIND_POP_PC:
+      cost.min = cost.max = S + stack->n32 + (count - 1) * stack->s32 + 1 + N + S;
+      break;
+
+    case KIND_BRANCH:
+    case KIND_BRANCH_EXCHANGE:
+    case KIND_PC_WRITE:
+    case KIND_SWI:
+      cost.min = cost.max = 2 * S + N;
+      break;
+
+    case KIND_BRANCH_COND:
+      cost.max = 2 * S + N;
+      break;
+
+    case KIND_BRANCH_LINK:
+      // THUMB `bl` is two instructions
+      cost.min = cost.max = (arm ? 2 : 3) * S + N;
+      break;
+
+    case KIND_DATA_SHIFT_R:
+      cost.min = cost.max = S + 1;
+      break;
+
+    case KIND_MULTIPLY:
+      cost.min = S + 1 + record->count;
+      cost.max = S + 4 + record->count;
+      break;
+
+    default:
+      break;
+  }
+
+  // A skipped instruction still takes its fetch
+  if (record->kind & KIND_CONDITIONAL)
+    cost.min = S;
+
+  return cost;
+}
+
+typedef struct {
+  const char* name;
+  int instructions;
+  Cost total[REGION_COUNT];
+} FunctionReport;
+
+static void usage(void) {
+  fprintf(stderr, "usage: thumbcycles [-w WAITCNT] [-d rom|ewram|iwram] [-v] file.o...\n");
+  exit(2);
+}
+
+static int region_by_name(const char* name) {
+  if (!strcmp(name, "rom")) return REGION_ROM;
+  if (!strcmp(name, "ewram")) return REGION_EWRAM;
+  if (!strcmp(name, "iwram")) return REGION_IWRAM;
+  fprintf(stderr, "thumbcycles: unknown region '%s'\n", name);
+  exit(2);
+}
+
+static int report_file(const char* path, int dataRegion, int verbose) {
+  ElfFile elf;
+  Annotation* records;
+  FunctionReport* functions;
+  int count, functionCount = 0, i, r;
+
+  if (elf_open(&elf, path) != 0)
+    return 1;
+
+  count = annotations_read(&elf, &records);
+  if (count < 0) {
+    elf_close(&elf);
+    return 1;
+  }
+
+  functions = (FunctionReport*)calloc(count ? count : 1, sizeof(FunctionReport));
+
+  printf("%s:\n", path);
+  if (verbose)
+    printf("  %-32s %5s  %-6s %14s%14s%14s\n", "function", "line", "op", "ROM", "EWRAM", "IWRAM");
+
+  for (i = 0; i < count; i++) {
+    const char* name = annotation_function_name(&records[i]);
+    FunctionReport* function = NULL;
+    int j;
+
+    for (j = 0; j < functionCount; j++)
+      if (!strcmp(functions[j].name, name))
+        function = &functions[j];
+
+    if (!function) {
+      function = &functions[functionCount++];
+      function->name = name;
+    }
+
+    function->instructions++;
+    if (verbose)
+      printf("  %-32s %5u  %-6s", name, records[i].line, records[i].mnemonic);
+
+    for (r = 0; r < REGION_COUNT; r++) {
+      Cost cost = cost_of(&records[i], &regions[r], &regions[dataRegion]);
+      function->total[r].min += cost.min;
+      function->total[r].max += cost.max;
+      if (verbose)
+        printf(" %6d/%-6d", cost.min, cost.max);
+    }
+
+    if (verbose)
+      printf("\n");
+  }
+
+  if (verbose)
+    printf("\n");
+
+  printf("  %-32s %6s %14s%14s%14s\n", "function", "instrs", "ROM", "EWRAM", "IWRAM");
+  for (i = 0; i < functionCount; i++) {
+    printf("  %-32s %6d", functions[i].name, functions[i].instructions);
+    for (r = 0; r < REGION_COUNT; r++)
+      printf(" %6d/%-6d", functions[i].total[r].min, functions[i].total[r].max);
+    printf("\n");
+  }
+
+  free(functions);
+  free(records);
+  elf_close(&elf);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  int dataRegion = REGION_EWRAM, verbose = 0, status = 0, i;
+
+  set_waitcnt(0x4317);
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    if (!strcmp(argv[i], "-w") && i + 1 < argc)
+      set_waitcnt((unsigned)strtoul(argv[++i], NULL, 0));
+    else if (!strcmp(argv[i], "-d") && i + 1 < argc)
+      dataRegion = region_by_name(argv[++i]);
+    else if (!strcmp(argv[i], "-v"))
+      verbose = 1;
+    else
+      usage();
+  }
+
+  if (i == argc)
+    usage();
+
+  for (; i < argc; i++)
+    status |= report_file(argv[i], dataRegion, verbose);
+
+  return status;
+}
@@ -0,0 +1,381 @@
+#ifndef THUMBLIB_3_TOOLS_ELF
+#define THUMBLIB_3_TOOLS_ELF
+
+  /* THUMBLIB3 host tool ELF reader
+   *
+   * A small reader for 32-bit little endian ARM ELF files,
+   * shared by the host tools in this folder. It understands
+   * both relocatable objects (as produced when compiling
+   * THUMBLIB sources) and linked executables.
+   *
+   * Everything here is `static` so that each tool can be
+   * built from a single source file.
+   */
+
+  #include <stdint.h>
+  #include <stdio.h>
+  #include <stdlib.h>
+  #include <string.h>
+
+  #define ELF_SHT_SYMTAB 2
+  #define ELF_SHT_NOBITS 8
+  #define ELF_SHT_REL    9
+
+  #define ELF_SHF_ALLOC 2
+
+  #define ELF_STT_FUNC    2
+  #define ELF_STT_SECTION 3
+
+  #define ELF_STB_LOCAL 0
+
+  #define ELF_ET_REL 1
+
+  #define ELF_EM_ARM 40
+
+  #define ELF_SHN_UNDEF  0
+  #define ELF_SHN_ABS    0xFFF1
+  #define ELF_SHN_COMMON 0xFFF2
+
+  // ARM relocation types
+  #define ELF_R_ARM_NONE        0
+  #define ELF_R_ARM_PC24        1
+  #define ELF_R_ARM_ABS32       2
+  #define ELF_R_ARM_REL32       3
+  #define ELF_R_ARM_THM_CALL    10
+  #define ELF_R_ARM_CALL        28
+  #define ELF_R_ARM_JUMP24      29
+  #define ELF_R_ARM_V4BX        40
+  #define ELF_R_ARM_THM_JUMP11  102
+  #define ELF_R_ARM_THM_JUMP8   103
+
+  typedef struct {
+    const char* name;
+    uint32_t type;
+    uint32_t flags;
+    uint32_t addr;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t link;
+    uint32_t info;
+    uint32_t addralign;
+    uint32_t entsize;
+  } ElfSection;
+
+  typedef struct {
+    const char* name;
+    uint32_t value;
+    uint32_t size;
+    uint8_t type;
+    uint8_t bind;
+    uint16_t shndx;
+  } ElfSymbol;
+
+  typedef struct {
+    uint32_t offset;
+    uint32_t symbol;
+    uint8_t type;
+  } ElfRel;
+
+  typedef struct {
+    const char* path;
+    uint8_t* data;
+    size_t length;
+    uint16_t type;
+    ElfSection* sections;
+    int sectionCount;
+    ElfSymbol* symbols;
+    int symbolCount;
+  } ElfFile;
+
+  static inline uint16_t elf_read16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+  }
+
+  static inline uint32_t elf_read32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  }
+
+  static inline const char* elf_string(const ElfFile* elf, int tableSection, uint32_t index) {
+    const ElfSection* table;
+    if (tableSection <= 0 || tableSection >= elf->sectionCount)
+      return "";
+    table = &elf->sections[tableSection];
+    if (index >= table->size)
+      return "";
+    return (const char*)elf->data + table->offset + index;
+  }
+
+  static inline void elf_close(ElfFile* elf) {
+    free(elf->data);
+    free(elf->sections);
+    free(elf->symbols);
+    memset(elf, 0, sizeof(*elf));
+  }
+
+  // Loads `path`, returning 0 on success. Errors are
+  // reported on stderr.
+  static inline int elf_open(ElfFile* elf, const char* path) {
+    FILE* file;
+    long length;
+    uint32_t shoff;
+    uint16_t shentsize, shnum, shstrndx;
+    int i;
+
+    memset(elf, 0, sizeof(*elf));
+    elf->path = path;
+
+    file = fopen(path, "rb");
+    if (!file) {
+      fprintf(stderr, "%s: cannot open file\n", path);
+      return 1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    elf->data = (uint8_t*)malloc(length > 0 ? (size_t)length : 1);
+    elf->length = (size_t)length;
+    if (length < 52 || fread(elf->data, 1, elf->length, file) != elf->length) {
+      fprintf(stderr, "%s: cannot read file\n", path);
+      fclose(file);
+      elf_close(elf);
+      return 1;
+    }
+    fclose(file);
+
+    if (memcmp(elf->data, "\x7F" "ELF", 4) != 0 || elf->data[4] != 1 || elf->data[5] != 1) {
+      fprintf(stderr, "%s: not a 32-bit little endian ELF file\n", path);
+      elf_close(elf);
+      return 1;
+    }
+
+    if (elf_read16(elf->data + 18) != ELF_EM_ARM) {
+      fprintf(stderr, "%s: not an ARM ELF file\n", path);
+      elf_close(elf);
+      return 1;
+    }
+
+    elf->type = elf_read16(elf->data + 16);
+    shoff = elf_read32(elf->data + 32);
+    shentsize = elf_read16(elf->data + 46);
+    shnum = elf_read16(elf->data + 48);
+    shstrndx = elf_read16(elf->data + 50);
+
+    if (shentsize < 40 || (size_t)shoff + (size_t)shnum * shentsize > elf->length) {
+      fprintf(stderr, "%s: bad section header table\n", path);
+      elf_close(elf);
+      return 1;
+    }
+
+    elf->sectionCount = shnum;
+    elf->sections = (ElfSection*)calloc(shnum ? shnum : 1, sizeof(ElfSection));
+
+    for (i = 0; i < shnum; i++) {
+      const uint8_t* header = elf->data + shoff + (size_t)i * shentsize;
+      ElfSection* section = &elf->sections[i];
+      section->type = elf_read32(header + 4);
+      section->flags = elf_read32(header + 8);
+      section->addr = elf_read32(header + 12);
+      section->offset = elf_read32(header + 16);
+      section->size = elf_read32(header + 20);
+      section->link = elf_read32(header + 24);
+      section->info = elf_read32(header + 28);
+      section->addralign = elf_read32(header + 32);
+      section->entsize = elf_read32(header + 36);
+      if (section->type != ELF_SHT_NOBITS && (size_t)section->offset + section->size > elf->length) {
+        fprintf(stderr, "%s: section %d is out of bounds\n", path, i);
+        elf_close(elf);
+        return 1;
+      }
+    }
+
+    for (i = 0; i < shnum; i++)
+      elf->sections[i].name = elf_string(elf, shstrndx, elf_read32(elf->data + shoff + (size_t)i * shentsize));
+
+    for (i = 0; i < shnum; i++) {
+      const ElfSection* section = &elf->sections[i];
+      int j;
+      if (section->type != ELF_SHT_SYMTAB)
+        continue;
+      elf->symbolCount = (int)(section->size / 16);
+      elf->symbols = (ElfSymbol*)calloc(elf->symbolCount ? elf->symbolCount : 1, sizeof(ElfSymbol));
+      for (j = 0; j < elf->symbolCount; j++) {
+        const uint8_t* entry = elf->data + section->offset + (size_t)j * 16;
+        ElfSymbol* symbol = &elf->symbols[j];
+        symbol->name = elf_string(elf, (int)section->link, elf_read32(entry));
+        symbol->value = elf_read32(entry + 4);
+        symbol->size = elf_read32(entry + 8);
+        symbol->type = entry[12] & 0xF;
+        symbol->bind = entry[12] >> 4;
+        symbol->shndx = elf_read16(entry + 14);
+      }
+      break;
+    }
+
+    return 0;
+  }
+
+  static inline int elf_find_section(const ElfFile* elf, const char* name) {
+    int i;
+    for (i = 0; i < elf->sectionCount; i++)
+      if (strcmp(elf->sections[i].name, name) == 0)
+        return i;
+    return -1;
+  }
+
+  static inline const uint8_t* elf_section_data(const ElfFile* elf, int section) {
+    return elf->data + elf->sections[section].offset;
+  }
+
+  // Finds the SHT_REL section that applies to `section`,
+  // or -1 if there is none.
+  static inline int elf_find_rel(const ElfFile* elf, int section) {
+    int i;
+    for (i = 0; i < elf->sectionCount; i++)
+      if (elf->sections[i].type == ELF_SHT_REL && (int)elf->sections[i].info == section)
+        return i;
+    return -1;
+  }
+
+  // Reads the relocation at `offset` within `section`,
+  // returning 0 if there is one.
+  static inline int elf_rel_at(const ElfFile* elf, int section, uint32_t offset, ElfRel* out) {
+    int rel = elf_find_rel(elf, section);
+    uint32_t i, count;
+    const uint8_t* entries;
+    if (rel < 0)
+      return 1;
+    entries = elf_section_data(elf, rel);
+    count = elf->sections[rel].size / 8;
+    for (i = 0; i < count; i++) {
+      if (elf_read32(entries + i * 8) == offset) {
+        uint32_t info = elf_read32(entries + i * 8 + 4);
+        out->offset = offset;
+        out->symbol = info >> 8;
+        out->type = (uint8_t)info;
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+  // Resolves a 32-bit address stored at `offset` within
+  // `section` into a (section, offset) pair. Relocatable
+  // objects go through the relocation table, executables
+  // through the section addresses.
+  static inline int elf_resolve_pointer(const ElfFile* elf, int section, uint32_t offset, int* outSection, uint32_t* outOffset) {
+    uint32_t value = elf_read32(elf_section_data(elf, section) + offset);
+    int i;
+
+    if (elf->type == ELF_ET_REL) {
+      ElfRel rel;
+      const ElfSymbol* symbol;
+      if (elf_rel_at(elf, section, offset, &rel) != 0 || rel.symbol >= (uint32_t)elf->symbolCount)
+        return 1;
+      symbol = &elf->symbols[rel.symbol];
+      if (symbol->shndx == ELF_SHN_UNDEF || symbol->shndx >= elf->sectionCount)
+        return 1;
+      *outSection = symbol->shndx;
+      *outOffset = ((symbol->value & ~1u) + value) & ~1u;
+      return 0;
+    }
+
+    for (i = 1; i < elf->sectionCount; i++) {
+      const ElfSection* candidate = &elf->sections[i];
+      if ((candidate->flags & ELF_SHF_ALLOC) && value >= candidate->addr && value < candidate->addr + candidate->size) {
+        *outSection = i;
+        *outOffset = (value - candidate->addr) & ~1u;
+        return 0;
+      }
+    }
+
+    return 1;
+  }
+
+  // Finds the function symbol covering `offset` within
+  // `section`, or NULL.
+  static inline const ElfSymbol* elf_function_at(const ElfFile* elf, int section, uint32_t offset) {
+    int i;
+    uint32_t base = elf->type == ELF_ET_REL ? 0 : elf->sections[section].addr;
+    for (i = 0; i < elf->symbolCount; i++) {
+      const ElfSymbol* symbol = &elf->symbols[i];
+      uint32_t start;
+      if (symbol->type != ELF_STT_FUNC || symbol->shndx != section)
+        continue;
+      start = (symbol->value & ~1u) - base;
+      if (offset >= start && (offset < start + symbol->size || (symbol->size == 0 && offset == start)))
+        return symbol;
+    }
+    return NULL;
+  }
+
+  // Mapping symbols
+
+  typedef struct {
+    uint32_t offset;
+    char state;     // 'a', 't' or 'd'
+  } ElfMapping;
+
+  // Address that symbol values in `section` are relative to
+  static inline uint32_t elf_section_base(const ElfFile* elf, int section) {
+    return elf->type == ELF_ET_REL ? 0 : elf->sections[section].addr;
+  }
+
+  static inline int elf_compare_mappings(const void* a, const void* b) {
+    const ElfMapping* x = (const ElfMapping*)a;
+    const ElfMapping* y = (const ElfMapping*)b;
+    return x->offset < y->offset ? -1 : x->offset > y->offset;
+  }
+
+  // Collects the `$a`, `$t` and `$d` mapping symbols of
+  // `section`, sorted by offset. The caller frees `*out`.
+  static inline int elf_read_mappings(const ElfFile* elf, int section, ElfMapping** out) {
+    uint32_t base = elf_section_base(elf, section);
+    int count = 0, i;
+    ElfMapping* mappings = (ElfMapping*)malloc((elf->symbolCount ? elf->symbolCount : 1) * sizeof(ElfMapping));
+
+    for (i = 0; i < elf->symbolCount; i++) {
+      const ElfSymbol* symbol = &elf->symbols[i];
+      const char* name = symbol->name;
+      if (symbol->shndx != section || name[0] != '$' || !strchr("atd", name[1]) || (name[2] && name[2] != '.'))
+        continue;
+      mappings[count].offset = symbol->value - base;
+      mappings[count].state = name[1];
+      count++;
+    }
+
+    qsort(mappings, count, sizeof(ElfMapping), elf_compare_mappings);
+    *out = mappings;
+    return count;
+  }
+
+  // Returns the state at `offset`, or `fallback` if no mapping
+  // symbol comes before it.
+  static inline char elf_state_at(const ElfMapping* mappings, int count, uint32_t offset, char fallback) {
+    char state = fallback;
+    int i;
+    for (i = 0; i < count && mappings[i].offset <= offset; i++)
+      state = mappings[i].state;
+    return state;
+  }
+
+  // Returns the offset of the first mapping symbol after
+  // `offset`, or `end`.
+  static inline uint32_t elf_next_mapping(const ElfMapping* mappings, int count, uint32_t offset, uint32_t end) {
+    int i;
+    for (i = 0; i < count; i++)
+      if (mappings[i].offset > offset && mappings[i].offset < end)
+        return mappings[i].offset;
+    return end;
+  }
+
+  // `mov r8, r8` and `mov r0, r0` are the nops GCC and GAS
+  // align with, and a zero halfword can pad a literal pool
+  static inline int elf_is_padding(char state, uint32_t offset, uint32_t instruction) {
+    if (state == 'a')
+      return instruction == 0xE1A00000;
+    return instruction == 0x46C0 || (instruction == 0 && (offset & 3) == 2);
+  }
+
+#endif // THUMBLIB_3_TOOLS_ELF
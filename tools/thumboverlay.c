@@ -0,0 +1,202 @@
+/* thumboverlay
+ *
+ * Generates the IWRAM overlay manifest for the functions
+ * marked with `THUMBLIB_OVERLAY_FUNC` in a set of objects.
+ *
+ * Each overlay function is in a `.thumblib.overlay.Name`
+ * section of its own, whose size is the number of bytes
+ * copied into IWRAM. The manifest is written as a C file that
+ * uses the manifest macros of include/overlay.h and also
+ * defines the loader, so it should be compiled and linked
+ * (or installed) with the rest of the objects. ROM addresses
+ * are filled in by the linker through the function symbols.
+ *
+ * Build:  cc -O2 -o thumboverlay tools/thumboverlay.c
+ * Usage:  thumboverlay [options] file.o... > overlays.c
+ *
+ * Options:
+ *   -w ADDRESS  RAM address of the overlay state (required),
+ *               which takes 4 + 8 * slots + 4 * functions bytes
+ *   -i ADDRESS  IWRAM address of the first slot (required)
+ *   -n COUNT    number of slots (default 1)
+ *   -s SIZE     size of each slot in bytes (default: the size
+ *               of the largest function)
+ *   -o FILE     write the manifest to FILE rather than stdout
+ *
+ * Fails if a function doesn't fit in a slot or the slots don't
+ * fit in IWRAM. A summary of the slots is written into the
+ * manifest as a comment.
+ */
+
+#include "thumbelf.h"
+
+#define OVERLAY_PREFIX ".thumblib.overlay."
+
+#define IWRAM_START 0x03000000u
+#define IWRAM_END   0x03008000u
+
+typedef struct {
+  const char* name;
+  const char* path;
+  uint32_t size;
+} Overlay;
+
+static Overlay* overlays = NULL;
+static int overlayCount = 0, overlayCapacity = 0;
+
+static void usage(void) {
+  fprintf(stderr, "usage: thumboverlay -w RAM -i IWRAM [-n SLOTS] [-s SLOT_SIZE] [-o FILE] file.o...\n");
+  exit(2);
+}
+
+static int has_function(const ElfFile* elf, int section, const char* name) {
+  int i;
+  for (i = 0; i < elf->symbolCount; i++)
+    if (elf->symbols[i].type == ELF_STT_FUNC && elf->symbols[i].shndx == section && !strcmp(elf->symbols[i].name, name))
+      return 1;
+  return 0;
+}
+
+// Adds the overlay sections of `path`. The file stays open,
+// since the names point into it.
+static int read_file(const char* path) {
+  ElfFile* elf = (ElfFile*)malloc(sizeof(ElfFile));
+  int status = 0, i, j;
+
+  if (elf_open(elf, path) != 0) {
+    free(elf);
+    return 1;
+  }
+
+  if (elf->type != ELF_ET_REL) {
+    fprintf(stderr, "%s: not a relocatable object\n", path);
+    elf_close(elf);
+    free(elf);
+    return 1;
+  }
+
+  for (i = 0; i < elf->sectionCount; i++) {
+    const char* name = elf->sections[i].name;
+    if (strncmp(name, OVERLAY_PREFIX, strlen(OVERLAY_PREFIX)) != 0)
+      continue;
+    name += strlen(OVERLAY_PREFIX);
+
+    if (!has_function(elf, i, name)) {
+      fprintf(stderr, "%s: section %s doesn't define the function %s\n", path, elf->sections[i].name, name);
+      status = 1;
+      continue;
+    }
+
+    for (j = 0; j < overlayCount; j++) {
+      if (!strcmp(overlays[j].name, name)) {
+        fprintf(stderr, "%s: %s is also an overlay function in %s\n", path, name, overlays[j].path);
+        status = 1;
+      }
+    }
+
+    if (overlayCount == overlayCapacity) {
+      overlayCapacity = overlayCapacity ? overlayCapacity * 2 : 16;
+      overlays = (Overlay*)realloc(overlays, overlayCapacity * sizeof(Overlay));
+    }
+    overlays[overlayCount].name = name;
+    overlays[overlayCount].path = path;
+    overlays[overlayCount].size = (elf->sections[i].size + 3) & ~3u;
+    overlayCount++;
+  }
+
+  return status;
+}
+
+int main(int argc, char** argv) {
+  unsigned long ram = 0, iwram = 0, slotCount = 1, slotSize = 0;
+  const char* outPath = NULL;
+  FILE* out = stdout;
+  int haveRam = 0, haveIwram = 0, status = 0, first, i;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+      ram = strtoul(argv[++i], NULL, 0);
+      haveRam = 1;
+    } else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+      iwram = strtoul(argv[++i], NULL, 0);
+      haveIwram = 1;
+    } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+      slotCount = strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+      slotSize = strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      outPath = argv[++i];
+    } else {
+      usage();
+    }
+  }
+
+  if (i == argc || !haveRam || !haveIwram || slotCount == 0)
+    usage();
+
+  first = i;
+  for (; i < argc; i++)
+    status |= read_file(argv[i]);
+
+  if (status)
+    return 1;
+
+  if (overlayCount == 0) {
+    fprintf(stderr, "thumboverlay: no THUMBLIB_OVERLAY_FUNC functions found\n");
+    return 1;
+  }
+
+  if (slotSize == 0) {
+    for (i = 0; i < overlayCount; i++)
+      if (overlays[i].size > slotSize)
+        slotSize = overlays[i].size;
+  }
+
+  if ((slotSize & 3) || (iwram & 3) || (ram & 3)) {
+    fprintf(stderr, "thumboverlay: addresses and the slot size must be word aligned\n");
+    return 1;
+  }
+
+  if (iwram < IWRAM_START || iwram + slotSize * slotCount > IWRAM_END) {
+    fprintf(stderr, "thumboverlay: %lu slots of 0x%lX bytes at 0x%08lX don't fit in IWRAM\n", slotCount, slotSize, iwram);
+    return 1;
+  }
+
+  for (i = 0; i < overlayCount; i++) {
+    if (overlays[i].size > slotSize) {
+      fprintf(stderr, "%s: %s is 0x%X bytes, more than the slot size of 0x%lX\n", overlays[i].path, overlays[i].name, overlays[i].size, slotSize);
+      status = 1;
+    }
+  }
+
+  if (status)
+    return 1;
+
+  if (outPath) {
+    out = fopen(outPath, "w");
+    if (!out) {
+      fprintf(stderr, "%s: cannot open file\n", outPath);
+      return 1;
+    }
+  }
+
+  fprintf(out, "/* IWRAM overlay manifest, generated by thumboverlay from\n *\n");
+  for (i = first; i < argc; i++)
+    fprintf(out, " * %s\n", argv[i]);
+  fprintf(out, " *\n * Slots:  %lu of 0x%lX bytes at 0x%08lX-0x%08lX\n", slotCount, slotSize, iwram, iwram + slotSize * slotCount);
+  fprintf(out, " * State:  0x%08lX-0x%08lX\n *\n", ram, ram + 4 + 8 * slotCount + 4 * overlayCount);
+  for (i = 0; i < overlayCount; i++)
+    fprintf(out, " * %-32s 0x%04X bytes, %3lu%% of a slot\n", overlays[i].name, overlays[i].size, overlays[i].size * 100 / slotSize);
+  fprintf(out, " */\n\n");
+
+  fprintf(out, "#define THUMBLIB_OVERLAY_MANAGER\n");
+  fprintf(out, "#include \"thumblib3.h\"\n\n");
+  fprintf(out, "THUMBLIB_OVERLAY_MANIFEST(0x%08lX, 0x%08lX, 0x%lX, %lu)\n", ram, iwram, slotSize, slotCount);
+  for (i = 0; i < overlayCount; i++)
+    fprintf(out, "THUMBLIB_OVERLAY_ENTRY(%d, %s, 0x%X)\n", i, overlays[i].name, overlays[i].size);
+  fprintf(out, "THUMBLIB_OVERLAY_MANIFEST_END(%d)\n", overlayCount);
+
+  if (out != stdout)
+    fclose(out);
+  return 0;
+}
@@ -0,0 +1,218 @@
+/* thumbprofile
+ *
+ * Decodes the profiling table of `PROFILE_BEGIN` and
+ * `PROFILE_END` (see include/profile.h) from a memory dump.
+ *
+ * The file is any copy of the memory holding the table, such
+ * as an EWRAM dump from an emulator, the file `thumbsim -m`
+ * writes, or an uncompressed save state. The table is found
+ * by its magic number unless its address is given.
+ *
+ * Build:  cc -O2 -o thumbprofile tools/thumbprofile.c
+ * Usage:  thumbprofile [options] FILE
+ *
+ * Options:
+ *   -b ADDRESS  address of the start of the file
+ *               (default 0x02000000)
+ *   -a ADDRESS  address of the table, instead of searching
+ *   -n FILE     names of the ids, one `ID NAME` per line
+ *   -s COUNT    number of recent samples to list (default 16,
+ *               0 for none)
+ *
+ * Prints the calls, total and average cycles of each id that
+ * was called, sorted by total, then the most recent samples
+ * with the oldest first.
+ */
+
+#include "thumbelf.h"
+
+#define PROFILE_MAGIC 0x46504854u
+#define PROFILE_EMPTY 0xFFFFFFFFu
+
+#define HEADER_SIZE 12
+#define SAMPLE_SIZE 8
+#define ENTRY_SIZE  16
+
+// Cycles per frame, to express totals in frames
+#define FRAME_CYCLES 280896.0
+
+typedef struct {
+  unsigned id;
+  uint32_t calls;
+  uint64_t total;
+} Total;
+
+static char* names[256];
+
+static void usage(void) {
+  fprintf(stderr, "usage: thumbprofile [-b BASE] [-a ADDRESS] [-n NAMES] [-s COUNT] FILE\n");
+  exit(2);
+}
+
+static uint8_t* read_file(const char* path, long* length) {
+  FILE* file = fopen(path, "rb");
+  uint8_t* data;
+  if (!file) {
+    fprintf(stderr, "%s: cannot open file\n", path);
+    exit(1);
+  }
+  fseek(file, 0, SEEK_END);
+  *length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  data = (uint8_t*)malloc(*length ? *length : 1);
+  if (fread(data, 1, (size_t)*length, file) != (size_t)*length) {
+    fprintf(stderr, "%s: cannot read file\n", path);
+    exit(1);
+  }
+  fclose(file);
+  return data;
+}
+
+static void read_names(const char* path) {
+  FILE* file = fopen(path, "r");
+  char line[256], name[200];
+  int id;
+  if (!file) {
+    fprintf(stderr, "%s: cannot open file\n", path);
+    exit(1);
+  }
+  while (fgets(line, sizeof(line), file))
+    if (sscanf(line, "%i %199s", &id, name) == 2 && id >= 0 && id < 256) {
+      names[id] = (char*)malloc(strlen(name) + 1);
+      strcpy(names[id], name);
+    }
+  fclose(file);
+}
+
+static const char* name_of(unsigned id) {
+  static char text[16];
+  if (id < 256 && names[id])
+    return names[id];
+  sprintf(text, "%u", id);
+  return text;
+}
+
+// Returns the size of the table at `offset`, or 0 if it
+// isn't a valid table.
+static long table_size(const uint8_t* data, long length, long offset) {
+  unsigned ids, samples;
+  uint32_t head;
+  long size;
+  if (offset < 0 || offset + HEADER_SIZE > length || elf_read32(data + offset) != PROFILE_MAGIC)
+    return 0;
+  ids = elf_read16(data + offset + 4);
+  samples = elf_read16(data + offset + 6);
+  head = elf_read32(data + offset + 8);
+  if (ids < 1 || ids > 256 || samples < 2 || samples > 1024 || (samples & (samples - 1)))
+    return 0;
+  if (head % SAMPLE_SIZE || head >= samples * SAMPLE_SIZE)
+    return 0;
+  size = HEADER_SIZE + (long)samples * SAMPLE_SIZE + (long)ids * ENTRY_SIZE;
+  return offset + size <= length ? size : 0;
+}
+
+static int by_total(const void* a, const void* b) {
+  const Total* x = (const Total*)a;
+  const Total* y = (const Total*)b;
+  if (x->total != y->total)
+    return x->total < y->total ? 1 : -1;
+  return x->id < y->id ? -1 : 1;
+}
+
+int main(int argc, char** argv) {
+  unsigned long base = 0x02000000, address = 0, sampleCount = 16;
+  int haveAddress = 0, i;
+  long length, offset = -1, size;
+  const uint8_t* data;
+  const uint8_t* table;
+  unsigned ids, samples, head, count = 0, valid = 0;
+  Total* totals;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+      base = strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "-a") && i + 1 < argc) {
+      address = strtoul(argv[++i], NULL, 0);
+      haveAddress = 1;
+    } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+      read_names(argv[++i]);
+    } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+      sampleCount = strtoul(argv[++i], NULL, 0);
+    } else {
+      usage();
+    }
+  }
+
+  if (i + 1 != argc)
+    usage();
+
+  data = read_file(argv[i], &length);
+
+  if (haveAddress) {
+    offset = (long)(address - base);
+    if (address < base || !table_size(data, length, offset)) {
+      fprintf(stderr, "%s: no profiling table at 0x%08lX\n", argv[i], address);
+      return 1;
+    }
+  } else {
+    long found;
+    for (found = 0; found + HEADER_SIZE <= length; found += 4) {
+      if (!table_size(data, length, found))
+        continue;
+      if (offset < 0)
+        offset = found;
+      else
+        fprintf(stderr, "%s: another profiling table at 0x%08lX, use -a to pick one\n", argv[i], base + found);
+    }
+    if (offset < 0) {
+      fprintf(stderr, "%s: no profiling table found\n", argv[i]);
+      return 1;
+    }
+  }
+
+  size = table_size(data, length, offset);
+  table = data + offset;
+  ids = elf_read16(table + 4);
+  samples = elf_read16(table + 6);
+  head = elf_read32(table + 8) / SAMPLE_SIZE;
+
+  printf("Profiling table at 0x%08lX-0x%08lX: %u ids, %u samples\n\n", base + offset, base + offset + size, ids, samples);
+
+  totals = (Total*)calloc(ids, sizeof(Total));
+  for (i = 0; i < (int)ids; i++) {
+    const uint8_t* entry = table + HEADER_SIZE + samples * SAMPLE_SIZE + i * ENTRY_SIZE;
+    uint32_t calls = elf_read32(entry + 4);
+    if (!calls)
+      continue;
+    totals[count].id = (unsigned)i;
+    totals[count].calls = calls;
+    totals[count].total = elf_read32(entry + 8) | ((uint64_t)elf_read32(entry + 12) << 32);
+    count++;
+  }
+  qsort(totals, count, sizeof(Total), by_total);
+
+  printf("%-24s %10s %14s %12s %9s\n", "id", "calls", "cycles", "average", "frames");
+  for (i = 0; i < (int)count; i++)
+    printf("%-24s %10u %14llu %12.1f %9.2f\n", name_of(totals[i].id), totals[i].calls, (unsigned long long)totals[i].total, (double)totals[i].total / totals[i].calls, totals[i].total / FRAME_CYCLES);
+  if (!count)
+    printf("(no calls)\n");
+
+  if (sampleCount) {
+    printf("\nRecent samples, oldest first:\n\n");
+    printf("%-24s %10s\n", "id", "cycles");
+    for (i = 0; i < (int)samples; i++)
+      if (elf_read32(table + HEADER_SIZE + i * SAMPLE_SIZE) != PROFILE_EMPTY)
+        valid++;
+    for (i = 0; i < (int)samples; i++) {
+      const uint8_t* sample = table + HEADER_SIZE + ((head + i) % samples) * SAMPLE_SIZE;
+      uint32_t id = elf_read32(sample);
+      if (id == PROFILE_EMPTY)
+        continue;
+      // Only the last `sampleCount` of them
+      if (valid-- <= sampleCount)
+        printf("%-24s %10u\n", name_of(id), elf_read32(sample + 4));
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,1704 @@
+/* thumbsim
+ *
+ * Host-side ARM7TDMI interpreter for THUMBLIB functions.
+ *
+ * Loads relocatable objects built from THUMBLIB sources,
+ * lays them out in a GBA memory map, calls one function with
+ * the given register and memory state and reports the number
+ * of cycles it took using the GBA's memory timings.
+ *
+ * Build:  cc -O2 -o thumbsim tools/thumbsim.c
+ * Usage:  thumbsim [options] -c FUNCTION file.o...
+ *
+ * Options:
+ *   -c NAME          function to call
+ *   -r REG=VALUE     set a register before the call (r0-r12)
+ *   -s ADDR=TEXT     write a NUL-terminated string before the call
+ *   -l ADDR=FILE     load a file into memory before the call
+ *   -x NAME[=VALUE]  stub the function NAME, setting r0 to VALUE
+ *                    when given
+ *   -D NAME=VALUE    define the symbol NAME as VALUE
+ *   -p REGION        where to place code: rom, ewram or iwram
+ *                    (default rom)
+ *   -w VALUE         WAITCNT value used for ROM timings
+ *                    (default 0x4317)
+ *   -e REG=VALUE     expect a register value after the call
+ *   -E ADDR=TEXT     expect a NUL-terminated string after the call
+ *   -d ADDR=LENGTH   dump memory after the call
+ *   -m FILE          write EWRAM to FILE after the call
+ *   -L COUNT         instruction limit (default 10000000)
+ *   -t               trace every instruction
+ *   -v               list calls to stubbed functions
+ *
+ * VALUE and ADDR may be numbers or symbol names, optionally
+ * followed by `+offset`.
+ *
+ * Sections named `.iwram*`, `.data*` and `.bss*` are placed
+ * in IWRAM and `.ewram*` in EWRAM, everything else goes to
+ * the region chosen with `-p`. Undefined functions are stubbed
+ * automatically and return immediately. Other undefined
+ * symbols get a zeroed 64-byte block in EWRAM unless they are
+ * given a value with `-D`.
+ *
+ * BIOS calls Div, DivArm, Sqrt, CpuSet and CpuFastSet are
+ * carried out by the host, and cost only the `swi` and the
+ * return into the caller. The prefetch buffer is not
+ * modelled.
+ *
+ * Timers 0-3 count from the cycle count of the accesses that
+ * read them, with their prescalers and cascading. Reload
+ * values take effect when a timer is enabled and on overflow,
+ * and no interrupts are raised.
+ *
+ * The exit status is 0 on success, 1 when an expectation
+ * failed and 2 on errors.
+ */
+
+#include "thumbelf.h"
+
+#include <stdarg.h>
+
+// Memory map
+
+typedef struct {
+  const char* name;
+  uint32_t base;
+  uint32_t size;
+  uint8_t* data;
+  int n16, s16, n32, s32;
+  int writable;
+} Region;
+
+enum {
+  REGION_BIOS,
+  REGION_EWRAM,
+  REGION_IWRAM,
+  REGION_IO,
+  REGION_PALETTE,
+  REGION_VRAM,
+  REGION_OAM,
+  REGION_ROM,
+  REGION_SRAM,
+  REGION_COUNT,
+};
+
+static Region regions[REGION_COUNT] = {
+  {"BIOS",    0x00000000, 0x00004000,  NULL, 1, 1, 1, 1, 0},
+  {"EWRAM",   0x02000000, 0x00040000,  NULL, 3, 3, 6, 6, 1},
+  {"IWRAM",   0x03000000, 0x00008000,  NULL, 1, 1, 1, 1, 1},
+  {"IO",      0x04000000, 0x00000400,  NULL, 1, 1, 1, 1, 1},
+  {"palette", 0x05000000, 0x00000400,  NULL, 1, 1, 2, 2, 1},
+  {"VRAM",    0x06000000, 0x00020000,  NULL, 1, 1, 2, 2, 1},
+  {"OAM",     0x07000000, 0x00000400,  NULL, 1, 1, 1, 1, 1},
+  {"ROM",     0x08000000, 0x02000000,  NULL, 5, 3, 8, 6, 0},
+  {"SRAM",    0x0E000000, 0x00010000,  NULL, 5, 5, 5, 5, 1},
+};
+
+// ROM wait states for WS0, WS1 and WS2, indexed by
+// (address >> 25) - 4.
+static int romN16[3], romS16[3];
+
+// Sets ROM and SRAM timings from WAITCNT.
+static void set_waitcnt(unsigned waitcnt) {
+  static const int firstAccess[4] = {4, 3, 2, 8};
+  static const int secondAccess[3][2] = {{2, 1}, {4, 1}, {8, 1}};
+  int i;
+  for (i = 0; i < 3; i++) {
+    romN16[i] = 1 + firstAccess[(waitcnt >> (2 + i * 3)) & 3];
+    romS16[i] = 1 + secondAccess[i][(waitcnt >> (4 + i * 3)) & 1];
+  }
+  regions[REGION_ROM].n16 = romN16[0];
+  regions[REGION_ROM].s16 = romS16[0];
+  regions[REGION_SRAM].n16 = regions[REGION_SRAM].s16 = 1 + firstAccess[waitcnt & 3];
+  regions[REGION_SRAM].n32 = regions[REGION_SRAM].s32 = regions[REGION_SRAM].n16;
+}
+
+static void fatal(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  fprintf(stderr, "thumbsim: ");
+  vfprintf(stderr, format, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+  exit(2);
+}
+
+static Region* region_at(uint32_t address) {
+  switch (address >> 24) {
+    case 0x00: return address < 0x4000 ? &regions[REGION_BIOS] : NULL;
+    case 0x02: return &regions[REGION_EWRAM];
+    case 0x03: return &regions[REGION_IWRAM];
+    case 0x04: return address < 0x04000400 ? &regions[REGION_IO] : NULL;
+    case 0x05: return &regions[REGION_PALETTE];
+    case 0x06: return &regions[REGION_VRAM];
+    case 0x07: return &regions[REGION_OAM];
+    case 0x08: case 0x09: case 0x0A: case 0x0B: case 0x0C: case 0x0D:
+      return &regions[REGION_ROM];
+    case 0x0E: return &regions[REGION_SRAM];
+    default: return NULL;
+  }
+}
+
+static uint8_t* host_pointer(uint32_t address, uint32_t length) {
+  Region* region = region_at(address);
+  uint32_t offset;
+  if (!region)
+    return NULL;
+  offset = (address - region->base) & (region->size - 1);
+  if (region == &regions[REGION_VRAM])
+    offset = (address - region->base) & 0x1FFFF;
+  if (offset + length > region->size)
+    return NULL;
+  return region->data + offset;
+}
+
+// Cycles taken by one access of `width` bytes.
+static int access_cycles(uint32_t address, int width, int sequential) {
+  Region* region = region_at(address);
+  if (!region)
+    return 1;
+  if (region == &regions[REGION_ROM]) {
+    int ws = ((address >> 25) & 7) - 4;
+    int n16 = romN16[ws], s16 = romS16[ws];
+    if (width == 4)
+      return (sequential ? s16 : n16) + s16;
+    return sequential ? s16 : n16;
+  }
+  if (width == 4)
+    return sequential ? region->s32 : region->n32;
+  return sequential ? region->s16 : region->n16;
+}
+
+// CPU state
+
+typedef struct {
+  uint32_t r[16];
+  uint32_t pc;       // Address of the current instruction
+  int n, z, c, v;
+  int thumb;
+  int branched;      // Set when the current instruction wrote pc
+  uint64_t cycles;
+  uint64_t instructions;
+} Cpu;
+
+static Cpu cpu;
+
+static int traceEnabled;
+
+// Timers
+
+enum {
+  TIMER_CASCADE = 0x0004,
+  TIMER_ENABLE  = 0x0080,
+
+  TIMER_FIRST = 0x04000100,
+  TIMER_LAST  = 0x0400010F,
+};
+
+typedef struct {
+  uint16_t reload;
+  uint16_t control;
+  uint16_t counter;  // Value when stopped or enabled
+  uint64_t started;  // Cycle count, or the previous timer's
+                     // overflow count when cascading
+} Timer;
+
+static Timer timers[4];
+
+static uint64_t timer_overflows(int index);
+
+// Ticks of timer `index` since it was enabled
+static uint64_t timer_ticks(int index) {
+  static const int prescaler[4] = {0, 6, 8, 10};
+  const Timer* timer = &timers[index];
+  if ((timer->control & TIMER_CASCADE) && index > 0)
+    return timer_overflows(index - 1) - timer->started;
+  return (cpu.cycles - timer->started) >> prescaler[timer->control & 3];
+}
+
+static uint64_t timer_overflows(int index) {
+  const Timer* timer = &timers[index];
+  uint64_t ticks;
+  if (!(timer->control & TIMER_ENABLE))
+    return 0;
+  ticks = timer_ticks(index);
+  if (ticks < 0x10000u - timer->counter)
+    return 0;
+  return 1 + (ticks - (0x10000u - timer->counter)) / (0x10000u - timer->reload);
+}
+
+static uint16_t timer_counter(int index) {
+  const Timer* timer = &timers[index];
+  uint64_t ticks;
+  if (!(timer->control & TIMER_ENABLE))
+    return timer->counter;
+  ticks = timer_ticks(index);
+  if (ticks < 0x10000u - timer->counter)
+    return (uint16_t)(timer->counter + ticks);
+  ticks -= 0x10000u - timer->counter;
+  return (uint16_t)(timer->reload + ticks % (0x10000u - timer->reload));
+}
+
+// Applies a byte written to the timer registers.
+static void timer_write(uint32_t address, uint8_t value) {
+  int index = (address >> 2) & 3, shift = (address & 1) * 8;
+  Timer* timer = &timers[index];
+  uint16_t control;
+
+  if (!(address & 2)) {
+    timer->reload = (uint16_t)((timer->reload & ~(0xFF << shift)) | (value << shift));
+    return;
+  }
+
+  control = (uint16_t)((timer->control & ~(0xFF << shift)) | (value << shift));
+  if ((control ^ timer->control) & (TIMER_ENABLE | TIMER_CASCADE | 3)) {
+    // Keep the current value, or start over from the reload
+    // value when enabled
+    timer->counter = (control & TIMER_ENABLE) && !(timer->control & TIMER_ENABLE) ? timer->reload : timer_counter(index);
+    if ((control & TIMER_CASCADE) && index > 0)
+      timer->started = timer_overflows(index - 1);
+    else
+      timer->started = cpu.cycles;
+  }
+  timer->control = control;
+}
+
+// Reads a register as an operand of the current instruction.
+static uint32_t reg(int index) {
+  if (index == 15)
+    return cpu.pc + (cpu.thumb ? 4 : 8);
+  return cpu.r[index];
+}
+
+static void branch_to(uint32_t target) {
+  cpu.r[15] = target & (cpu.thumb ? ~1u : ~3u);
+  cpu.branched = 1;
+}
+
+static void write_reg(int index, uint32_t value) {
+  if (index == 15)
+    branch_to(value);
+  else
+    cpu.r[index] = value;
+}
+
+// Branch and exchange
+static void branch_exchange(uint32_t target) {
+  cpu.thumb = target & 1;
+  branch_to(target);
+}
+
+static uint32_t cpsr(void) {
+  return ((uint32_t)cpu.n << 31) | ((uint32_t)cpu.z << 30) | ((uint32_t)cpu.c << 29) | ((uint32_t)cpu.v << 28) | (cpu.thumb << 5) | 0x1F;
+}
+
+// Memory access
+
+static uint32_t memory_read(uint32_t address, int width) {
+  uint32_t aligned = address & ~(uint32_t)(width - 1);
+  uint8_t* p = host_pointer(aligned, width);
+  uint32_t value;
+  if (!p)
+    fatal("read of %d bytes from unmapped address 0x%08X at pc 0x%08X", width, address, cpu.pc);
+  if (aligned >= TIMER_FIRST && aligned <= TIMER_LAST) {
+    int i;
+    for (i = 0; i < 4; i++) {
+      uint8_t* timer = host_pointer(TIMER_FIRST + 4 * i, 4);
+      uint16_t counter = timer_counter(i);
+      timer[0] = (uint8_t)counter;
+      timer[1] = (uint8_t)(counter >> 8);
+      timer[2] = (uint8_t)timers[i].control;
+      timer[3] = (uint8_t)(timers[i].control >> 8);
+    }
+  }
+  if (width == 1)
+    return p[0];
+  if (width == 2)
+    value = elf_read16(p);
+  else
+    value = elf_read32(p);
+  // Misaligned loads rotate the aligned value
+  if (address & (width - 1)) {
+    int rotate = (address & (width - 1)) * 8;
+    value = (value >> rotate) | (value << (32 - rotate));
+  }
+  return value;
+}
+
+static void memory_write(uint32_t address, int width, uint32_t value) {
+  uint32_t aligned = address & ~(uint32_t)(width - 1);
+  Region* region = region_at(aligned);
+  uint8_t* p = host_pointer(aligned, width);
+  int i;
+  if (!p)
+    fatal("write of %d bytes to unmapped address 0x%08X at pc 0x%08X", width, address, cpu.pc);
+  if (!region->writable)
+    fatal("write to %s address 0x%08X at pc 0x%08X", region->name, address, cpu.pc);
+  for (i = 0; i < width; i++) {
+    p[i] = (uint8_t)(value >> (i * 8));
+    if (aligned + i >= TIMER_FIRST && aligned + i <= TIMER_LAST)
+      timer_write(aligned + i, p[i]);
+  }
+}
+
+// Cycle accounting
+
+static int fetch_width(void) {
+  return cpu.thumb ? 2 : 4;
+}
+
+// Sequential fetch of the current instruction
+static void cycles_fetch(void) {
+  cpu.cycles += access_cycles(cpu.pc, fetch_width(), 1);
+}
+
+// Nonsequential fetch, after a data write
+static void cycles_fetch_nonsequential(void) {
+  cpu.cycles += access_cycles(cpu.pc, fetch_width(), 0) - access_cycles(cpu.pc, fetch_width(), 1);
+}
+
+static void cycles_data(uint32_t address, int width, int sequential) {
+  cpu.cycles += access_cycles(address, width, sequential);
+}
+
+// Pipeline refill after pc was written
+static void cycles_refill(void) {
+  uint32_t target = cpu.r[15];
+  int width = fetch_width();
+  cpu.cycles += access_cycles(target, width, 0) + access_cycles(target + width, width, 1);
+}
+
+// Internal cycles of a multiply by `multiplier`
+static int multiply_cycles(uint32_t multiplier, int isSigned) {
+  if ((multiplier >> 8) == 0 || (isSigned && (multiplier >> 8) == 0xFFFFFF))
+    return 1;
+  if ((multiplier >> 16) == 0 || (isSigned && (multiplier >> 16) == 0xFFFF))
+    return 2;
+  if ((multiplier >> 24) == 0 || (isSigned && (multiplier >> 24) == 0xFF))
+    return 3;
+  return 4;
+}
+
+// ALU helpers
+
+static void set_nz(uint32_t value) {
+  cpu.n = value >> 31;
+  cpu.z = value == 0;
+}
+
+static uint32_t add_with_carry(uint32_t a, uint32_t b, uint32_t carry, int setFlags) {
+  uint64_t wide = (uint64_t)a + b + carry;
+  uint32_t result = (uint32_t)wide;
+  if (setFlags) {
+    set_nz(result);
+    cpu.c = (int)(wide >> 32);
+    cpu.v = (int)((~(a ^ b) & (a ^ result)) >> 31);
+  }
+  return result;
+}
+
+enum {
+  SHIFT_LSL,
+  SHIFT_LSR,
+  SHIFT_ASR,
+  SHIFT_ROR,
+};
+
+// Barrel shifter. `immediate` selects the immediate shift
+// encodings, where an amount of 0 means LSR/ASR #32 or RRX.
+static uint32_t barrel_shift(int type, uint32_t value, uint32_t amount, int* carry, int immediate) {
+  if (immediate && amount == 0) {
+    switch (type) {
+      case SHIFT_LSL: return value;
+      case SHIFT_LSR: amount = 32; break;
+      case SHIFT_ASR: amount = 32; break;
+      case SHIFT_ROR: {
+        uint32_t result = ((uint32_t)*carry << 31) | (value >> 1);
+        *carry = value & 1;
+        return result;
+      }
+    }
+  }
+  if (amount == 0)
+    return value;
+  switch (type) {
+    case SHIFT_LSL:
+      if (amount > 32) { *carry = 0; return 0; }
+      *carry = (value >> (32 - amount)) & 1;
+      return amount == 32 ? 0 : value << amount;
+    case SHIFT_LSR:
+      if (amount > 32) { *carry = 0; return 0; }
+      *carry = (value >> (amount - 1)) & 1;
+      return amount == 32 ? 0 : value >> amount;
+    case SHIFT_ASR:
+      if (amount >= 32) { *carry = value >> 31; return (value >> 31) ? 0xFFFFFFFF : 0; }
+      *carry = (value >> (amount - 1)) & 1;
+      return (uint32_t)((int32_t)value >> amount);
+    default:
+      amount &= 31;
+      if (amount == 0) { *carry = value >> 31; return value; }
+      *carry = (value >> (amount - 1)) & 1;
+      return (value >> amount) | (value << (32 - amount));
+  }
+}
+
+static int condition_passed(int condition) {
+  switch (condition) {
+    case 0x0: return cpu.z;
+    case 0x1: return !cpu.z;
+    case 0x2: return cpu.c;
+    case 0x3: return !cpu.c;
+    case 0x4: return cpu.n;
+    case 0x5: return !cpu.n;
+    case 0x6: return cpu.v;
+    case 0x7: return !cpu.v;
+    case 0x8: return cpu.c && !cpu.z;
+    case 0x9: return !cpu.c || cpu.z;
+    case 0xA: return cpu.n == cpu.v;
+    case 0xB: return cpu.n != cpu.v;
+    case 0xC: return !cpu.z && cpu.n == cpu.v;
+    case 0xD: return cpu.z || cpu.n != cpu.v;
+    case 0xE: return 1;
+    default: return 0;
+  }
+}
+
+// Data processing shared by both states. Returns the result
+// and whether it should be written to the destination.
+static uint32_t data_processing(int opcode, uint32_t a, uint32_t b, int shifterCarry, int setFlags, int* write) {
+  uint32_t result = 0;
+  *write = 1;
+  switch (opcode) {
+    case 0x0: result = a & b; break;
+    case 0x1: result = a ^ b; break;
+    case 0x2: return add_with_carry(a, ~b, 1, setFlags);
+    case 0x3: return add_with_carry(b, ~a, 1, setFlags);
+    case 0x4: return add_with_carry(a, b, 0, setFlags);
+    case 0x5: return add_with_carry(a, b, cpu.c, setFlags);
+    case 0x6: return add_with_carry(a, ~b, cpu.c, setFlags);
+    case 0x7: return add_with_carry(b, ~a, cpu.c, setFlags);
+    case 0x8: result = a & b; *write = 0; break;
+    case 0x9: result = a ^ b; *write = 0; break;
+    case 0xA: *write = 0; return add_with_carry(a, ~b, 1, setFlags);
+    case 0xB: *write = 0; return add_with_carry(a, b, 0, setFlags);
+    case 0xC: result = a | b; break;
+    case 0xD: result = b; break;
+    case 0xE: result = a & ~b; break;
+    case 0xF: result = ~b; break;
+  }
+  if (setFlags) {
+    set_nz(result);
+    cpu.c = shifterCarry;
+  }
+  return result;
+}
+
+// BIOS calls
+
+static uint32_t isqrt(uint32_t value) {
+  uint32_t result = 0, bit = 1u << 30;
+  while (bit > value)
+    bit >>= 2;
+  while (bit) {
+    if (value >= result + bit) {
+      value -= result + bit;
+      result = (result >> 1) + bit;
+    } else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return result;
+}
+
+static void bios_divide(int32_t numerator, int32_t denominator) {
+  int32_t quotient;
+  if (denominator == 0)
+    fatal("BIOS Div by zero at pc 0x%08X", cpu.pc);
+  quotient = numerator / denominator;
+  cpu.r[0] = (uint32_t)quotient;
+  cpu.r[1] = (uint32_t)(numerator % denominator);
+  cpu.r[3] = (uint32_t)(quotient < 0 ? -quotient : quotient);
+}
+
+static void bios_cpu_set(uint32_t source, uint32_t dest, uint32_t control, int fast) {
+  uint32_t count = control & 0x1FFFFF;
+  int fill = (control >> 24) & 1;
+  int width = (fast || ((control >> 26) & 1)) ? 4 : 2;
+  uint32_t i, value = memory_read(source, width);
+  if (fast)
+    count = (count + 7) & ~7u;
+  for (i = 0; i < count; i++) {
+    if (!fill)
+      value = memory_read(source + i * width, width);
+    memory_write(dest + i * width, width, value);
+  }
+}
+
+static void bios_call(int index) {
+  switch (index) {
+    case 0x06: bios_divide((int32_t)cpu.r[0], (int32_t)cpu.r[1]); break;
+    case 0x07: bios_divide((int32_t)cpu.r[1], (int32_t)cpu.r[0]); break;
+    case 0x08: cpu.r[0] = isqrt(cpu.r[0]); break;
+    case 0x0B: bios_cpu_set(cpu.r[0], cpu.r[1], cpu.r[2], 0); break;
+    case 0x0C: bios_cpu_set(cpu.r[0], cpu.r[1], cpu.r[2], 1); break;
+    default: fatal("unsupported BIOS call 0x%02X at pc 0x%08X", index, cpu.pc);
+  }
+  // The swi enters the BIOS vector and returns to the
+  // following instruction.
+  cpu.cycles += 2;
+  branch_to(cpu.pc + fetch_width());
+}
+
+// THUMB state
+
+static void thumb_load_store_multiple(int load, uint32_t* base, int list, int extra, int extraIndex) {
+  uint32_t address = *base;
+  int i, first = 1;
+  for (i = 0; i < 16; i++) {
+    if (!((list >> i) & 1) && !(extra && i == extraIndex))
+      continue;
+    if (load)
+      write_reg(i, memory_read(address, 4));
+    else
+      memory_write(address, 4, reg(i));
+    cycles_data(address, 4, !first);
+    first = 0;
+    address += 4;
+  }
+  *base = address;
+  if (load)
+    cpu.cycles += 1;
+  else
+    cycles_fetch_nonsequential();
+}
+
+static void thumb_step(uint16_t op) {
+  int rd = op & 7, rs = (op >> 3) & 7;
+  int carry = cpu.c, write;
+  uint32_t address;
+
+  cycles_fetch();
+
+  switch (op >> 13) {
+    case 0:
+      if (((op >> 11) & 3) == 3) {
+        // Add/subtract
+        uint32_t operand = (op & 0x0400) ? (uint32_t)((op >> 6) & 7) : cpu.r[(op >> 6) & 7];
+        if (op & 0x0200)
+          cpu.r[rd] = add_with_carry(cpu.r[rs], ~operand, 1, 1);
+        else
+          cpu.r[rd] = add_with_carry(cpu.r[rs], operand, 0, 1);
+      } else {
+        // Move shifted register
+        cpu.r[rd] = barrel_shift((op >> 11) & 3, cpu.r[rs], (op >> 6) & 31, &carry, 1);
+        set_nz(cpu.r[rd]);
+        cpu.c = carry;
+      }
+      break;
+
+    case 1: {
+      // Move/compare/add/subtract immediate
+      int r = (op >> 8) & 7;
+      uint32_t immediate = op & 0xFF;
+      switch ((op >> 11) & 3) {
+        case 0: cpu.r[r] = immediate; set_nz(immediate); break;
+        case 1: add_with_carry(cpu.r[r], ~immediate, 1, 1); break;
+        case 2: cpu.r[r] = add_with_carry(cpu.r[r], immediate, 0, 1); break;
+        case 3: cpu.r[r] = add_with_carry(cpu.r[r], ~immediate, 1, 1); break;
+      }
+      break;
+    }
+
+    case 2:
+      if ((op >> 10) == 0x10) {
+        // ALU operations
+        uint32_t a = cpu.r[rd], b = cpu.r[rs];
+        switch ((op >> 6) & 0xF) {
+          case 0x0: cpu.r[rd] = data_processing(0x0, a, b, carry, 1, &write); break;
+          case 0x1: cpu.r[rd] = data_processing(0x1, a, b, carry, 1, &write); break;
+          case 0x2: case 0x3: case 0x4: case 0x7: {
+            static const int shifts[8] = {0, 0, SHIFT_LSL, SHIFT_LSR, SHIFT_ASR, 0, 0, SHIFT_ROR};
+            cpu.r[rd] = barrel_shift(shifts[(op >> 6) & 7], a, b & 0xFF, &carry, 0);
+            set_nz(cpu.r[rd]);
+            cpu.c = carry;
+            cpu.cycles += 1;
+            break;
+          }
+          case 0x5: cpu.r[rd] = add_with_carry(a, b, cpu.c, 1); break;
+          case 0x6: cpu.r[rd] = add_with_carry(a, ~b, cpu.c, 1); break;
+          case 0x8: data_processing(0x8, a, b, carry, 1, &write); break;
+          case 0x9: cpu.r[rd] = add_with_carry(0, ~b, 1, 1); break;
+          case 0xA: add_with_carry(a, ~b, 1, 1); break;
+          case 0xB: add_with_carry(a, b, 0, 1); break;
+          case 0xC: cpu.r[rd] = data_processing(0xC, a, b, carry, 1, &write); break;
+          case 0xD:
+            cpu.cycles += multiply_cycles(a, 1);
+            cpu.r[rd] = a * b;
+            set_nz(cpu.r[rd]);
+            break;
+          case 0xE: cpu.r[rd] = data_processing(0xE, a, b, carry, 1, &write); break;
+          case 0xF: cpu.r[rd] = data_processing(0xF, a, b, carry, 1, &write); break;
+        }
+      } else if ((op >> 10) == 0x11) {
+        // Hi register operations/branch exchange
+        int d = rd | ((op >> 4) & 8), s = rs | ((op >> 3) & 8);
+        switch ((op >> 8) & 3) {
+          case 0: write_reg(d, reg(d) + reg(s)); break;
+          case 1: add_with_carry(reg(d), ~reg(s), 1, 1); break;
+          case 2: write_reg(d, reg(s)); break;
+          case 3: branch_exchange(reg(s)); break;
+        }
+      } else if ((op >> 11) == 9) {
+        // PC-relative load
+        address = ((cpu.pc + 4) & ~2u) + (op & 0xFF) * 4;
+        cpu.r[(op >> 8) & 7] = memory_read(address, 4);
+        cycles_data(address, 4, 0);
+        cpu.cycles += 1;
+      } else {
+        // Load/store with register offset, sign-extended
+        // byte/halfword
+        int ro = (op >> 6) & 7;
+        address = cpu.r[rs] + cpu.r[ro];
+        if (op & 0x0200) {
+          switch ((op >> 10) & 3) {
+            case 0: memory_write(address, 2, cpu.r[rd]); break;
+            case 1: cpu.r[rd] = (uint32_t)(int32_t)(int8_t)memory_read(address, 1); break;
+            case 2: cpu.r[rd] = memory_read(address, 2); break;
+            case 3: cpu.r[rd] = (address & 1) ? (uint32_t)(int32_t)(int8_t)memory_read(address, 1) : (uint32_t)(int32_t)(int16_t)memory_read(address, 2); break;
+          }
+          cycles_data(address, ((op >> 10) & 3) == 1 ? 1 : 2, 0);
+          if (((op >> 10) & 3) == 0)
+            cycles_fetch_nonsequential();
+          else
+            cpu.cycles += 1;
+        } else {
+          int width = (op & 0x0400) ? 1 : 4;
+          if (op & 0x0800) {
+            cpu.r[rd] = memory_read(address, width);
+            cpu.cycles += 1;
+          } else {
+            memory_write(address, width, cpu.r[rd]);
+            cycles_fetch_nonsequential();
+          }
+          cycles_data(address, width, 0);
+        }
+      }
+      break;
+
+    case 3: {
+      // Load/store with immediate offset
+      int width = (op & 0x1000) ? 1 : 4;
+      address = cpu.r[rs] + ((op >> 6) & 31) * width;
+      if (op & 0x0800) {
+        cpu.r[rd] = memory_read(address, width);
+        cpu.cycles += 1;
+      } else {
+        memory_write(address, width, cpu.r[rd]);
+        cycles_fetch_nonsequential();
+      }
+      cycles_data(address, width, 0);
+      break;
+    }
+
+    case 4:
+      if (!(op & 0x1000)) {
+        // Load/store halfword
+        address = cpu.r[rs] + ((op >> 6) & 31) * 2;
+        if (op & 0x0800) {
+          cpu.r[rd] = memory_read(address, 2);
+          cpu.cycles += 1;
+        } else {
+          memory_write(address, 2, cpu.r[rd]);
+          cycles_fetch_nonsequential();
+        }
+        cycles_data(address, 2, 0);
+      } else {
+        // SP-relative load/store
+        int r = (op >> 8) & 7;
+        address = cpu.r[13] + (op & 0xFF) * 4;
+        if (op & 0x0800) {
+          cpu.r[r] = memory_read(address, 4);
+          cpu.cycles += 1;
+        } else {
+          memory_write(address, 4, cpu.r[r]);
+          cycles_fetch_nonsequential();
+        }
+        cycles_data(address, 4, 0);
+      }
+      break;
+
+    case 5:
+      if (!(op & 0x1000)) {
+        // Load address
+        uint32_t base = (op & 0x0800) ? cpu.r[13] : ((cpu.pc + 4) & ~2u);
+        cpu.r[(op >> 8) & 7] = base + (op & 0xFF) * 4;
+      } else if (((op >> 8) & 0xF) == 0) {
+        // Add offset to stack pointer
+        uint32_t offset = (op & 0x7F) * 4;
+        cpu.r[13] = (op & 0x80) ? cpu.r[13] - offset : cpu.r[13] + offset;
+      } else if ((op & 0x0600) == 0x0400) {
+        // Push/pop registers
+        int count = 0, i;
+        for (i = 0; i < 8; i++)
+          count += (op >> i) & 1;
+        count += (op >> 8) & 1;
+        if (op & 0x0800) {
+          thumb_load_store_multiple(1, &cpu.r[13], op & 0xFF, (op >> 8) & 1, 15);
+        } else {
+          uint32_t base = cpu.r[13] - count * 4;
+          cpu.r[13] = base;
+          thumb_load_store_multiple(0, &base, op & 0xFF, (op >> 8) & 1, 14);
+        }
+      } else {
+        fatal("undefined THUMB instruction 0x%04X at 0x%08X", op, cpu.pc);
+      }
+      break;
+
+    case 6:
+      if (!(op & 0x1000)) {
+        // Multiple load/store
+        int base = (op >> 8) & 7;
+        uint32_t address = cpu.r[base];
+        int inList = (op >> base) & 1;
+        thumb_load_store_multiple((op >> 11) & 1, &address, op & 0xFF, 0, 0);
+        if (!((op & 0x0800) && inList))
+          cpu.r[base] = address;
+      } else if (((op >> 8) & 0xF) == 0xF) {
+        bios_call(op & 0xFF);
+      } else if (((op >> 8) & 0xF) == 0xE) {
+        fatal("undefined THUMB instruction 0x%04X at 0x%08X", op, cpu.pc);
+      } else if (condition_passed((op >> 8) & 0xF)) {
+        // Conditional branch
+        branch_to(cpu.pc + 4 + (uint32_t)((int32_t)(int8_t)(op & 0xFF) * 2));
+      }
+      break;
+
+    case 7:
+      switch ((op >> 11) & 3) {
+        case 0:
+          // Unconditional branch
+          branch_to(cpu.pc + 4 + (uint32_t)(((int32_t)(op << 21) >> 21) * 2));
+          break;
+        case 2:
+          // Long branch with link, high half
+          cpu.r[14] = cpu.pc + 4 + (uint32_t)(((int32_t)(op << 21) >> 21) << 12);
+          break;
+        case 3: {
+          // Long branch with link, low half
+          uint32_t target = cpu.r[14] + (op & 0x7FF) * 2;
+          cpu.r[14] = (cpu.pc + 2) | 1;
+          branch_to(target);
+          break;
+        }
+        default:
+          fatal("undefined THUMB instruction 0x%04X at 0x%08X", op, cpu.pc);
+      }
+      break;
+  }
+}
+
+// ARM state
+
+static void arm_data_processing(uint32_t op) {
+  int opcode = (op >> 21) & 0xF, setFlags = (op >> 20) & 1;
+  int rn = (op >> 16) & 0xF, rd = (op >> 12) & 0xF;
+  int carry = cpu.c, write;
+  uint32_t operand, a, result;
+
+  if (op & 0x02000000) {
+    uint32_t rotate = ((op >> 8) & 0xF) * 2;
+    operand = op & 0xFF;
+    if (rotate) {
+      operand = (operand >> rotate) | (operand << (32 - rotate));
+      carry = operand >> 31;
+    }
+    a = reg(rn);
+  } else if (op & 0x10) {
+    // Shift by register, pc reads 4 bytes further
+    uint32_t amount = cpu.r[(op >> 8) & 0xF] & 0xFF;
+    int rm = op & 0xF;
+    operand = barrel_shift((op >> 5) & 3, rm == 15 ? reg(15) + 4 : cpu.r[rm], amount, &carry, 0);
+    a = rn == 15 ? reg(15) + 4 : reg(rn);
+    cpu.cycles += 1;
+  } else {
+    operand = barrel_shift((op >> 5) & 3, reg(op & 0xF), (op >> 7) & 31, &carry, 1);
+    a = reg(rn);
+  }
+
+  result = data_processing(opcode, a, operand, carry, setFlags, &write);
+  if (write)
+    write_reg(rd, result);
+}
+
+static void arm_multiply(uint32_t op) {
+  int rd = (op >> 16) & 0xF, rn = (op >> 12) & 0xF, rs = (op >> 8) & 0xF, rm = op & 0xF;
+  int setFlags = (op >> 20) & 1;
+
+  if (op & 0x00800000) {
+    // Multiply long: rd is RdHi, rn is RdLo
+    int isSigned = (op >> 22) & 1, accumulate = (op >> 21) & 1;
+    uint64_t result;
+    if (isSigned)
+      result = (uint64_t)((int64_t)(int32_t)cpu.r[rm] * (int32_t)cpu.r[rs]);
+    else
+      result = (uint64_t)cpu.r[rm] * cpu.r[rs];
+    if (accumulate)
+      result += ((uint64_t)cpu.r[rd] << 32) | cpu.r[rn];
+    cpu.r[rn] = (uint32_t)result;
+    cpu.r[rd] = (uint32_t)(result >> 32);
+    if (setFlags) {
+      cpu.n = (int)(result >> 63);
+      cpu.z = result == 0;
+    }
+    cpu.cycles += multiply_cycles(cpu.r[rs], isSigned) + 1 + accumulate;
+  } else {
+    uint32_t result = cpu.r[rm] * cpu.r[rs];
+    int accumulate = (op >> 21) & 1;
+    if (accumulate)
+      result += cpu.r[rn];
+    cpu.r[rd] = result;
+    if (setFlags)
+      set_nz(result);
+    cpu.cycles += multiply_cycles(cpu.r[rs], 1) + accumulate;
+  }
+}
+
+static void arm_single_transfer(uint32_t op) {
+  int pre = (op >> 24) & 1, up = (op >> 23) & 1, writeback = (op >> 21) & 1, load = (op >> 20) & 1;
+  int rn = (op >> 16) & 0xF, rd = (op >> 12) & 0xF;
+  int halfword = !((op >> 26) & 1);
+  int width;
+  uint32_t offset, base = reg(rn), address;
+
+  if (halfword) {
+    int sh = (op >> 5) & 3;
+    offset = (op & 0x00400000) ? (((op >> 4) & 0xF0) | (op & 0xF)) : cpu.r[op & 0xF];
+    width = sh == 2 ? 1 : 2;
+    address = pre ? (up ? base + offset : base - offset) : base;
+    if (load) {
+      uint32_t value;
+      if (sh == 1)
+        value = memory_read(address, 2);
+      else if (sh == 2)
+        value = (uint32_t)(int32_t)(int8_t)memory_read(address, 1);
+      else
+        value = (address & 1) ? (uint32_t)(int32_t)(int8_t)memory_read(address, 1) : (uint32_t)(int32_t)(int16_t)memory_read(address, 2);
+      if (!pre || writeback)
+        cpu.r[rn] = up ? base + offset : base - offset;
+      write_reg(rd, value);
+    } else {
+      memory_write(address, 2, reg(rd) + (rd == 15 ? 4 : 0));
+      if (!pre || writeback)
+        write_reg(rn, up ? base + offset : base - offset);
+    }
+  } else {
+    int carry = cpu.c;
+    if (op & 0x02000000)
+      offset = barrel_shift((op >> 5) & 3, reg(op & 0xF), (op >> 7) & 31, &carry, 1);
+    else
+      offset = op & 0xFFF;
+    width = (op & 0x00400000) ? 1 : 4;
+    address = pre ? (up ? base + offset : base - offset) : base;
+    if (load) {
+      uint32_t value = memory_read(address, width);
+      if (!pre || writeback)
+        cpu.r[rn] = up ? base + offset : base - offset;
+      write_reg(rd, value);
+    } else {
+      memory_write(address, width, reg(rd) + (rd == 15 ? 4 : 0));
+      if (!pre || writeback)
+        write_reg(rn, up ? base + offset : base - offset);
+    }
+  }
+
+  cycles_data(address, width, 0);
+  if (load)
+    cpu.cycles += 1;
+  else
+    cycles_fetch_nonsequential();
+}
+
+static void arm_block_transfer(uint32_t op) {
+  int pre = (op >> 24) & 1, up = (op >> 23) & 1, writeback = (op >> 21) & 1, load = (op >> 20) & 1;
+  int rn = (op >> 16) & 0xF, list = op & 0xFFFF;
+  int count = 0, i, first = 1;
+  uint32_t base = cpu.r[rn], address, final;
+
+  for (i = 0; i < 16; i++)
+    count += (list >> i) & 1;
+
+  // Transfers always go upwards through memory
+  if (up) {
+    address = pre ? base + 4 : base;
+    final = base + count * 4;
+  } else {
+    address = pre ? base - count * 4 : base - count * 4 + 4;
+    final = base - count * 4;
+  }
+
+  if (writeback && !(load && ((list >> rn) & 1)))
+    cpu.r[rn] = final;
+
+  for (i = 0; i < 16; i++) {
+    if (!((list >> i) & 1))
+      continue;
+    if (load)
+      write_reg(i, memory_read(address, 4));
+    else
+      memory_write(address, 4, i == 15 ? reg(15) + 4 : (i == rn && !first ? final : cpu.r[i]));
+    cycles_data(address, 4, !first);
+    first = 0;
+    address += 4;
+  }
+
+  if (load)
+    cpu.cycles += 1;
+  else
+    cycles_fetch_nonsequential();
+}
+
+static void arm_step(uint32_t op) {
+  cycles_fetch();
+
+  if (!condition_passed(op >> 28))
+    return;
+
+  if ((op & 0x0FFFFFF0) == 0x012FFF10) {
+    branch_exchange(reg(op & 0xF));
+  } else if ((op & 0x0FC000F0) == 0x00000090 || (op & 0x0F8000F0) == 0x00800090) {
+    arm_multiply(op);
+  } else if ((op & 0x0E000090) == 0x00000090 && (op & 0x60)) {
+    arm_single_transfer(op);
+  } else if ((op & 0x0FBF0FFF) == 0x010F0000) {
+    // MRS, only the CPSR is modelled
+    cpu.r[(op >> 12) & 0xF] = cpsr();
+  } else if ((op & 0x0DB0F000) == 0x0120F000) {
+    // MSR, only the CPSR flags are modelled
+    uint32_t value;
+    if (op & 0x02000000) {
+      uint32_t rotate = ((op >> 8) & 0xF) * 2;
+      value = ((op & 0xFF) >> rotate) | ((op & 0xFF) << ((32 - rotate) & 31));
+    } else {
+      value = cpu.r[op & 0xF];
+    }
+    if (!(op & 0x00400000) && (op & 0x00080000)) {
+      cpu.n = value >> 31;
+      cpu.z = (value >> 30) & 1;
+      cpu.c = (value >> 29) & 1;
+      cpu.v = (value >> 28) & 1;
+    }
+  } else if ((op & 0x0C000000) == 0x00000000) {
+    arm_data_processing(op);
+  } else if ((op & 0x0E000010) == 0x06000010) {
+    fatal("undefined ARM instruction 0x%08X at 0x%08X", op, cpu.pc);
+  } else if ((op & 0x0C000000) == 0x04000000) {
+    arm_single_transfer(op);
+  } else if ((op & 0x0E000000) == 0x08000000) {
+    arm_block_transfer(op);
+  } else if ((op & 0x0E000000) == 0x0A000000) {
+    if (op & 0x01000000)
+      cpu.r[14] = cpu.pc + 4;
+    branch_to(cpu.pc + 8 + (uint32_t)(((int32_t)(op << 8) >> 8) * 4));
+  } else if ((op & 0x0F000000) == 0x0F000000) {
+    bios_call((op >> 16) & 0xFF);
+  } else {
+    fatal("unsupported ARM instruction 0x%08X at 0x%08X", op, cpu.pc);
+  }
+}
+
+// Loading
+
+typedef struct {
+  const char* name;
+  uint32_t address;
+  int isFunction;    // Referenced by branches
+  int isStub;
+  int hasReturn;     // Stub sets r0 to `returnValue`
+  uint32_t returnValue;
+  unsigned calls;
+} Symbol;
+
+static Symbol* symbols;
+static int symbolCount, symbolCapacity;
+
+static ElfFile* objects;
+static uint32_t** sectionAddresses;
+static int objectCount;
+
+// Next free address of each region
+static uint32_t cursors[REGION_COUNT];
+
+static Symbol* find_symbol(const char* name) {
+  int i;
+  for (i = 0; i < symbolCount; i++)
+    if (!strcmp(symbols[i].name, name))
+      return &symbols[i];
+  return NULL;
+}
+
+static char* copy_string(const char* text) {
+  char* copy = (char*)malloc(strlen(text) + 1);
+  strcpy(copy, text);
+  return copy;
+}
+
+static Symbol* add_symbol(const char* name, uint32_t address) {
+  Symbol* symbol;
+  if (symbolCount == symbolCapacity) {
+    symbolCapacity = symbolCapacity ? symbolCapacity * 2 : 64;
+    symbols = (Symbol*)realloc(symbols, symbolCapacity * sizeof(Symbol));
+  }
+  symbol = &symbols[symbolCount++];
+  memset(symbol, 0, sizeof(*symbol));
+  symbol->name = name;
+  symbol->address = address;
+  return symbol;
+}
+
+static uint32_t allocate(int region, uint32_t size, uint32_t align) {
+  uint32_t address;
+  if (align < 1)
+    align = 1;
+  address = (cursors[region] + align - 1) & ~(align - 1);
+  if (address + size > regions[region].base + regions[region].size)
+    fatal("%s is full", regions[region].name);
+  cursors[region] = address + size;
+  return address;
+}
+
+static int starts_with(const char* text, const char* prefix) {
+  return !strncmp(text, prefix, strlen(prefix));
+}
+
+static int section_region(const char* name, int codeRegion) {
+  if (starts_with(name, ".iwram") || starts_with(name, ".data") || starts_with(name, ".bss"))
+    return REGION_IWRAM;
+  if (starts_with(name, ".ewram"))
+    return REGION_EWRAM;
+  return codeRegion;
+}
+
+static int is_branch_relocation(int type) {
+  return type == ELF_R_ARM_THM_CALL || type == ELF_R_ARM_THM_JUMP11 || type == ELF_R_ARM_THM_JUMP8
+    || type == ELF_R_ARM_CALL || type == ELF_R_ARM_JUMP24 || type == ELF_R_ARM_PC24;
+}
+
+static void layout_sections(int codeRegion) {
+  int o, i;
+  for (o = 0; o < objectCount; o++) {
+    const ElfFile* elf = &objects[o];
+    sectionAddresses[o] = (uint32_t*)calloc(elf->sectionCount ? elf->sectionCount : 1, sizeof(uint32_t));
+    for (i = 0; i < elf->sectionCount; i++) {
+      const ElfSection* section = &elf->sections[i];
+      int region;
+      if (!(section->flags & ELF_SHF_ALLOC) || section->size == 0)
+        continue;
+      region = section_region(section->name, codeRegion);
+      sectionAddresses[o][i] = allocate(region, section->size, section->addralign);
+      if (section->type != ELF_SHT_NOBITS)
+        memcpy(host_pointer(sectionAddresses[o][i], section->size), elf_section_data(elf, i), section->size);
+    }
+  }
+}
+
+// Address of symbol `index` of object `o`, or 0 with
+// `*defined` cleared if it is undefined.
+static uint32_t symbol_address(int o, uint32_t index, int* defined) {
+  const ElfSymbol* symbol = &objects[o].symbols[index];
+  *defined = 1;
+  if (symbol->shndx == ELF_SHN_ABS)
+    return symbol->value;
+  if (symbol->shndx != ELF_SHN_UNDEF && symbol->shndx < objects[o].sectionCount)
+    return sectionAddresses[o][symbol->shndx] + symbol->value;
+  *defined = 0;
+  return 0;
+}
+
+static void collect_symbols(void) {
+  int o, i;
+  for (o = 0; o < objectCount; o++) {
+    const ElfFile* elf = &objects[o];
+    for (i = 1; i < elf->symbolCount; i++) {
+      const ElfSymbol* symbol = &elf->symbols[i];
+      int defined;
+      uint32_t address;
+      if (symbol->bind == ELF_STB_LOCAL || !symbol->name[0])
+        continue;
+      if (symbol->shndx == ELF_SHN_COMMON) {
+        if (!find_symbol(symbol->name))
+          add_symbol(symbol->name, allocate(REGION_IWRAM, symbol->size, symbol->value));
+        continue;
+      }
+      address = symbol_address(o, (uint32_t)i, &defined);
+      if (!defined)
+        continue;
+      if (find_symbol(symbol->name))
+        fatal("%s: %s is defined more than once", elf->path, symbol->name);
+      add_symbol(symbol->name, address)->isFunction = symbol->type == ELF_STT_FUNC;
+    }
+  }
+}
+
+// Creates stubs for every symbol that is still undefined.
+static void create_stubs(int codeRegion) {
+  int o, i;
+  uint32_t j;
+
+  // Find out which undefined symbols are called
+  for (o = 0; o < objectCount; o++) {
+    const ElfFile* elf = &objects[o];
+    for (i = 0; i < elf->sectionCount; i++) {
+      const ElfSection* rel = &elf->sections[i];
+      const uint8_t* entries;
+      if (rel->type != ELF_SHT_REL || !sectionAddresses[o][rel->info])
+        continue;
+      entries = elf_section_data(elf, i);
+      for (j = 0; j < rel->size / 8; j++) {
+        uint32_t info = elf_read32(entries + j * 8 + 4);
+        const ElfSymbol* symbol = &elf->symbols[info >> 8];
+        Symbol* stub;
+        int defined;
+        if ((info >> 8) == 0 || (info >> 8) >= (uint32_t)elf->symbolCount)
+          continue;
+        symbol_address(o, info >> 8, &defined);
+        if (defined)
+          continue;
+        stub = find_symbol(symbol->name);
+        if (!stub) {
+          stub = add_symbol(symbol->name, 0);
+          stub->isStub = 1;
+        }
+        if (stub->isStub && is_branch_relocation((int)(info & 0xFF)))
+          stub->isFunction = 1;
+      }
+    }
+  }
+
+  // Stubbed functions get a THUMB `bx lr` close to the code,
+  // so that short branches can reach them, and data gets a
+  // zeroed block.
+  for (i = 0; i < symbolCount; i++) {
+    Symbol* symbol = &symbols[i];
+    uint8_t* code;
+    if (!symbol->isStub || symbol->address)
+      continue;
+    if (symbol->isFunction || symbol->hasReturn) {
+      symbol->address = allocate(codeRegion, 4, 4);
+      code = host_pointer(symbol->address, 4);
+      code[0] = 0x70; code[1] = 0x47;  // bx lr
+      code[2] = 0xC0; code[3] = 0x46;  // nop
+      symbol->address |= 1;
+      symbol->isFunction = 1;
+    } else {
+      symbol->address = allocate(REGION_EWRAM, 64, 4);
+    }
+  }
+}
+
+static void write16(uint8_t* p, uint32_t value) {
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+}
+
+static void write32(uint8_t* p, uint32_t value) {
+  write16(p, value);
+  write16(p + 2, value >> 16);
+}
+
+static int32_t sign_extend(uint32_t value, int bits) {
+  return (int32_t)(value << (32 - bits)) >> (32 - bits);
+}
+
+static void relocate(int o, int section, uint32_t offset, int type, uint32_t S, const char* name) {
+  const ElfFile* elf = &objects[o];
+  uint32_t P = sectionAddresses[o][section] + offset;
+  uint8_t* p = host_pointer(P, 4);
+  int32_t A, value;
+
+  switch (type) {
+    case ELF_R_ARM_NONE:
+    case ELF_R_ARM_V4BX:
+      break;
+
+    case ELF_R_ARM_ABS32:
+      write32(p, S + elf_read32(p));
+      break;
+
+    case ELF_R_ARM_REL32:
+      write32(p, S + elf_read32(p) - P);
+      break;
+
+    case ELF_R_ARM_THM_CALL: {
+      uint32_t high = elf_read16(p), low = elf_read16(p + 2);
+      A = sign_extend(((high & 0x7FF) << 12) | ((low & 0x7FF) << 1), 23);
+      if (!(S & 1))
+        fatal("%s: THUMB call to ARM function %s needs a veneer", elf->path, name);
+      value = (int32_t)((S & ~1u) + A - P);
+      if (value < -0x400000 || value >= 0x400000)
+        fatal("%s: call to %s is out of range, see THUMBLIB_IWRAM_VENEER", elf->path, name);
+      write16(p, (high & 0xF800) | ((value >> 12) & 0x7FF));
+      write16(p + 2, (low & 0xF800) | ((value >> 1) & 0x7FF));
+      break;
+    }
+
+    case ELF_R_ARM_THM_JUMP11: {
+      uint32_t insn = elf_read16(p);
+      A = sign_extend((insn & 0x7FF) << 1, 12);
+      value = (int32_t)((S & ~1u) + A - P);
+      if (value < -0x800 || value >= 0x800)
+        fatal("%s: branch to %s is out of range", elf->path, name);
+      write16(p, (insn & 0xF800) | ((value >> 1) & 0x7FF));
+      break;
+    }
+
+    case ELF_R_ARM_THM_JUMP8: {
+      uint32_t insn = elf_read16(p);
+      A = sign_extend((insn & 0xFF) << 1, 9);
+      value = (int32_t)((S & ~1u) + A - P);
+      if (value < -0x100 || value >= 0x100)
+        fatal("%s: branch to %s is out of range", elf->path, name);
+      write16(p, (insn & 0xFF00) | ((value >> 1) & 0xFF));
+      break;
+    }
+
+    case ELF_R_ARM_PC24:
+    case ELF_R_ARM_CALL:
+    case ELF_R_ARM_JUMP24: {
+      uint32_t insn = elf_read32(p);
+      A = sign_extend((insn & 0xFFFFFF) << 2, 26);
+      if (S & 1)
+        fatal("%s: ARM branch to THUMB function %s needs a veneer", elf->path, name);
+      value = (int32_t)(S + A - P);
+      if (value < -0x2000000 || value >= 0x2000000)
+        fatal("%s: branch to %s is out of range", elf->path, name);
+      write32(p, (insn & 0xFF000000) | ((value >> 2) & 0xFFFFFF));
+      break;
+    }
+
+    default:
+      fatal("%s: unsupported relocation type %d against %s", elf->path, type, name);
+  }
+}
+
+static void apply_relocations(void) {
+  int o, i;
+  uint32_t j;
+  for (o = 0; o < objectCount; o++) {
+    const ElfFile* elf = &objects[o];
+    for (i = 0; i < elf->sectionCount; i++) {
+      const ElfSection* rel = &elf->sections[i];
+      const uint8_t* entries;
+      if (rel->type != ELF_SHT_REL || !sectionAddresses[o][rel->info])
+        continue;
+      entries = elf_section_data(elf, i);
+      for (j = 0; j < rel->size / 8; j++) {
+        uint32_t offset = elf_read32(entries + j * 8);
+        uint32_t info = elf_read32(entries + j * 8 + 4);
+        uint32_t index = info >> 8, S = 0;
+        const char* name = "";
+        int defined = 1;
+        if (index && index < (uint32_t)elf->symbolCount) {
+          const ElfSymbol* symbol = &elf->symbols[index];
+          name = symbol->name;
+          S = symbol_address(o, index, &defined);
+          if (!defined || symbol->shndx == ELF_SHN_COMMON)
+            S = find_symbol(name)->address;
+        }
+        relocate(o, (int)rel->info, offset, (int)(info & 0xFF), S, name);
+      }
+    }
+  }
+}
+
+// Finds a function by name, including local functions.
+static uint32_t find_function(const char* name) {
+  Symbol* symbol = find_symbol(name);
+  int o, i;
+  if (symbol)
+    return symbol->address;
+  for (o = 0; o < objectCount; o++) {
+    for (i = 1; i < objects[o].symbolCount; i++) {
+      const ElfSymbol* candidate = &objects[o].symbols[i];
+      int defined;
+      uint32_t address;
+      if (candidate->type != ELF_STT_FUNC || strcmp(candidate->name, name))
+        continue;
+      address = symbol_address(o, (uint32_t)i, &defined);
+      if (defined)
+        return address;
+    }
+  }
+  fatal("function %s not found", name);
+  return 0;
+}
+
+// Command line values
+
+// Parses a number or `symbol[+offset]`.
+static uint32_t parse_value(const char* text) {
+  char name[256];
+  const char* plus;
+  size_t length;
+  uint32_t offset = 0;
+  Symbol* symbol;
+
+  if ((text[0] >= '0' && text[0] <= '9') || text[0] == '-')
+    return (uint32_t)strtoul(text, NULL, 0);
+
+  plus = strchr(text, '+');
+  length = plus ? (size_t)(plus - text) : strlen(text);
+  if (length >= sizeof(name))
+    fatal("symbol name too long: %s", text);
+  memcpy(name, text, length);
+  name[length] = 0;
+  if (plus)
+    offset = (uint32_t)strtoul(plus + 1, NULL, 0);
+
+  symbol = find_symbol(name);
+  if (!symbol) {
+    int o, i;
+    for (o = 0; o < objectCount && !symbol; o++) {
+      for (i = 1; i < objects[o].symbolCount; i++) {
+        int defined;
+        uint32_t address;
+        if (strcmp(objects[o].symbols[i].name, name))
+          continue;
+        address = symbol_address(o, (uint32_t)i, &defined);
+        if (defined)
+          return address + offset;
+      }
+    }
+    fatal("unknown symbol %s", name);
+  }
+  return symbol->address + offset;
+}
+
+static int parse_register(const char* text) {
+  if (!strcmp(text, "sp")) return 13;
+  if (!strcmp(text, "lr")) return 14;
+  if (text[0] == 'r') {
+    char* end;
+    long index = strtol(text + 1, &end, 10);
+    if (!*end && index >= 0 && index <= 14)
+      return (int)index;
+  }
+  fatal("bad register %s", text);
+  return 0;
+}
+
+// Splits `KEY=VALUE` into its two halves.
+static const char* split(const char* option, char* key, size_t size) {
+  const char* equals = strchr(option, '=');
+  size_t length;
+  if (!equals)
+    fatal("expected KEY=VALUE, got %s", option);
+  length = (size_t)(equals - option);
+  if (length >= size)
+    fatal("key too long: %s", option);
+  memcpy(key, option, length);
+  key[length] = 0;
+  return equals + 1;
+}
+
+typedef struct {
+  char type;
+  const char* text;
+} Option;
+
+static void usage(void) {
+  fprintf(stderr, "usage: thumbsim [-c NAME] [-r REG=VALUE] [-s ADDR=TEXT] [-l ADDR=FILE] [-x NAME[=VALUE]]\n"
+                  "                [-D NAME=VALUE] [-p rom|ewram|iwram] [-w WAITCNT] [-e REG=VALUE]\n"
+                  "                [-E ADDR=TEXT] [-d ADDR=LENGTH] [-m FILE] [-L COUNT] [-t] [-v] file.o...\n");
+  exit(2);
+}
+
+static int region_by_name(const char* name) {
+  if (!strcmp(name, "rom")) return REGION_ROM;
+  if (!strcmp(name, "ewram")) return REGION_EWRAM;
+  if (!strcmp(name, "iwram")) return REGION_IWRAM;
+  fatal("unknown region '%s'", name);
+  return 0;
+}
+
+static void load_file(uint32_t address, const char* path) {
+  FILE* file = fopen(path, "rb");
+  long length;
+  uint8_t* p;
+  if (!file)
+    fatal("cannot open %s", path);
+  fseek(file, 0, SEEK_END);
+  length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  p = host_pointer(address, (uint32_t)length);
+  if (!p || fread(p, 1, (size_t)length, file) != (size_t)length)
+    fatal("cannot load %s at 0x%08X", path, address);
+  fclose(file);
+}
+
+static void save_file(const Region* region, const char* path) {
+  FILE* file = fopen(path, "wb");
+  if (!file || fwrite(region->data, 1, region->size, file) != region->size)
+    fatal("cannot write %s", path);
+  fclose(file);
+}
+
+static void write_string(uint32_t address, const char* text) {
+  uint32_t length = (uint32_t)strlen(text) + 1;
+  uint8_t* p = host_pointer(address, length);
+  if (!p)
+    fatal("cannot write string at 0x%08X", address);
+  memcpy(p, text, length);
+}
+
+// Running
+
+#define RETURN_ADDRESS 0xFFFFFFF0u
+#define STACK_TOP      0x03007F00u
+
+static void trace(uint32_t op) {
+  int i;
+  printf("%08X  %0*X  %6llu ", cpu.pc, cpu.thumb ? 4 : 8, op, (unsigned long long)cpu.cycles);
+  if (cpu.thumb)
+    printf("    ");
+  for (i = 0; i < 8; i++)
+    printf(" r%d=%08X", i, cpu.r[i]);
+  printf(" sp=%08X lr=%08X %c%c%c%c\n", cpu.r[13], cpu.r[14], cpu.n ? 'N' : '-', cpu.z ? 'Z' : '-', cpu.c ? 'C' : '-', cpu.v ? 'V' : '-');
+}
+
+static Symbol* stub_at(uint32_t address) {
+  int i;
+  for (i = 0; i < symbolCount; i++)
+    if (symbols[i].isStub && (symbols[i].address & ~1u) == address)
+      return &symbols[i];
+  return NULL;
+}
+
+static void run(uint32_t entry, uint64_t limit) {
+  cpu.r[13] = STACK_TOP;
+  cpu.r[14] = RETURN_ADDRESS | 1;
+  cpu.thumb = entry & 1;
+  cpu.r[15] = entry & ~1u;
+
+  // The call itself refills the pipeline
+  cpu.pc = cpu.r[15];
+  cycles_refill();
+
+  for (;;) {
+    uint32_t op;
+    Symbol* stub;
+
+    cpu.pc = cpu.r[15];
+    if ((cpu.pc & ~1u) == (RETURN_ADDRESS & ~1u))
+      break;
+
+    if (cpu.instructions >= limit)
+      fatal("instruction limit reached at pc 0x%08X", cpu.pc);
+
+    stub = stub_at(cpu.pc);
+    if (stub) {
+      stub->calls++;
+      if (stub->hasReturn)
+        cpu.r[0] = stub->returnValue;
+    }
+
+    op = cpu.thumb ? memory_read(cpu.pc, 2) : memory_read(cpu.pc, 4);
+    if (traceEnabled)
+      trace(op);
+
+    cpu.branched = 0;
+    cpu.r[15] = cpu.pc + fetch_width();
+    if (cpu.thumb)
+      thumb_step((uint16_t)op);
+    else
+      arm_step(op);
+    cpu.instructions++;
+
+    if (cpu.branched)
+      cycles_refill();
+  }
+}
+
+static int check_string(uint32_t address, const char* expected) {
+  uint32_t length = (uint32_t)strlen(expected) + 1;
+  const uint8_t* p = host_pointer(address, length);
+  if (p && !memcmp(p, expected, length))
+    return 0;
+  printf("expected \"%s\" at 0x%08X, got \"", expected, address);
+  if (p) {
+    uint32_t i;
+    for (i = 0; i < length + 16 && p[i]; i++)
+      putchar(p[i] >= 0x20 && p[i] < 0x7F ? p[i] : '?');
+  }
+  printf("\"\n");
+  return 1;
+}
+
+static void dump(uint32_t address, uint32_t length) {
+  const uint8_t* p = host_pointer(address, length);
+  uint32_t i;
+  if (!p)
+    fatal("cannot dump 0x%08X", address);
+  for (i = 0; i < length; i++) {
+    if (i % 16 == 0)
+      printf("%s%08X:", i ? "\n" : "", address + i);
+    printf(" %02X", p[i]);
+  }
+  printf("\n");
+}
+
+int main(int argc, char** argv) {
+  Option* options = (Option*)calloc(argc, sizeof(Option));
+  const char* function = NULL;
+  int codeRegion = REGION_ROM, verbose = 0, optionCount = 0, failed = 0, i, o;
+  uint64_t limit = 10000000;
+  char key[256];
+
+  set_waitcnt(0x4317);
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    char type = argv[i][1];
+    if (argv[i][2])
+      usage();
+    switch (type) {
+      case 't': traceEnabled = 1; break;
+      case 'v': verbose = 1; break;
+      case 'c': case 'r': case 's': case 'l': case 'x': case 'D':
+      case 'p': case 'w': case 'e': case 'E': case 'd': case 'm': case 'L':
+        if (i + 1 >= argc)
+          usage();
+        options[optionCount].type = type;
+        options[optionCount++].text = argv[++i];
+        break;
+      default:
+        usage();
+    }
+  }
+
+  if (i == argc)
+    usage();
+
+  objectCount = argc - i;
+  objects = (ElfFile*)calloc(objectCount, sizeof(ElfFile));
+  sectionAddresses = (uint32_t**)calloc(objectCount, sizeof(uint32_t*));
+  for (o = 0; o < objectCount; o++) {
+    if (elf_open(&objects[o], argv[i + o]) != 0)
+      return 2;
+    if (objects[o].type != ELF_ET_REL)
+      fatal("%s: not a relocatable object", argv[i + o]);
+  }
+
+  for (i = 0; i < REGION_COUNT; i++) {
+    regions[i].data = (uint8_t*)calloc(regions[i].size, 1);
+    cursors[i] = regions[i].base;
+  }
+
+  // Options that affect layout
+  for (i = 0; i < optionCount; i++) {
+    const Option* option = &options[i];
+    switch (option->type) {
+      case 'c': function = option->text; break;
+      case 'p': codeRegion = region_by_name(option->text); break;
+      case 'w': set_waitcnt((unsigned)strtoul(option->text, NULL, 0)); break;
+      case 'L': limit = strtoull(option->text, NULL, 0); break;
+    }
+  }
+
+  if (!function)
+    usage();
+
+  layout_sections(codeRegion);
+
+  // Definitions and explicit stubs come before the objects'
+  // own symbols so that duplicates are reported.
+  for (i = 0; i < optionCount; i++) {
+    const Option* option = &options[i];
+    if (option->type == 'D') {
+      const char* value = split(option->text, key, sizeof(key));
+      add_symbol(copy_string(key), parse_value(value));
+    } else if (option->type == 'x') {
+      Symbol* stub;
+      const char* value = strchr(option->text, '=') ? split(option->text, key, sizeof(key)) : NULL;
+      if (!value) {
+        strncpy(key, option->text, sizeof(key) - 1);
+        key[sizeof(key) - 1] = 0;
+      }
+      stub = add_symbol(copy_string(key), 0);
+      stub->isStub = 1;
+      stub->isFunction = 1;
+      if (value) {
+        stub->hasReturn = 1;
+        stub->returnValue = parse_value(value);
+      }
+    }
+  }
+
+  collect_symbols();
+  create_stubs(codeRegion);
+  apply_relocations();
+
+  // Initial state
+  for (i = 0; i < optionCount; i++) {
+    const Option* option = &options[i];
+    const char* value;
+    switch (option->type) {
+      case 'r':
+        value = split(option->text, key, sizeof(key));
+        cpu.r[parse_register(key)] = parse_value(value);
+        break;
+      case 's':
+        value = split(option->text, key, sizeof(key));
+        write_string(parse_value(key), value);
+        break;
+      case 'l':
+        value = split(option->text, key, sizeof(key));
+        load_file(parse_value(key), value);
+        break;
+    }
+  }
+
+  run(find_function(function), limit);
+
+  printf("%s: %llu cycles, %llu instructions\n", function, (unsigned long long)cpu.cycles, (unsigned long long)cpu.instructions);
+  for (i = 0; i < 8; i++)
+    printf("  r%d = 0x%08X%s", i, cpu.r[i], i % 4 == 3 ? "\n" : "");
+  if (cpu.r[13] != STACK_TOP)
+    printf("  warning: sp is 0x%08X after return, expected 0x%08X\n", cpu.r[13], STACK_TOP);
+
+  if (verbose)
+    for (i = 0; i < symbolCount; i++)
+      if (symbols[i].isStub && symbols[i].isFunction)
+        printf("  stub %s: %u calls\n", symbols[i].name, symbols[i].calls);
+
+  // Results
+  for (i = 0; i < optionCount; i++) {
+    const Option* option = &options[i];
+    const char* value;
+    switch (option->type) {
+      case 'e': {
+        uint32_t expected, actual;
+        value = split(option->text, key, sizeof(key));
+        expected = parse_value(value);
+        actual = cpu.r[parse_register(key)];
+        if (actual != expected) {
+          printf("expected %s = 0x%08X, got 0x%08X\n", key, expected, actual);
+          failed = 1;
+        }
+        break;
+      }
+      case 'E':
+        value = split(option->text, key, sizeof(key));
+        failed |= check_string(parse_value(key), value);
+        break;
+      case 'd':
+        value = split(option->text, key, sizeof(key));
+        dump(parse_value(key), parse_value(value));
+        break;
+      case 'm':
+        save_file(&regions[REGION_EWRAM], option->text);
+        break;
+    }
+  }
+
+  return failed;
+}
@@ -0,0 +1,259 @@
+/* thumbsize
+ *
+ * Reports how the bytes of each function are spent, to help
+ * fit hooks into the space they replace.
+ *
+ * Splits each function of a set of objects into:
+ *
+ *   code     instructions
+ *   pool     data within the function, which the assembler
+ *            marks with `$d` mapping symbols: literal pools
+ *            from `LDR_POOL` and `MOV_CONST`, and the tables of
+ *            `SWITCH_TABLE`
+ *   padding  nops and zeroes inserted to align code and pools,
+ *            by `ALIGN`, `LTORG` and the assembler
+ *
+ * and lists them with the function's limit, if it has one,
+ * and the bytes left under it. Limits come from
+ * `THUMBLIB_SIZE_LIMIT` in the source, which the assembler
+ * already checks, or from the command line, which is handy
+ * for functions whose budget is only known to the build
+ * scripts.
+ *
+ * Build:  cc -O2 -o thumbsize tools/thumbsize.c
+ * Usage:  thumbsize [options] file.o...
+ *
+ * Options:
+ *   -l NAME=BYTES  limit for the functions called NAME in every
+ *                  file, overriding any `THUMBLIB_SIZE_LIMIT`
+ *   -v             list each run of code, pool and padding
+ *
+ * The exit status is 1 if a function is over its limit.
+ *
+ * The size of a function is that of its symbol, so alignment
+ * between functions isn't counted. Padding is found the way
+ * `thumbverify` finds it, so `NOP()` opcodes count as padding
+ * too, and zero halfwords only count when they end a word.
+ */
+
+#include "thumbelf.h"
+
+#define SIZES_SECTION ".thumblib.sizes"
+
+#define NO_LIMIT -1
+
+// A limit from the command line, for every function
+// called `name`
+typedef struct {
+  char* name;
+  long bytes;
+} Limit;
+
+// A limit from `THUMBLIB_SIZE_LIMIT`, for one function of
+// the file being listed
+typedef struct {
+  const ElfSymbol* function;
+  long bytes;
+} SourceLimit;
+
+static Limit* limits = NULL;
+static int limitCount = 0;
+
+static int verbose = 0;
+
+static const char* kind_name(int kind) {
+  static const char* names[3] = {"code", "pool", "padding"};
+  return names[kind];
+}
+
+static void set_limit(const char* name, long bytes) {
+  int i;
+  for (i = 0; i < limitCount; i++) {
+    if (!strcmp(limits[i].name, name)) {
+      limits[i].bytes = bytes;
+      return;
+    }
+  }
+  limits = (Limit*)realloc(limits, (limitCount + 1) * sizeof(Limit));
+  limits[limitCount].name = (char*)malloc(strlen(name) + 1);
+  strcpy(limits[limitCount].name, name);
+  limits[limitCount].bytes = bytes;
+  limitCount++;
+}
+
+// Limit of `function`, from the command line or else from
+// `sources`, the limits of its own file
+static long limit_of(const ElfSymbol* function, const SourceLimit* sources, int sourceCount) {
+  int i;
+  for (i = 0; i < limitCount; i++)
+    if (!strcmp(limits[i].name, function->name))
+      return limits[i].bytes;
+  for (i = 0; i < sourceCount; i++)
+    if (sources[i].function == function)
+      return sources[i].bytes;
+  return NO_LIMIT;
+}
+
+// Reads the `THUMBLIB_SIZE_LIMIT` records of `elf`, each a
+// pointer to the function and its limit. Limits are kept
+// per function symbol, so they don't apply to functions of
+// the same name in other files. The caller frees `*out`.
+static int read_limits(const ElfFile* elf, SourceLimit** out) {
+  int section = elf_find_section(elf, SIZES_SECTION);
+  SourceLimit* sources;
+  const uint8_t* data;
+  uint32_t position;
+  int count = 0;
+
+  *out = NULL;
+  if (section < 0)
+    return 0;
+
+  data = elf_section_data(elf, section);
+  sources = (SourceLimit*)malloc((elf->sections[section].size / 8 + 1) * sizeof(SourceLimit));
+  for (position = 0; position + 8 <= elf->sections[section].size; position += 8) {
+    int target;
+    uint32_t offset;
+    const ElfSymbol* function;
+    if (elf_resolve_pointer(elf, section, position, &target, &offset) != 0 ||
+        !(function = elf_function_at(elf, target, offset))) {
+      fprintf(stderr, "%s: cannot resolve size limit at 0x%X\n", elf->path, position);
+      continue;
+    }
+    sources[count].function = function;
+    sources[count].bytes = (long)elf_read32(data + position + 4);
+    count++;
+  }
+
+  *out = sources;
+  return count;
+}
+
+// Adds up the code, pool and padding bytes of `function`.
+static void measure(const ElfFile* elf, const ElfSymbol* function, uint32_t bytes[3]) {
+  int section = function->shndx;
+  const uint8_t* data = elf_section_data(elf, section);
+  uint32_t start = (function->value & ~1u) - elf_section_base(elf, section);
+  uint32_t end = start + function->size;
+  char fallback = (function->value & 1) ? 't' : 'a';
+  ElfMapping* mappings;
+  int mappingCount = elf_read_mappings(elf, section, &mappings);
+  uint32_t offset = start, runStart = start;
+  int runKind = -1;
+
+  bytes[0] = bytes[1] = bytes[2] = 0;
+  if (end > elf->sections[section].size)
+    end = elf->sections[section].size;
+
+  while (offset < end) {
+    char state = elf_state_at(mappings, mappingCount, offset, fallback);
+    uint32_t size, instruction;
+    int kind;
+
+    if (state == 'd') {
+      kind = 1;
+      size = 1;
+    } else if (state == 'a') {
+      size = 4;
+      instruction = offset + 4 <= end ? elf_read32(data + offset) : 0;
+      kind = elf_is_padding(state, offset, instruction) ? 2 : 0;
+    } else {
+      size = 2;
+      instruction = offset + 2 <= end ? elf_read16(data + offset) : 0;
+      kind = elf_is_padding(state, offset, instruction) ? 2 : 0;
+    }
+
+    if (offset + size > end)
+      size = end - offset;
+
+    if (verbose && kind != runKind) {
+      if (runKind >= 0)
+        printf("    +0x%04X  %-8s %u bytes\n", runStart - start, kind_name(runKind), offset - runStart);
+      runKind = kind;
+      runStart = offset;
+    }
+
+    bytes[kind] += size;
+    offset += size;
+  }
+
+  if (verbose && runKind >= 0)
+    printf("    +0x%04X  %-8s %u bytes\n", runStart - start, kind_name(runKind), end - runStart);
+
+  free(mappings);
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: thumbsize [-l NAME=BYTES] [-v] file.o...\n");
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  uint32_t totals[3] = {0, 0, 0};
+  int over = 0, i, j;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    if (!strcmp(argv[i], "-l") && i + 1 < argc) {
+      char* text = argv[++i];
+      char* equals = strchr(text, '=');
+      if (!equals)
+        usage();
+      *equals = 0;
+      set_limit(text, strtol(equals + 1, NULL, 0));
+    } else if (!strcmp(argv[i], "-v")) {
+      verbose = 1;
+    } else {
+      usage();
+    }
+  }
+
+  if (i == argc)
+    usage();
+
+  for (; i < argc; i++) {
+    ElfFile elf;
+    SourceLimit* sources;
+    int sourceCount;
+
+    if (elf_open(&elf, argv[i]) != 0)
+      return 2;
+
+    sourceCount = read_limits(&elf, &sources);
+
+    printf("%s:\n", argv[i]);
+    printf("  %-32s %6s %6s %6s %7s %6s %6s\n", "function", "size", "code", "pool", "padding", "limit", "left");
+
+    for (j = 0; j < elf.symbolCount; j++) {
+      const ElfSymbol* function = &elf.symbols[j];
+      uint32_t bytes[3];
+      long limit;
+
+      if (function->type != ELF_STT_FUNC || function->shndx == ELF_SHN_UNDEF || function->shndx >= elf.sectionCount || !function->size)
+        continue;
+
+      if (verbose)
+        printf("  %s\n", function->name);
+      measure(&elf, function, bytes);
+      totals[0] += bytes[0];
+      totals[1] += bytes[1];
+      totals[2] += bytes[2];
+
+      printf("  %-32s %6u %6u %6u %7u", function->name, function->size, bytes[0], bytes[1], bytes[2]);
+      limit = limit_of(function, sources, sourceCount);
+      if (limit == NO_LIMIT) {
+        printf("\n");
+      } else {
+        printf(" %6ld %6ld%s\n", limit, limit - (long)function->size, (long)function->size > limit ? "  over" : "");
+        if ((long)function->size > limit)
+          over++;
+      }
+    }
+
+    free(sources);
+    elf_close(&elf);
+  }
+
+  printf("\n  %-32s %6u %6u %6u %7u\n", "total", totals[0] + totals[1] + totals[2], totals[0], totals[1], totals[2]);
+
+  return over ? 1 : 0;
+}
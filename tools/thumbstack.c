@@ -0,0 +1,661 @@
+/* thumbstack
+ *
+ * Static stack depth analyzer for THUMBLIB functions.
+ *
+ * Follows every path through each function of a set of
+ * objects, adding up the bytes pushed and popped, and reports
+ * the deepest point of each function on its own (its frame)
+ * and through the `BL` call graph (its worst case). The
+ * worst case is what a hook needs below its entry stack
+ * pointer, so it tells how much stack can safely be reserved.
+ *
+ * Stack changes come from the annotation records of `PUSH`,
+ * `PUSH_WITH_LR`, `POP`, `POP_WITH_PC`, `ADD_TO_SP`,
+ * `SUB_FROM_SP` and their ARM counterparts, in objects built
+ * with `-D THUMBLIB_ANNOTATE`. Instructions that no opcode
+ * emitted, such as GCC's own prologues and the code of plain
+ * C functions, are decoded instead.
+ *
+ * Build:  cc -O2 -o thumbstack tools/thumbstack.c
+ * Usage:  thumbstack [options] file.o...
+ *
+ * Options:
+ *   -s NAME=BYTES  stack used by NAME, a function that isn't
+ *                  in the objects (such as one in the game)
+ *   -f FILE        reads `NAME BYTES` lines as with `-s`
+ *   -r NAME        only report NAME and the functions it calls
+ *   -l BYTES       fail if a worst case is deeper than BYTES
+ *   -v             list the stack depth at every instruction
+ *
+ * It reports:
+ *
+ *   unbalanced  an instruction reached with different depths
+ *               on different paths
+ *   leaves      a return or tail call with bytes still pushed
+ *   underflow   more popped than pushed
+ *   unknown sp  `sp` set from a register
+ *   recursion   a cycle in the call graph
+ *
+ * The exit status is 1 if anything was reported or a limit
+ * was exceeded.
+ *
+ * Calls to functions that are neither in the objects nor
+ * given with `-s`, and indirect calls, count as 0 bytes and
+ * mark the worst case with a `+`; they are listed at the end.
+ * Interrupts run on their own stack and are not counted.
+ * Jump tables from `SWITCH_TABLE` and `LOOP_UNROLLED` are
+ * followed, other jumps through a register end the path.
+ */
+
+#include "annotations.h"
+
+#include <limits.h>
+#include <stdarg.h>
+
+#define UNVISITED INT_MIN
+
+typedef struct {
+  const char* name;   // Callee, NULL for an indirect call
+  uint32_t offset;    // Of the call, from the start of the function
+  int depth;          // Bytes pushed at the call
+} Call;
+
+typedef struct {
+  const char* name;
+  const char* path;
+  ElfFile* elf;
+  const ElfSymbol* symbol;
+  int local;
+  int frame;
+  int problems;
+  Call* calls;
+  int callCount;
+
+  // Worst case through calls
+  int visiting, done;
+  int worst;
+  int incomplete;    // An unknown callee is somewhere below
+  int deepest;       // Index of the call on the deepest path, or -1
+} Function;
+
+typedef struct {
+  const char* name;
+  int bytes;
+} External;
+
+static Function* functions = NULL;
+static int functionCount = 0, functionCapacity = 0;
+
+static External* externals = NULL;
+static int externalCount = 0, externalCapacity = 0;
+
+static int verbose = 0;
+
+// Returns the size of the instruction at `p` and stores it
+// in `instruction`. A THUMB `bl` pair is read as its first
+// half, with the second half in the upper 16 bits.
+static uint32_t decode(char state, const uint8_t* p, uint32_t remaining, uint32_t* instruction) {
+  if (state == 'a') {
+    *instruction = remaining >= 4 ? elf_read32(p) : 0;
+    return 4;
+  }
+  *instruction = elf_read16(p);
+  if ((*instruction & 0xF800) == 0xF000 && remaining >= 4 && (elf_read16(p + 2) & 0xF800) == 0xF800) {
+    *instruction |= (uint32_t)elf_read16(p + 2) << 16;
+    return 4;
+  }
+  return 2;
+}
+
+// Target of a branch or `bl` at `offset` as encoded, or -1
+// if `instruction` is not a direct branch.
+static int64_t branch_target(char state, uint32_t offset, uint32_t instruction) {
+  if (state == 'a') {
+    if ((instruction & 0x0E000000) != 0x0A000000 || (instruction >> 28) == 0xF)
+      return -1;
+    return (int64_t)offset + 8 + ((int32_t)(instruction << 8) >> 6);
+  }
+  if ((instruction & 0xF800) == 0xF000 && (instruction >> 16))
+    return (int64_t)offset + 4 + ((int32_t)(instruction << 21) >> 9) + ((instruction >> 16) & 0x7FF) * 2;
+  if ((instruction & 0xFFFF) >= 0xD000 && (instruction & 0xFFFF) < 0xDE00)
+    return (int64_t)offset + 4 + ((int8_t)(instruction & 0xFF) * 2);
+  if ((instruction & 0xFFFF) >= 0xE000 && (instruction & 0xFFFF) < 0xE800)
+    return (int64_t)offset + 4 + ((int32_t)(instruction << 21) >> 20);
+  return -1;
+}
+
+static int bit_count(uint32_t value) {
+  int count = 0;
+  for (; value; value &= value - 1)
+    count++;
+  return count;
+}
+
+// Bytes pushed by `instruction`, negative when popped. Sets
+// `*unknown` when `sp` is set from a register.
+static int decoded_delta(char state, uint32_t instruction, int* unknown) {
+  *unknown = 0;
+  if (state == 'a') {
+    uint32_t rotate = ((instruction >> 8) & 0xF) * 2;
+    uint32_t immediate = ((instruction & 0xFF) >> rotate) | ((instruction & 0xFF) << ((32 - rotate) & 31));
+    if ((instruction & 0x0FFF0000) == 0x092D0000)  // stmfd sp!
+      return 4 * bit_count(instruction & 0xFFFF);
+    if ((instruction & 0x0FFF0000) == 0x08BD0000)  // ldmfd sp!
+      return -4 * bit_count(instruction & 0xFFFF);
+    if ((instruction & 0x0FFF0FFF) == 0x052D0004)  // str rd, [sp, #-4]!
+      return 4;
+    if ((instruction & 0x0FFF0FFF) == 0x049D0004)  // ldr rd, [sp], #4
+      return -4;
+    if ((instruction & 0x0FFFF000) == 0x024DD000)  // sub sp, sp, #imm
+      return (int)immediate;
+    if ((instruction & 0x0FFFF000) == 0x028DD000)  // add sp, sp, #imm
+      return -(int)immediate;
+    if ((instruction & 0x0C00F000) == 0x0000D000 && ((instruction >> 21) & 0xF) != 0xA && ((instruction >> 21) & 0xF) != 0x8 &&
+        ((instruction >> 21) & 0xF) != 0x9 && ((instruction >> 21) & 0xF) != 0xB)
+      *unknown = 1;  // Other data processing into sp
+    return 0;
+  }
+  instruction &= 0xFFFF;
+  if ((instruction & 0xFE00) == 0xB400)            // push
+    return 4 * (bit_count(instruction & 0xFF) + ((instruction >> 8) & 1));
+  if ((instruction & 0xFE00) == 0xBC00)            // pop
+    return -4 * (bit_count(instruction & 0xFF) + ((instruction >> 8) & 1));
+  if ((instruction & 0xFF00) == 0xB000)            // add/sub sp, #imm
+    return (instruction & 0x80) ? 4 * (instruction & 0x7F) : -4 * (instruction & 0x7F);
+  if ((instruction & 0xFD87) == 0x4485)            // add/mov sp, rs
+    *unknown = 1;
+  return 0;
+}
+
+// Bytes pushed according to an annotation record, or
+// UNVISITED if the record isn't a stack operation.
+static int annotated_delta(const Annotation* record, int* unknown) {
+  *unknown = 0;
+  switch (record->kind & KIND_MASK) {
+    case KIND_PUSH: return 4 * record->count;
+    case KIND_POP: case KIND_POP_PC: return -4 * record->count;
+    case KIND_SP_ADJUST: return -4 * record->count;
+    case KIND_SP_ADJUST_R: *unknown = 1; return 0;
+    default: return UNVISITED;
+  }
+}
+
+static void add_function(const char* path, ElfFile* elf, const ElfSymbol* symbol) {
+  Function* function;
+  if (functionCount == functionCapacity) {
+    functionCapacity = functionCapacity ? functionCapacity * 2 : 64;
+    functions = (Function*)realloc(functions, functionCapacity * sizeof(Function));
+  }
+  function = &functions[functionCount++];
+  memset(function, 0, sizeof(*function));
+  function->name = symbol->name;
+  function->path = path;
+  function->elf = elf;
+  function->symbol = symbol;
+  function->local = symbol->bind == ELF_STB_LOCAL;
+  function->deepest = -1;
+}
+
+static void add_external(const char* name, int bytes) {
+  if (externalCount == externalCapacity) {
+    externalCapacity = externalCapacity ? externalCapacity * 2 : 16;
+    externals = (External*)realloc(externals, externalCapacity * sizeof(External));
+  }
+  externals[externalCount].name = name;
+  externals[externalCount].bytes = bytes;
+  externalCount++;
+}
+
+static void add_call(Function* function, const char* name, uint32_t offset, int depth) {
+  function->calls = (Call*)realloc(function->calls, (function->callCount + 1) * sizeof(Call));
+  function->calls[function->callCount].name = name;
+  function->calls[function->callCount].offset = offset;
+  function->calls[function->callCount].depth = depth;
+  function->callCount++;
+}
+
+// Name of the function a `bl` or `b` at `offset` within
+// `section` calls, or NULL if it stays within the function
+// or can't be resolved.
+static const char* call_target(const ElfFile* elf, int section, uint32_t offset, int64_t encoded, const ElfSymbol* self) {
+  ElfRel rel;
+  const ElfSymbol* target = NULL;
+
+  if (elf->type == ELF_ET_REL && elf_rel_at(elf, section, offset, &rel) == 0 && rel.symbol < (uint32_t)elf->symbolCount) {
+    const ElfSymbol* symbol = &elf->symbols[rel.symbol];
+    if (symbol->type != ELF_STT_SECTION)
+      return symbol->name;
+    // REL addends are in the instruction, so the target is
+    // the symbol plus the encoded displacement
+    if (symbol->shndx < elf->sectionCount)
+      target = elf_function_at(elf, symbol->shndx, (uint32_t)(((symbol->value & ~1u) + encoded - offset) & ~1u));
+  } else if (encoded >= 0) {
+    target = elf_function_at(elf, section, (uint32_t)encoded);
+  }
+
+  return target && target != self ? target->name : NULL;
+}
+
+static void report(Function* function, uint32_t offset, const char* format, ...) {
+  va_list arguments;
+  printf("  %s +0x%04X: ", function->name, offset);
+  va_start(arguments, format);
+  vprintf(format, arguments);
+  va_end(arguments);
+  printf("\n");
+  function->problems++;
+}
+
+typedef struct {
+  uint32_t offset;
+  int depth;
+} Pending;
+
+// Walks every path through `function` from its entry.
+static void analyze(Function* function, const Annotation* records, int recordCount) {
+  const ElfFile* elf = function->elf;
+  const ElfSymbol* symbol = function->symbol;
+  int section = symbol->shndx;
+  const uint8_t* data = elf_section_data(elf, section);
+  uint32_t start = (symbol->value & ~1u) - elf_section_base(elf, section);
+  uint32_t end = start + symbol->size;
+  char fallback = (symbol->value & 1) ? 't' : 'a';
+  ElfMapping* mappings;
+  int mappingCount = elf_read_mappings(elf, section, &mappings);
+  uint32_t halves = symbol->size / 2 + 1;
+  int* depths = (int*)malloc(halves * sizeof(int));
+  uint8_t* reported = (uint8_t*)calloc(halves, 1);
+  const Annotation** recordAt = (const Annotation**)calloc(halves, sizeof(Annotation*));
+  Pending* pending = (Pending*)malloc(halves * 2 * sizeof(Pending));
+  int pendingCount = 0, i;
+  uint32_t h;
+
+  if (end > elf->sections[section].size)
+    end = elf->sections[section].size;
+
+  for (h = 0; h < halves; h++)
+    depths[h] = UNVISITED;
+
+  for (i = 0; i < recordCount; i++)
+    if (records[i].function == symbol && records[i].section == section && records[i].offset >= start && records[i].offset < end)
+      recordAt[(records[i].offset - start) / 2] = &records[i];
+
+  pending[pendingCount].offset = start;
+  pending[pendingCount++].depth = 0;
+
+  while (pendingCount) {
+    Pending current = pending[--pendingCount];
+    uint32_t offset = current.offset, instruction, size, previous = 0;
+    int depth = current.depth, delta, unknown, exits = 0, falls = 1;
+    const Annotation* record;
+    char state;
+    int64_t target;
+
+    #define FOLLOW(Target, Depth)                                                            \
+      if (pendingCount < (int)halves * 2) {                                                  \
+        pending[pendingCount].offset = (Target);                                             \
+        pending[pendingCount++].depth = (Depth);                                             \
+      }
+
+    if (offset < start || offset >= end)
+      continue;
+
+    h = (offset - start) / 2;
+    if (depths[h] != UNVISITED) {
+      if (depths[h] != depth && !reported[h]) {
+        report(function, offset - start, "unbalanced, reached with %d and %d bytes pushed", depths[h], depth);
+        reported[h] = 1;
+      }
+      continue;
+    }
+    depths[h] = depth;
+
+    state = elf_state_at(mappings, mappingCount, offset, fallback);
+    if (state == 'd')
+      continue;
+
+    size = decode(state, data + offset, end - offset, &instruction);
+    if (offset >= start + 2 && state == 't')
+      previous = elf_read16(data + offset - 2);
+
+    record = recordAt[h];
+    delta = record ? annotated_delta(record, &unknown) : UNVISITED;
+    if (delta == UNVISITED)
+      delta = decoded_delta(state, instruction, &unknown);
+    if (unknown)
+      report(function, offset - start, "unknown sp, set from a register");
+
+    if (verbose)
+      printf("    %s +0x%04X  %4d  %0*X%s\n", function->name, offset - start, depth, state == 'a' ? 8 : 4,
+             state == 'a' || size == 2 ? instruction : (instruction & 0xFFFF), record ? "" : "  (decoded)");
+
+    depth += delta;
+    if (depth < 0) {
+      report(function, offset - start, "underflow, %d more bytes popped than pushed", -depth);
+      depth = 0;
+    }
+    if (depth > function->frame)
+      function->frame = depth;
+
+    target = branch_target(state, offset, instruction);
+
+    if (state == 'a') {
+      uint32_t condition = instruction >> 28;
+      if ((instruction & 0x0F000000) == 0x0B000000) {
+        add_call(function, call_target(elf, section, offset, target, symbol), offset - start, depth);
+      } else if ((instruction & 0x0F000000) == 0x0A000000) {
+        const char* callee = call_target(elf, section, offset, target, symbol);
+        if (callee || target < start || target >= end) {
+          add_call(function, callee, offset - start, depth);
+          exits = 1;
+        } else {
+          FOLLOW((uint32_t)target, depth)
+        }
+        falls = condition != 0xE;
+      } else if ((instruction & 0x0FFFFFF0) == 0x012FFF10 || (instruction & 0x0E10F000) == 0x0410F000 ||
+                 ((instruction & 0x0E108000) == 0x08108000) || ((instruction & 0x0C00F000) == 0x0000F000)) {
+        // bx, ldr pc, ldm with pc or data processing into pc
+        if (offset >= start + 4 && elf_read32(data + offset - 4) == 0xE1A0E00F) {
+          add_call(function, NULL, offset - start, depth);
+        } else {
+          exits = 1;
+          falls = condition != 0xE;
+        }
+      }
+    } else if (size == 4) {
+      add_call(function, call_target(elf, section, offset, target, symbol), offset - start, depth);
+    } else if ((instruction & 0xF800) == 0xF800) {
+      // Second half of a `bl` on its own, as in `BL_LR`
+      add_call(function, NULL, offset - start, depth);
+    } else if (instruction >= 0xD000 && instruction < 0xDE00) {
+      FOLLOW((uint32_t)target, depth)
+    } else if (instruction >= 0xE000 && instruction < 0xE800) {
+      const char* callee = call_target(elf, section, offset, target, symbol);
+      if (callee || target < start || target >= end) {
+        add_call(function, callee, offset - start, depth);
+        exits = 1;
+      } else {
+        FOLLOW((uint32_t)target, depth)
+      }
+      falls = 0;
+    } else if ((instruction & 0xFF00) == 0x4700 || (instruction & 0xFF87) == 0x4687) {
+      // bx or mov pc, after `mov lr, pc` for a call through
+      // a register
+      if (previous == 0x46FE) {
+        add_call(function, NULL, offset - start, depth);
+      } else {
+        exits = 1;
+        falls = 0;
+      }
+    } else if ((instruction & 0xFF00) == 0xBD00) {
+      exits = 1;
+      falls = 0;
+    } else if ((instruction & 0xFF87) == 0x4487) {
+      // add pc: a table of `b` opcodes after a nop, or a table
+      // of halfword offsets after `ldrh` or byte offsets
+      uint32_t table = offset + 2;
+      if (elf_state_at(mappings, mappingCount, table, fallback) == 't') {
+        uint32_t entry;
+        for (entry = table; entry < end; entry += 2) {
+          uint32_t op = elf_read16(data + entry);
+          if (op != 0x46C0 && (op < 0xE000 || op >= 0xE800))
+            break;
+          FOLLOW(entry, depth)
+        }
+      } else {
+        uint32_t tableEnd = elf_next_mapping(mappings, mappingCount, table, end);
+        int halfwords = offset >= start + 4 && (elf_read16(data + offset - 4) & 0xF800) == 0x8800;
+        uint32_t entry;
+        for (entry = table; entry + (halfwords ? 2 : 1) <= tableEnd; entry += halfwords ? 2 : 1) {
+          uint32_t value = halfwords ? elf_read16(data + entry) : data[entry];
+          FOLLOW(table + 2 + value * 2, depth)
+        }
+      }
+      falls = 0;
+    }
+
+    if (exits && depth != 0)
+      report(function, offset - start, "leaves with %d bytes pushed", depth);
+
+    if (falls)
+      FOLLOW(offset + size, depth)
+
+    #undef FOLLOW
+  }
+
+  free(pending);
+  free(recordAt);
+  free(reported);
+  free(depths);
+  free(mappings);
+}
+
+static int read_file(const char* path) {
+  ElfFile* elf = (ElfFile*)malloc(sizeof(ElfFile));
+  Annotation* records = NULL;
+  int count = 0, first = functionCount, i;
+
+  if (elf_open(elf, path) != 0) {
+    free(elf);
+    return 1;
+  }
+
+  // Objects without THUMBLIB opcodes have no records and
+  // are decoded
+  if (elf_find_section(elf, ANNOTATION_SECTION) >= 0) {
+    count = annotations_read(elf, &records);
+    if (count < 0)
+      return 1;
+  }
+
+  for (i = 0; i < elf->symbolCount; i++) {
+    const ElfSymbol* symbol = &elf->symbols[i];
+    if (symbol->type == ELF_STT_FUNC && symbol->shndx != ELF_SHN_UNDEF && symbol->shndx < elf->sectionCount && symbol->size)
+      add_function(path, elf, symbol);
+  }
+
+  for (i = first; i < functionCount; i++)
+    analyze(&functions[i], records, count);
+
+  free(records);
+  return 0;
+}
+
+// Finds the function `name` called from `caller`, preferring
+// a local one in the same file.
+static int find_function(const char* name, const Function* caller) {
+  int i, found = -1;
+  for (i = 0; i < functionCount; i++) {
+    if (strcmp(functions[i].name, name))
+      continue;
+    if (caller && functions[i].elf == caller->elf)
+      return i;
+    if (!functions[i].local && found < 0)
+      found = i;
+  }
+  return found;
+}
+
+static const External* find_external(const char* name) {
+  int i;
+  for (i = 0; i < externalCount; i++)
+    if (!strcmp(externals[i].name, name))
+      return &externals[i];
+  return NULL;
+}
+
+// Computes the worst case of `functions[index]` and of
+// everything it calls.
+static void compute_worst(int index) {
+  Function* function = &functions[index];
+  int i;
+
+  if (function->done)
+    return;
+
+  function->visiting = 1;
+  function->worst = function->frame;
+
+  for (i = 0; i < function->callCount; i++) {
+    const Call* call = &function->calls[i];
+    int callee = call->name ? find_function(call->name, function) : -1;
+    int below = 0;
+
+    if (callee >= 0 && functions[callee].visiting) {
+      // Its worst case isn't known yet, and is unbounded
+      report(function, call->offset, "recursion, calls %s which is still running", call->name);
+      function->incomplete = 1;
+      continue;
+    } else if (callee >= 0) {
+      compute_worst(callee);
+      below = functions[callee].worst;
+      if (functions[callee].incomplete)
+        function->incomplete = 1;
+    } else if (call->name && find_external(call->name)) {
+      below = find_external(call->name)->bytes;
+    } else {
+      function->incomplete = 1;
+    }
+
+    if (call->depth + below > function->worst) {
+      function->worst = call->depth + below;
+      function->deepest = i;
+    }
+  }
+
+  function->visiting = 0;
+  function->done = 1;
+}
+
+static void print_path(const Function* function) {
+  printf("%s", function->name);
+  while (function->deepest >= 0) {
+    const Call* call = &function->calls[function->deepest];
+    int callee = call->name ? find_function(call->name, function) : -1;
+    if (callee < 0) {
+      printf(" > %s", call->name ? call->name : "(indirect)");
+      return;
+    }
+    function = &functions[callee];
+    printf(" > %s", function->name);
+  }
+}
+
+// Marks `functions[index]` and everything it calls.
+static void mark_reachable(int index, uint8_t* reachable) {
+  int i;
+  if (reachable[index])
+    return;
+  reachable[index] = 1;
+  for (i = 0; i < functions[index].callCount; i++) {
+    const Call* call = &functions[index].calls[i];
+    int callee = call->name ? find_function(call->name, &functions[index]) : -1;
+    if (callee >= 0)
+      mark_reachable(callee, reachable);
+  }
+}
+
+static void read_externals(const char* path) {
+  FILE* file = fopen(path, "r");
+  char line[512], name[256];
+  int bytes;
+  if (!file) {
+    fprintf(stderr, "%s: cannot open file\n", path);
+    exit(2);
+  }
+  while (fgets(line, sizeof(line), file))
+    if (line[0] != '#' && sscanf(line, "%255s %i", name, &bytes) == 2) {
+      char* copy = (char*)malloc(strlen(name) + 1);
+      strcpy(copy, name);
+      add_external(copy, bytes);
+    }
+  fclose(file);
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: thumbstack [-s NAME=BYTES] [-f FILE] [-r NAME] [-l BYTES] [-v] file.o...\n");
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  const char* root = NULL;
+  long limit = -1;
+  int status = 0, problems = 0, unknownCount = 0, i, j;
+  uint8_t* reachable;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+      char* text = argv[++i];
+      char* equals = strchr(text, '=');
+      if (!equals)
+        usage();
+      *equals = 0;
+      add_external(text, (int)strtol(equals + 1, NULL, 0));
+    } else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+      read_externals(argv[++i]);
+    } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+      root = argv[++i];
+    } else if (!strcmp(argv[i], "-l") && i + 1 < argc) {
+      limit = strtol(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "-v")) {
+      verbose = 1;
+    } else {
+      usage();
+    }
+  }
+
+  if (i == argc)
+    usage();
+
+  for (; i < argc; i++)
+    status |= read_file(argv[i]);
+  if (status)
+    return 2;
+
+  for (i = 0; i < functionCount; i++)
+    compute_worst(i);
+
+  reachable = (uint8_t*)calloc(functionCount ? functionCount : 1, 1);
+  if (root) {
+    int index = find_function(root, NULL);
+    if (index < 0) {
+      fprintf(stderr, "thumbstack: no function %s\n", root);
+      return 2;
+    }
+    mark_reachable(index, reachable);
+  } else {
+    memset(reachable, 1, functionCount);
+  }
+
+  printf("\n  %-32s %6s %7s  %s\n", "function", "frame", "worst", "deepest path");
+  for (i = 0; i < functionCount; i++) {
+    const Function* function = &functions[i];
+    if (!reachable[i])
+      continue;
+    printf("  %-32s %6d %6d%c  ", function->name, function->frame, function->worst, function->incomplete ? '+' : ' ');
+    print_path(function);
+    printf("\n");
+    problems += function->problems;
+    if (limit >= 0 && function->worst > limit) {
+      printf("    deeper than the limit of %ld bytes\n", limit);
+      problems++;
+    }
+  }
+
+  // Callees with unknown stack use
+  for (i = 0; i < functionCount; i++) {
+    if (!reachable[i])
+      continue;
+    for (j = 0; j < functions[i].callCount; j++) {
+      const Call* call = &functions[i].calls[j];
+      if (call->name && (find_function(call->name, &functions[i]) >= 0 || find_external(call->name)))
+        continue;
+      if (!unknownCount++)
+        printf("\n  unknown stack use, give it with -s or -f:\n");
+      printf("    %-32s called from %s +0x%04X\n", call->name ? call->name : "(indirect call)", functions[i].name, call->offset);
+    }
+  }
+
+  free(reachable);
+  return problems ? 1 : 0;
+}
@@ -0,0 +1,399 @@
+/* thumbverify
+ *
+ * Checks that the code GCC emitted for each THUMBLIB function
+ * is exactly the sequence of THUMBLIB opcodes that produced it.
+ *
+ * Reads the annotation records of objects built with
+ * `-D THUMBLIB_ANNOTATE`, which mark the address of every
+ * opcode, and walks the code of each function that has any.
+ * It reports:
+ *
+ *   inserted  instructions that no opcode emitted, such as
+ *             spills and reloads, extra `mov`s between opcodes
+ *             or the address math that "m" operands need
+ *   reordered opcodes that appear in a straight-line run of
+ *             code after an opcode from a later source line
+ *   dropped   opcodes that are missing compared to a reference
+ *             build (only with `-r`, see below)
+ *
+ * Build:  cc -O2 -o thumbverify tools/thumbverify.c
+ * Usage:  thumbverify [options] file.o...
+ *
+ * Options:
+ *   -r FILE   reference object, built from the same source
+ *             with `-D THUMBLIB_VOLATILE` as well. Opcodes that
+ *             are in a function of the reference but not in the
+ *             function of the same name in file.o are reported
+ *             as dropped.
+ *   -v        list every instruction of the checked functions
+ *
+ * The exit status is 1 if anything was reported.
+ *
+ * Data the assembler marks with `$d` mapping symbols, such as
+ * literal pools and jump tables, is skipped, as are the
+ * nops and zeroes used as alignment padding.
+ * Dropped opcodes can't be seen in the object itself, since
+ * their records go away with them, hence the reference build.
+ * Runs are split at branches and branch targets, so blocks
+ * that GCC moves around as a whole aren't reported.
+ * Opcodes from inlined functions in other files can show up as
+ * reordered; check the line numbers against the right file.
+ */
+
+#include "annotations.h"
+
+typedef struct {
+  uint16_t line;
+  int count;
+} LineCount;
+
+typedef struct {
+  const char* name;
+  LineCount* lines;
+  int lineCount;
+} FunctionLines;
+
+static int verbose = 0;
+
+static int compare_records(const void* a, const void* b) {
+  const Annotation* x = (const Annotation*)a;
+  const Annotation* y = (const Annotation*)b;
+  if (x->section != y->section)
+    return x->section - y->section;
+  return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+static int compare_lines(const void* a, const void* b) {
+  return (int)((const LineCount*)a)->line - (int)((const LineCount*)b)->line;
+}
+
+// Rough description of a THUMB instruction, enough to tell
+// what kind of thing the compiler inserted.
+static const char* describe_thumb(uint16_t hw) {
+  if (hw < 0x1800) return "shift";
+  if (hw < 0x2000) return (hw & 0x0200) ? "sub" : "add";
+  if (hw < 0x4000) {
+    static const char* names[4] = {"mov", "cmp", "add", "sub"};
+    return names[(hw >> 11) & 3];
+  }
+  if (hw < 0x4400) return "alu";
+  if (hw < 0x4800) {
+    static const char* names[4] = {"add (high register)", "cmp (high register)", "mov (high register)", "bx"};
+    return names[(hw >> 8) & 3];
+  }
+  if (hw < 0x5000) return "ldr (literal pool)";
+  if (hw < 0x9000) return (hw & 0x0800) || (hw >= 0x5600 && hw < 0x5800) ? "load" : "store";
+  if (hw < 0xA000) return (hw & 0x0800) ? "ldr [sp] (reload)" : "str [sp] (spill)";
+  if (hw < 0xB000) return (hw & 0x0800) ? "add rd, sp (address)" : "add rd, pc (address)";
+  if ((hw & 0xFF00) == 0xB000) return "add/sub sp";
+  if ((hw & 0xF600) == 0xB400) return (hw & 0x0800) ? "pop" : "push";
+  if (hw < 0xC000) return "undefined";
+  if (hw < 0xD000) return (hw & 0x0800) ? "ldmia" : "stmia";
+  if ((hw & 0xFF00) == 0xDF00) return "swi";
+  if (hw < 0xE000) return "conditional branch";
+  if (hw < 0xE800) return "b";
+  if (hw >= 0xF000) return "bl";
+  return "undefined";
+}
+
+// Whether `instruction` ends a straight-line run.
+static int is_branch(char state, uint32_t instruction) {
+  if (state == 'a') {
+    uint32_t op = instruction & 0x0E000000;
+    return op == 0x0A000000 || (instruction & 0x0FFFFFF0) == 0x012FFF10 ||
+           ((instruction & 0x0000F000) == 0x0000F000 && (op == 0 || op == 0x02000000 || op == 0x04000000 || op == 0x06000000)) ||
+           ((instruction & 0x0E108000) == 0x08108000);
+  }
+  return (instruction >= 0xD000 && instruction < 0xE800 && (instruction & 0xFF00) != 0xDF00) ||
+         (instruction & 0xFF00) == 0x4700 || (instruction & 0xFF87) == 0x4687 ||
+         (instruction & 0xFF87) == 0x4487 || (instruction & 0xFF00) == 0xBD00;
+}
+
+// Target of a branch at `offset`, or -1 if `instruction`
+// is not a direct branch.
+static int64_t branch_target(char state, uint32_t offset, uint32_t instruction) {
+  if (state == 'a') {
+    if ((instruction & 0x0F000000) != 0x0A000000)
+      return -1;
+    return (int64_t)offset + 8 + ((int32_t)(instruction << 8) >> 6);
+  }
+  if (instruction >= 0xD000 && instruction < 0xDE00)
+    return (int64_t)offset + 4 + ((int8_t)(instruction & 0xFF) * 2);
+  if (instruction >= 0xE000 && instruction < 0xE800)
+    return (int64_t)offset + 4 + ((int32_t)(instruction << 21) >> 20);
+  return -1;
+}
+
+// Returns the size of the instruction at `p` and stores it
+// in `instruction`. A THUMB `bl` pair is read as its first half.
+static uint32_t decode(char state, const uint8_t* p, uint32_t remaining, uint32_t* instruction) {
+  if (state == 'a') {
+    *instruction = remaining >= 4 ? elf_read32(p) : 0;
+    return 4;
+  }
+  *instruction = elf_read16(p);
+  if ((*instruction & 0xF800) == 0xF000 && remaining >= 4 && (elf_read16(p + 2) & 0xF800) == 0xF800)
+    return 4;
+  return 2;
+}
+
+static int record_lines(const Annotation* records, int count, const ElfSymbol* function, LineCount** out) {
+  LineCount* lines = (LineCount*)malloc((count ? count : 1) * sizeof(LineCount));
+  int lineCount = 0, i;
+
+  for (i = 0; i < count; i++) {
+    if (records[i].function != function)
+      continue;
+    if (lineCount && lines[lineCount - 1].line == records[i].line) {
+      lines[lineCount - 1].count++;
+      continue;
+    }
+    lines[lineCount].line = records[i].line;
+    lines[lineCount].count = 1;
+    lineCount++;
+  }
+
+  qsort(lines, lineCount, sizeof(LineCount), compare_lines);
+  for (i = 1; i < lineCount; ) {
+    if (lines[i].line == lines[i - 1].line) {
+      lines[i - 1].count += lines[i].count;
+      memmove(&lines[i], &lines[i + 1], (lineCount - i - 1) * sizeof(LineCount));
+      lineCount--;
+    } else {
+      i++;
+    }
+  }
+
+  *out = lines;
+  return lineCount;
+}
+
+// Reads the opcode counts per source line of every function
+// in the reference object.
+static int read_reference(const char* path, FunctionLines** out) {
+  static ElfFile elf;
+  Annotation* records;
+  FunctionLines* functions;
+  int count, functionCount = 0, i, j;
+
+  if (elf_open(&elf, path) != 0)
+    return -1;
+
+  count = annotations_read(&elf, &records);
+  if (count < 0)
+    return -1;
+
+  functions = (FunctionLines*)calloc(count ? count : 1, sizeof(FunctionLines));
+  for (i = 0; i < count; i++) {
+    if (!records[i].function)
+      continue;
+    for (j = 0; j < functionCount; j++)
+      if (!strcmp(functions[j].name, records[i].function->name))
+        break;
+    if (j < functionCount)
+      continue;
+    functions[functionCount].name = records[i].function->name;
+    functions[functionCount].lineCount = record_lines(records, count, records[i].function, &functions[functionCount].lines);
+    functionCount++;
+  }
+
+  // `elf` stays open, the names point into it
+  free(records);
+  *out = functions;
+  return functionCount;
+}
+
+// Reports lines of `function` that have fewer opcodes than
+// in the reference. Returns the number of dropped opcodes.
+static int check_dropped(const Annotation* records, int count, const ElfSymbol* function,
+                         const FunctionLines* reference, int referenceCount) {
+  const FunctionLines* expected = NULL;
+  LineCount* lines;
+  int lineCount, dropped = 0, i, j = 0;
+
+  for (i = 0; i < referenceCount; i++)
+    if (!strcmp(reference[i].name, function->name))
+      expected = &reference[i];
+
+  if (!expected)
+    return 0;
+
+  lineCount = record_lines(records, count, function, &lines);
+  for (i = 0; i < expected->lineCount; i++) {
+    int found = 0;
+    while (j < lineCount && lines[j].line < expected->lines[i].line)
+      j++;
+    if (j < lineCount && lines[j].line == expected->lines[i].line)
+      found = lines[j].count;
+    if (found < expected->lines[i].count) {
+      printf("    line %5u  dropped    %d of %d opcodes\n", expected->lines[i].line, expected->lines[i].count - found, expected->lines[i].count);
+      dropped += expected->lines[i].count - found;
+    }
+  }
+
+  free(lines);
+  return dropped;
+}
+
+// Checks one function, whose records are `records[0..count)`
+// sorted by offset. Returns the number of problems found.
+static int check_function(const ElfFile* elf, const ElfSymbol* function, const Annotation* records, int count,
+                          const Annotation* all, int allCount, const FunctionLines* reference, int referenceCount) {
+  int section = function->shndx;
+  const uint8_t* data = elf_section_data(elf, section);
+  uint32_t start = (function->value & ~1u) - elf_section_base(elf, section);
+  uint32_t end = start + function->size, offset;
+  char fallback = (function->value & 1) ? 't' : 'a';
+  ElfMapping* mappings;
+  int mappingCount = elf_read_mappings(elf, section, &mappings);
+  uint8_t* targets = (uint8_t*)calloc(function->size / 2 + 1, 1);
+  int inserted = 0, reordered = 0, dropped = 0, instructions = 0, next = 0, previousLine = -1;
+
+  if (end > elf->sections[section].size)
+    end = elf->sections[section].size;
+
+  // Branch targets start new runs
+  for (offset = start; offset < end; ) {
+    char state = elf_state_at(mappings, mappingCount, offset, fallback);
+    uint32_t instruction, size;
+    int64_t target;
+    if (state == 'd') {
+      offset = elf_next_mapping(mappings, mappingCount, offset, end);
+      continue;
+    }
+    size = decode(state, data + offset, end - offset, &instruction);
+    target = branch_target(state, offset, instruction);
+    if (target >= start && target < end)
+      targets[(target - start) / 2] = 1;
+    offset += size;
+  }
+
+  printf("  %s:\n", function->name);
+
+  for (offset = start; offset < end; ) {
+    char state = elf_state_at(mappings, mappingCount, offset, fallback);
+    uint32_t instruction, size;
+    const Annotation* record = NULL;
+
+    if (state == 'd') {
+      uint32_t dataEnd = elf_next_mapping(mappings, mappingCount, offset, end);
+      if (verbose)
+        printf("    +0x%04X              data       %u bytes\n", offset - start, dataEnd - offset);
+      offset = dataEnd;
+      previousLine = -1;
+      continue;
+    }
+
+    size = decode(state, data + offset, end - offset, &instruction);
+    if (targets[(offset - start) / 2])
+      previousLine = -1;
+
+    while (next < count && records[next].offset < offset)
+      next++;
+    if (next < count && records[next].offset == offset)
+      record = &records[next++];
+
+    instructions++;
+    if (record) {
+      if (previousLine > (int)record->line) {
+        printf("    +0x%04X  line %5u  reordered  %-6s after line %d\n", offset - start, record->line, record->mnemonic, previousLine);
+        reordered++;
+      } else if (verbose) {
+        printf("    +0x%04X  line %5u  ok         %s\n", offset - start, record->line, record->mnemonic);
+      }
+      previousLine = record->line;
+    } else if (elf_is_padding(state, offset, instruction)) {
+      if (verbose)
+        printf("    +0x%04X              padding\n", offset - start);
+      instructions--;
+    } else {
+      if (state == 'a')
+        printf("    +0x%04X              inserted   %08X  ARM instruction\n", offset - start, instruction);
+      else
+        printf("    +0x%04X              inserted   %04X      %s\n", offset - start, instruction, describe_thumb((uint16_t)instruction));
+      inserted++;
+    }
+
+    if (is_branch(state, instruction))
+      previousLine = -1;
+    offset += size;
+  }
+
+  if (reference)
+    dropped = check_dropped(all, allCount, function, reference, referenceCount);
+
+  if (inserted || reordered || dropped)
+    printf("    %d instructions, %d inserted, %d reordered, %d dropped\n", instructions, inserted, reordered, dropped);
+  else
+    printf("    %d instructions, ok\n", instructions);
+
+  free(targets);
+  free(mappings);
+  return inserted + reordered + dropped;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: thumbverify [-r reference.o] [-v] file.o...\n");
+  exit(2);
+}
+
+static int verify_file(const char* path, const FunctionLines* reference, int referenceCount) {
+  ElfFile elf;
+  Annotation* records;
+  Annotation* sorted;
+  int count, problems = 0, i, j;
+
+  if (elf_open(&elf, path) != 0)
+    return 1;
+
+  count = annotations_read(&elf, &records);
+  if (count < 0) {
+    elf_close(&elf);
+    return 1;
+  }
+
+  sorted = (Annotation*)malloc((count ? count : 1) * sizeof(Annotation));
+  memcpy(sorted, records, count * sizeof(Annotation));
+  qsort(sorted, count, sizeof(Annotation), compare_records);
+
+  printf("%s:\n", path);
+
+  for (i = 0; i < count; ) {
+    const ElfSymbol* function = sorted[i].function;
+    for (j = i; j < count && sorted[j].function == function; j++)
+      ;
+    if (function)
+      problems += check_function(&elf, function, &sorted[i], j - i, records, count, reference, referenceCount);
+    i = j;
+  }
+
+  free(sorted);
+  free(records);
+  elf_close(&elf);
+  return problems != 0;
+}
+
+int main(int argc, char** argv) {
+  FunctionLines* reference = NULL;
+  int referenceCount = 0, status = 0, i;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+      referenceCount = read_reference(argv[++i], &reference);
+      if (referenceCount < 0)
+        return 2;
+    } else if (!strcmp(argv[i], "-v")) {
+      verbose = 1;
+    } else {
+      usage();
+    }
+  }
+
+  if (i == argc)
+    usage();
+
+  for (; i < argc; i++)
+    status |= verify_file(argv[i], reference, referenceCount);
+
+  return status;
+}